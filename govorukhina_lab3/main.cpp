@@ -1,74 +1,22 @@
 #include <iostream>
 #include <vector>
-#include <fstream>
 #include <string>
 #include <limits>
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
-#include <cctype>
 #include <chrono>
+#include <ctime>
+
+#include "pipeline_core/AutoSaver.h"
+#include "pipeline_core/Logger.h"
+#include "pipeline_core/PipelineCore.h"
+#include "pipeline_core/PipelineHistory.h"
 
 using namespace std;
 namespace fs = filesystem;
 
-struct Pipe {
-    int id;
-    string name;
-    double length;
-    int diameter;
-    bool underRepair;
-};
-
-struct CompressorStation {
-    int id;
-    string name;
-    int totalWorkshops;
-    int activeWorkshops;
-    int stationClass;
-};
-
-class Logger {
-private:
-    mutable ofstream logFile;
-    
-public:
-    Logger() {
-        logFile.open("pipeline_log.txt", ios::app);
-        if (logFile.is_open()) {
-            auto now = chrono::system_clock::now();
-            auto time = chrono::system_clock::to_time_t(now);
-            logFile << "\n=== Сессия начата: " << ctime(&time);
-        }
-    }
-    
-    ~Logger() {
-        if (logFile.is_open()) {
-            auto now = chrono::system_clock::now();
-            auto time = chrono::system_clock::to_time_t(now);
-            logFile << "=== Сессия завершена: " << ctime(&time) << endl;
-            logFile.close();
-        }
-    }
-    
-    void log(const string& action, const string& details = "") const {
-        if (logFile.is_open()) {
-            auto now = chrono::system_clock::now();
-            auto time = chrono::system_clock::to_time_t(now);
-            
-            char timeStr[20];
-            strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", localtime(&time));
-            
-            logFile << timeStr << " | " << action;
-            if (!details.empty()) {
-                logFile << " | " << details;
-            }
-            logFile << endl;
-        }
-    }
-};
-
 class InputValidator {
 public:
     static int getIntInput(const string& prompt, int min = numeric_limits<int>::min(),
@@ -141,37 +89,24 @@ public:
 
 class PipelineSystem {
 private:
-    vector<Pipe> pipes;
-    vector<CompressorStation> stations;
-    int nextPipeId = 1;
-    int nextStationId = 1;
+    PipelineCore core;
+    PipelineHistory history;
     Logger logger;
-
-    int findPipeIndexById(int id) const {
-        auto it = find_if(pipes.begin(), pipes.end(),
-                         [id](const Pipe& p) { return p.id == id; });
-        return it != pipes.end() ? distance(pipes.begin(), it) : -1;
-    }
-
-    int findStationIndexById(int id) const {
-        auto it = find_if(stations.begin(), stations.end(),
-                         [id](const CompressorStation& s) { return s.id == id; });
-        return it != stations.end() ? distance(stations.begin(), it) : -1;
-    }
+    AutoSaver autosaver{"autosave.txt", chrono::seconds(60), SaveFormat::Basic, &logger};
 
     vector<int> parseIndicesFromInput(const string& input, const vector<int>& validIds) const {
         if (input == "all" || input == "ALL") {
             vector<int> allIndices;
-            for (int i = 0; i < validIds.size(); ++i) {
-                allIndices.push_back(i);
+            for (size_t i = 0; i < validIds.size(); ++i) {
+                allIndices.push_back(static_cast<int>(i));
             }
             return allIndices;
         }
-        
+
         vector<int> indices;
         stringstream ss(input);
         string token;
-        
+
         while (getline(ss, token, ',')) {
             try {
                 int id = stoi(token);
@@ -185,7 +120,7 @@ private:
                 cout << "Предупреждение: '" << token << "' не является числом.\n";
             }
         }
-        
+
         sort(indices.begin(), indices.end());
         indices.erase(unique(indices.begin(), indices.end()), indices.end());
         return indices;
@@ -196,92 +131,12 @@ private:
             cout << "Нет доступных " << objectType << "!\n";
             return {};
         }
-        
+
         cout << "\nВыберите ID " << objectType << " через запятую или 'all' для всех: ";
         string input;
         getline(cin, input);
-        
-        return parseIndicesFromInput(input, validIds);
-    }
-
-    vector<int> getPipeIds() const {
-        vector<int> ids;
-        for (const auto& pipe : pipes) {
-            ids.push_back(pipe.id);
-        }
-        return ids;
-    }
-
-    vector<int> getStationIds() const {
-        vector<int> ids;
-        for (const auto& station : stations) {
-            ids.push_back(station.id);
-        }
-        return ids;
-    }
 
-    static string toLower(const string& str) {
-        string result = str;
-        transform(result.begin(), result.end(), result.begin(), ::tolower);
-        return result;
-    }
-
-    double calculateInactivePercent(const CompressorStation& station) const {
-        return station.totalWorkshops > 0 ?
-               100.0 * (station.totalWorkshops - station.activeWorkshops) / station.totalWorkshops : 0.0;
-    }
-
-    vector<int> findPipesByName(const string& searchName) const {
-        vector<int> result;
-        string searchLower = toLower(searchName);
-        
-        for (size_t i = 0; i < pipes.size(); ++i) {
-            if (toLower(pipes[i].name).find(searchLower) != string::npos) {
-                result.push_back(i);
-            }
-        }
-        return result;
-    }
-
-    vector<int> findPipesByRepairStatus(bool repairStatus) const {
-        vector<int> result;
-        for (size_t i = 0; i < pipes.size(); ++i) {
-            if (pipes[i].underRepair == repairStatus) {
-                result.push_back(i);
-            }
-        }
-        return result;
-    }
-
-    vector<int> findStationsByName(const string& searchName) const {
-        vector<int> result;
-        string searchLower = toLower(searchName);
-        
-        for (size_t i = 0; i < stations.size(); ++i) {
-            if (toLower(stations[i].name).find(searchLower) != string::npos) {
-                result.push_back(i);
-            }
-        }
-        return result;
-    }
-
-    vector<int> findStationsByInactivePercent(double targetPercent, int comparisonType) const {
-        vector<int> result;
-        for (size_t i = 0; i < stations.size(); ++i) {
-            double inactivePercent = calculateInactivePercent(stations[i]);
-            bool match = false;
-            
-            switch (comparisonType) {
-                case 1: match = (inactivePercent > targetPercent); break;
-                case 2: match = (inactivePercent < targetPercent); break;
-                case 3: match = (abs(inactivePercent - targetPercent) < 0.01); break;
-            }
-            
-            if (match) {
-                result.push_back(i);
-            }
-        }
-        return result;
+        return parseIndicesFromInput(input, validIds);
     }
 
     void displayObjects(const vector<int>& pipeIndices, const vector<int>& stationIndices) const {
@@ -289,11 +144,11 @@ private:
             cout << "Нет объектов для отображения.\n";
             return;
         }
-        
+
         if (!pipeIndices.empty()) {
             cout << "\nТрубы (" << pipeIndices.size() << ")\n";
             for (int index : pipeIndices) {
-                const Pipe& pipe = pipes[index];
+                const Pipe& pipe = core.getPipes()[index];
                 cout << "ID: " << pipe.id << " | " << pipe.name
                      << ", Длина: " << pipe.length << " км"
                      << ", Диаметр: " << pipe.diameter << " мм"
@@ -304,8 +159,8 @@ private:
         if (!stationIndices.empty()) {
             cout << "\nКС (" << stationIndices.size() << ")\n";
             for (int index : stationIndices) {
-                const CompressorStation& station = stations[index];
-                double inactivePercent = calculateInactivePercent(station);
+                const CompressorStation& station = core.getStations()[index];
+                double inactivePercent = PipelineCore::calculateInactivePercent(station);
                 cout << "ID: " << station.id << " | " << station.name
                      << ", Цехов: " << station.totalWorkshops
                      << ", Работает: " << station.activeWorkshops
@@ -317,30 +172,24 @@ private:
 
 public:
     void addPipe() {
-        Pipe newPipe;
-        newPipe.id = nextPipeId++;
-        newPipe.name = InputValidator::getStringInput("Введите название трубы: ");
-        newPipe.length = InputValidator::getDoubleInput("Введите длину трубы (км): ", 0.001);
-        newPipe.diameter = InputValidator::getIntInput("Введите диаметр трубы (мм): ", 1);
-        newPipe.underRepair = false;
-        
-        pipes.push_back(newPipe);
-        cout << "Труба '" << newPipe.name << "' добавлена с ID: " << newPipe.id << "!\n";
-        logger.log("Добавлена труба", "ID: " + to_string(newPipe.id) + ", Название: " + newPipe.name);
+        string name = InputValidator::getStringInput("Введите название трубы: ");
+        double length = InputValidator::getDoubleInput("Введите длину трубы (км): ", 0.001);
+        int diameter = InputValidator::getIntInput("Введите диаметр трубы (мм): ", 1);
+
+        int id = core.addPipe(name, length, diameter);
+        cout << "Труба '" << name << "' добавлена с ID: " << id << "!\n";
+        logger.log("Добавлена труба", "ID: " + to_string(id) + ", Название: " + name);
     }
 
     void addStation() {
-        CompressorStation newStation;
-        newStation.id = nextStationId++;
-        newStation.name = InputValidator::getStringInput("Введите название КС: ");
-        newStation.totalWorkshops = InputValidator::getIntInput("Введите количество цехов: ", 1);
-        newStation.activeWorkshops = InputValidator::getIntInput("Введите работающих цехов: ",
-                                                               0, newStation.totalWorkshops);
-        newStation.stationClass = InputValidator::getIntInput("Введите класс станции: ", 1);
-        
-        stations.push_back(newStation);
-        cout << "КС '" << newStation.name << "' добавлена с ID: " << newStation.id << "!\n";
-        logger.log("Добавлена КС", "ID: " + to_string(newStation.id) + ", Название: " + newStation.name);
+        string name = InputValidator::getStringInput("Введите название КС: ");
+        int totalWorkshops = InputValidator::getIntInput("Введите количество цехов: ", 1);
+        int activeWorkshops = InputValidator::getIntInput("Введите работающих цехов: ", 0, totalWorkshops);
+        int stationClass = InputValidator::getIntInput("Введите класс станции: ", 1);
+
+        int id = core.addStation(name, totalWorkshops, activeWorkshops, stationClass);
+        cout << "КС '" << name << "' добавлена с ID: " << id << "!\n";
+        logger.log("Добавлена КС", "ID: " + to_string(id) + ", Название: " + name);
     }
 
     void addMultipleObjects(bool isPipe) {
@@ -349,167 +198,170 @@ public:
             cout << "\n" << (isPipe ? "Добавление трубы " : "Добавление КС ") << (i + 1) << " из " << count << "\n";
             isPipe ? addPipe() : addStation();
         }
-        cout << "Добавлено " << count << (isPipe ? " труб" : " КС") << ". Всего: " << (isPipe ? pipes.size() : stations.size()) << "\n";
+        cout << "Добавлено " << count << (isPipe ? " труб" : " КС") << ". Всего: " << (isPipe ? core.getPipes().size() : core.getStations().size()) << "\n";
     }
 
     void deleteObjects(bool isPipe) {
         vector<int> indices = isPipe ?
-            selectMultipleObjects(getPipeIds(), "труб") :
-            selectMultipleObjects(getStationIds(), "КС");
-            
+            selectMultipleObjects(core.getPipeIds(), "труб") :
+            selectMultipleObjects(core.getStationIds(), "КС");
+
         if (indices.empty()) return;
-        
+
         sort(indices.rbegin(), indices.rend());
         int count = 0;
-        
+
         for (int index : indices) {
             if (isPipe) {
-                cout << "Удалена труба: " << pipes[index].name << " (ID: " << pipes[index].id << ")\n";
-                logger.log("Удалена труба", "ID: " + to_string(pipes[index].id) + ", Название: " + pipes[index].name);
-                pipes.erase(pipes.begin() + index);
+                Pipe pipe = core.getPipes()[index];
+                core.removePipe(pipe.id);
+                cout << "Удалена труба: " << pipe.name << " (ID: " << pipe.id << ")\n";
+                logger.log("Удалена труба", "ID: " + to_string(pipe.id) + ", Название: " + pipe.name.str());
             } else {
-                cout << "Удалена КС: " << stations[index].name << " (ID: " << stations[index].id << ")\n";
-                logger.log("Удалена КС", "ID: " + to_string(stations[index].id) + ", Название: " + stations[index].name);
-                stations.erase(stations.begin() + index);
+                CompressorStation station = core.getStations()[index];
+                core.removeStation(station.id);
+                cout << "Удалена КС: " << station.name << " (ID: " << station.id << ")\n";
+                logger.log("Удалена КС", "ID: " + to_string(station.id) + ", Название: " + station.name.str());
             }
             count++;
         }
-        
-        cout << "Удалено " << count << (isPipe ? " труб" : " КС") << ". Осталось: " << (isPipe ? pipes.size() : stations.size()) << "\n";
+
+        cout << "Удалено " << count << (isPipe ? " труб" : " КС") << ". Осталось: " << (isPipe ? core.getPipes().size() : core.getStations().size()) << "\n";
     }
 
     void editPipe() {
-        if (pipes.empty()) {
+        if (core.getPipes().empty()) {
             cout << "Нет доступных труб!\n";
             return;
         }
-        
+
         viewAll();
         int id = InputValidator::getIntInput("Введите ID трубы для редактирования: ", 1);
-        int index = findPipeIndexById(id);
-        
+        int index = core.findPipeIndexById(id);
+
         if (index == -1) {
             cout << "Труба с ID " << id << " не найдена!\n";
             return;
         }
-        
-        cout << "Редактирование трубы ID: " << pipes[index].id << " - " << pipes[index].name << endl;
+
+        const Pipe& pipe = core.getPipes()[index];
+        cout << "Редактирование трубы ID: " << pipe.id << " - " << pipe.name << endl;
         cout << "1. Изменить статус ремонта\n2. Редактировать параметры\n";
         int choice = InputValidator::getIntInput("Выберите действие: ", 1, 2);
-        
+
         if (choice == 1) {
-            pipes[index].underRepair = !pipes[index].underRepair;
-            string status = pipes[index].underRepair ? "В ремонте" : "Работает";
+            bool underRepair = !pipe.underRepair;
+            core.setPipeRepair(id, underRepair);
+            string status = underRepair ? "В ремонте" : "Работает";
             cout << "Статус ремонта изменен на: " << status << endl;
-            logger.log("Изменен статус трубы", "ID: " + to_string(pipes[index].id) + ", Статус: " + status);
+            logger.log("Изменен статус трубы", "ID: " + to_string(id) + ", Статус: " + status);
         } else {
-            pipes[index].name = InputValidator::getStringInput("Введите новое название трубы: ");
-            pipes[index].length = InputValidator::getDoubleInput("Введите новую длину трубы (км): ", 0.001);
-            pipes[index].diameter = InputValidator::getIntInput("Введите новый диаметр трубы (мм): ", 1);
+            string name = InputValidator::getStringInput("Введите новое название трубы: ");
+            double length = InputValidator::getDoubleInput("Введите новую длину трубы (км): ", 0.001);
+            int diameter = InputValidator::getIntInput("Введите новый диаметр трубы (мм): ", 1);
+            core.updatePipe(id, name, length);
+            core.setPipeDiameter(id, diameter);
             cout << "Параметры трубы обновлены!\n";
-            logger.log("Обновлена труба", "ID: " + to_string(pipes[index].id) + ", Новое название: " + pipes[index].name);
+            logger.log("Обновлена труба", "ID: " + to_string(id) + ", Новое название: " + name);
         }
     }
 
     void editStation() {
-        if (stations.empty()) {
+        if (core.getStations().empty()) {
             cout << "Нет доступных КС!\n";
             return;
         }
-        
+
         viewAll();
         int id = InputValidator::getIntInput("Введите ID КС для редактирования: ", 1);
-        int index = findStationIndexById(id);
-        
+        int index = core.findStationIndexById(id);
+
         if (index == -1) {
             cout << "КС с ID " << id << " не найдена!\n";
             return;
         }
-        
-        cout << "Редактирование КС ID: " << stations[index].id << " - " << stations[index].name << endl;
+
+        const CompressorStation& station = core.getStations()[index];
+        cout << "Редактирование КС ID: " << station.id << " - " << station.name << endl;
         cout << "1. Запустить/остановить цех\n2. Редактировать параметры\n";
         int choice = InputValidator::getIntInput("Выберите действие: ", 1, 2);
-        
+
         if (choice == 1) {
-            cout << "Текущее состояние: " << stations[index].activeWorkshops
-                 << "/" << stations[index].totalWorkshops << " цехов работает\n";
+            cout << "Текущее состояние: " << station.activeWorkshops
+                 << "/" << station.totalWorkshops << " цехов работает\n";
             cout << "1. Запустить цех\n2. Остановить цех\n";
             int action = InputValidator::getIntInput("Выберите действие: ", 1, 2);
-            
-            if (action == 1 && stations[index].activeWorkshops < stations[index].totalWorkshops) {
-                stations[index].activeWorkshops++;
-                cout << "Цех запущен! Работает цехов: " << stations[index].activeWorkshops << endl;
-                logger.log("Запущен цех КС", "ID: " + to_string(stations[index].id) + ", Работает цехов: " + to_string(stations[index].activeWorkshops));
-            } else if (action == 2 && stations[index].activeWorkshops > 0) {
-                stations[index].activeWorkshops--;
-                cout << "Цех остановлен! Работает цехов: " << stations[index].activeWorkshops << endl;
-                logger.log("Остановлен цех КС", "ID: " + to_string(stations[index].id) + ", Работает цехов: " + to_string(stations[index].activeWorkshops));
+
+            if (action == 1 && core.startWorkshop(id)) {
+                int active = core.getStations()[index].activeWorkshops;
+                cout << "Цех запущен! Работает цехов: " << active << endl;
+                logger.log("Запущен цех КС", "ID: " + to_string(id) + ", Работает цехов: " + to_string(active));
+            } else if (action == 2 && core.stopWorkshop(id)) {
+                int active = core.getStations()[index].activeWorkshops;
+                cout << "Цех остановлен! Работает цехов: " << active << endl;
+                logger.log("Остановлен цех КС", "ID: " + to_string(id) + ", Работает цехов: " + to_string(active));
             } else {
                 cout << "Невозможно выполнить операцию!\n";
             }
         } else {
-            stations[index].name = InputValidator::getStringInput("Введите новое название КС: ");
+            string name = InputValidator::getStringInput("Введите новое название КС: ");
             int newTotal = InputValidator::getIntInput("Введите новое количество цехов: ", 1);
-            
-            if (newTotal < stations[index].activeWorkshops) {
-                stations[index].activeWorkshops = newTotal;
-            }
-            stations[index].totalWorkshops = newTotal;
-            stations[index].stationClass = InputValidator::getIntInput("Введите новый класс станции: ", 1);
-            
+            int stationClass = InputValidator::getIntInput("Введите новый класс станции: ", 1);
+            core.updateStation(id, name, newTotal, stationClass);
+
             cout << "Параметры КС обновлены!\n";
-            logger.log("Обновлена КС", "ID: " + to_string(stations[index].id) + ", Новое название: " + stations[index].name);
+            logger.log("Обновлена КС", "ID: " + to_string(id) + ", Новое название: " + name);
         }
     }
 
     void searchPipes() {
-        if (pipes.empty()) {
+        if (core.getPipes().empty()) {
             cout << "Нет доступных труб для поиска!\n";
             return;
         }
-        
+
         cout << "\nПоиск труб\n";
         cout << "1. По названию\n";
         cout << "2. По признаку 'в ремонте'\n";
         int choice = InputValidator::getIntInput("Выберите тип поиска: ", 1, 2);
-        
+
         vector<int> results;
         string searchDetails;
-        
+
         if (choice == 1) {
             string searchName = InputValidator::getStringInput("Введите название для поиска: ");
-            results = findPipesByName(searchName);
+            results = core.findPipesByName(searchName);
             searchDetails = "Поиск по названию: " + searchName;
         } else {
             cout << "1. Трубы в ремонте\n";
             cout << "2. Трубы не в ремонте\n";
             int repairChoice = InputValidator::getIntInput("Выберите статус: ", 1, 2);
             bool searchRepairStatus = (repairChoice == 1);
-            results = findPipesByRepairStatus(searchRepairStatus);
+            results = core.findPipesByRepairStatus(searchRepairStatus);
             searchDetails = "Поиск по статусу ремонта: " + string(searchRepairStatus ? "в ремонте" : "не в ремонте");
         }
-        
+
         displayObjects(results, {});
         logger.log("Поиск труб", searchDetails + ", Найдено: " + to_string(results.size()));
     }
 
     void searchStations() {
-        if (stations.empty()) {
+        if (core.getStations().empty()) {
             cout << "Нет доступных КС для поиска!\n";
             return;
         }
-        
+
         cout << "\nПоиск КС\n";
         cout << "1. По названию\n";
         cout << "2. По проценту незадействованных цехов\n";
         int choice = InputValidator::getIntInput("Выберите тип поиска: ", 1, 2);
-        
+
         vector<int> results;
         string searchDetails;
-        
+
         if (choice == 1) {
             string searchName = InputValidator::getStringInput("Введите название для поиска: ");
-            results = findStationsByName(searchName);
+            results = core.findStationsByName(searchName);
             searchDetails = "Поиск по названию: " + searchName;
         } else {
             cout << "1. КС с процентом незадействованных цехов БОЛЬШЕ заданного\n";
@@ -517,18 +369,18 @@ public:
             cout << "3. КС с процентом незадействованных цехов РАВНЫМ заданному\n";
             int percentChoice = InputValidator::getIntInput("Выберите тип сравнения: ", 1, 3);
             double targetPercent = InputValidator::getDoubleInput("Введите процент незадействованных цехов (0-100): ", 0, 100);
-            results = findStationsByInactivePercent(targetPercent, percentChoice);
+            results = core.findStationsByInactivePercent(targetPercent, percentChoice);
             searchDetails = "Поиск по проценту: " + to_string(targetPercent) + "%, Тип: " + to_string(percentChoice);
         }
-        
+
         displayObjects({}, results);
         logger.log("Поиск КС", searchDetails + ", Найдено: " + to_string(results.size()));
     }
 
     void viewAll() const {
         vector<int> allPipeIndices, allStationIndices;
-        for (int i = 0; i < pipes.size(); ++i) allPipeIndices.push_back(i);
-        for (int i = 0; i < stations.size(); ++i) allStationIndices.push_back(i);
+        for (size_t i = 0; i < core.getPipes().size(); ++i) allPipeIndices.push_back(static_cast<int>(i));
+        for (size_t i = 0; i < core.getStations().size(); ++i) allStationIndices.push_back(static_cast<int>(i));
         displayObjects(allPipeIndices, allStationIndices);
     }
 
@@ -537,100 +389,73 @@ public:
         if (filename.find('.') == string::npos) {
             filename += ".txt";
         }
-        
-        ofstream file(filename);
-        if (!file.is_open()) {
+
+        if (!core.saveToFile(filename, SaveFormat::Basic)) {
             cout << "Ошибка: невозможно создать файл " << filename << endl;
             return;
         }
-        
-        file << "NEXT_PIPE_ID " << nextPipeId << endl;
-        file << "NEXT_STATION_ID " << nextStationId << endl;
-        
-        file << "PIPES " << pipes.size() << endl;
-        for (const auto& pipe : pipes) {
-            file << pipe.id << endl << pipe.name << endl << pipe.length << endl
-                 << pipe.diameter << endl << pipe.underRepair << endl;
-        }
-        
-        file << "STATIONS " << stations.size() << endl;
-        for (const auto& station : stations) {
-            file << station.id << endl << station.name << endl << station.totalWorkshops << endl
-                 << station.activeWorkshops << endl << station.stationClass << endl;
-        }
-        
-        file.close();
+
         cout << "Данные сохранены в файл: " << fs::absolute(filename) << endl;
-        logger.log("Сохранение данных", "Файл: " + filename + ", Трубы: " + to_string(pipes.size()) + ", КС: " + to_string(stations.size()));
+        logger.log("Сохранение данных", "Файл: " + filename + ", Трубы: " + to_string(core.getPipes().size()) + ", КС: " + to_string(core.getStations().size()));
     }
 
     void loadData() {
         string filename = InputValidator::getStringInput("Введите имя файла для загрузки: ");
-        
-        ifstream file(filename);
-        if (!file.is_open()) {
-            cout << "Ошибка: файл " << filename << " не найден.\n";
-            return;
+
+        switch (core.loadFromFile(filename, SaveFormat::Basic)) {
+            case LoadStatus::FileNotFound:
+                cout << "Ошибка: файл " << filename << " не найден.\n";
+                return;
+            case LoadStatus::BadFormat:
+                cout << "Ошибка: неверный формат файла.\n";
+                return;
+            case LoadStatus::Ok:
+                break;
         }
-        
-        pipes.clear();
-        stations.clear();
-        
-        string header;
-        size_t count;
-        
-        file >> header >> nextPipeId;
-        if (header != "NEXT_PIPE_ID") {
-            file.seekg(0);
-            nextPipeId = 1;
-            nextStationId = 1;
-        } else {
-            file >> header >> nextStationId;
+
+        cout << "Данные загружены из файла: " << fs::absolute(filename) << endl;
+        cout << "Загружено труб: " << core.getPipes().size() << ", КС: " << core.getStations().size() << endl;
+        logger.log("Загрузка данных", "Файл: " + filename + ", Трубы: " + to_string(core.getPipes().size()) + ", КС: " + to_string(core.getStations().size()));
+    }
+
+    void undoChange() {
+        if (!history.undo(core)) {
+            cout << "Нет действий для отмены.\n";
+            return;
         }
-        
-        file >> header >> count;
-        if (header != "PIPES") {
-            cout << "Ошибка: неверный формат файла.\n";
+        autosaver.update(core);
+        cout << "Последнее изменение отменено. Доступно отмен: " << history.undoDepth() << "\n";
+        logger.log("Отмена изменения", "Доступно отмен: " + to_string(history.undoDepth()));
+    }
+
+    void redoChange() {
+        if (!history.redo(core)) {
+            cout << "Нет отмененных действий для повтора.\n";
             return;
         }
-        file.ignore();
-        
-        for (size_t i = 0; i < count; ++i) {
-            Pipe pipe;
-            file >> pipe.id;
-            file.ignore();
-            getline(file, pipe.name);
-            file >> pipe.length >> pipe.diameter >> pipe.underRepair;
-            file.ignore();
-            pipes.push_back(pipe);
+        autosaver.update(core);
+        cout << "Отмененное изменение восстановлено. Доступно повторов: " << history.redoDepth() << "\n";
+        logger.log("Повтор изменения", "Доступно повторов: " + to_string(history.redoDepth()));
+    }
+
+    void showAutoSaveStatus() const {
+        AutoSaveStatus status = autosaver.getStatus();
+        cout << "\nАвтосохранение в файл " << autosaver.getFilename()
+             << " каждые " << autosaver.getInterval().count() << " с\n";
+
+        if (status.inProgress) {
+            cout << "Идет сохранение: записано " << status.written << " из " << status.total << " объектов\n";
         }
-        
-        file >> header >> count;
-        if (header != "STATIONS") {
-            cout << "Ошибка: неверный формат файла.\n";
-            return;
+        cout << "Выполнено автосохранений: " << status.savesCompleted << endl;
+        if (status.savesCompleted > 0) {
+            time_t time = chrono::system_clock::to_time_t(status.lastSaveTime);
+            tm localTime{};
+            localtime_r(&time, &localTime);
+            cout << "Последнее автосохранение: " << put_time(&localTime, "%Y-%m-%d %H:%M:%S") << endl;
         }
-        file.ignore();
-        
-        for (size_t i = 0; i < count; ++i) {
-            CompressorStation station;
-            file >> station.id;
-            file.ignore();
-            getline(file, station.name);
-            file >> station.totalWorkshops >> station.activeWorkshops >> station.stationClass;
-            file.ignore();
-            
-            if (station.activeWorkshops > station.totalWorkshops) {
-                station.activeWorkshops = station.totalWorkshops;
-            }
-            
-            stations.push_back(station);
+        if (status.lastSaveFailed) {
+            cout << "Ошибка: последнее автосохранение не удалось, предыдущий файл сохранен без изменений!\n";
         }
-        
-        file.close();
-        cout << "Данные загружены из файла: " << fs::absolute(filename) << endl;
-        cout << "Загружено труб: " << pipes.size() << ", КС: " << stations.size() << endl;
-        logger.log("Загрузка данных", "Файл: " + filename + ", Трубы: " + to_string(pipes.size()) + ", КС: " + to_string(stations.size()));
     }
 
     void run() {
@@ -641,11 +466,16 @@ public:
                  << "1. Добавить трубу\n2. Добавить КС\n3. Добавить несколько труб\n4. Добавить несколько КС\n"
                  << "5. Просмотр всех объектов\n6. Редактировать трубу\n7. Редактировать КС\n"
                  << "8. Удалить трубу\n9. Удалить КС\n10. Удалить несколько труб\n11. Удалить несколько КС\n"
-                 << "12. Поиск труб\n13. Поиск КС\n14. Сохранить данные\n15. Загрузить данные\n0. Выход\n";
+                 << "12. Поиск труб\n13. Поиск КС\n14. Сохранить данные\n15. Загрузить данные\n"
+                 << "16. Отменить последнее изменение\n17. Повторить отмененное изменение\n"
+                 << "18. Состояние автосохранения\n0. Выход\n";
             
-            int choice = InputValidator::getIntInput("Выберите действие: ", 0, 15);
+            int choice = InputValidator::getIntInput("Выберите действие: ", 0, 18);
             logger.log("Выбор меню", "Действие: " + to_string(choice));
-            
+
+            // Снимок до операции создается за O(1) и нужен для отмены
+            PipelineCore before = core;
+
             switch (choice) {
                 case 1: addPipe(); break;
                 case 2: addStation(); break;
@@ -662,11 +492,17 @@ public:
                 case 13: searchStations(); break;
                 case 14: saveData(); break;
                 case 15: loadData(); break;
+                case 16: undoChange(); continue;
+                case 17: redoChange(); continue;
+                case 18: showAutoSaveStatus(); break;
                 case 0:
                     cout << "Выход из программы.\n";
                     logger.log("Выход из программы");
                     return;
             }
+            if (history.commit(before, core)) {
+                autosaver.update(core);
+            }
         }
     }
 };
@@ -1,131 +1,25 @@
 #include <iostream>
 #include <vector>
-#include <fstream>
 #include <string>
 #include <limits>
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
-#include <cctype>
 #include <chrono>
-#include <map>
-#include <set>
-#include <queue>
+#include <ctime>
+
+#include "pipeline_core/AutoSaver.h"
+#include "pipeline_core/Logger.h"
+#include "pipeline_core/OperationMetrics.h"
+#include "pipeline_core/PipelineCore.h"
+#include "pipeline_core/PipelineHistory.h"
+#include "pipeline_core/PipeIndex.h"
+#include "pipeline_core/Tracing.h"
 
 using namespace std;
 namespace fs = filesystem;
 
-// Перечисление для типов соединений
-enum ConnectionType {
-    STATION_TO_STATION,
-    STATION_TO_PIPE,
-    PIPE_TO_STATION,
-    PIPE_TO_PIPE
-};
-
-// Оператор вывода для ConnectionType
-ostream& operator<<(ostream& os, const ConnectionType& type) {
-    switch (type) {
-        case STATION_TO_STATION: os << "0"; break;
-        case STATION_TO_PIPE: os << "1"; break;
-        case PIPE_TO_STATION: os << "2"; break;
-        case PIPE_TO_PIPE: os << "3"; break;
-    }
-    return os;
-}
-
-// Оператор ввода для ConnectionType
-istream& operator>>(istream& is, ConnectionType& type) {
-    int value;
-    is >> value;
-    switch (value) {
-        case 0: type = STATION_TO_STATION; break;
-        case 1: type = STATION_TO_PIPE; break;
-        case 2: type = PIPE_TO_STATION; break;
-        case 3: type = PIPE_TO_PIPE; break;
-        default: type = STATION_TO_STATION; break;
-    }
-    return is;
-}
-
-struct Pipe {
-    int id;
-    string name;
-    double length;
-    int diameter;
-    bool underRepair;
-    bool inUse;  // используется ли в сети
-    int startId;  // ID начальной точки (КС или трубы)
-    int endId;   // ID конечной точки (КС или трубы)
-    ConnectionType startType;  // тип начальной точки
-    ConnectionType endType;    // тип конечной точки
-};
-
-struct CompressorStation {
-    int id;
-    string name;
-    int totalWorkshops;
-    int activeWorkshops;
-    int stationClass;
-};
-
-// Структура для представления связи в сети
-struct NetworkConnection {
-    int pipeId;
-    int startId;
-    int endId;
-    ConnectionType startType;
-    ConnectionType endType;
-};
-
-// Структура для графа
-struct GraphNode {
-    int id;
-    bool isStation;  // true - КС, false - труба
-    vector<pair<int, int>> connections; // пары (id соседа, id трубы)
-};
-
-class Logger {
-private:
-    mutable ofstream logFile;
-    
-public:
-    Logger() {
-        logFile.open("pipeline_log.txt", ios::app);
-        if (logFile.is_open()) {
-            auto now = chrono::system_clock::now();
-            auto time = chrono::system_clock::to_time_t(now);
-            logFile << "\n=== Сессия начата: " << ctime(&time);
-        }
-    }
-    
-    ~Logger() {
-        if (logFile.is_open()) {
-            auto now = chrono::system_clock::now();
-            auto time = chrono::system_clock::to_time_t(now);
-            logFile << "=== Сессия завершена: " << ctime(&time) << endl;
-            logFile.close();
-        }
-    }
-    
-    void log(const string& action, const string& details = "") const {
-        if (logFile.is_open()) {
-            auto now = chrono::system_clock::now();
-            auto time = chrono::system_clock::to_time_t(now);
-            
-            char timeStr[20];
-            strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", localtime(&time));
-            
-            logFile << timeStr << " | " << action;
-            if (!details.empty()) {
-                logFile << " | " << details;
-            }
-            logFile << endl;
-        }
-    }
-};
-
 class InputValidator {
 public:
     static int getIntInput(const string& prompt, int min = numeric_limits<int>::min(),
@@ -196,7 +90,6 @@ public:
     }
 
     static int getDiameterInput(const string& prompt) {
-        vector<int> allowedDiameters = {500, 700, 1000, 1400};
         while (true) {
             cout << prompt << " (500, 700, 1000, 1400 мм): ";
             string input;
@@ -209,10 +102,8 @@ public:
             
             try {
                 int diameter = stoi(input);
-                for (int d : allowedDiameters) {
-                    if (d == diameter) {
-                        return diameter;
-                    }
+                if (PipelineCore::isAllowedDiameter(diameter)) {
+                    return diameter;
                 }
                 cout << "Ошибка: допустимые диаметры: 500, 700, 1000, 1400 мм\n";
             } catch (const exception&) {
@@ -224,38 +115,25 @@ public:
 
 class PipelineSystem {
 private:
-    vector<Pipe> pipes;
-    vector<CompressorStation> stations;
-    vector<NetworkConnection> network;
-    int nextPipeId = 1;
-    int nextStationId = 1;
+    PipelineCore core;
+    PipelineHistory history;
     Logger logger;
-
-    int findPipeIndexById(int id) const {
-        auto it = find_if(pipes.begin(), pipes.end(),
-                         [id](const Pipe& p) { return p.id == id; });
-        return it != pipes.end() ? distance(pipes.begin(), it) : -1;
-    }
-
-    int findStationIndexById(int id) const {
-        auto it = find_if(stations.begin(), stations.end(),
-                         [id](const CompressorStation& s) { return s.id == id; });
-        return it != stations.end() ? distance(stations.begin(), it) : -1;
-    }
+    AutoSaver autosaver{"autosave.txt", chrono::seconds(60), SaveFormat::Network, &logger};
+    bool damageReported = false;  // о поврежденной секции ленивого снимка уже сообщено
 
     vector<int> parseIndicesFromInput(const string& input, const vector<int>& validIds) const {
         if (input == "all" || input == "ALL") {
             vector<int> allIndices;
-            for (int i = 0; i < validIds.size(); ++i) {
-                allIndices.push_back(i);
+            for (size_t i = 0; i < validIds.size(); ++i) {
+                allIndices.push_back(static_cast<int>(i));
             }
             return allIndices;
         }
-        
+
         vector<int> indices;
         stringstream ss(input);
         string token;
-        
+
         while (getline(ss, token, ',')) {
             try {
                 int id = stoi(token);
@@ -269,7 +147,7 @@ private:
                 cout << "Предупреждение: '" << token << "' не является числом.\n";
             }
         }
-        
+
         sort(indices.begin(), indices.end());
         indices.erase(unique(indices.begin(), indices.end()), indices.end());
         return indices;
@@ -280,92 +158,16 @@ private:
             cout << "Нет доступных " << objectType << "!\n";
             return {};
         }
-        
+
         cout << "\nВыберите ID " << objectType << " через запятую или 'all' для всех: ";
         string input;
         getline(cin, input);
-        
-        return parseIndicesFromInput(input, validIds);
-    }
-
-    vector<int> getPipeIds() const {
-        vector<int> ids;
-        for (const auto& pipe : pipes) {
-            ids.push_back(pipe.id);
-        }
-        return ids;
-    }
-
-    vector<int> getStationIds() const {
-        vector<int> ids;
-        for (const auto& station : stations) {
-            ids.push_back(station.id);
-        }
-        return ids;
-    }
-
-    static string toLower(const string& str) {
-        string result = str;
-        transform(result.begin(), result.end(), result.begin(), ::tolower);
-        return result;
-    }
-
-    double calculateInactivePercent(const CompressorStation& station) const {
-        return station.totalWorkshops > 0 ?
-               100.0 * (station.totalWorkshops - station.activeWorkshops) / station.totalWorkshops : 0.0;
-    }
-
-    vector<int> findPipesByName(const string& searchName) const {
-        vector<int> result;
-        string searchLower = toLower(searchName);
-        
-        for (size_t i = 0; i < pipes.size(); ++i) {
-            if (toLower(pipes[i].name).find(searchLower) != string::npos) {
-                result.push_back(i);
-            }
-        }
-        return result;
-    }
-
-    vector<int> findPipesByRepairStatus(bool repairStatus) const {
-        vector<int> result;
-        for (size_t i = 0; i < pipes.size(); ++i) {
-            if (pipes[i].underRepair == repairStatus) {
-                result.push_back(i);
-            }
-        }
-        return result;
-    }
 
-    vector<int> findStationsByName(const string& searchName) const {
-        vector<int> result;
-        string searchLower = toLower(searchName);
-        
-        for (size_t i = 0; i < stations.size(); ++i) {
-            if (toLower(stations[i].name).find(searchLower) != string::npos) {
-                result.push_back(i);
-            }
-        }
-        return result;
+        return parseIndicesFromInput(input, validIds);
     }
 
-    vector<int> findStationsByInactivePercent(double targetPercent, int comparisonType) const {
-        vector<int> result;
-        for (size_t i = 0; i < stations.size(); ++i) {
-            double inactivePercent = calculateInactivePercent(stations[i]);
-            bool match = false;
-            
-            switch (comparisonType) {
-                case 1: match = (inactivePercent > targetPercent); break;
-                case 2: match = (inactivePercent < targetPercent); break;
-                case 3: match = (abs(inactivePercent - targetPercent) < 0.01); break;
-            }
-            
-            if (match) {
-                result.push_back(i);
-            }
-        }
-        return result;
+    static string endpointLabel(bool isStation, int id) {
+        return (isStation ? "КС" : "Тр") + to_string(id);
     }
 
     void displayObjects(const vector<int>& pipeIndices, const vector<int>& stationIndices) const {
@@ -373,7 +175,10 @@ private:
             cout << "Нет объектов для отображения.\n";
             return;
         }
-        
+
+        const auto& pipes = core.getPipes();
+        const auto& stations = core.getStations();
+
         if (!pipeIndices.empty()) {
             cout << "\nТрубы (" << pipeIndices.size() << ")\n";
             cout << "ID | Название | Длина | Диаметр | В ремонте | В сети | Начало -> Конец\n";
@@ -381,28 +186,17 @@ private:
             for (int index : pipeIndices) {
                 const Pipe& pipe = pipes[index];
                 cout << setw(3) << pipe.id << " | "
-                     << setw(10) << left << (pipe.name.length() > 10 ? pipe.name.substr(0, 7) + "..." : pipe.name) << " | "
+                     << setw(10) << left << (pipe.name.length() > 10 ? pipe.name.str().substr(0, 7) + "..." : pipe.name.str()) << " | "
                      << setw(6) << fixed << setprecision(2) << pipe.length << " | "
                      << setw(7) << pipe.diameter << " | "
                      << setw(10) << (pipe.underRepair ? "Да" : "Нет") << " | "
                      << setw(6) << (pipe.inUse ? "Да" : "Нет") << " | ";
-                
+
                 if (pipe.inUse) {
-                    string startStr, endStr;
-                    
-                    if (pipe.startType == STATION_TO_STATION || pipe.startType == STATION_TO_PIPE) {
-                        startStr = "КС" + to_string(pipe.startId);
-                    } else {
-                        startStr = "Тр" + to_string(pipe.startId);
-                    }
-                    
-                    if (pipe.endType == STATION_TO_STATION || pipe.endType == PIPE_TO_STATION) {
-                        endStr = "КС" + to_string(pipe.endId);
-                    } else {
-                        endStr = "Тр" + to_string(pipe.endId);
-                    }
-                    
-                    cout << startStr << " -> " << endStr;
+                    bool startIsStation = pipe.startType == STATION_TO_STATION || pipe.startType == STATION_TO_PIPE;
+                    bool endIsStation = pipe.endType == STATION_TO_STATION || pipe.endType == PIPE_TO_STATION;
+                    cout << endpointLabel(startIsStation, pipe.startId) << " -> "
+                         << endpointLabel(endIsStation, pipe.endId);
                 } else {
                     cout << "Не подключена";
                 }
@@ -416,9 +210,9 @@ private:
             cout << string(70, '-') << endl;
             for (int index : stationIndices) {
                 const CompressorStation& station = stations[index];
-                double inactivePercent = calculateInactivePercent(station);
+                double inactivePercent = PipelineCore::calculateInactivePercent(station);
                 cout << setw(3) << station.id << " | "
-                     << setw(10) << left << (station.name.length() > 10 ? station.name.substr(0, 7) + "..." : station.name) << " | "
+                     << setw(10) << left << (station.name.length() > 10 ? station.name.str().substr(0, 7) + "..." : station.name.str()) << " | "
                      << setw(12) << station.totalWorkshops << " | "
                      << setw(9) << station.activeWorkshops << " | "
                      << setw(15) << fixed << setprecision(1) << inactivePercent << "% | "
@@ -427,123 +221,58 @@ private:
         }
     }
 
-    // Поиск свободной трубы по диаметру
-    int findAvailablePipeByDiameter(int diameter) const {
-        for (size_t i = 0; i < pipes.size(); ++i) {
-            if (pipes[i].diameter == diameter && !pipes[i].inUse && !pipes[i].underRepair) {
-                return i;
-            }
-        }
-        return -1;
-    }
-
-    // Получение типа объекта по ID
-    pair<bool, int> getObjectInfo(int id) const {
-        // Проверяем, является ли ID станцией
-        int stationIndex = findStationIndexById(id);
-        if (stationIndex != -1) {
-            return {true, stationIndex}; // true = станция
-        }
-        
-        // Проверяем, является ли ID трубой
-        int pipeIndex = findPipeIndexById(id);
-        if (pipeIndex != -1) {
-            return {false, pipeIndex}; // false = труба
-        }
-        
-        return {false, -1}; // не найдено
-    }
-
-    // Определение типа соединения
-    ConnectionType determineConnectionType(bool isStartStation, bool isEndStation) {
-        if (isStartStation && isEndStation) return STATION_TO_STATION;
-        if (!isStartStation && !isEndStation) return PIPE_TO_PIPE;
-        if (isStartStation && !isEndStation) return STATION_TO_PIPE;
-        return PIPE_TO_STATION;
-    }
-
-    // Проверка возможности соединения
-    bool canConnectObjects(int startId, int endId, int diameter) {
-        if (startId == endId) {
-            cout << "Ошибка: нельзя соединить объект с самим собой!\n";
-            return false;
-        }
-        
-        // Получаем информацию об объектах
-        auto [isStartStation, startIndex] = getObjectInfo(startId);
-        auto [isEndStation, endIndex] = getObjectInfo(endId);
-        
-        if (startIndex == -1) {
-            cout << "Ошибка: объект с ID " << startId << " не существует!\n";
-            return false;
-        }
-        
-        if (endIndex == -1) {
-            cout << "Ошибка: объект с ID " << endId << " не существует!\n";
-            return false;
-        }
-        
-        // Проверка для труб
-        if (!isStartStation) {
-            const Pipe& startPipe = pipes[startIndex];
-            if (startPipe.underRepair) {
+    // Вывод причины, по которой соединение невозможно
+    void printConnectError(ConnectStatus status, int startId, int endId, int diameter) const {
+        switch (status) {
+            case ConnectStatus::SameObject:
+                cout << "Ошибка: нельзя соединить объект с самим собой!\n";
+                break;
+            case ConnectStatus::StartNotFound:
+                cout << "Ошибка: объект с ID " << startId << " не существует!\n";
+                break;
+            case ConnectStatus::EndNotFound:
+                cout << "Ошибка: объект с ID " << endId << " не существует!\n";
+                break;
+            case ConnectStatus::StartUnderRepair:
                 cout << "Ошибка: труба " << startId << " в ремонте!\n";
-                return false;
-            }
-        }
-        
-        if (!isEndStation) {
-            const Pipe& endPipe = pipes[endIndex];
-            if (endPipe.underRepair) {
+                break;
+            case ConnectStatus::EndUnderRepair:
                 cout << "Ошибка: труба " << endId << " в ремонте!\n";
-                return false;
-            }
-        }
-        
-        // Проверка на существующее соединение (в одну сторону)
-        for (const auto& conn : network) {
-            if (conn.startId == startId && conn.endId == endId) {
+                break;
+            case ConnectStatus::AlreadyExists:
                 cout << "Ошибка: соединение между этими объектами уже существует!\n";
-                return false;
-            }
-        }
-        
-        // Проверка диаметра для соединения труб с трубами
-        if (!isStartStation && !isEndStation) {
-            const Pipe& startPipe = pipes[startIndex];
-            const Pipe& endPipe = pipes[endIndex];
-            
-            if (startPipe.diameter != diameter || endPipe.diameter != diameter) {
+                break;
+            case ConnectStatus::DiameterMismatch: {
+                const auto& pipes = core.getPipes();
                 cout << "Ошибка: диаметр соединяющей трубы должен совпадать с диаметром соединяемых труб!\n";
-                cout << "Диаметр трубы " << startId << ": " << startPipe.diameter << " мм\n";
-                cout << "Диаметр трубы " << endId << ": " << endPipe.diameter << " мм\n";
+                cout << "Диаметр трубы " << startId << ": " << pipes[core.findPipeIndexById(startId)].diameter << " мм\n";
+                cout << "Диаметр трубы " << endId << ": " << pipes[core.findPipeIndexById(endId)].diameter << " мм\n";
                 cout << "Диаметр соединяющей трубы: " << diameter << " мм\n";
-                return false;
+                break;
             }
+            default:
+                break;
         }
-        
-        return true;
     }
 
     void connectObjects() {
-        if (pipes.empty() && stations.empty()) {
+        if (core.getPipes().empty() && core.getStations().empty()) {
             cout << "Нет объектов для соединения!\n";
             return;
         }
-        
+
         viewAll();
-        
+
         cout << "\nТипы соединений:\n";
         cout << "1. КС -> КС\n";
         cout << "2. КС -> Труба\n";
         cout << "3. Труба -> КС\n";
         cout << "4. Труба -> Труба\n";
-        
+
         int connectionType = InputValidator::getIntInput("Выберите тип соединения: ", 1, 4);
-        
-        int startId, endId;
+
         string startPrompt, endPrompt;
-        
+
         switch (connectionType) {
             case 1: // КС -> КС
                 startPrompt = "Введите ID КС входа: ";
@@ -562,213 +291,112 @@ private:
                 endPrompt = "Введите ID трубы выхода: ";
                 break;
         }
-        
-        startId = InputValidator::getIntInput(startPrompt, 1);
-        endId = InputValidator::getIntInput(endPrompt, 1);
-        
+
+        int startId = InputValidator::getIntInput(startPrompt, 1);
+        int endId = InputValidator::getIntInput(endPrompt, 1);
+
         int diameter = InputValidator::getDiameterInput("Введите диаметр соединяющей трубы");
-        
-        // Проверка возможности соединения
-        if (!canConnectObjects(startId, endId, diameter)) {
-            return;
-        }
-        
-        // Определение типов объектов
-        auto [isStartStation, startIndex] = getObjectInfo(startId);
-        auto [isEndStation, endIndex] = getObjectInfo(endId);
-        
-        // Поиск доступной трубы
-        int pipeIndex = findAvailablePipeByDiameter(diameter);
-        
-        if (pipeIndex != -1) {
-            // Используем существующую трубу
-            pipes[pipeIndex].inUse = true;
-            pipes[pipeIndex].startId = startId;
-            pipes[pipeIndex].endId = endId;
-            pipes[pipeIndex].startType = determineConnectionType(isStartStation, isEndStation);
-            pipes[pipeIndex].endType = pipes[pipeIndex].startType; // для простоты
-            
-            NetworkConnection conn;
-            conn.pipeId = pipes[pipeIndex].id;
-            conn.startId = startId;
-            conn.endId = endId;
-            conn.startType = determineConnectionType(isStartStation, isEndStation);
-            conn.endType = conn.startType;
-            network.push_back(conn);
-            
-            string startTypeStr = isStartStation ? "КС" : "Труба";
-            string endTypeStr = isEndStation ? "КС" : "Труба";
-            
+
+        ConnectResult result = core.connectObjects(startId, endId, diameter);
+
+        string startTypeStr = core.getObjectInfo(startId).first ? "КС" : "Труба";
+        string endTypeStr = core.getObjectInfo(endId).first ? "КС" : "Труба";
+
+        if (result.status == ConnectStatus::Ok) {
             cout << "Соединение создано: " << startTypeStr << " " << startId
                  << " -> " << endTypeStr << " " << endId
-                 << " (труба ID: " << pipes[pipeIndex].id << ")\n";
-            
+                 << " (труба ID: " << result.pipeId << ")\n";
+
             logger.log("Создано соединение",
                       startTypeStr + " " + to_string(startId) + " -> " +
                       endTypeStr + " " + to_string(endId) +
-                      ", Труба ID: " + to_string(pipes[pipeIndex].id));
-        } else {
-            // Создаем новую трубу
-            cout << "Свободной трубы диаметром " << diameter << " мм не найдено.\n";
-            cout << "Создание новой трубы для соединения...\n";
-            
-            Pipe newPipe;
-            newPipe.id = nextPipeId++;
-            newPipe.name = InputValidator::getStringInput("Введите название соединяющей трубы: ");
-            newPipe.length = InputValidator::getDoubleInput("Введите длину соединяющей трубы (км): ", 0.001);
-            newPipe.diameter = diameter;
-            newPipe.underRepair = false;
-            newPipe.inUse = true;
-            newPipe.startId = startId;
-            newPipe.endId = endId;
-            newPipe.startType = determineConnectionType(isStartStation, isEndStation);
-            newPipe.endType = newPipe.startType;
-            
-            pipes.push_back(newPipe);
-            
-            NetworkConnection conn;
-            conn.pipeId = newPipe.id;
-            conn.startId = startId;
-            conn.endId = endId;
-            conn.startType = determineConnectionType(isStartStation, isEndStation);
-            conn.endType = conn.startType;
-            network.push_back(conn);
-            
-            string startTypeStr = isStartStation ? "КС" : "Труба";
-            string endTypeStr = isEndStation ? "КС" : "Труба";
-            
-            cout << "Создана и соединена новая труба ID: " << newPipe.id << "\n";
-            cout << "Соединение: " << startTypeStr << " " << startId
-                 << " -> " << endTypeStr << " " << endId << "\n";
-            
-            logger.log("Создание и соединение новой трубы",
-                      "Труба ID: " + to_string(newPipe.id) + ", " + newPipe.name +
-                      ", " + startTypeStr + " " + to_string(startId) +
-                      " -> " + endTypeStr + " " + to_string(endId));
+                      ", Труба ID: " + to_string(result.pipeId));
+            return;
+        }
+
+        if (result.status != ConnectStatus::NoFreePipe) {
+            printConnectError(result.status, startId, endId, diameter);
+            return;
+        }
+
+        // Создаем новую трубу
+        cout << "Свободной трубы диаметром " << diameter << " мм не найдено.\n";
+        cout << "Создание новой трубы для соединения...\n";
+
+        string name = InputValidator::getStringInput("Введите название соединяющей трубы: ");
+        double length = InputValidator::getDoubleInput("Введите длину соединяющей трубы (км): ", 0.001);
+
+        result = core.connectWithNewPipe(startId, endId, diameter, name, length);
+        if (result.status != ConnectStatus::Ok) {
+            printConnectError(result.status, startId, endId, diameter);
+            return;
         }
+
+        cout << "Создана и соединена новая труба ID: " << result.pipeId << "\n";
+        cout << "Соединение: " << startTypeStr << " " << startId
+             << " -> " << endTypeStr << " " << endId << "\n";
+
+        logger.log("Создание и соединение новой трубы",
+                  "Труба ID: " + to_string(result.pipeId) + ", " + name +
+                  ", " + startTypeStr + " " + to_string(startId) +
+                  " -> " + endTypeStr + " " + to_string(endId));
     }
 
     void disconnectPipe() {
-        if (network.empty()) {
+        if (core.getNetwork().empty()) {
             cout << "Нет соединений в сети!\n";
             return;
         }
-        
+
         viewNetwork();
-        
+
         int pipeId = InputValidator::getIntInput("Введите ID трубы для разъединения: ", 1);
-        int pipeIndex = findPipeIndexById(pipeId);
-        
-        if (pipeIndex == -1) {
-            cout << "Труба с ID " << pipeId << " не найдена!\n";
-            return;
-        }
-        
-        if (!pipes[pipeIndex].inUse) {
-            cout << "Труба не используется в сети!\n";
-            return;
+
+        switch (core.disconnectPipe(pipeId)) {
+            case RemoveStatus::NotFound:
+                cout << "Труба с ID " << pipeId << " не найдена!\n";
+                return;
+            case RemoveStatus::NotConnected:
+                cout << "Труба не используется в сети!\n";
+                return;
+            default:
+                break;
         }
-        
-        // Удаляем из сети
-        auto it = remove_if(network.begin(), network.end(),
-                           [pipeId](const NetworkConnection& conn) { return conn.pipeId == pipeId; });
-        network.erase(it, network.end());
-        
-        // Сбрасываем флаг использования в трубе
-        pipes[pipeIndex].inUse = false;
-        pipes[pipeIndex].startId = 0;
-        pipes[pipeIndex].endId = 0;
-        
+
         cout << "Труба ID: " << pipeId << " отключена от сети.\n";
         logger.log("Отключение трубы от сети", "Труба ID: " + to_string(pipeId));
     }
 
-    // Построение графа сети
-    map<int, GraphNode> buildGraph() const {
-        map<int, GraphNode> graph;
-        
-        // Добавляем станции
-        for (const auto& station : stations) {
-            GraphNode node;
-            node.id = station.id;
-            node.isStation = true;
-            graph[station.id] = node;
-        }
-        
-        // Добавляем трубы, которые являются узлами при соединении труб
-        for (const auto& pipe : pipes) {
-            if (pipe.inUse) {
-                // Если труба соединена с другой трубой, она становится узлом
-                auto [isStartStation, startIdx] = getObjectInfo(pipe.startId);
-                auto [isEndStation, endIdx] = getObjectInfo(pipe.endId);
-                
-                if (!isStartStation || !isEndStation) {
-                    // Добавляем трубу как узел графа
-                    GraphNode node;
-                    node.id = pipe.id;
-                    node.isStation = false;
-                    if (graph.find(pipe.id) == graph.end()) {
-                        graph[pipe.id] = node;
-                    }
-                }
-            }
-        }
-        
-        // Добавляем соединения
-        for (const auto& conn : network) {
-            int pipeId = conn.pipeId;
-            
-            // Добавляем связь от начального узла к конечному через трубу
-            if (graph.find(conn.startId) != graph.end()) {
-                graph[conn.startId].connections.push_back({conn.endId, pipeId});
-            }
-            
-            // Для неориентированного графа добавляем обратную связь
-            // (раскомментировать если сеть неориентированная)
-            // if (graph.find(conn.endId) != graph.end()) {
-            //     graph[conn.endId].connections.push_back({conn.startId, pipeId});
-            // }
-        }
-        
-        return graph;
-    }
-
     void viewNetwork() const {
+        const auto& network = core.getNetwork();
         if (network.empty()) {
             cout << "Газотранспортная сеть пуста.\n";
             return;
         }
-        
+
+        const auto& pipes = core.getPipes();
+        const PipeIndex pipeById(pipes);
+
         cout << "\nГазотранспортная сеть (" << network.size() << " соединений)\n";
         cout << "Труба | Диаметр | Длина | Начало -> Конец | Тип соединения | Статус\n";
         cout << string(90, '-') << endl;
-        
+
         for (const auto& conn : network) {
-            int pipeIndex = findPipeIndexById(conn.pipeId);
-            if (pipeIndex != -1) {
-                const Pipe& pipe = pipes[pipeIndex];
-                
-                string startStr, endStr;
-                if (conn.startType == STATION_TO_STATION || conn.startType == STATION_TO_PIPE) {
-                    startStr = "КС" + to_string(conn.startId);
-                } else {
-                    startStr = "Тр" + to_string(conn.startId);
-                }
-                
-                if (conn.endType == STATION_TO_STATION || conn.endType == PIPE_TO_STATION) {
-                    endStr = "КС" + to_string(conn.endId);
-                } else {
-                    endStr = "Тр" + to_string(conn.endId);
-                }
-                
+            const Pipe* found = pipeById.find(conn.pipeId);
+            if (found) {
+                const Pipe& pipe = *found;
+
+                string startStr = endpointLabel(startIsStation(pipe), pipe.startId);
+                string endStr = endpointLabel(endIsStation(pipe), pipe.endId);
+
                 string connTypeStr;
-                switch (conn.startType) {
+                switch (pipe.startType) {
                     case STATION_TO_STATION: connTypeStr = "КС-КС"; break;
                     case STATION_TO_PIPE: connTypeStr = "КС-Труба"; break;
                     case PIPE_TO_STATION: connTypeStr = "Труба-КС"; break;
                     case PIPE_TO_PIPE: connTypeStr = "Труба-Труба"; break;
                 }
-                
+
                 cout << setw(5) << pipe.id << " | "
                      << setw(7) << pipe.diameter << " | "
                      << setw(6) << fixed << setprecision(2) << pipe.length << " | "
@@ -778,49 +406,52 @@ private:
                      << (pipe.underRepair ? "В ремонте" : "Работает") << endl;
             }
         }
-        
+
         // Статистика
+        NetworkStats stats = core.getNetworkStats();
         cout << "\nСтатистика сети:\n";
-        cout << "Всего соединений: " << network.size() << endl;
-        
-        set<int> connectedStations;
-        set<int> connectedPipes;
-        for (const auto& conn : network) {
-            auto [isStartStation, startIdx] = getObjectInfo(conn.startId);
-            auto [isEndStation, endIdx] = getObjectInfo(conn.endId);
-            
-            if (isStartStation) {
-                connectedStations.insert(conn.startId);
-            } else {
-                connectedPipes.insert(conn.startId);
+        cout << "Всего соединений: " << stats.connections << endl;
+        cout << "Подключенных КС: " << stats.connectedStations << " из " << core.getStations().size() << endl;
+        cout << "Подключенных труб: " << stats.connectedPipes << " из " << pipes.size() << endl;
+
+        // Острова - изолированные друг от друга подсети
+        auto islands = core.getIslands();
+        cout << "Изолированных подсетей (островов): " << islands.size() << endl;
+        for (size_t i = 0; i < islands.size(); ++i) {
+            const IslandSummary& island = islands[i];
+            cout << "  Остров " << (i + 1) << ": соединений " << island.connections << ", КС: ";
+            if (island.stationIds.empty()) {
+                cout << "нет";
             }
-            
-            if (isEndStation) {
-                connectedStations.insert(conn.endId);
-            } else {
-                connectedPipes.insert(conn.endId);
+            for (size_t j = 0; j < island.stationIds.size(); ++j) {
+                if (j > 0) cout << ", ";
+                cout << island.stationIds[j];
+            }
+            if (!island.pipeIds.empty()) {
+                cout << "; трубы-узлы: ";
+                for (size_t j = 0; j < island.pipeIds.size(); ++j) {
+                    if (j > 0) cout << ", ";
+                    cout << island.pipeIds[j];
+                }
             }
+            cout << endl;
         }
-        
-        cout << "Подключенных КС: " << connectedStations.size() << " из " << stations.size() << endl;
-        cout << "Подключенных труб: " << connectedPipes.size() << " из " << pipes.size() << endl;
-        
+
         // Построение и вывод графа
-        auto graph = buildGraph();
+        auto graph = core.buildGraph();
         if (!graph.empty()) {
             cout << "\nСтруктура сети (граф):\n";
             for (const auto& [nodeId, node] : graph) {
                 string nodeType = node.isStation ? "КС" : "Труба";
                 cout << nodeType << " " << nodeId << " соединен с: ";
-                
+
                 if (node.connections.empty()) {
                     cout << "ни с чем";
                 } else {
                     for (size_t i = 0; i < node.connections.size(); ++i) {
                         auto [neighborId, pipeId] = node.connections[i];
-                        auto [isNeighborStation, neighborIdx] = getObjectInfo(neighborId);
-                        string neighborType = isNeighborStation ? "КС" : "Труба";
-                        
+                        string neighborType = core.getObjectInfo(neighborId).first ? "КС" : "Труба";
+
                         cout << neighborType << " " << neighborId << " (через трубу " << pipeId << ")";
                         if (i < node.connections.size() - 1) {
                             cout << ", ";
@@ -833,80 +464,31 @@ private:
     }
 
     void topologicalSort() const {
-        if (network.empty()) {
+        if (core.getNetwork().empty()) {
             cout << "Сеть пуста, сортировка невозможна.\n";
             return;
         }
-        
-        // Построение графа только для КС
-        map<int, vector<int>> adjList;
-        map<int, int> inDegree;
-        
-        // Инициализация степеней входа для всех станций
-        for (const auto& station : stations) {
-            inDegree[station.id] = 0;
-        }
-        
-        // Построение списка смежности и подсчет степеней входа
-        // Учитываем только соединения между станциями
-        for (const auto& conn : network) {
-            auto [isStartStation, startIdx] = getObjectInfo(conn.startId);
-            auto [isEndStation, endIdx] = getObjectInfo(conn.endId);
-            
-            if (isStartStation && isEndStation) {
-                adjList[conn.startId].push_back(conn.endId);
-                inDegree[conn.endId]++;
-            }
-        }
-        
-        // Алгоритм Кана
-        vector<int> result;
-        vector<int> zeroDegreeNodes;
-        
-        for (const auto& [node, degree] : inDegree) {
-            if (degree == 0) {
-                zeroDegreeNodes.push_back(node);
-            }
-        }
-        
-        while (!zeroDegreeNodes.empty()) {
-            int node = zeroDegreeNodes.back();
-            zeroDegreeNodes.pop_back();
-            result.push_back(node);
-            
-            for (int neighbor : adjList[node]) {
-                inDegree[neighbor]--;
-                if (inDegree[neighbor] == 0) {
-                    zeroDegreeNodes.push_back(neighbor);
-                }
-            }
-        }
-        
-        // Проверка на циклы
-        if (result.size() != stations.size()) {
+
+        TopoSortResult result = core.topologicalSort();
+        const auto& stations = core.getStations();
+
+        if (result.hasCycle) {
             cout << "Обнаружен цикл в сети КС! Сортировка невозможна.\n";
-            
-            // Поиск циклических зависимостей
-            set<int> sortedStations(result.begin(), result.end());
             cout << "КС, образующие циклы: ";
-            bool first = true;
-            for (const auto& station : stations) {
-                if (sortedStations.find(station.id) == sortedStations.end()) {
-                    if (!first) cout << ", ";
-                    cout << station.id << " (" << station.name << ")";
-                    first = false;
-                }
+            for (size_t i = 0; i < result.cyclicStations.size(); ++i) {
+                int stationId = result.cyclicStations[i];
+                if (i > 0) cout << ", ";
+                cout << stationId << " (" << stations[core.findStationIndexById(stationId)].name << ")";
             }
             cout << endl;
             return;
         }
-        
-        // Вывод результата
+
         cout << "\nТопологическая сортировка КС:\n";
-        for (size_t i = 0; i < result.size(); ++i) {
-            int stationIndex = findStationIndexById(result[i]);
+        for (size_t i = 0; i < result.order.size(); ++i) {
+            int stationIndex = core.findStationIndexById(result.order[i]);
             if (stationIndex != -1) {
-                cout << (i + 1) << ". КС ID: " << result[i]
+                cout << (i + 1) << ". КС ID: " << result.order[i]
                      << " (" << stations[stationIndex].name << ")\n";
             }
         }
@@ -914,154 +496,91 @@ private:
 
     // Поиск пути в сети
     void findPath() {
-        if (network.empty()) {
+        if (core.getNetwork().empty()) {
             cout << "Сеть пуста!\n";
             return;
         }
-        
+
         viewAll();
-        
+
         cout << "\nПоиск пути в сети:\n";
         int startId = InputValidator::getIntInput("Введите ID начальной точки: ", 1);
         int endId = InputValidator::getIntInput("Введите ID конечной точки: ", 1);
-        
-        auto [isStartStation, startIdx] = getObjectInfo(startId);
-        auto [isEndStation, endIdx] = getObjectInfo(endId);
-        
-        if (startIdx == -1) {
-            cout << "Начальная точка не найдена!\n";
-            return;
-        }
-        
-        if (endIdx == -1) {
-            cout << "Конечная точка не найдена!\n";
-            return;
-        }
-        
-        // Построение графа
-        auto graph = buildGraph();
-        
-        if (graph.find(startId) == graph.end() || graph.find(endId) == graph.end()) {
-            cout << "Одна или обе точки не подключены к сети!\n";
-            return;
-        }
-        
-        // BFS для поиска пути
-        map<int, int> parent;
-        map<int, int> parentPipe;
-        queue<int> q;
-        set<int> visited;
-        
-        q.push(startId);
-        visited.insert(startId);
-        parent[startId] = -1;
-        
-        while (!q.empty()) {
-            int current = q.front();
-            q.pop();
-            
-            if (current == endId) {
+
+        PathResult result = core.findPath(startId, endId);
+        switch (result.status) {
+            case PathStatus::StartNotFound:
+                cout << "Начальная точка не найдена!\n";
+                return;
+            case PathStatus::EndNotFound:
+                cout << "Конечная точка не найдена!\n";
+                return;
+            case PathStatus::NotInNetwork:
+                cout << "Одна или обе точки не подключены к сети!\n";
+                return;
+            case PathStatus::NoPath:
+            case PathStatus::EmptyNetwork:
+                cout << "Путь не найден!\n";
+                return;
+            case PathStatus::Found:
                 break;
-            }
-            
-            if (graph.find(current) != graph.end()) {
-                for (const auto& [neighbor, pipeId] : graph[current].connections) {
-                    if (visited.find(neighbor) == visited.end()) {
-                        visited.insert(neighbor);
-                        parent[neighbor] = current;
-                        parentPipe[neighbor] = pipeId;
-                        q.push(neighbor);
-                    }
-                }
-            }
-        }
-        
-        // Восстановление пути
-        if (parent.find(endId) == parent.end()) {
-            cout << "Путь не найден!\n";
-            return;
-        }
-        
-        vector<int> path;
-        vector<int> pipesPath;
-        int current = endId;
-        
-        while (current != -1) {
-            path.push_back(current);
-            if (current != startId && parentPipe.find(current) != parentPipe.end()) {
-                pipesPath.push_back(parentPipe[current]);
-            }
-            current = parent[current];
         }
-        
-        reverse(path.begin(), path.end());
-        reverse(pipesPath.begin(), pipesPath.end());
-        
+
+        const auto& pipes = core.getPipes();
+        const auto& stations = core.getStations();
+
         // Вывод пути
         cout << "\nНайденный путь:\n";
-        for (size_t i = 0; i < path.size(); ++i) {
-            auto [isStation, idx] = getObjectInfo(path[i]);
+        for (size_t i = 0; i < result.nodes.size(); ++i) {
+            auto [isStation, idx] = core.getObjectInfo(result.nodes[i]);
             string type = isStation ? "КС" : "Труба";
             string name = isStation ? stations[idx].name : pipes[idx].name;
-            
-            cout << (i + 1) << ". " << type << " ID: " << path[i]
+
+            cout << (i + 1) << ". " << type << " ID: " << result.nodes[i]
                  << " (" << name << ")";
-            
-            if (i < path.size() - 1) {
+
+            if (i < result.nodes.size() - 1) {
                 cout << " ->\n";
             }
         }
-        
-        if (!pipesPath.empty()) {
+
+        if (!result.pipeIds.empty()) {
             cout << "\n\nИспользуемые трубы на пути:\n";
-            double totalLength = 0;
-            for (size_t i = 0; i < pipesPath.size(); ++i) {
-                int pipeIdx = findPipeIndexById(pipesPath[i]);
+            for (int pipeId : result.pipeIds) {
+                int pipeIdx = core.findPipeIndexById(pipeId);
                 if (pipeIdx != -1) {
-                    cout << "Труба ID: " << pipesPath[i]
+                    cout << "Труба ID: " << pipeId
                          << " (" << pipes[pipeIdx].name
                          << "), Длина: " << pipes[pipeIdx].length << " км\n";
-                    totalLength += pipes[pipeIdx].length;
                 }
             }
-            cout << "Общая длина пути: " << totalLength << " км\n";
+            cout << "Общая длина пути: " << result.totalLength << " км\n";
         }
-        
+
         logger.log("Поиск пути", "От: " + to_string(startId) + " до: " + to_string(endId) +
-                  ", Длина пути: " + to_string(pipesPath.size()) + " труб");
+                  ", Длина пути: " + to_string(result.pipeIds.size()) + " труб");
     }
 
 public:
     void addPipe() {
-        Pipe newPipe;
-        newPipe.id = nextPipeId++;
-        newPipe.name = InputValidator::getStringInput("Введите название трубы: ");
-        newPipe.length = InputValidator::getDoubleInput("Введите длину трубы (км): ", 0.001);
-        newPipe.diameter = InputValidator::getDiameterInput("Введите диаметр трубы");
-        newPipe.underRepair = false;
-        newPipe.inUse = false;
-        newPipe.startId = 0;
-        newPipe.endId = 0;
-        newPipe.startType = STATION_TO_STATION;
-        newPipe.endType = STATION_TO_STATION;
-        
-        pipes.push_back(newPipe);
-        cout << "Труба '" << newPipe.name << "' добавлена с ID: " << newPipe.id << "!\n";
-        logger.log("Добавлена труба", "ID: " + to_string(newPipe.id) + ", Название: " + newPipe.name);
+        string name = InputValidator::getStringInput("Введите название трубы: ");
+        double length = InputValidator::getDoubleInput("Введите длину трубы (км): ", 0.001);
+        int diameter = InputValidator::getDiameterInput("Введите диаметр трубы");
+
+        int id = core.addPipe(name, length, diameter);
+        cout << "Труба '" << name << "' добавлена с ID: " << id << "!\n";
+        logger.log("Добавлена труба", "ID: " + to_string(id) + ", Название: " + name);
     }
 
     void addStation() {
-        CompressorStation newStation;
-        newStation.id = nextStationId++;
-        newStation.name = InputValidator::getStringInput("Введите название КС: ");
-        newStation.totalWorkshops = InputValidator::getIntInput("Введите количество цехов: ", 1);
-        newStation.activeWorkshops = InputValidator::getIntInput("Введите работающих цехов: ",
-                                                               0, newStation.totalWorkshops);
-        newStation.stationClass = InputValidator::getIntInput("Введите класс станции: ", 1);
-        
-        stations.push_back(newStation);
-        cout << "КС '" << newStation.name << "' добавлена с ID: " << newStation.id << "!\n";
-        logger.log("Добавлена КС", "ID: " + to_string(newStation.id) + ", Название: " + newStation.name);
+        string name = InputValidator::getStringInput("Введите название КС: ");
+        int totalWorkshops = InputValidator::getIntInput("Введите количество цехов: ", 1);
+        int activeWorkshops = InputValidator::getIntInput("Введите работающих цехов: ", 0, totalWorkshops);
+        int stationClass = InputValidator::getIntInput("Введите класс станции: ", 1);
+
+        int id = core.addStation(name, totalWorkshops, activeWorkshops, stationClass);
+        cout << "КС '" << name << "' добавлена с ID: " << id << "!\n";
+        logger.log("Добавлена КС", "ID: " + to_string(id) + ", Название: " + name);
     }
 
     void addMultipleObjects(bool isPipe) {
@@ -1070,224 +589,206 @@ public:
             cout << "\n" << (isPipe ? "Добавление трубы " : "Добавление КС ") << (i + 1) << " из " << count << "\n";
             isPipe ? addPipe() : addStation();
         }
-        cout << "Добавлено " << count << (isPipe ? " труб" : " КС") << ". Всего: " << (isPipe ? pipes.size() : stations.size()) << "\n";
+        cout << "Добавлено " << count << (isPipe ? " труб" : " КС") << ". Всего: " << (isPipe ? core.getPipes().size() : core.getStations().size()) << "\n";
     }
 
     void deleteObjects(bool isPipe) {
         vector<int> indices = isPipe ?
-            selectMultipleObjects(getPipeIds(), "труб") :
-            selectMultipleObjects(getStationIds(), "КС");
-            
+            selectMultipleObjects(core.getPipeIds(), "труб") :
+            selectMultipleObjects(core.getStationIds(), "КС");
+
         if (indices.empty()) return;
-        
-        // Проверка использования труб в сети перед удалением
-        if (isPipe) {
-            vector<int> pipesToRemove;
-            for (int index : indices) {
-                if (pipes[index].inUse) {
-                    cout << "Предупреждение: труба ID " << pipes[index].id
+
+        // Индексы меняются при удалении, поэтому работаем с ID
+        vector<pair<int, string>> targets;
+        for (int index : indices) {
+            if (isPipe) {
+                const Pipe& pipe = core.getPipes()[index];
+                // Проверка использования труб в сети перед удалением
+                if (pipe.inUse) {
+                    cout << "Предупреждение: труба ID " << pipe.id
                          << " используется в сети и не будет удалена!\n";
                 } else {
-                    pipesToRemove.push_back(index);
+                    targets.push_back({pipe.id, pipe.name});
                 }
+            } else {
+                const CompressorStation& station = core.getStations()[index];
+                targets.push_back({station.id, station.name});
             }
-            indices = pipesToRemove;
         }
-        
-        sort(indices.rbegin(), indices.rend());
+
         int count = 0;
-        
-        for (int index : indices) {
+        for (auto it = targets.rbegin(); it != targets.rend(); ++it) {
+            const auto& [id, name] = *it;
             if (isPipe) {
-                cout << "Удалена труба: " << pipes[index].name << " (ID: " << pipes[index].id << ")\n";
-                logger.log("Удалена труба", "ID: " + to_string(pipes[index].id) + ", Название: " + pipes[index].name);
-                pipes.erase(pipes.begin() + index);
+                if (core.removePipe(id) != RemoveStatus::Ok) continue;
+                cout << "Удалена труба: " << name << " (ID: " << id << ")\n";
+                logger.log("Удалена труба", "ID: " + to_string(id) + ", Название: " + name);
             } else {
-                // При удалении станции удаляем все соединения с ней
-                int stationId = stations[index].id;
-                auto it = remove_if(network.begin(), network.end(),
-                                   [stationId](const NetworkConnection& conn) {
-                                       return conn.startId == stationId || conn.endId == stationId;
-                                   });
-                network.erase(it, network.end());
-                
-                // Освобождаем связанные трубы
-                for (auto& pipe : pipes) {
-                    if (pipe.startId == stationId || pipe.endId == stationId) {
-                        pipe.inUse = false;
-                        pipe.startId = 0;
-                        pipe.endId = 0;
-                    }
-                }
-                
-                cout << "Удалена КС: " << stations[index].name << " (ID: " << stations[index].id << ")\n";
-                logger.log("Удалена КС", "ID: " + to_string(stations[index].id) + ", Название: " + stations[index].name);
-                stations.erase(stations.begin() + index);
+                // При удалении станции удаляются все соединения с ней
+                if (!core.removeStation(id)) continue;
+                cout << "Удалена КС: " << name << " (ID: " << id << ")\n";
+                logger.log("Удалена КС", "ID: " + to_string(id) + ", Название: " + name);
             }
             count++;
         }
-        
-        cout << "Удалено " << count << (isPipe ? " труб" : " КС") << ". Осталось: " << (isPipe ? pipes.size() : stations.size()) << "\n";
+
+        cout << "Удалено " << count << (isPipe ? " труб" : " КС") << ". Осталось: " << (isPipe ? core.getPipes().size() : core.getStations().size()) << "\n";
     }
 
     void editPipe() {
-        if (pipes.empty()) {
+        if (core.getPipes().empty()) {
             cout << "Нет доступных труб!\n";
             return;
         }
-        
+
         viewAll();
         int id = InputValidator::getIntInput("Введите ID трубы для редактирования: ", 1);
-        int index = findPipeIndexById(id);
-        
+        int index = core.findPipeIndexById(id);
+
         if (index == -1) {
             cout << "Труба с ID " << id << " не найдена!\n";
             return;
         }
-        
-        cout << "Редактирование трубы ID: " << pipes[index].id << " - " << pipes[index].name << endl;
+
+        const Pipe& pipe = core.getPipes()[index];
+        cout << "Редактирование трубы ID: " << pipe.id << " - " << pipe.name << endl;
         cout << "1. Изменить статус ремонта\n2. Редактировать параметры\n";
         int choice = InputValidator::getIntInput("Выберите действие: ", 1, 2);
-        
+
         if (choice == 1) {
-            pipes[index].underRepair = !pipes[index].underRepair;
-            string status = pipes[index].underRepair ? "В ремонте" : "Работает";
+            bool underRepair = !pipe.underRepair;
+            core.setPipeRepair(id, underRepair);
+            string status = underRepair ? "В ремонте" : "Работает";
             cout << "Статус ремонта изменен на: " << status << endl;
-            
+
             // Если труба в ремонте и используется в сети
-            if (pipes[index].underRepair && pipes[index].inUse) {
+            if (underRepair && core.getPipes()[index].inUse) {
                 cout << "Внимание: труба используется в сети!\n";
             }
-            
-            logger.log("Изменен статус трубы", "ID: " + to_string(pipes[index].id) + ", Статус: " + status);
+
+            logger.log("Изменен статус трубы", "ID: " + to_string(id) + ", Статус: " + status);
         } else {
-            pipes[index].name = InputValidator::getStringInput("Введите новое название трубы: ");
-            pipes[index].length = InputValidator::getDoubleInput("Введите новую длину трубы (км): ", 0.001);
-            
+            string name = InputValidator::getStringInput("Введите новое название трубы: ");
+            double length = InputValidator::getDoubleInput("Введите новую длину трубы (км): ", 0.001);
+            core.updatePipe(id, name, length);
+
             // Если труба не используется в сети, можно изменить диаметр
-            if (!pipes[index].inUse) {
-                pipes[index].diameter = InputValidator::getDiameterInput("Введите новый диаметр трубы");
+            if (!core.getPipes()[index].inUse) {
+                core.setPipeDiameter(id, InputValidator::getDiameterInput("Введите новый диаметр трубы"));
             } else {
                 cout << "Диаметр нельзя изменить, так как труба используется в сети.\n";
             }
-            
+
             cout << "Параметры трубы обновлены!\n";
-            logger.log("Обновлена труба", "ID: " + to_string(pipes[index].id) + ", Новое название: " + pipes[index].name);
+            logger.log("Обновлена труба", "ID: " + to_string(id) + ", Новое название: " + name);
         }
     }
 
     void editStation() {
-        if (stations.empty()) {
+        if (core.getStations().empty()) {
             cout << "Нет доступных КС!\n";
             return;
         }
-        
+
         viewAll();
         int id = InputValidator::getIntInput("Введите ID КС для редактирования: ", 1);
-        int index = findStationIndexById(id);
-        
+        int index = core.findStationIndexById(id);
+
         if (index == -1) {
             cout << "КС с ID " << id << " не найдена!\n";
             return;
         }
-        
-        cout << "Редактирование КС ID: " << stations[index].id << " - " << stations[index].name << endl;
+
+        const CompressorStation& station = core.getStations()[index];
+        cout << "Редактирование КС ID: " << station.id << " - " << station.name << endl;
         cout << "1. Запустить/остановить цех\n2. Редактировать параметры\n";
         int choice = InputValidator::getIntInput("Выберите действие: ", 1, 2);
-        
+
         if (choice == 1) {
-            cout << "Текущее состояние: " << stations[index].activeWorkshops
-                 << "/" << stations[index].totalWorkshops << " цехов работает\n";
+            cout << "Текущее состояние: " << station.activeWorkshops
+                 << "/" << station.totalWorkshops << " цехов работает\n";
             cout << "1. Запустить цех\n2. Остановить цех\n";
             int action = InputValidator::getIntInput("Выберите действие: ", 1, 2);
-            
-            if (action == 1 && stations[index].activeWorkshops < stations[index].totalWorkshops) {
-                stations[index].activeWorkshops++;
-                cout << "Цех запущен! Работает цехов: " << stations[index].activeWorkshops << endl;
-                logger.log("Запущен цех КС", "ID: " + to_string(stations[index].id) + ", Работает цехов: " + to_string(stations[index].activeWorkshops));
-            } else if (action == 2 && stations[index].activeWorkshops > 0) {
-                stations[index].activeWorkshops--;
-                cout << "Цех остановлен! Работает цехов: " << stations[index].activeWorkshops << endl;
-                logger.log("Остановлен цех КС", "ID: " + to_string(stations[index].id) + ", Работает цехов: " + to_string(stations[index].activeWorkshops));
+
+            if (action == 1 && core.startWorkshop(id)) {
+                int active = core.getStations()[index].activeWorkshops;
+                cout << "Цех запущен! Работает цехов: " << active << endl;
+                logger.log("Запущен цех КС", "ID: " + to_string(id) + ", Работает цехов: " + to_string(active));
+            } else if (action == 2 && core.stopWorkshop(id)) {
+                int active = core.getStations()[index].activeWorkshops;
+                cout << "Цех остановлен! Работает цехов: " << active << endl;
+                logger.log("Остановлен цех КС", "ID: " + to_string(id) + ", Работает цехов: " + to_string(active));
             } else {
                 cout << "Невозможно выполнить операцию!\n";
             }
         } else {
-            stations[index].name = InputValidator::getStringInput("Введите новое название КС: ");
+            string name = InputValidator::getStringInput("Введите новое название КС: ");
             int newTotal = InputValidator::getIntInput("Введите новое количество цехов: ", 1);
-            
-            if (newTotal < stations[index].activeWorkshops) {
-                stations[index].activeWorkshops = newTotal;
-            }
-            stations[index].totalWorkshops = newTotal;
-            stations[index].stationClass = InputValidator::getIntInput("Введите новый класс станции: ", 1);
-            
+            int stationClass = InputValidator::getIntInput("Введите новый класс станции: ", 1);
+            core.updateStation(id, name, newTotal, stationClass);
+
             cout << "Параметры КС обновлены!\n";
-            logger.log("Обновлена КС", "ID: " + to_string(stations[index].id) + ", Новое название: " + stations[index].name);
+            logger.log("Обновлена КС", "ID: " + to_string(id) + ", Новое название: " + name);
         }
     }
 
     void searchPipes() {
-        if (pipes.empty()) {
+        if (core.getPipes().empty()) {
             cout << "Нет доступных труб для поиска!\n";
             return;
         }
-        
+
         cout << "\nПоиск труб\n";
         cout << "1. По названию\n";
         cout << "2. По признаку 'в ремонте'\n";
         cout << "3. По использованию в сети\n";
         int choice = InputValidator::getIntInput("Выберите тип поиска: ", 1, 3);
-        
+
         vector<int> results;
         string searchDetails;
-        
+
         if (choice == 1) {
             string searchName = InputValidator::getStringInput("Введите название для поиска: ");
-            results = findPipesByName(searchName);
+            results = core.findPipesByName(searchName);
             searchDetails = "Поиск по названию: " + searchName;
         } else if (choice == 2) {
             cout << "1. Трубы в ремонте\n";
             cout << "2. Трубы не в ремонте\n";
             int repairChoice = InputValidator::getIntInput("Выберите статус: ", 1, 2);
             bool searchRepairStatus = (repairChoice == 1);
-            results = findPipesByRepairStatus(searchRepairStatus);
+            results = core.findPipesByRepairStatus(searchRepairStatus);
             searchDetails = "Поиск по статусу ремонта: " + string(searchRepairStatus ? "в ремонте" : "не в ремонте");
         } else {
             cout << "1. Трубы в сети\n";
             cout << "2. Свободные трубы\n";
             int useChoice = InputValidator::getIntInput("Выберите статус: ", 1, 2);
             bool searchUseStatus = (useChoice == 1);
-            
-            for (size_t i = 0; i < pipes.size(); ++i) {
-                if (pipes[i].inUse == searchUseStatus) {
-                    results.push_back(i);
-                }
-            }
+            results = core.findPipesByUseStatus(searchUseStatus);
             searchDetails = "Поиск по использованию в сети: " + string(searchUseStatus ? "в сети" : "свободные");
         }
-        
+
         displayObjects(results, {});
         logger.log("Поиск труб", searchDetails + ", Найдено: " + to_string(results.size()));
     }
 
     void searchStations() {
-        if (stations.empty()) {
+        if (core.getStations().empty()) {
             cout << "Нет доступных КС для поиска!\n";
             return;
         }
-        
+
         cout << "\nПоиск КС\n";
         cout << "1. По названию\n";
         cout << "2. По проценту незадействованных цехов\n";
         int choice = InputValidator::getIntInput("Выберите тип поиска: ", 1, 2);
-        
+
         vector<int> results;
         string searchDetails;
-        
+
         if (choice == 1) {
             string searchName = InputValidator::getStringInput("Введите название для поиска: ");
-            results = findStationsByName(searchName);
+            results = core.findStationsByName(searchName);
             searchDetails = "Поиск по названию: " + searchName;
         } else {
             cout << "1. КС с процентом незадействованных цехов БОЛЬШЕ заданного\n";
@@ -1295,152 +796,576 @@ public:
             cout << "3. КС с процентом незадействованных цехов РАВНЫМ заданному\n";
             int percentChoice = InputValidator::getIntInput("Выберите тип сравнения: ", 1, 3);
             double targetPercent = InputValidator::getDoubleInput("Введите процент незадействованных цехов (0-100): ", 0, 100);
-            results = findStationsByInactivePercent(targetPercent, percentChoice);
+            results = core.findStationsByInactivePercent(targetPercent, percentChoice);
             searchDetails = "Поиск по проценту: " + to_string(targetPercent) + "%, Тип: " + to_string(percentChoice);
         }
-        
+
         displayObjects({}, results);
         logger.log("Поиск КС", searchDetails + ", Найдено: " + to_string(results.size()));
     }
 
     void viewAll() const {
         vector<int> allPipeIndices, allStationIndices;
-        for (int i = 0; i < pipes.size(); ++i) allPipeIndices.push_back(i);
-        for (int i = 0; i < stations.size(); ++i) allStationIndices.push_back(i);
+        for (size_t i = 0; i < core.getPipes().size(); ++i) allPipeIndices.push_back(static_cast<int>(i));
+        for (size_t i = 0; i < core.getStations().size(); ++i) allStationIndices.push_back(static_cast<int>(i));
         displayObjects(allPipeIndices, allStationIndices);
     }
 
     void saveData() {
-        string filename = InputValidator::getStringInput("Введите имя файла для сохранения: ");
+        string filename = InputValidator::getStringInput("Введите имя файла для сохранения (.snap - сжатый снимок): ");
         if (filename.find('.') == string::npos) {
             filename += ".txt";
         }
-        
-        ofstream file(filename);
-        if (!file.is_open()) {
+        SaveFormat format = fs::path(filename).extension() == ".snap" ? SaveFormat::Compact : SaveFormat::Network;
+
+        if (!core.saveToFile(filename, format)) {
             cout << "Ошибка: невозможно создать файл " << filename << endl;
             return;
         }
-        
-        file << "NEXT_PIPE_ID " << nextPipeId << endl;
-        file << "NEXT_STATION_ID " << nextStationId << endl;
-        
-        file << "PIPES " << pipes.size() << endl;
-        for (const auto& pipe : pipes) {
-            file << pipe.id << endl << pipe.name << endl << pipe.length << endl
-                 << pipe.diameter << endl << pipe.underRepair << endl
-                 << pipe.inUse << endl << pipe.startId << endl << pipe.endId << endl
-                 << pipe.startType << endl << pipe.endType << endl;
-        }
-        
-        file << "STATIONS " << stations.size() << endl;
-        for (const auto& station : stations) {
-            file << station.id << endl << station.name << endl << station.totalWorkshops << endl
-                 << station.activeWorkshops << endl << station.stationClass << endl;
-        }
-        
-        file << "NETWORK " << network.size() << endl;
-        for (const auto& conn : network) {
-            file << conn.pipeId << endl << conn.startId << endl << conn.endId << endl
-                 << conn.startType << endl << conn.endType << endl;
-        }
-        
-        file.close();
+
         cout << "Данные сохранены в файл: " << fs::absolute(filename) << endl;
         logger.log("Сохранение данных", "Файл: " + filename +
-                  ", Трубы: " + to_string(pipes.size()) +
-                  ", КС: " + to_string(stations.size()) +
-                  ", Соединения: " + to_string(network.size()));
+                  ", Трубы: " + to_string(core.getPipes().size()) +
+                  ", КС: " + to_string(core.getStations().size()) +
+                  ", Соединения: " + to_string(core.getNetwork().size()));
     }
 
     void loadData() {
         string filename = InputValidator::getStringInput("Введите имя файла для загрузки: ");
-        
-        ifstream file(filename);
-        if (!file.is_open()) {
-            cout << "Ошибка: файл " << filename << " не найден.\n";
+
+        // Снимок открывается лениво: трубы и соединения разбираются при первом обращении
+        switch (core.loadFromFile(filename, SaveFormat::Network, LoadMode::Lazy)) {
+            case LoadStatus::FileNotFound:
+                cout << "Ошибка: файл " << filename << " не найден.\n";
+                return;
+            case LoadStatus::BadFormat:
+                cout << "Ошибка: неверный формат файла.\n";
+                return;
+            case LoadStatus::Ok:
+                break;
+        }
+
+        cout << "Данные загружены из файла: " << fs::absolute(filename) << endl;
+        damageReported = false;
+        // Размер секции - тоже обращение к ней, поэтому у отложенных секций он не выводится
+        if (!core.getPipes().isLoaded()) {
+            cout << "Загружено КС: " << core.getStations().size()
+                 << ". Трубы и соединения будут прочитаны из снимка при первом обращении.\n";
+            logger.log("Загрузка данных", "Файл: " + filename + ", КС: " + to_string(core.getStations().size()) +
+                      ", Трубы и соединения: отложены");
             return;
         }
-        
-        pipes.clear();
-        stations.clear();
-        network.clear();
-        
-        string header;
-        size_t count;
-        
-        file >> header >> nextPipeId;
-        if (header != "NEXT_PIPE_ID") {
-            file.seekg(0);
-            nextPipeId = 1;
-            nextStationId = 1;
+        cout << "Загружено труб: " << core.getPipes().size() << ", КС: " << core.getStations().size()
+             << ", Соединений: " << core.getNetwork().size() << endl;
+        logger.log("Загрузка данных", "Файл: " + filename +
+                  ", Трубы: " + to_string(core.getPipes().size()) +
+                  ", КС: " + to_string(core.getStations().size()) +
+                  ", Соединения: " + to_string(core.getNetwork().size()));
+    }
+
+    void undoChange() {
+        if (!history.undo(core)) {
+            cout << "Нет действий для отмены.\n";
+            return;
+        }
+        autosaver.update(core);
+        cout << "Последнее изменение отменено. Доступно отмен: " << history.undoDepth() << "\n";
+        logger.log("Отмена изменения", "Доступно отмен: " + to_string(history.undoDepth()));
+    }
+
+    void redoChange() {
+        if (!history.redo(core)) {
+            cout << "Нет отмененных действий для повтора.\n";
+            return;
+        }
+        autosaver.update(core);
+        cout << "Отмененное изменение восстановлено. Доступно повторов: " << history.redoDepth() << "\n";
+        logger.log("Повтор изменения", "Доступно повторов: " + to_string(history.redoDepth()));
+    }
+
+    // Несколько маршрутов в обход труб в ремонте, от кратчайшего к длинному
+    void findAlternativeRoutes() {
+        if (core.getNetwork().empty()) {
+            cout << "Сеть пуста!\n";
+            return;
+        }
+
+        int startId = InputValidator::getIntInput("Введите ID начальной точки: ", 1);
+        int endId = InputValidator::getIntInput("Введите ID конечной точки: ", 1);
+        int count = InputValidator::getIntInput("Сколько маршрутов показать (1-20): ", 1, 20);
+
+        RoutesResult result = core.findAlternativeRoutes(startId, endId, count);
+        switch (result.status) {
+            case PathStatus::StartNotFound:
+                cout << "Начальная точка не найдена!\n";
+                return;
+            case PathStatus::EndNotFound:
+                cout << "Конечная точка не найдена!\n";
+                return;
+            case PathStatus::NotInNetwork:
+                cout << "Одна или обе точки не подключены к сети!\n";
+                return;
+            case PathStatus::NoPath:
+            case PathStatus::EmptyNetwork:
+                cout << "Маршрут в обход труб в ремонте не найден!\n";
+                return;
+            case PathStatus::Found:
+                break;
+        }
+
+        cout << "\nНайдено маршрутов: " << result.routes.size() << endl;
+        for (size_t i = 0; i < result.routes.size(); ++i) {
+            const Route& route = result.routes[i];
+            cout << (i + 1) << ". Длина: " << route.totalLength << " км, узлы: ";
+            for (size_t j = 0; j < route.nodes.size(); ++j) {
+                if (j > 0) cout << " -> ";
+                cout << route.nodes[j];
+            }
+            cout << "; трубы: ";
+            for (size_t j = 0; j < route.pipeIds.size(); ++j) {
+                if (j > 0) cout << ", ";
+                cout << route.pipeIds[j];
+            }
+            cout << endl;
+        }
+
+        logger.log("Поиск маршрутов", "От: " + to_string(startId) + " до: " + to_string(endId) +
+                  ", Найдено: " + to_string(result.routes.size()));
+    }
+
+    // Проверка достижимости по направлению соединений
+    void checkReachability() const {
+        if (core.getNetwork().empty()) {
+            cout << "Сеть пуста!\n";
+            return;
+        }
+
+        int startId = InputValidator::getIntInput("Введите ID начальной точки: ", 1);
+        int endId = InputValidator::getIntInput("Введите ID конечной точки: ", 1);
+        if (core.getObjectInfo(startId).second == -1 || core.getObjectInfo(endId).second == -1) {
+            cout << "Объект не найден!\n";
+            return;
+        }
+
+        if (core.canReach(startId, endId)) {
+            cout << "Газ из объекта " << startId << " доходит до объекта " << endId << endl;
         } else {
-            file >> header >> nextStationId;
+            cout << "Из объекта " << startId << " нельзя попасть в объект " << endId << endl;
         }
-        
-        file >> header >> count;
-        if (header != "PIPES") {
-            cout << "Ошибка: неверный формат файла.\n";
+    }
+
+    // Установившийся режим: давления в узлах и расходы по трубам
+    void calculateFlow() const {
+        if (core.getNetwork().empty()) {
+            cout << "Сеть пуста!\n";
             return;
         }
-        file.ignore();
-        
-        for (size_t i = 0; i < count; ++i) {
-            Pipe pipe;
-            file >> pipe.id;
-            file.ignore();
-            getline(file, pipe.name);
-            file >> pipe.length >> pipe.diameter >> pipe.underRepair
-                 >> pipe.inUse >> pipe.startId >> pipe.endId
-                 >> pipe.startType >> pipe.endType;
-            file.ignore();
-            pipes.push_back(pipe);
+
+        FlowSettings settings;
+        settings.sourcePressure = InputValidator::getDoubleInput("Давление на входах сети (МПа): ", 0.1, 20);
+        settings.deliveryPressure = InputValidator::getDoubleInput("Давление на выходах сети (МПа): ", 0.1,
+                                                                   settings.sourcePressure);
+
+        FlowResult result = core.solveFlow(settings);
+        if (!result.converged) {
+            cout << "Расчет не сошелся за " << result.iterations << " итераций, небаланс "
+                 << result.residual << " млн м3/сут. Результат приближенный!\n";
+            switch (result.status) {
+                case FlowStatus::LinearSolverFailed: cout << "Не решена линейная система шага Ньютона.\n"; break;
+                case FlowStatus::StepRejected: cout << "Шаг Ньютона не уменьшает небаланс.\n"; break;
+                default: break;
+            }
+        } else {
+            cout << "\nРасчет сошелся за " << result.iterations << " итераций\n";
         }
-        
-        file >> header >> count;
-        if (header != "STATIONS") {
-            cout << "Ошибка: неверный формат файла.\n";
+        cout << "Подача в сеть: " << result.totalSupply << " млн м3/сут\n";
+
+        cout << "\nДавления в узлах:\n";
+        for (const FlowNode& node : result.nodes) {
+            cout << (node.isStation ? "КС " : "Труба ") << node.id << ": ";
+            switch (node.role) {
+                case FlowNodeRole::Source: cout << node.pressure << " МПа (вход)\n"; break;
+                case FlowNodeRole::Delivery: cout << node.pressure << " МПа (выход)\n"; break;
+                case FlowNodeRole::Junction: cout << node.pressure << " МПа\n"; break;
+                case FlowNodeRole::Undetermined: cout << "не определено (нет входа и выхода)\n"; break;
+            }
+        }
+        cout << "\nРасходы по трубам:\n";
+        for (const PipeFlow& pipe : result.pipes) {
+            cout << "Труба " << pipe.pipeId << ": " << pipe.flow << " млн м3/сут\n";
+        }
+
+        logger.log("Расчет режима течения", "Итераций: " + to_string(result.iterations) +
+                  ", Подача: " + to_string(result.totalSupply));
+    }
+
+    // Переходный режим после изменения числа работающих цехов КС
+    void simulateTransient() const {
+        if (core.getNetwork().empty()) {
+            cout << "Сеть пуста!\n";
             return;
         }
-        file.ignore();
-        
-        for (size_t i = 0; i < count; ++i) {
-            CompressorStation station;
-            file >> station.id;
-            file.ignore();
-            getline(file, station.name);
-            file >> station.totalWorkshops >> station.activeWorkshops >> station.stationClass;
-            file.ignore();
-            
-            if (station.activeWorkshops > station.totalWorkshops) {
-                station.activeWorkshops = station.totalWorkshops;
+
+        int stationId = InputValidator::getIntInput("Введите ID КС, на которой меняется число цехов: ", 1);
+        int index = core.findStationIndexById(stationId);
+        if (index == -1) {
+            cout << "КС не найдена!\n";
+            return;
+        }
+        const CompressorStation& station = core.getStations()[index];
+        int active = InputValidator::getIntInput("Новое число работающих цехов: ", 0, station.totalWorkshops);
+        double changeHours = InputValidator::getDoubleInput("Через сколько часов изменить: ", 0, 1000);
+        double totalHours = InputValidator::getDoubleInput("Длительность моделирования (ч): ", 0.1, 10000);
+        int pipeId = InputValidator::getIntInput("ID трубы для наблюдения за расходом (0 - нет): ", 0);
+
+        TransientSettings settings;
+        settings.sampleInterval = max(totalHours * 3600 / 24, 60.0);
+        TransientSimulator simulation = core.createTransientSimulation(settings);
+        if (!simulation.watchStation(stationId)) {
+            cout << "КС не подключена к сети!\n";
+            return;
+        }
+        if (pipeId != 0 && !simulation.watchPipe(pipeId)) {
+            cout << "Труба " << pipeId << " не подключена к сети, расход не выводится.\n";
+        }
+        simulation.scheduleWorkshops(changeHours * 3600, stationId, active);
+        if (simulation.run(totalHours * 3600) == TransientStatus::NotConverged) {
+            cout << "Внимание: шагов без сходимости расчета - " << simulation.getUnconvergedStepCount()
+                 << ", результаты приближенные.\n";
+        }
+
+        const auto& times = simulation.getSampleTimes();
+        const auto& series = simulation.getSeries();
+        cout << "\nВремя (ч)  Давление на КС " << stationId << " (МПа)";
+        if (series.size() > 1) {
+            cout << "  Расход по трубе " << pipeId << " (млн м3/сут)";
+        }
+        cout << endl;
+        for (size_t i = 0; i < times.size(); ++i) {
+            cout << fixed << setprecision(2) << times[i] / 3600 << "\t   " << setprecision(4) << series[0].values[i];
+            if (series.size() > 1) {
+                cout << "\t\t\t" << series[1].values[i];
             }
-            
-            stations.push_back(station);
+            cout << endl;
         }
-        
-        // Загрузка сети (если есть)
-        if (file >> header >> count) {
-            if (header == "NETWORK") {
-                file.ignore();
-                for (size_t i = 0; i < count; ++i) {
-                    NetworkConnection conn;
-                    file >> conn.pipeId >> conn.startId >> conn.endId
-                         >> conn.startType >> conn.endType;
-                    file.ignore();
-                    network.push_back(conn);
+        cout << defaultfloat << setprecision(6) << "Шагов по времени: " << simulation.getStepCount() << endl;
+
+        logger.log("Моделирование переходного режима", "КС: " + to_string(stationId) +
+                  ", Цехов: " + to_string(active) + ", Шагов: " + to_string(simulation.getStepCount()));
+    }
+
+    // Выгрузка сети для программ визуализации
+    void exportNetwork() const {
+        int formatChoice = InputValidator::getIntInput("Формат (1 - DOT для Graphviz, 2 - GraphML): ", 1, 2);
+        ExportFormat format = formatChoice == 1 ? ExportFormat::Dot : ExportFormat::GraphML;
+        string filename = InputValidator::getStringInput("Введите имя файла для выгрузки: ");
+        if (filename.find('.') == string::npos) {
+            filename += format == ExportFormat::Dot ? ".dot" : ".graphml";
+        }
+
+        if (!core.exportNetwork(filename, format)) {
+            cout << "Ошибка: невозможно создать файл " << filename << endl;
+            return;
+        }
+
+        cout << "Сеть выгружена в файл: " << fs::absolute(filename) << endl;
+        logger.log("Выгрузка сети", "Файл: " + filename + ", Соединения: " + to_string(core.getNetwork().size()));
+    }
+
+    // Вывод причины, по которой строка CSV отклонена
+    void printCsvRowError(const CsvRowError& error) const {
+        cout << "Строка " << error.line << ": ";
+        switch (error.problem) {
+            case CsvRowProblem::MissingField: cout << "не хватает полей\n"; break;
+            case CsvRowProblem::BadNumber: cout << "некорректное число\n"; break;
+            case CsvRowProblem::EmptyName: cout << "пустое название\n"; break;
+            case CsvRowProblem::BadLength: cout << "длина должна быть не меньше 0.001 км\n"; break;
+            case CsvRowProblem::BadDiameter: cout << "недопустимый диаметр\n"; break;
+            case CsvRowProblem::BadWorkshops: cout << "некорректное число цехов\n"; break;
+            case CsvRowProblem::BadClass: cout << "класс должен быть не меньше 1\n"; break;
+            case CsvRowProblem::BadFlag: cout << "признак ремонта должен быть 0 или 1\n"; break;
+            case CsvRowProblem::NamesExhausted: cout << "нет места для нового названия\n"; break;
+            case CsvRowProblem::Connect:
+                switch (error.connectStatus) {
+                    case ConnectStatus::SameObject: cout << "нельзя соединить объект с самим собой\n"; break;
+                    case ConnectStatus::StartNotFound: cout << "начальный объект не существует\n"; break;
+                    case ConnectStatus::EndNotFound: cout << "конечный объект не существует\n"; break;
+                    case ConnectStatus::StartUnderRepair: cout << "начальная труба в ремонте\n"; break;
+                    case ConnectStatus::EndUnderRepair: cout << "конечная труба в ремонте\n"; break;
+                    case ConnectStatus::AlreadyExists: cout << "соединение уже существует\n"; break;
+                    case ConnectStatus::DiameterMismatch:
+                        cout << "диаметр не совпадает с диаметром соединяемых труб\n";
+                        break;
+                    case ConnectStatus::NoFreePipe:
+                        cout << "нет свободной трубы нужного диаметра (укажите name и length)\n";
+                        break;
+                    default: cout << "соединение невозможно\n"; break;
+                }
+                break;
+        }
+    }
+
+    // Массовый импорт труб, КС или соединений из CSV
+    void importCsv() {
+        int tableChoice = InputValidator::getIntInput("Что импортировать (1 - трубы, 2 - КС, 3 - соединения): ", 1, 3);
+        CsvTable table = tableChoice == 1 ? CsvTable::Pipes : tableChoice == 2 ? CsvTable::Stations
+                                                                                 : CsvTable::Connections;
+        string filename = InputValidator::getStringInput("Введите имя файла CSV: ");
+
+        CsvImportReport report = core.importCsv(filename, table);
+        if (report.status == CsvImportStatus::FileNotFound) {
+            cout << "Ошибка: файл " << filename << " не найден!\n";
+            return;
+        }
+        if (report.status == CsvImportStatus::BadHeader) {
+            cout << "Ошибка: в заголовке нет обязательных столбцов!\n";
+            return;
+        }
+
+        cout << "Импортировано строк: " << report.imported << ", отклонено: " << report.rejected << endl;
+        const size_t shown = min<size_t>(report.errors.size(), 20);
+        for (size_t i = 0; i < shown; ++i) {
+            printCsvRowError(report.errors[i]);
+        }
+        if (report.rejected > shown) {
+            cout << "... и еще " << report.rejected - shown << " строк с ошибками\n";
+        }
+        logger.log("Импорт из CSV", "Файл: " + filename + ", Импортировано: " + to_string(report.imported) +
+                  ", Отклонено: " + to_string(report.rejected));
+    }
+
+    static void printChange(const NetworkChange& change) {
+        const char* sign = change.kind == ChangeKind::Added     ? "+ "
+                           : change.kind == ChangeKind::Removed ? "- "
+                                                                : "~ ";
+        cout << sign;
+        if (change.connection) {
+            const Pipe* pipe = change.connectionPipe;
+            cout << "соединение ";
+            if (pipe) {
+                cout << endpointLabel(startIsStation(*pipe), pipe->startId) << " -> "
+                     << endpointLabel(endIsStation(*pipe), pipe->endId) << ' ';
+            }
+            cout << "трубой " << change.connection->pipeId << endl;
+        } else if (change.pipeBefore || change.pipeAfter) {
+            const Pipe& pipe = change.pipeAfter ? *change.pipeAfter : *change.pipeBefore;
+            cout << "труба " << pipe.id << " \"" << pipe.name << "\"";
+            if (change.kind == ChangeKind::Modified) {
+                const Pipe& old = *change.pipeBefore;
+                if (old.name != pipe.name) cout << ", название: \"" << old.name << "\"";
+                if (old.length != pipe.length) cout << ", длина: " << old.length << " -> " << pipe.length;
+                if (old.diameter != pipe.diameter) cout << ", диаметр: " << old.diameter << " -> " << pipe.diameter;
+                if (old.underRepair != pipe.underRepair) cout << (pipe.underRepair ? ", в ремонт" : ", из ремонта");
+                if (old.inUse != pipe.inUse) cout << (pipe.inUse ? ", подключена" : ", отключена");
+            }
+            cout << endl;
+        } else {
+            const CompressorStation& station = change.stationAfter ? *change.stationAfter : *change.stationBefore;
+            cout << "КС " << station.id << " \"" << station.name << "\"";
+            if (change.kind == ChangeKind::Modified) {
+                const CompressorStation& old = *change.stationBefore;
+                if (old.name != station.name) cout << ", название: \"" << old.name << "\"";
+                if (old.totalWorkshops != station.totalWorkshops) {
+                    cout << ", цехов: " << old.totalWorkshops << " -> " << station.totalWorkshops;
+                }
+                if (old.activeWorkshops != station.activeWorkshops) {
+                    cout << ", работает: " << old.activeWorkshops << " -> " << station.activeWorkshops;
+                }
+                if (old.stationClass != station.stationClass) {
+                    cout << ", класс: " << old.stationClass << " -> " << station.stationClass;
                 }
             }
+            cout << endl;
+        }
+    }
+
+    // Сравнение двух файлов сохранения и, по желанию, запись патча
+    void compareSaves() const {
+        string before = InputValidator::getStringInput("Файл до изменений: ");
+        string after = InputValidator::getStringInput("Файл после изменений: ");
+        PipelineCore first, second;
+        for (auto [state, filename] : {make_pair(&first, before), make_pair(&second, after)}) {
+            switch (state->loadFromFile(filename)) {
+                case LoadStatus::FileNotFound:
+                    cout << "Ошибка: файл " << filename << " не найден.\n";
+                    return;
+                case LoadStatus::BadFormat:
+                    cout << "Ошибка: неверный формат файла " << filename << ".\n";
+                    return;
+                case LoadStatus::Ok:
+                    break;
+            }
+        }
+
+        const size_t shownLimit = 30;
+        size_t shown = 0;
+        DiffSummary summary = first.diff(second, [&](const NetworkChange& change) {
+            if (shown++ < shownLimit) {
+                printChange(change);
+            }
+        });
+        if (summary.total() == 0) {
+            cout << "Различий нет.\n";
+            return;
+        }
+        if (summary.total() > shownLimit) {
+            cout << "... и еще " << summary.total() - shownLimit << " изменений\n";
+        }
+        cout << "Трубы: +" << summary.pipesAdded << " -" << summary.pipesRemoved << " ~" << summary.pipesModified
+             << "; КС: +" << summary.stationsAdded << " -" << summary.stationsRemoved << " ~" << summary.stationsModified
+             << "; соединения: +" << summary.connectionsAdded << " -" << summary.connectionsRemoved << endl;
+
+        string patchFile = InputValidator::getStringInput("Файл для патча (0 - не сохранять): ");
+        if (patchFile == "0") {
+            return;
+        }
+        if (!first.savePatch(second, patchFile, summary)) {
+            cout << "Ошибка: невозможно создать файл " << patchFile << endl;
+            return;
+        }
+        cout << "Патч сохранен в файл: " << fs::absolute(patchFile) << endl;
+        logger.log("Сравнение сохранений", before + " -> " + after + ", Изменений: " + to_string(summary.total()));
+    }
+
+    void applyPatch() {
+        string filename = InputValidator::getStringInput("Введите имя файла патча: ");
+        switch (core.applyPatch(filename)) {
+            case PatchStatus::FileNotFound:
+                cout << "Ошибка: файл " << filename << " не найден.\n";
+                return;
+            case PatchStatus::BadFormat:
+                cout << "Ошибка: неверный формат патча.\n";
+                return;
+            case PatchStatus::Conflict:
+                cout << "Ошибка: патч не соответствует текущим данным, изменения не внесены.\n";
+                return;
+            case PatchStatus::NamesExhausted:
+                cout << "Ошибка: нет места для новых названий, изменения не внесены.\n";
+                return;
+            case PatchStatus::Ok:
+                break;
+        }
+        cout << "Патч применен. Труб: " << core.getPipes().size() << ", КС: " << core.getStations().size()
+             << ", Соединений: " << core.getNetwork().size() << endl;
+        logger.log("Применение патча", "Файл: " + filename);
+    }
+
+    // Таблица процентилей по операциям, состояние кэша запросов и управление сбором статистики
+    void showMetrics() const {
+        OperationMetrics& metrics = OperationMetrics::instance();
+        cout << "\nСбор статистики операций " << (metrics.enabled() ? "включен" : "выключен") << endl;
+        vector<OperationStats> all = metrics.collect();
+        if (all.empty()) {
+            cout << "Замеров пока нет.\n";
+        } else {
+            auto micro = [](uint64_t nanoseconds) { return nanoseconds / 1000.0; };
+            cout << "Время в мкс\n";
+            // setw считает байты, поэтому русские заголовки выровнены вручную
+            cout << "Операция           Вызовов" << setw(12) << "p50" << setw(12) << "p90" << setw(12) << "p99"
+                 << setw(12) << "p99.9" << "        Макс" << endl;
+            cout << fixed << setprecision(1);
+            for (const OperationStats& stats : all) {
+                cout << left << setw(16) << operationName(stats.operation) << right << setw(10) << stats.count
+                     << setw(12) << micro(stats.p50) << setw(12) << micro(stats.p90) << setw(12) << micro(stats.p99)
+                     << setw(12) << micro(stats.p999) << setw(12) << micro(stats.max) << endl;
+            }
+            cout << defaultfloat << setprecision(6);
+        }
+        QueryCacheStats cache = core.getQueryCacheStats();
+        cout << "Кэш путей и сортировки: попаданий " << cache.hits << ", промахов " << cache.misses
+             << ", вытеснено " << cache.evictions << ", записей " << cache.entries << " ("
+             << cache.bytes / 1024 << " из " << cache.capacityBytes / 1024 << " КБ)\n";
+
+        int choice = InputValidator::getIntInput(
+            string("1 - ") + (metrics.enabled() ? "выключить" : "включить") +
+            " сбор, 2 - сбросить, 3 - выгрузить для Prometheus, 0 - назад: ", 0, 3);
+        if (choice == 1) {
+            metrics.setEnabled(!metrics.enabled());
+            cout << "Сбор статистики " << (metrics.enabled() ? "включен" : "выключен") << ".\n";
+            logger.log("Статистика операций", metrics.enabled() ? "Сбор включен" : "Сбор выключен");
+        } else if (choice == 2) {
+            metrics.reset();
+            core.clearQueryCache();
+            cout << "Статистика и кэш запросов сброшены.\n";
+        } else if (choice == 3) {
+            string filename = InputValidator::getStringInput("Введите имя файла для выгрузки: ");
+            if (!metrics.exportPrometheus(filename)) {
+                cout << "Ошибка: невозможно создать файл " << filename << endl;
+                return;
+            }
+            cout << "Статистика выгружена в файл: " << fs::absolute(filename) << endl;
+            logger.log("Выгрузка статистики операций", "Файл: " + filename);
+        }
+    }
+
+    // Первый вызов начинает запись трассы, второй останавливает и сохраняет ее
+    void toggleTracing() const {
+        TraceRecorder& recorder = TraceRecorder::instance();
+        if (!recorder.enabled()) {
+            recorder.start();
+            cout << "Запись трассы начата. Выполните нужные операции и снова выберите этот пункт.\n";
+            logger.log("Трассировка", "Запись начата");
+            return;
+        }
+        recorder.stop();
+        string filename = InputValidator::getStringInput("Введите имя файла трассы (0 - не сохранять): ");
+        if (filename == "0") {
+            cout << "Запись трассы остановлена.\n";
+            return;
+        }
+        if (filename.find('.') == string::npos) {
+            filename += ".json";
+        }
+        if (!recorder.saveChromeTrace(filename)) {
+            cout << "Ошибка: невозможно создать файл " << filename << endl;
+            return;
+        }
+        cout << "Трасса (" << recorder.eventCount() << " событий) сохранена в файл: " << fs::absolute(filename)
+             << "\nОткройте его в Perfetto (ui.perfetto.dev) или chrome://tracing.\n";
+        logger.log("Трассировка", "Файл: " + filename + ", События: " + to_string(recorder.eventCount()));
+    }
+
+    // Память по структурам в мегабайтах: занято данными, выделено и пик
+    void showMemoryUsage() const {
+        MemoryReport report = core.memoryReport();
+        auto megabytes = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+        cout << "\nИспользование памяти, МБ (выделено - во всех версиях, включая историю отмены: "
+             << history.undoDepth() << " шагов)\n";
+        cout << "Структура          Занято    Выделено         Пик" << endl;
+        cout << fixed << setprecision(2);
+        for (const MemoryUsage& usage : report.entries) {
+            cout << left << setw(14) << memoryCategoryName(usage.category) << right << setw(12)
+                 << megabytes(usage.used) << setw(12) << megabytes(usage.reserved) << setw(12)
+                 << megabytes(usage.peak) << endl;
+        }
+        cout << left << setw(14) << "total" << right << setw(12) << megabytes(report.totalUsed) << setw(12)
+             << megabytes(report.totalReserved) << setw(12) << megabytes(report.totalPeak) << endl;
+        cout << defaultfloat << setprecision(6);
+
+        if (InputValidator::getIntInput("1 - сбросить пики, 0 - назад: ", 0, 1) == 1) {
+            MemoryTracker::instance().resetPeaks();
+            cout << "Пики сброшены.\n";
+        }
+    }
+
+    void showAutoSaveStatus() const {
+        AutoSaveStatus status = autosaver.getStatus();
+        cout << "\nАвтосохранение в файл " << autosaver.getFilename()
+             << " каждые " << autosaver.getInterval().count() << " с\n";
+
+        if (status.inProgress) {
+            cout << "Идет сохранение: записано " << status.written << " из " << status.total << " объектов\n";
+        }
+        cout << "Выполнено автосохранений: " << status.savesCompleted << endl;
+        if (status.savesCompleted > 0) {
+            time_t time = chrono::system_clock::to_time_t(status.lastSaveTime);
+            tm localTime{};
+            localtime_r(&time, &localTime);
+            cout << "Последнее автосохранение: " << put_time(&localTime, "%Y-%m-%d %H:%M:%S") << endl;
+        }
+        if (status.lastSaveFailed) {
+            cout << "Ошибка: последнее автосохранение не удалось, предыдущий файл сохранен без изменений!\n";
         }
-        
-        file.close();
-        cout << "Данные загружены из файла: " << fs::absolute(filename) << endl;
-        cout << "Загружено труб: " << pipes.size() << ", КС: " << stations.size()
-             << ", Соединений: " << network.size() << endl;
-        logger.log("Загрузка данных", "Файл: " + filename +
-                  ", Трубы: " + to_string(pipes.size()) +
-                  ", КС: " + to_string(stations.size()) +
-                  ", Соединения: " + to_string(network.size()));
     }
 
     void run() {
@@ -1454,11 +1379,21 @@ public:
                  << "12. Поиск труб\n13. Поиск КС\n14. Сохранить данные\n15. Загрузить данные\n"
                  << "16. Соединить объекты (создать сеть)\n17. Отключить трубу от сети\n"
                  << "18. Просмотр сети\n19. Топологическая сортировка КС\n"
-                 << "20. Поиск пути в сети\n0. Выход\n";
+                 << "20. Поиск пути в сети\n"
+                 << "21. Отменить последнее изменение\n22. Повторить отмененное изменение\n"
+                 << "23. Состояние автосохранения\n24. Проверить достижимость\n"
+                 << "25. Альтернативные маршруты\n26. Расчет режима течения газа\n"
+                 << "27. Переходный режим при смене цехов КС\n28. Выгрузить сеть (DOT/GraphML)\n"
+                 << "29. Импорт из CSV\n30. Сравнить файлы сохранения\n31. Применить патч\n"
+                 << "32. Статистика операций\n33. Трассировка (начать/остановить)\n"
+                 << "34. Использование памяти\n0. Выход\n";
             
-            int choice = InputValidator::getIntInput("Выберите действие: ", 0, 20);
+            int choice = InputValidator::getIntInput("Выберите действие: ", 0, 34);
             logger.log("Выбор меню", "Действие: " + to_string(choice));
-            
+
+            // Снимок до операции создается за O(1) и нужен для отмены
+            PipelineCore before = core;
+
             switch (choice) {
                 case 1: addPipe(); break;
                 case 2: addStation(); break;
@@ -1480,11 +1415,34 @@ public:
                 case 18: viewNetwork(); break;
                 case 19: topologicalSort(); break;
                 case 20: findPath(); break;
+                case 21: undoChange(); continue;
+                case 22: redoChange(); continue;
+                case 23: showAutoSaveStatus(); break;
+                case 24: checkReachability(); break;
+                case 25: findAlternativeRoutes(); break;
+                case 26: calculateFlow(); break;
+                case 27: simulateTransient(); break;
+                case 28: exportNetwork(); break;
+                case 29: importCsv(); break;
+                case 30: compareSaves(); break;
+                case 31: applyPatch(); break;
+                case 32: showMetrics(); break;
+                case 33: toggleTracing(); break;
+                case 34: showMemoryUsage(); break;
                 case 0:
                     cout << "Выход из программы.\n";
                     logger.log("Выход из программы");
                     return;
             }
+            // Подделанный снимок обнаруживается только при первом обращении к секции
+            if (core.deferredLoadFailed() && !damageReported) {
+                cout << "Ошибка: снимок поврежден, трубы или соединения не прочитаны и пусты.\n";
+                logger.log("Ошибка загрузки", "Поврежденная секция снимка");
+                damageReported = true;
+            }
+            if (history.commit(before, core)) {
+                autosaver.update(core);
+            }
         }
     }
 };
@@ -0,0 +1,54 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "MemoryAccounting.h"
+
+using namespace std;
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    // Ищем место в текущем блоке, затем в следующих уже выделенных
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        const uintptr_t aligned = (base + offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (aligned + bytes <= base + block.size) {
+            offset = aligned + bytes - base;
+            return reinterpret_cast<void*>(aligned);
+        }
+        ++current;
+        offset = 0;
+    }
+
+    // Блоки растут вдвое, чтобы их число оставалось логарифмическим
+    const size_t previous = blocks.empty() ? firstBlockSize / 2 : blocks.back().size;
+    const size_t size = max(previous * 2, bytes + alignment);
+    blocks.push_back({unique_ptr<byte[]>(new byte[size]), size});
+    MemoryTracker::instance().allocated(MemoryCategory::Scratch, size);
+    current = blocks.size() - 1;
+    offset = 0;
+    return do_allocate(bytes, alignment);
+}
+
+Arena::~Arena() {
+    MemoryTracker::instance().released(MemoryCategory::Scratch, bytesReserved());
+}
+
+void Arena::rewind(Mark position) {
+    current = position.block;
+    offset = position.offset;
+}
+
+size_t Arena::bytesReserved() const {
+    size_t total = 0;
+    for (const Block& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+Arena& Arena::forThread() {
+    thread_local Arena arena;
+    return arena;
+}
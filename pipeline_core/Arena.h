@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Монотонная арена: память выдается подряд из крупных блоков и не
+// освобождается по одному объекту. Вся арена (или все, что выделено после
+// отметки) возвращается разом за O(1), блоки остаются для следующих запросов,
+// так что после прогрева запросы не обращаются к системному аллокатору.
+//
+// Арена - memory_resource, поэтому годится и для std::pmr-контейнеров.
+// Не потокобезопасна: у каждого потока своя арена (forThread).
+// Блоки учитываются в MemoryTracker как Scratch.
+class Arena : public std::pmr::memory_resource {
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;   // блок, из которого идет выделение
+    size_t offset = 0;    // занято байт в текущем блоке
+    size_t firstBlockSize;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    explicit Arena(size_t firstBlockSize = 64 * 1024) : firstBlockSize(firstBlockSize) {}
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Массив из count элементов; T должен быть тривиальным - деструкторы не вызываются
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count, const T& value) {
+        T* result = allocateArray<T>(count);
+        std::uninitialized_fill_n(result, count, value);
+        return result;
+    }
+
+    // Позиция в арене; откат к ней освобождает все выделенное позже
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+    Mark mark() const { return {current, offset}; }
+    void rewind(Mark position);
+    void reset() { rewind({0, 0}); }
+
+    size_t bytesReserved() const;
+
+    // Арена текущего потока
+    static Arena& forThread();
+};
+
+// Откат арены при выходе из области видимости. Области вкладываются:
+// задача, выполненная потоком во время ожидания, освобождает только свое.
+class ArenaScope {
+private:
+    Arena& owner;
+    Arena::Mark start;
+
+public:
+    explicit ArenaScope(Arena& arena = Arena::forThread()) : owner(arena), start(arena.mark()) {}
+    ~ArenaScope() { owner.rewind(start); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    Arena& arena() { return owner; }
+};
@@ -0,0 +1,88 @@
+#include "AtomicFile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = filesystem;
+
+namespace {
+
+bool syncPath(const string& path, int flags) {
+    int fd = open(path.c_str(), flags);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Права прежнего целевого файла переходят к временному: иначе после
+// переименования файл получил бы права по умолчанию (с учетом umask)
+bool prepareTempFile(const string& tempPath, const string& path) {
+    int fd = open(tempPath.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat target;
+    bool ok = stat(path.c_str(), &target) != 0 || fchmod(fd, target.st_mode & 07777) == 0;
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Удаляет временный файл при любом выходе, кроме успешного переименования,
+// в том числе при исключении из функции записи
+class TempFileGuard {
+private:
+    string path;
+    bool kept = false;
+
+public:
+    explicit TempFileGuard(string path) : path(move(path)) {}
+    ~TempFileGuard() {
+        if (!kept) {
+            remove(path.c_str());
+        }
+    }
+
+    TempFileGuard(const TempFileGuard&) = delete;
+    TempFileGuard& operator=(const TempFileGuard&) = delete;
+
+    void keep() { kept = true; }
+};
+
+}
+
+bool writeFileAtomically(const string& path, const function<bool(ostream&)>& writer) {
+    // Уникальное имя, чтобы параллельные сохранения в один файл не мешали друг другу
+    static atomic<unsigned> counter{0};
+    string tempPath = path + ".tmp." + to_string(getpid()) + "." + to_string(counter++);
+    TempFileGuard guard(tempPath);
+
+    {
+        ofstream file(tempPath, ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        if (!writer(file) || !file.flush()) {
+            return false;
+        }
+    }
+
+    if (!prepareTempFile(tempPath, path) || rename(tempPath.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    guard.keep();
+
+    // Сбрасываем каталог, чтобы само переименование пережило сбой питания
+    fs::path directory = fs::absolute(path).parent_path();
+    syncPath(directory.string(), O_RDONLY | O_DIRECTORY);
+    return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+// Атомарная запись файла: данные пишутся во временный файл рядом с целевым,
+// сбрасываются на диск (fsync) и только затем временный файл переименовывается
+// в целевой. При сбое на любом этапе (и при исключении из writer) прежняя
+// версия файла остается нетронутой, а временный файл удаляется. Права
+// существующего файла сохраняются; новый файл получает права по умолчанию.
+bool writeFileAtomically(const std::string& path, const std::function<bool(std::ostream&)>& writer);
@@ -0,0 +1,99 @@
+#include "AutoSaver.h"
+
+#include <utility>
+
+using namespace std;
+
+AutoSaver::AutoSaver(string filename, chrono::seconds interval, SaveFormat format, const Logger* logger)
+    : filename(move(filename)), interval(interval), format(format), logger(logger) {
+    worker = thread(&AutoSaver::workerLoop, this);
+}
+
+AutoSaver::~AutoSaver() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    worker.join();
+}
+
+void AutoSaver::update(const PipelineCore& snapshot) {
+    lock_guard<mutex> lock(stateMutex);
+    pending = snapshot;
+}
+
+void AutoSaver::flush() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        flushRequested = true;
+    }
+    wakeUp.notify_all();
+}
+
+AutoSaveStatus AutoSaver::getStatus() const {
+    lock_guard<mutex> lock(stateMutex);
+    return status;
+}
+
+void AutoSaver::workerLoop() {
+    optional<PipelineCore> lastSaved;
+
+    unique_lock<mutex> lock(stateMutex);
+    while (true) {
+        wakeUp.wait_for(lock, interval, [this] { return stopping || flushRequested; });
+        flushRequested = false;
+
+        // Сохраняем, только если состояние изменилось с прошлого сохранения
+        if (pending && !(lastSaved && lastSaved->sharesStateWith(*pending))) {
+            PipelineCore snapshot = move(*pending);
+            pending.reset();
+            status.inProgress = true;
+            status.written = 0;
+            status.total = 0;
+
+            lock.unlock();
+            const bool ok = saveSnapshot(snapshot);
+            lock.lock();
+            if (ok) {
+                lastSaved = move(snapshot);
+            } else if (!pending) {
+                // Неудачный снимок повторяется на следующем такте или в деструкторе,
+                // если за время записи не пришел более новый
+                pending = move(snapshot);
+            }
+        } else {
+            pending.reset();
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+bool AutoSaver::saveSnapshot(const PipelineCore& snapshot) {
+    bool ok = snapshot.saveToFile(filename, format, [this](size_t written, size_t total) {
+        lock_guard<mutex> lock(stateMutex);
+        status.written = written;
+        status.total = total;
+    });
+
+    {
+        lock_guard<mutex> lock(stateMutex);
+        status.inProgress = false;
+        status.lastSaveFailed = !ok;
+        if (ok) {
+            status.savesCompleted++;
+            status.lastSaveTime = chrono::system_clock::now();
+        }
+    }
+
+    if (logger) {
+        logger->log(ok ? "Автосохранение" : "Ошибка автосохранения",
+                    "Файл: " + filename +
+                    ", Трубы: " + to_string(snapshot.getPipes().size()) +
+                    ", КС: " + to_string(snapshot.getStations().size()));
+    }
+    return ok;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "Logger.h"
+#include "PipelineCore.h"
+
+struct AutoSaveStatus {
+    bool inProgress = false;
+    size_t written = 0;      // записано объектов в текущем сохранении
+    size_t total = 0;        // всего объектов в текущем сохранении
+    size_t savesCompleted = 0;
+    bool lastSaveFailed = false;
+    std::chrono::system_clock::time_point lastSaveTime{};
+};
+
+// Периодическое автосохранение в фоновом потоке.
+// Основной поток после каждого изменения передает снимок состояния через update()
+// (копия PipelineCore стоит O(1)), а фоновый поток раз в interval записывает
+// последний снимок атомарно (временный файл + rename), не останавливая работу.
+class AutoSaver {
+private:
+    std::string filename;
+    std::chrono::seconds interval;
+    SaveFormat format;
+    const Logger* logger;
+
+    mutable std::mutex stateMutex;
+    std::condition_variable wakeUp;
+    std::optional<PipelineCore> pending;  // последний еще не сохраненный снимок
+    AutoSaveStatus status;
+    bool stopping = false;
+    bool flushRequested = false;
+    std::thread worker;
+
+    void workerLoop();
+    // false, если запись не удалась
+    bool saveSnapshot(const PipelineCore& snapshot);
+
+public:
+    AutoSaver(std::string filename, std::chrono::seconds interval,
+              SaveFormat format = SaveFormat::Network, const Logger* logger = nullptr);
+    // Перед завершением дописывает последний снимок
+    ~AutoSaver();
+
+    AutoSaver(const AutoSaver&) = delete;
+    AutoSaver& operator=(const AutoSaver&) = delete;
+
+    void update(const PipelineCore& snapshot);
+    // Сохранить последний снимок, не дожидаясь интервала
+    void flush();
+
+    AutoSaveStatus getStatus() const;
+    const std::string& getFilename() const { return filename; }
+    std::chrono::seconds getInterval() const { return interval; }
+};
@@ -0,0 +1,925 @@
+#include "CompactSnapshot.h"
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "PipeIndex.h"
+#include "TaskScheduler.h"
+#include "Tracing.h"
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = {'P', 'I', 'P', 'E', 'S', 'N', 'A', 'P'};
+const uint64_t VERSION = 1;
+
+// Порядок столбцов в каталоге; новые столбцы добавляются только в конец
+enum Column {
+    NAMES,
+    PIPE_ID,
+    PIPE_NAME,
+    PIPE_LENGTH,
+    PIPE_DIAMETER,
+    PIPE_FLAGS,  // ремонт, в сети, тип начала, тип конца: 6 бит
+    PIPE_START,
+    PIPE_END,
+    STATION_ID,
+    STATION_NAME,
+    STATION_TOTAL,
+    STATION_ACTIVE,
+    STATION_CLASS,
+    CONN_PIPE,
+    CONN_START,
+    CONN_END,
+    CONN_TYPES,  // тип начала, тип конца: 4 бита
+    INDEX,       // число названий КС в начале словаря и контрольные суммы столбцов
+    COLUMN_COUNT
+};
+
+// Столбцы, без которых снимок не разобрать; каталога INDEX может не быть
+// в снимках, записанных до его появления, - такие загружаются только целиком
+const size_t REQUIRED_COLUMNS = INDEX;
+
+// Разность соседних ID по модулю не больше 2^32; большее - признак порчи
+const int64_t MAX_DELTA = int64_t(1) << 33;
+
+// У КС нет столбца битов на запись, а серии повторов сжимают их столбцы до
+// нескольких байт, поэтому число КС ограничено явно - с запасом для любой сети
+const uint64_t MAX_STATIONS = uint64_t(1) << 24;
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class ByteWriter {
+public:
+    string bytes;
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    void signedVarint(int64_t value) { varint(zigzag(value)); }
+    void raw(string_view text) { bytes.append(text.data(), text.size()); }
+};
+
+// Чтение с проверкой границ: выход за конец взводит признак ошибки
+class ByteReader {
+private:
+    string_view bytes;
+    size_t position = 0;
+    bool failed = false;
+
+public:
+    explicit ByteReader(string_view bytes) : bytes(bytes) {}
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64 && position < bytes.size(); shift += 7) {
+            const uint8_t byte = static_cast<uint8_t>(bytes[position++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    int64_t signedVarint() { return unzigzag(varint()); }
+
+    string_view raw(uint64_t size) {
+        if (size > bytes.size() - position) {
+            failed = true;
+            return {};
+        }
+        string_view text = bytes.substr(position, size);
+        position += size;
+        return text;
+    }
+
+    string_view rest() const { return bytes.substr(position); }
+    bool ok() const { return !failed; }
+    bool done() const { return !failed && position == bytes.size(); }
+};
+
+// Биты пишутся с младшего; последний байт дополняется нулями
+class BitWriter {
+private:
+    string& bytes;
+    uint64_t pending = 0;
+    int pendingBits = 0;
+
+public:
+    explicit BitWriter(string& bytes) : bytes(bytes) {}
+    ~BitWriter() { finish(); }
+
+    void put(uint64_t value, int bits) {
+        if (bits > 32) {
+            put(value & 0xffffffffu, 32);
+            put(value >> 32, bits - 32);
+            return;
+        }
+        if (bits == 0) {
+            return;
+        }
+        pending |= (value & ((uint64_t(1) << bits) - 1)) << pendingBits;
+        pendingBits += bits;
+        while (pendingBits >= 8) {
+            bytes.push_back(static_cast<char>(pending & 0xff));
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+
+    void finish() {
+        if (pendingBits > 0) {
+            bytes.push_back(static_cast<char>(pending));
+            pending = 0;
+            pendingBits = 0;
+        }
+    }
+};
+
+class BitReader {
+private:
+    string_view bytes;
+    size_t position = 0;
+    uint64_t pending = 0;
+    int pendingBits = 0;
+    bool failed = false;
+
+public:
+    explicit BitReader(string_view bytes) : bytes(bytes) {}
+
+    uint64_t get(int bits) {
+        if (bits > 32) {
+            const uint64_t low = get(32);
+            return low | (get(bits - 32) << 32);
+        }
+        while (pendingBits < bits) {
+            if (position >= bytes.size()) {
+                failed = true;
+                return 0;
+            }
+            pending |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[position++])) << pendingBits;
+            pendingBits += 8;
+        }
+        const uint64_t value = bits == 0 ? 0 : pending & ((uint64_t(1) << bits) - 1);
+        pending >>= bits;
+        pendingBits -= bits;
+        return value;
+    }
+
+    bool ok() const { return !failed; }
+    // Столбец прочитан целиком: остались только биты дополнения
+    bool done() const { return !failed && position == bytes.size() && pendingBits < 8; }
+};
+
+int bitWidth(size_t values) {
+    int width = 0;
+    while ((size_t(1) << width) < values) {
+        ++width;
+    }
+    return width;
+}
+
+// Сжатие double без потерь: XOR с предыдущим значением. Совпадение - бит 0;
+// иначе значащие биты XOR, а при выходе за прежнее окно - и новое окно
+// (ведущие нули - 5 бит, длина - 6 бит).
+class XorEncoder {
+private:
+    BitWriter& bits;
+    uint64_t previous = 0;
+    int leading = -1;
+    int trailing = 0;
+
+public:
+    explicit XorEncoder(BitWriter& bits) : bits(bits) {}
+
+    void put(double value) {
+        uint64_t current;
+        memcpy(&current, &value, sizeof(current));
+        const uint64_t difference = current ^ previous;
+        previous = current;
+        if (difference == 0) {
+            bits.put(0, 1);
+            return;
+        }
+        bits.put(1, 1);
+        const int lead = min(__builtin_clzll(difference), 31);
+        const int trail = __builtin_ctzll(difference);
+        if (leading != -1 && lead >= leading && trail >= trailing) {
+            bits.put(0, 1);
+            bits.put(difference >> trailing, 64 - leading - trailing);
+            return;
+        }
+        const int significant = 64 - lead - trail;
+        bits.put(1, 1);
+        bits.put(lead, 5);
+        bits.put(significant - 1, 6);
+        bits.put(difference >> trail, significant);
+        leading = lead;
+        trailing = trail;
+    }
+};
+
+class XorDecoder {
+private:
+    BitReader& bits;
+    uint64_t previous = 0;
+    int leading = -1;
+    int trailing = 0;
+
+public:
+    explicit XorDecoder(BitReader& bits) : bits(bits) {}
+
+    bool get(double& value) {
+        if (bits.get(1) != 0) {
+            uint64_t difference;
+            if (bits.get(1) == 0) {
+                if (leading == -1) {
+                    return false;
+                }
+                difference = bits.get(64 - leading - trailing) << trailing;
+            } else {
+                const int lead = static_cast<int>(bits.get(5));
+                const int significant = static_cast<int>(bits.get(6)) + 1;
+                if (lead + significant > 64) {
+                    return false;
+                }
+                leading = lead;
+                trailing = 64 - lead - significant;
+                difference = bits.get(significant) << trailing;
+            }
+            previous ^= difference;
+        }
+        memcpy(&value, &previous, sizeof(value));
+        return bits.ok();
+    }
+};
+
+// Столбец целых - разности соседних значений. Первый байт - способ записи:
+// каждая разность отдельно или серии (разность, повторов). Серии выигрывают
+// у ID подряд, неподключенных труб и одинаковых чисел цехов; берется
+// более короткий вариант.
+enum DeltaMode : char {
+    PLAIN_DELTAS,
+    DELTA_RUNS
+};
+
+template <typename Value>
+string encodeDeltas(size_t count, Value value) {
+    ByteWriter plain;
+    ByteWriter runs;
+    plain.bytes.push_back(PLAIN_DELTAS);
+    runs.bytes.push_back(DELTA_RUNS);
+    int64_t previous = 0;
+    int64_t runDelta = 0;
+    uint64_t runLength = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const int64_t current = value(i);
+        const int64_t delta = current - previous;
+        previous = current;
+        plain.signedVarint(delta);
+        if (runLength > 0 && delta != runDelta) {
+            runs.signedVarint(runDelta);
+            runs.varint(runLength);
+            runLength = 0;
+        }
+        runDelta = delta;
+        ++runLength;
+    }
+    if (runLength > 0) {
+        runs.signedVarint(runDelta);
+        runs.varint(runLength);
+    }
+    return move(runs.bytes.size() < plain.bytes.size() ? runs.bytes : plain.bytes);
+}
+
+// assign(i, value) возвращает false для недопустимого значения
+template <typename Assign>
+bool decodeDeltas(string_view bytes, size_t count, Assign assign) {
+    if (bytes.empty()) {
+        return false;
+    }
+    const bool runs = bytes[0] == DELTA_RUNS;
+    ByteReader column(bytes.substr(1));
+    int64_t previous = 0;
+    int64_t delta = 0;
+    uint64_t repeats = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (repeats == 0) {
+            delta = column.signedVarint();
+            repeats = runs ? column.varint() : 1;
+            if (!column.ok() || repeats == 0 || delta < -MAX_DELTA || delta > MAX_DELTA) {
+                return false;
+            }
+        }
+        --repeats;
+        const int64_t current = previous + delta;
+        if (current < INT_MIN || current > INT_MAX || !assign(i, static_cast<int>(current))) {
+            return false;
+        }
+        previous = current;
+    }
+    return repeats == 0 && column.done();
+}
+
+// Число значений в столбце разностей без разбора самих значений: счетчики
+// записей проверяются по нему до выделения памяти под записи
+bool countDeltas(string_view bytes, uint64_t& count) {
+    if (bytes.empty()) {
+        return false;
+    }
+    const bool runs = bytes[0] == DELTA_RUNS;
+    ByteReader column(bytes.substr(1));
+    count = 0;
+    while (column.ok() && !column.done()) {
+        column.signedVarint();
+        const uint64_t repeats = runs ? column.varint() : 1;
+        // Переполнение суммы подогнало бы счетчик под любой заголовок
+        if (repeats > UINT64_MAX - count) {
+            return false;
+        }
+        count += repeats;
+    }
+    return column.ok();
+}
+
+// Столбец упакованных битов фиксированной ширины: его длина однозначно
+// задает число записей, сколько бы их ни обещали столбцы с повторами
+bool matchesBitColumn(string_view bytes, uint64_t count, uint64_t bitsPerRecord) {
+    return count <= bytes.size() * 8 / bitsPerRecord && (count * bitsPerRecord + 7) / 8 == bytes.size();
+}
+
+// Словарь названий: у каждой строки - длина общего префикса с предыдущей и остаток
+string encodeNames(const vector<string_view>& names) {
+    ByteWriter column;
+    column.varint(names.size());
+    string_view previous;
+    for (string_view name : names) {
+        size_t shared = 0;
+        const size_t limit = min(previous.size(), name.size());
+        while (shared < limit && previous[shared] == name[shared]) {
+            ++shared;
+        }
+        column.varint(shared);
+        column.varint(name.size() - shared);
+        column.raw(name.substr(shared));
+        previous = name;
+    }
+    return move(column.bytes);
+}
+
+// limit - сколько первых строк разобрать (остальные не читаются)
+bool decodeNames(string_view bytes, vector<InternedName>& names, uint64_t limit = UINT64_MAX) {
+    ByteReader column(bytes);
+    const uint64_t count = column.varint();
+    if (!column.ok() || count > bytes.size()) {
+        return false;
+    }
+    const uint64_t decoded = min(count, limit);
+    names.reserve(decoded);
+    string current;
+    for (uint64_t i = 0; i < decoded; ++i) {
+        const uint64_t shared = column.varint();
+        const uint64_t suffix = column.varint();
+        if (shared > current.size()) {
+            return false;
+        }
+        current.resize(shared);
+        string_view text = column.raw(suffix);
+        if (!column.ok()) {
+            return false;
+        }
+        current.append(text.data(), text.size());
+        InternedName name;
+        if (!name.assign(current)) {
+            return false;
+        }
+        names.push_back(name);
+    }
+    return decoded < count || column.done();
+}
+
+// Контрольная сумма столбца: по 8 байт за шаг с перемешиванием умножением
+uint64_t checksum(string_view bytes) {
+    const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+    uint64_t hash = bytes.size() * multiplier;
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes.data() + i, sizeof(word));
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ static_cast<uint8_t>(bytes[i])) * multiplier;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// Словарь различных диаметров, затем номер в словаре на каждую трубу
+string encodeDiameters(const PersistentVector<Pipe>& pipes) {
+    vector<int> values;
+    unordered_map<int, uint32_t> index;
+    vector<uint32_t> codes(pipes.size());
+    for (size_t i = 0; i < pipes.size(); ++i) {
+        auto [it, added] = index.emplace(pipes[i].diameter, static_cast<uint32_t>(values.size()));
+        if (added) {
+            values.push_back(pipes[i].diameter);
+        }
+        codes[i] = it->second;
+    }
+    ByteWriter column;
+    column.varint(values.size());
+    for (int value : values) {
+        column.signedVarint(value);
+    }
+    {
+        BitWriter bits(column.bytes);
+        const int width = bitWidth(values.size());
+        for (uint32_t code : codes) {
+            bits.put(code, width);
+        }
+    }
+    return move(column.bytes);
+}
+
+bool decodeDiameters(string_view bytes, vector<Pipe>& pipes) {
+    ByteReader column(bytes);
+    const uint64_t count = column.varint();
+    if (!column.ok() || count > bytes.size()) {
+        return false;
+    }
+    vector<int> values(count);
+    for (auto& value : values) {
+        const int64_t decoded = column.signedVarint();
+        if (decoded < INT_MIN || decoded > INT_MAX) {
+            return false;
+        }
+        value = static_cast<int>(decoded);
+    }
+    if (!column.ok() || (count == 0 && !pipes.empty())) {
+        return false;
+    }
+    BitReader bits(column.rest());
+    const int width = bitWidth(count);
+    for (auto& pipe : pipes) {
+        const uint64_t code = bits.get(width);
+        if (code >= count) {
+            return false;
+        }
+        pipe.diameter = values[code];
+    }
+    return bits.done();
+}
+
+// Заголовок снимка: счетчики записей и границы столбцов
+struct Layout {
+    int nextPipeId = 1;
+    int nextStationId = 1;
+    uint64_t pipeCount = 0;
+    uint64_t stationCount = 0;
+    uint64_t connectionCount = 0;
+    vector<string_view> columns;
+};
+
+bool readLayout(string_view bytes, Layout& layout) {
+    if (!isCompactSnapshot(bytes)) {
+        return false;
+    }
+    ByteReader header(bytes.substr(sizeof(MAGIC)));
+    if (header.varint() != VERSION) {
+        return false;
+    }
+    const int64_t nextPipeId = header.signedVarint();
+    const int64_t nextStationId = header.signedVarint();
+    layout.pipeCount = header.varint();
+    layout.stationCount = header.varint();
+    layout.connectionCount = header.varint();
+    const uint64_t columnCount = header.varint();
+    if (!header.ok() || columnCount < REQUIRED_COLUMNS || columnCount > bytes.size() ||
+        nextPipeId < INT_MIN || nextPipeId > INT_MAX || nextStationId < INT_MIN || nextStationId > INT_MAX) {
+        return false;
+    }
+    layout.nextPipeId = static_cast<int>(nextPipeId);
+    layout.nextStationId = static_cast<int>(nextStationId);
+    vector<uint64_t> sizes(columnCount);
+    for (auto& size : sizes) {
+        size = header.varint();
+    }
+    layout.columns.resize(columnCount);
+    for (size_t c = 0; c < columnCount; ++c) {
+        layout.columns[c] = header.raw(sizes[c]);
+    }
+    // Старый снимок без каталога: столбец остается пустым
+    layout.columns.resize(max<size_t>(columnCount, COLUMN_COUNT));
+    uint64_t pipeIds = 0;
+    uint64_t stationIds = 0;
+    uint64_t connectionIds = 0;
+    // Счетчики сверяются до того, как под записи выделят память
+    return header.ok() && matchesBitColumn(layout.columns[PIPE_FLAGS], layout.pipeCount, 6) &&
+           matchesBitColumn(layout.columns[CONN_TYPES], layout.connectionCount, 4) &&
+           layout.stationCount <= MAX_STATIONS && countDeltas(layout.columns[PIPE_ID], pipeIds) && pipeIds == layout.pipeCount &&
+           countDeltas(layout.columns[STATION_ID], stationIds) && stationIds == layout.stationCount &&
+           countDeltas(layout.columns[CONN_PIPE], connectionIds) && connectionIds == layout.connectionCount;
+}
+
+// Разбор столбцов задачами: каждая пишет в свое поле записей, ошибка любой
+// задачи взводит общий признак. Без группы задачи выполняются сразу.
+class ColumnDecoder {
+private:
+    TaskGroup* group;
+    atomic<bool> failed{false};
+
+public:
+    explicit ColumnDecoder(TaskGroup* group) : group(group) {}
+
+    void run(function<bool()> column) {
+        if (!group) {
+            if (!failed && !column()) {
+                failed = true;
+            }
+            return;
+        }
+        group->run([this, column]() {
+            TraceSpan span("decode column");
+            if (!column()) {
+                failed = true;
+            }
+        });
+    }
+
+    bool finish() {
+        if (group) {
+            group->wait();
+        }
+        return !failed;
+    }
+};
+
+bool nameAt(const vector<InternedName>& names, int code, InternedName& name) {
+    if (code < 0 || static_cast<size_t>(code) >= names.size()) {
+        return false;
+    }
+    name = names[code];
+    return true;
+}
+
+// Флаги и типы - битовые поля одного байта, поэтому они в одном столбце
+// и разбираются одной задачей
+void decodePipes(ColumnDecoder& decoder, const Layout& layout, const vector<InternedName>& names,
+                 vector<Pipe>& pipes) {
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[PIPE_ID], layout.pipeCount,
+                            [&](size_t i, int value) { pipes[i].id = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[PIPE_NAME], layout.pipeCount,
+                            [&](size_t i, int value) { return nameAt(names, value, pipes[i].name); });
+    });
+    decoder.run([&]() {
+        BitReader bits(layout.columns[PIPE_LENGTH]);
+        XorDecoder lengths(bits);
+        for (auto& pipe : pipes) {
+            if (!lengths.get(pipe.length)) {
+                return false;
+            }
+        }
+        return bits.done();
+    });
+    decoder.run([&]() { return decodeDiameters(layout.columns[PIPE_DIAMETER], pipes); });
+    decoder.run([&]() {
+        BitReader bits(layout.columns[PIPE_FLAGS]);
+        for (auto& pipe : pipes) {
+            pipe.underRepair = bits.get(1) != 0;
+            pipe.inUse = bits.get(1) != 0;
+            pipe.startType = toConnectionType(static_cast<int>(bits.get(2)));
+            pipe.endType = toConnectionType(static_cast<int>(bits.get(2)));
+        }
+        return bits.done();
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[PIPE_START], layout.pipeCount,
+                            [&](size_t i, int value) { pipes[i].startId = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[PIPE_END], layout.pipeCount,
+                            [&](size_t i, int value) { pipes[i].endId = value; return true; });
+    });
+}
+
+void decodeStations(ColumnDecoder& decoder, const Layout& layout, const vector<InternedName>& names,
+                    vector<CompressorStation>& stations) {
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[STATION_ID], layout.stationCount,
+                            [&](size_t i, int value) { stations[i].id = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[STATION_NAME], layout.stationCount,
+                            [&](size_t i, int value) { return nameAt(names, value, stations[i].name); });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[STATION_TOTAL], layout.stationCount,
+                            [&](size_t i, int value) { stations[i].totalWorkshops = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[STATION_ACTIVE], layout.stationCount,
+                            [&](size_t i, int value) { stations[i].activeWorkshops = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[STATION_CLASS], layout.stationCount,
+                            [&](size_t i, int value) { stations[i].stationClass = value; return true; });
+    });
+}
+
+// Соединения со столбцами концов; в сеть из них попадают только ID труб
+void decodeNetwork(ColumnDecoder& decoder, const Layout& layout, vector<ConnectionRecord>& network) {
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[CONN_PIPE], layout.connectionCount,
+                            [&](size_t i, int value) { network[i].pipeId = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[CONN_START], layout.connectionCount,
+                            [&](size_t i, int value) { network[i].startId = value; return true; });
+    });
+    decoder.run([&]() {
+        return decodeDeltas(layout.columns[CONN_END], layout.connectionCount,
+                            [&](size_t i, int value) { network[i].endId = value; return true; });
+    });
+    decoder.run([&]() {
+        BitReader bits(layout.columns[CONN_TYPES]);
+        for (auto& conn : network) {
+            conn.startType = toConnectionType(static_cast<int>(bits.get(2)));
+            conn.endType = toConnectionType(static_cast<int>(bits.get(2)));
+        }
+        return bits.done();
+    });
+}
+
+void keepPipeIds(const vector<ConnectionRecord>& records, vector<NetworkConnection>& network) {
+    network.clear();
+    network.reserve(records.size());
+    for (const auto& record : records) {
+        network.push_back({record.pipeId});
+    }
+}
+
+// Как при загрузке текстового файла
+void clampActiveWorkshops(vector<CompressorStation>& stations) {
+    for (auto& station : stations) {
+        if (station.activeWorkshops > station.totalWorkshops) {
+            station.activeWorkshops = station.totalWorkshops;
+        }
+    }
+}
+
+}
+
+bool isCompactSnapshot(string_view bytes) {
+    return bytes.size() >= sizeof(MAGIC) && memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void writeCompactSnapshot(ostream& out, const PersistentVector<Pipe>& pipes,
+                          const PersistentVector<CompressorStation>& stations,
+                          const PersistentVector<NetworkConnection>& network, int nextPipeId, int nextStationId) {
+    // Словарь названий в порядке первого появления: у последовательных
+    // различных названий номера идут подряд, и разность занимает байт.
+    // Названия уже интернированы, поэтому ключ - номер в пуле, а не текст.
+    // Сначала идут названия КС: ленивая загрузка разбирает только их.
+    vector<string_view> names;
+    unordered_map<uint32_t, uint32_t> nameIndex;
+    nameIndex.reserve(pipes.size() + stations.size());
+    auto nameCode = [&](const InternedName& name) {
+        auto [it, added] = nameIndex.emplace(name.handleValue(), static_cast<uint32_t>(names.size()));
+        if (added) {
+            names.push_back(name.view());
+        }
+        return it->second;
+    };
+    vector<uint32_t> stationNames(stations.size());
+    for (size_t i = 0; i < stations.size(); ++i) {
+        stationNames[i] = nameCode(stations[i].name);
+    }
+    const size_t stationNameCount = names.size();
+    vector<uint32_t> pipeNames(pipes.size());
+    for (size_t i = 0; i < pipes.size(); ++i) {
+        pipeNames[i] = nameCode(pipes[i].name);
+    }
+
+    vector<string> columns(COLUMN_COUNT);
+    TaskGroup group;
+    group.run([&]() { columns[NAMES] = encodeNames(names); });
+
+    group.run([&]() { columns[PIPE_ID] = encodeDeltas(pipes.size(), [&](size_t i) { return pipes[i].id; }); });
+    group.run([&]() { columns[PIPE_NAME] = encodeDeltas(pipes.size(), [&](size_t i) { return pipeNames[i]; }); });
+    group.run([&]() {
+        BitWriter bits(columns[PIPE_LENGTH]);
+        XorEncoder lengths(bits);
+        for (const auto& pipe : pipes) {
+            lengths.put(pipe.length);
+        }
+    });
+    group.run([&]() { columns[PIPE_DIAMETER] = encodeDiameters(pipes); });
+    group.run([&]() {
+        BitWriter bits(columns[PIPE_FLAGS]);
+        for (const auto& pipe : pipes) {
+            bits.put(pipe.underRepair, 1);
+            bits.put(pipe.inUse, 1);
+            bits.put(pipe.startType, 2);
+            bits.put(pipe.endType, 2);
+        }
+    });
+    group.run([&]() { columns[PIPE_START] = encodeDeltas(pipes.size(), [&](size_t i) { return pipes[i].startId; }); });
+    group.run([&]() { columns[PIPE_END] = encodeDeltas(pipes.size(), [&](size_t i) { return pipes[i].endId; }); });
+
+    group.run([&]() { columns[STATION_ID] = encodeDeltas(stations.size(), [&](size_t i) { return stations[i].id; }); });
+    group.run([&]() {
+        columns[STATION_NAME] = encodeDeltas(stations.size(), [&](size_t i) { return stationNames[i]; });
+    });
+    group.run([&]() {
+        columns[STATION_TOTAL] = encodeDeltas(stations.size(), [&](size_t i) { return stations[i].totalWorkshops; });
+    });
+    group.run([&]() {
+        columns[STATION_ACTIVE] = encodeDeltas(stations.size(), [&](size_t i) { return stations[i].activeWorkshops; });
+    });
+    group.run([&]() {
+        columns[STATION_CLASS] = encodeDeltas(stations.size(), [&](size_t i) { return stations[i].stationClass; });
+    });
+
+    // Концы соединений берутся из их труб; у соединения без трубы - нули
+    vector<const Pipe*> connected(network.size());
+    {
+        PipeIndex pipeById(pipes);
+        for (size_t i = 0; i < network.size(); ++i) {
+            connected[i] = pipeById.find(network[i].pipeId);
+        }
+    }
+    group.run([&]() { columns[CONN_PIPE] = encodeDeltas(network.size(), [&](size_t i) { return network[i].pipeId; }); });
+    group.run([&]() {
+        columns[CONN_START] =
+            encodeDeltas(network.size(), [&](size_t i) { return connected[i] ? connected[i]->startId : 0; });
+    });
+    group.run([&]() {
+        columns[CONN_END] = encodeDeltas(network.size(), [&](size_t i) { return connected[i] ? connected[i]->endId : 0; });
+    });
+    group.run([&]() {
+        BitWriter bits(columns[CONN_TYPES]);
+        for (const Pipe* pipe : connected) {
+            bits.put(pipe ? pipe->startType : 0, 2);
+            bits.put(pipe ? pipe->endType : 0, 2);
+        }
+    });
+    group.wait();
+
+    ByteWriter index;
+    index.varint(stationNameCount);
+    for (size_t c = 0; c < INDEX; ++c) {
+        index.varint(checksum(columns[c]));
+    }
+    columns[INDEX] = move(index.bytes);
+
+    ByteWriter header;
+    header.raw(string_view(MAGIC, sizeof(MAGIC)));
+    header.varint(VERSION);
+    header.signedVarint(nextPipeId);
+    header.signedVarint(nextStationId);
+    header.varint(pipes.size());
+    header.varint(stations.size());
+    header.varint(network.size());
+    header.varint(columns.size());
+    for (const auto& column : columns) {
+        header.varint(column.size());
+    }
+    out.write(header.bytes.data(), header.bytes.size());
+    for (const auto& column : columns) {
+        out.write(column.data(), column.size());
+    }
+}
+
+bool readCompactSnapshot(string_view bytes, SnapshotContents& contents) {
+    Layout layout;
+    if (!readLayout(bytes, layout)) {
+        return false;
+    }
+    contents.nextPipeId = layout.nextPipeId;
+    contents.nextStationId = layout.nextStationId;
+    contents.pipes.assign(layout.pipeCount, Pipe());
+    contents.stations.assign(layout.stationCount, CompressorStation());
+    vector<ConnectionRecord> records(layout.connectionCount);
+
+    // Словарь нужен столбцам названий, поэтому разбирается первым;
+    // каждая различная строка интернируется один раз
+    TraceSpan phase("decode names");
+    vector<InternedName> names;
+    if (!decodeNames(layout.columns[NAMES], names)) {
+        return false;
+    }
+    phase.next("decode columns");
+    TaskGroup group;
+    ColumnDecoder decoder(&group);
+    decodePipes(decoder, layout, names, contents.pipes);
+    decodeStations(decoder, layout, names, contents.stations);
+    decodeNetwork(decoder, layout, records);
+    if (!decoder.finish()) {
+        return false;
+    }
+    // Каждое соединение ссылается на подключенную трубу с теми же концами
+    PipeIndex pipeById(contents.pipes);
+    for (const auto& record : records) {
+        if (!pipeById.connects(record)) {
+            return false;
+        }
+    }
+    keepPipeIds(records, contents.network);
+    clampActiveWorkshops(contents.stations);
+    return true;
+}
+
+bool openCompactSnapshot(shared_ptr<const string> bytes, SnapshotContents& contents, DeferredSections& deferred) {
+    Layout layout;
+    if (!readLayout(*bytes, layout)) {
+        return false;
+    }
+    ByteReader index(layout.columns[INDEX]);
+    const uint64_t stationNameCount = index.varint();
+    vector<uint64_t> checksums(INDEX);
+    for (auto& sum : checksums) {
+        sum = index.varint();
+    }
+    if (layout.columns[INDEX].empty() || !index.ok()) {
+        return false;
+    }
+    // Порча отложенных столбцов обнаружится сейчас, а не при первом
+    // обращении к трубам, когда о ней можно лишь оставить признак
+    for (Column c : {NAMES, PIPE_ID, PIPE_NAME, PIPE_LENGTH, PIPE_DIAMETER, PIPE_FLAGS, PIPE_START, PIPE_END,
+                     CONN_PIPE, CONN_START, CONN_END, CONN_TYPES}) {
+        if (checksum(layout.columns[c]) != checksums[c]) {
+            return false;
+        }
+    }
+
+    contents.nextPipeId = layout.nextPipeId;
+    contents.nextStationId = layout.nextStationId;
+    contents.pipes.clear();
+    contents.network.clear();
+    contents.stations.assign(layout.stationCount, CompressorStation());
+    vector<InternedName> names;
+    if (!decodeNames(layout.columns[NAMES], names, stationNameCount)) {
+        return false;
+    }
+    TaskGroup group;
+    ColumnDecoder decoder(&group);
+    decodeStations(decoder, layout, names, contents.stations);
+    if (!decoder.finish()) {
+        return false;
+    }
+    clampActiveWorkshops(contents.stations);
+
+    // Функции загрузки держат байты снимка, пока секция не разобрана. Разбор
+    // идет в вызывающем потоке: загрузку могут вызвать из задачи, и ожидание
+    // группы под мьютексом вектора не должно подхватить задачу, ждущую его же.
+    deferred.pipeCount = layout.pipeCount;
+    deferred.connectionCount = layout.connectionCount;
+    deferred.loadPipes = [bytes, layout](vector<Pipe>& pipes) {
+        TraceSpan span("load deferred pipes");
+        pipes.assign(layout.pipeCount, Pipe());
+        vector<InternedName> allNames;
+        if (!decodeNames(layout.columns[NAMES], allNames)) {
+            return false;
+        }
+        ColumnDecoder sequential(nullptr);
+        decodePipes(sequential, layout, allNames, pipes);
+        return sequential.finish();
+    };
+    deferred.loadNetwork = [bytes, layout](vector<NetworkConnection>& network) {
+        TraceSpan span("load deferred network");
+        // Трубы здесь могут быть еще не разобраны, поэтому концы не сверяются:
+        // снимок, прошедший проверку сумм, записан writeCompactSnapshot из труб
+        vector<ConnectionRecord> records(layout.connectionCount);
+        ColumnDecoder sequential(nullptr);
+        decodeNetwork(sequential, layout, records);
+        if (!sequential.finish()) {
+            return false;
+        }
+        keepPipeIds(records, network);
+        return true;
+    };
+    return true;
+}
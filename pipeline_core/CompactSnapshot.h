@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+// Двоичный поколоночный снимок состояния. Каждое поле записей хранится
+// отдельным столбцом, сжатым по своей природе:
+//   - ID и концы соединений - разность с предыдущим значением столбца
+//     (zigzag + varint), последовательные ID занимают по байту;
+//   - названия - общий словарь различных строк с префиксным сжатием,
+//     в записи - разность номера в словаре;
+//   - диаметры - словарь значений и номера по ceil(log2(n)) бит;
+//   - флаги и типы соединений - упакованные биты;
+//   - длины - XOR с предыдущим значением без потерь (схема Gorilla):
+//     повтор длины - 1 бит, близкие значения - несколько бит.
+// Перед данными - каталог длин столбцов, поэтому столбцы кодируются и
+// разбираются параллельно, а неизвестные новые столбцы пропускаются.
+// Последний столбец - каталог с контрольными суммами остальных и числом
+// названий КС (они идут в словаре первыми) - позволяет открыть снимок лениво.
+struct SnapshotContents {
+    int nextPipeId = 1;
+    int nextStationId = 1;
+    std::vector<Pipe> pipes;
+    std::vector<CompressorStation> stations;
+    std::vector<NetworkConnection> network;
+};
+
+// Начинается ли содержимое файла с сигнатуры снимка
+bool isCompactSnapshot(std::string_view bytes);
+
+void writeCompactSnapshot(std::ostream& out, const PersistentVector<Pipe>& pipes,
+                          const PersistentVector<CompressorStation>& stations,
+                          const PersistentVector<NetworkConnection>& network, int nextPipeId, int nextStationId);
+
+// false - поврежденный или усеченный снимок либо концы соединения не
+// совпадают с его трубой; contents тогда не определен
+bool readCompactSnapshot(std::string_view bytes, SnapshotContents& contents);
+
+// Отложенные секции лениво открытого снимка. Функции загрузки разбирают
+// трубы (вместе с их названиями) и соединения из байтов снимка, которые
+// держат до вызова; рассчитаны на PersistentVector::deferred.
+struct DeferredSections {
+    size_t pipeCount = 0;
+    size_t connectionCount = 0;
+    std::function<bool(std::vector<Pipe>&)> loadPipes;
+    std::function<bool(std::vector<NetworkConnection>&)> loadNetwork;
+};
+
+// Ленивое открытие: в contents разбираются заголовок и КС, трубы и
+// соединения остаются пустыми и описываются в deferred. Контрольные суммы
+// отложенных столбцов проверяются сразу, так что случайная порча видна уже
+// здесь; снимок, подделанный с верными суммами, не разберется только при
+// загрузке секции - функция загрузки тогда вернет false. false - снимок
+// поврежден или записан без каталога (такой загружается только целиком
+// через readCompactSnapshot).
+bool openCompactSnapshot(std::shared_ptr<const std::string> bytes, SnapshotContents& contents,
+                         DeferredSections& deferred);
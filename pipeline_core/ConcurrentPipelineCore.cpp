@@ -0,0 +1,34 @@
+#include "ConcurrentPipelineCore.h"
+
+using namespace std;
+
+ConcurrentPipelineCore::ConcurrentPipelineCore()
+    : state(make_shared<const PipelineCore>()) {}
+
+ConcurrentPipelineCore::ConcurrentPipelineCore(PipelineCore initial)
+    : state(make_shared<const PipelineCore>(move(initial))) {}
+
+ConcurrentPipelineCore::Snapshot ConcurrentPipelineCore::snapshot() const {
+    return atomic_load_explicit(&state, memory_order_acquire);
+}
+
+void ConcurrentPipelineCore::publish(Snapshot next) {
+    atomic_store_explicit(&state, move(next), memory_order_release);
+    stateVersion.fetch_add(1, memory_order_acq_rel);
+}
+
+void ConcurrentPipelineCore::replace(PipelineCore next) {
+    lock_guard<mutex> lock(writeMutex);
+    publish(make_shared<const PipelineCore>(move(next)));
+}
+
+const PipelineCore& ConcurrentPipelineCore::Reader::current() {
+    uint64_t version = owner->version();
+    if (!cached || version != cachedVersion) {
+        // Сначала версия, затем снимок: если между ними прошла запись,
+        // снимок окажется новее версии и будет обновлен при следующем вызове
+        cached = owner->snapshot();
+        cachedVersion = version;
+    }
+    return *cached;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "PipelineCore.h"
+
+// Потокобезопасная обертка над PipelineCore в стиле RCU.
+// Читатели работают с неизменяемым снимком состояния и никогда не ждут писателя.
+// Писатель (одновременно только один) копирует текущий снимок, применяет к копии
+// изменение и атомарно публикует новую версию. Старые версии освобождаются,
+// когда их отпускает последний читатель (подсчет ссылок shared_ptr).
+class ConcurrentPipelineCore {
+public:
+    using Snapshot = std::shared_ptr<const PipelineCore>;
+
+    // Дескриптор читателя для одного потока. Кеширует снимок и обновляет его,
+    // только если сменилась версия, поэтому в отсутствие записей чтение
+    // сводится к одной атомарной загрузке счетчика без общих блокировок.
+    class Reader {
+    private:
+        const ConcurrentPipelineCore* owner;
+        Snapshot cached;
+        uint64_t cachedVersion = 0;
+
+    public:
+        explicit Reader(const ConcurrentPipelineCore& core) : owner(&core) {}
+
+        const PipelineCore& current();
+        const Snapshot& snapshot() { current(); return cached; }
+    };
+
+private:
+    Snapshot state;
+    std::atomic<uint64_t> stateVersion{1};
+    std::mutex writeMutex;
+
+    void publish(Snapshot next);
+
+public:
+    ConcurrentPipelineCore();
+    explicit ConcurrentPipelineCore(PipelineCore initial);
+
+    // Текущий согласованный снимок; остается валидным, пока на него есть ссылка
+    Snapshot snapshot() const;
+    uint64_t version() const { return stateVersion.load(std::memory_order_acquire); }
+
+    // Применяет изменение к копии состояния и публикует ее.
+    // Возвращает результат функции (например, ConnectResult или id новой трубы).
+    template <typename Mutation>
+    auto write(Mutation&& mutation) -> decltype(mutation(std::declval<PipelineCore&>())) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        auto next = std::make_shared<PipelineCore>(*snapshot());
+        if constexpr (std::is_void_v<decltype(mutation(*next))>) {
+            mutation(*next);
+            publish(std::move(next));
+        } else {
+            auto result = mutation(*next);
+            publish(std::move(next));
+            return result;
+        }
+    }
+
+    // Полная замена состояния (например, после загрузки файла)
+    void replace(PipelineCore next);
+};
@@ -0,0 +1,486 @@
+#include "PipelineCore.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+const size_t MAX_REPORTED_ERRORS = 1000;
+
+string_view trim(string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Разбор чисел без исключений: поле должно быть числом целиком
+bool parseField(string_view text, int& value) {
+    auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    return error == errc() && end == text.data() + text.size() && !text.empty();
+}
+
+// decimalComma - в файлах с разделителем ';' дробная часть обычно отделяется запятой
+bool parseField(string_view text, double& value, bool decimalComma) {
+    char buffer[64];
+    if (decimalComma && text.find(',') != string_view::npos && text.size() < sizeof(buffer)) {
+        copy(text.begin(), text.end(), buffer);
+        replace(buffer, buffer + text.size(), ',', '.');
+        text = string_view(buffer, text.size());
+    }
+    auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    return error == errc() && end == text.data() + text.size() && !text.empty();
+}
+
+bool parseFlag(string_view text, bool& value) {
+    if (text == "1" || text == "true" || text == "TRUE") {
+        value = true;
+    } else if (text == "0" || text == "false" || text == "FALSE") {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Файл CSV в памяти; строки отдаются по одной, поля - представлениями без копий.
+// Копируются только поля в кавычках, из которых убирается экранирование.
+class CsvReader {
+private:
+    string text;
+    size_t position = 0;
+    size_t lineNumber = 0;
+    char delimiter = ',';
+    vector<string_view> fields;
+    string unquoted;
+
+    void split(string_view line) {
+        fields.clear();
+        unquoted.clear();
+        unquoted.reserve(line.size());  // поля смотрят в этот буфер - он не должен переезжать
+        size_t start = 0;
+        while (true) {
+            size_t cursor = start;
+            while (cursor < line.size() && (line[cursor] == ' ' || line[cursor] == '\t')) {
+                ++cursor;
+            }
+            if (cursor < line.size() && line[cursor] == '"') {
+                const size_t from = unquoted.size();
+                ++cursor;
+                while (cursor < line.size()) {
+                    if (line[cursor] == '"') {
+                        if (cursor + 1 < line.size() && line[cursor + 1] == '"') {
+                            unquoted.push_back('"');
+                            cursor += 2;
+                            continue;
+                        }
+                        ++cursor;
+                        break;
+                    }
+                    unquoted.push_back(line[cursor++]);
+                }
+                fields.push_back(string_view(unquoted).substr(from));
+                size_t next = line.find(delimiter, cursor);
+                if (next == string_view::npos) {
+                    return;
+                }
+                start = next + 1;
+                continue;
+            }
+            size_t next = line.find(delimiter, start);
+            fields.push_back(trim(line.substr(start, next == string_view::npos ? string_view::npos : next - start)));
+            if (next == string_view::npos) {
+                return;
+            }
+            start = next + 1;
+        }
+    }
+
+public:
+    bool open(const string& filename) {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        ostringstream buffer;
+        buffer << file.rdbuf();
+        text = buffer.str();
+        if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            position = 3;  // метка порядка байт UTF-8 из табличных редакторов
+        }
+        return true;
+    }
+
+    // Следующая непустая строка; false - файл кончился
+    bool next() {
+        while (position < text.size()) {
+            const char* begin = text.data() + position;
+            const char* newline = static_cast<const char*>(memchr(begin, '\n', text.size() - position));
+            const size_t length = newline ? newline - begin : text.size() - position;
+            position += length + 1;
+            ++lineNumber;
+            string_view line = trim(string_view(begin, length));
+            if (!line.empty()) {
+                split(line);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Разделитель по строке заголовка: ';', если его больше, чем запятых
+    void detectDelimiter() {
+        const char* begin = text.data() + position;
+        const char* newline = static_cast<const char*>(memchr(begin, '\n', text.size() - position));
+        string_view header(begin, newline ? newline - begin : text.size() - position);
+        delimiter = count(header.begin(), header.end(), ';') > count(header.begin(), header.end(), ',') ? ';' : ',';
+    }
+
+    char getDelimiter() const { return delimiter; }
+    size_t line() const { return lineNumber; }
+    const vector<string_view>& row() const { return fields; }
+};
+
+// Столбцы таблицы в порядке Column; необязательные отмечены
+struct ColumnSpec {
+    const char* name;
+    bool required;
+};
+
+vector<ColumnSpec> columnsOf(CsvTable table) {
+    switch (table) {
+        case CsvTable::Pipes:
+            return {{"name", true}, {"length", true}, {"diameter", true}, {"repair", false}};
+        case CsvTable::Stations:
+            return {{"name", true}, {"workshops", true}, {"active", true}, {"class", true}};
+        case CsvTable::Connections:
+            return {{"start", true}, {"end", true}, {"diameter", true}, {"name", false}, {"length", false}};
+    }
+    return {};
+}
+
+// Номер каждого столбца спецификации в файле (-1 - нет); false - нет обязательного
+bool mapHeader(const vector<string_view>& header, const vector<ColumnSpec>& spec, vector<int>& position) {
+    position.assign(spec.size(), -1);
+    for (size_t i = 0; i < header.size(); ++i) {
+        string name(header[i]);
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+        for (size_t k = 0; k < spec.size(); ++k) {
+            if (position[k] == -1 && name == spec[k].name) {
+                position[k] = static_cast<int>(i);
+            }
+        }
+    }
+    for (size_t k = 0; k < spec.size(); ++k) {
+        if (spec[k].required && position[k] == -1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void reject(CsvImportReport& report, size_t line, CsvRowProblem problem,
+            ConnectStatus connectStatus = ConnectStatus::Ok) {
+    ++report.rejected;
+    if (report.errors.size() < MAX_REPORTED_ERRORS) {
+        CsvRowError error;
+        error.line = line;
+        error.problem = problem;
+        error.connectStatus = connectStatus;
+        report.errors.push_back(error);
+    }
+}
+
+// ID -> индекс записи. ID выдаются счетчиками и лежат плотно, поэтому обычно
+// хватает массива по диапазону ID; для разреженных ID - хэш-таблица.
+// При повторе ID остается первый индекс, как у линейного поиска.
+class IdLookup {
+private:
+    int minId = 0;
+    bool dense = true;
+    vector<int> slots;
+    unordered_map<int, int> sparse;
+
+public:
+    IdLookup() = default;
+
+    template <typename Records>
+    explicit IdLookup(const Records& records) {
+        if (records.empty()) {
+            return;
+        }
+        int maxId = records[0].id;
+        minId = maxId;
+        for (const auto& record : records) {
+            minId = min(minId, record.id);
+            maxId = max(maxId, record.id);
+        }
+        const long long span = static_cast<long long>(maxId) - minId + 1;
+        dense = span <= 4 * static_cast<long long>(records.size()) + 4096;
+        if (dense) {
+            slots.assign(static_cast<size_t>(span), -1);
+        } else {
+            sparse.reserve(records.size());
+        }
+        for (size_t i = 0; i < records.size(); ++i) {
+            insert(records[i].id, static_cast<int>(i));
+        }
+    }
+
+    int find(int id) const {
+        if (dense) {
+            const long long offset = static_cast<long long>(id) - minId;
+            return offset >= 0 && offset < static_cast<long long>(slots.size()) ? slots[offset] : -1;
+        }
+        auto it = sparse.find(id);
+        return it != sparse.end() ? it->second : -1;
+    }
+
+    void insert(int id, int index) {
+        if (!dense) {
+            sparse.emplace(id, index);
+            return;
+        }
+        if (slots.empty()) {
+            minId = id;
+        }
+        const long long offset = static_cast<long long>(id) - minId;
+        if (offset < 0 || offset >= static_cast<long long>(slots.size()) + 4096) {
+            // ID далеко за диапазоном - переходим на хэш-таблицу
+            dense = false;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                if (slots[i] != -1) {
+                    sparse.emplace(static_cast<int>(minId + static_cast<long long>(i)), slots[i]);
+                }
+            }
+            slots.clear();
+            sparse.emplace(id, index);
+            return;
+        }
+        if (offset >= static_cast<long long>(slots.size())) {
+            slots.resize(static_cast<size_t>(offset) + 1, -1);
+        }
+        if (slots[offset] == -1) {
+            slots[offset] = index;
+        }
+    }
+};
+
+uint64_t pairKey(int startId, int endId) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(startId)) << 32) | static_cast<uint32_t>(endId);
+}
+
+}
+
+CsvImportReport PipelineCore::importCsv(const string& filename, CsvTable table) {
+    CsvImportReport report;
+    CsvReader reader;
+    if (!reader.open(filename)) {
+        report.status = CsvImportStatus::FileNotFound;
+        return report;
+    }
+
+    const vector<ColumnSpec> spec = columnsOf(table);
+    vector<int> column;
+    reader.detectDelimiter();
+    if (!reader.next() || !mapHeader(reader.row(), spec, column)) {
+        report.status = CsvImportStatus::BadHeader;
+        return report;
+    }
+    const bool decimalComma = reader.getDelimiter() == ';';
+    // Поле столбца k текущей строки; пустое, если столбца нет в файле или строке
+    auto field = [&](size_t k) {
+        const auto& row = reader.row();
+        return column[k] == -1 || static_cast<size_t>(column[k]) >= row.size() ? string_view() : row[column[k]];
+    };
+    size_t requiredWidth = 0;
+    for (size_t k = 0; k < spec.size(); ++k) {
+        if (spec[k].required) {
+            requiredWidth = max(requiredWidth, static_cast<size_t>(column[k]) + 1);
+        }
+    }
+
+    // Индексы для проверки соединений строятся один раз на весь файл вместо
+    // линейных поисков canConnectObjects на каждую строку
+    unordered_set<uint64_t> existing;
+    unordered_map<int, size_t> freeCursor;  // до этого индекса свободных труб диаметра нет
+    IdLookup stationIndex;
+    IdLookup pipeIndex;
+    if (table == CsvTable::Connections) {
+        stationIndex = IdLookup(stations);
+        pipeIndex = IdLookup(pipes);
+        existing.reserve(network.size());
+        // Подключенные трубы - ровно трубы соединений сети
+        for (const auto& pipe : pipes) {
+            if (pipe.inUse) {
+                existing.insert(pairKey(pipe.startId, pipe.endId));
+            }
+        }
+    }
+    // Как getObjectInfo: сначала КС, затем труба
+    auto objectInfo = [&](int id) -> pair<bool, int> {
+        const int station = stationIndex.find(id);
+        if (station != -1) {
+            return {true, station};
+        }
+        return {false, pipeIndex.find(id)};
+    };
+    bool networkChanged = false;
+    // Название интернируется до добавления записи: при переполнении пула
+    // строка отклоняется, а addPipe и addStation находят его готовым
+    uint32_t handle = 0;
+
+    while (reader.next()) {
+        const size_t line = reader.line();
+        if (reader.row().size() < requiredWidth) {
+            reject(report, line, CsvRowProblem::MissingField);
+            continue;
+        }
+
+        if (table == CsvTable::Pipes) {
+            string_view name = field(0);
+            double length = 0;
+            int diameter = 0;
+            bool repair = false;
+            if (name.empty()) {
+                reject(report, line, CsvRowProblem::EmptyName);
+            } else if (!parseField(field(1), length, decimalComma) || !parseField(field(2), diameter)) {
+                reject(report, line, CsvRowProblem::BadNumber);
+            } else if (length < 0.001) {
+                reject(report, line, CsvRowProblem::BadLength);
+            } else if (!isAllowedDiameter(diameter)) {
+                reject(report, line, CsvRowProblem::BadDiameter);
+            } else if (!field(3).empty() && !parseFlag(field(3), repair)) {
+                reject(report, line, CsvRowProblem::BadFlag);
+            } else if (!StringPool::tryIntern(name, handle)) {
+                reject(report, line, CsvRowProblem::NamesExhausted);
+            } else {
+                addPipe(string(name), length, diameter);
+                if (repair) {
+                    editPipes().mutableAt(pipes.size() - 1).underRepair = true;
+                }
+                ++report.imported;
+            }
+            continue;
+        }
+
+        if (table == CsvTable::Stations) {
+            string_view name = field(0);
+            int total = 0;
+            int active = 0;
+            int stationClass = 0;
+            if (name.empty()) {
+                reject(report, line, CsvRowProblem::EmptyName);
+            } else if (!parseField(field(1), total) || !parseField(field(2), active) ||
+                       !parseField(field(3), stationClass)) {
+                reject(report, line, CsvRowProblem::BadNumber);
+            } else if (total < 1 || active < 0 || active > total) {
+                reject(report, line, CsvRowProblem::BadWorkshops);
+            } else if (stationClass < 1) {
+                reject(report, line, CsvRowProblem::BadClass);
+            } else if (!StringPool::tryIntern(name, handle)) {
+                reject(report, line, CsvRowProblem::NamesExhausted);
+            } else {
+                addStation(string(name), total, active, stationClass);
+                ++report.imported;
+            }
+            continue;
+        }
+
+        int startId = 0;
+        int endId = 0;
+        int diameter = 0;
+        if (!parseField(field(0), startId) || !parseField(field(1), endId) || !parseField(field(2), diameter)) {
+            reject(report, line, CsvRowProblem::BadNumber);
+            continue;
+        }
+        if (!isAllowedDiameter(diameter)) {
+            reject(report, line, CsvRowProblem::BadDiameter);
+            continue;
+        }
+
+        // Проверки canConnectObjects в том же порядке
+        auto [isStartStation, startIndex] = objectInfo(startId);
+        auto [isEndStation, endIndex] = objectInfo(endId);
+        ConnectStatus status = ConnectStatus::Ok;
+        if (startId == endId) {
+            status = ConnectStatus::SameObject;
+        } else if (startIndex == -1) {
+            status = ConnectStatus::StartNotFound;
+        } else if (endIndex == -1) {
+            status = ConnectStatus::EndNotFound;
+        } else if (!isStartStation && pipes[startIndex].underRepair) {
+            status = ConnectStatus::StartUnderRepair;
+        } else if (!isEndStation && pipes[endIndex].underRepair) {
+            status = ConnectStatus::EndUnderRepair;
+        } else if (existing.count(pairKey(startId, endId))) {
+            status = ConnectStatus::AlreadyExists;
+        } else if (!isStartStation && !isEndStation &&
+                   (pipes[startIndex].diameter != diameter || pipes[endIndex].diameter != diameter)) {
+            status = ConnectStatus::DiameterMismatch;
+        }
+        if (status != ConnectStatus::Ok) {
+            reject(report, line, CsvRowProblem::Connect, status);
+            continue;
+        }
+
+        // Первая свободная труба диаметра, как findAvailablePipeByDiameter. Трубы
+        // в пакете только занимаются, поэтому поиск продолжается с прошлого места.
+        size_t& cursor = freeCursor[diameter];
+        while (cursor < pipes.size() &&
+               (pipes[cursor].diameter != diameter || pipes[cursor].inUse || pipes[cursor].underRepair)) {
+            ++cursor;
+        }
+        int pipeIndexToUse = static_cast<int>(cursor);
+        if (cursor == pipes.size()) {
+            // Свободной нет - создаем трубу, если строка задает ее название и длину
+            string_view name = field(3);
+            double length = 0;
+            if (name.empty() || !parseField(field(4), length, decimalComma) || length < 0.001) {
+                reject(report, line, CsvRowProblem::Connect, ConnectStatus::NoFreePipe);
+                continue;
+            }
+            if (!StringPool::tryIntern(name, handle)) {
+                reject(report, line, CsvRowProblem::NamesExhausted);
+                continue;
+            }
+            addPipe(string(name), length, diameter);
+            pipeIndexToUse = static_cast<int>(pipes.size()) - 1;
+            pipeIndex.insert(pipes[pipeIndexToUse].id, pipeIndexToUse);
+        }
+
+        // Как attachPipe, но острова перестраиваются один раз после пакета
+        if (!networkChanged) {
+            editNetwork();
+            networkChanged = true;
+        }
+        Pipe& pipe = editPipes().mutableAt(pipeIndexToUse);
+        pipe.inUse = true;
+        pipe.startId = startId;
+        pipe.endId = endId;
+        pipe.startType = determineConnectionType(isStartStation, isEndStation);
+        pipe.endType = pipe.startType;
+
+        network.push_back({pipe.id});
+        existing.insert(pairKey(startId, endId));
+        ++report.imported;
+    }
+
+    if (networkChanged) {
+        islands.rebuild(network, pipes);
+    }
+    return report;
+}
@@ -0,0 +1,359 @@
+#include "DynamicConnectivity.h"
+
+#include <algorithm>
+
+using namespace std;
+
+DynamicConnectivity::~DynamicConnectivity() {
+    for (auto& entry : edges) {
+        for (auto& arc : entry.second.arcs) {
+            delete arc.first;
+            delete arc.second;
+        }
+    }
+    for (Level& lvl : levels) {
+        for (auto& entry : lvl.vertexNodes) {
+            delete entry.second;
+        }
+    }
+}
+
+// ---- Декартово дерево с неявным ключом (последовательность эйлерова обхода) ----
+
+void DynamicConnectivity::update(Node* node) {
+    node->nodeCount = 1;
+    node->vertexCount = node->vertex >= 0 ? 1 : 0;
+    node->anyNonTree = node->hasNonTree;
+    node->anyLevelArc = node->isLevelArc;
+    for (Node* child : {node->left, node->right}) {
+        if (child) {
+            node->nodeCount += child->nodeCount;
+            node->vertexCount += child->vertexCount;
+            node->anyNonTree = node->anyNonTree || child->anyNonTree;
+            node->anyLevelArc = node->anyLevelArc || child->anyLevelArc;
+        }
+    }
+}
+
+void DynamicConnectivity::refreshUp(Node* node) {
+    for (; node; node = node->parent) {
+        update(node);
+    }
+}
+
+DynamicConnectivity::Node* DynamicConnectivity::merge(Node* a, Node* b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        a->right = merge(a->right, b);
+        a->right->parent = a;
+        update(a);
+        return a;
+    }
+    b->left = merge(a, b->left);
+    b->left->parent = b;
+    update(b);
+    return b;
+}
+
+// Первые count узлов - в first, остальные - в second
+pair<DynamicConnectivity::Node*, DynamicConnectivity::Node*> DynamicConnectivity::split(Node* root, int count) {
+    if (!root) {
+        return {nullptr, nullptr};
+    }
+    root->parent = nullptr;
+    if (count <= nodeCount(root->left)) {
+        auto parts = split(root->left, count);
+        root->left = parts.second;
+        if (root->left) root->left->parent = root;
+        update(root);
+        return {parts.first, root};
+    }
+    auto parts = split(root->right, count - nodeCount(root->left) - 1);
+    root->right = parts.first;
+    if (root->right) root->right->parent = root;
+    update(root);
+    return {root, parts.second};
+}
+
+DynamicConnectivity::Node* DynamicConnectivity::rootOf(Node* node) {
+    while (node->parent) {
+        node = node->parent;
+    }
+    return node;
+}
+
+int DynamicConnectivity::positionOf(Node* node) {
+    int position = nodeCount(node->left);
+    for (; node->parent; node = node->parent) {
+        if (node == node->parent->right) {
+            position += nodeCount(node->parent->left) + 1;
+        }
+    }
+    return position;
+}
+
+// Циклический сдвиг обхода так, чтобы он начинался с node
+DynamicConnectivity::Node* DynamicConnectivity::reroot(Node* node) {
+    Node* root = rootOf(node);
+    auto parts = split(root, positionOf(node));
+    return merge(parts.second, parts.first);
+}
+
+// Спуск к любому узлу с флагом (вершине с недревесными ребрами или дуге ребра уровня)
+DynamicConnectivity::Node* DynamicConnectivity::findFlagged(Node* root, bool nonTree) {
+    Node* node = root;
+    while (node) {
+        if (nonTree ? node->hasNonTree : node->isLevelArc) {
+            return node;
+        }
+        Node* left = node->left;
+        if (left && (nonTree ? left->anyNonTree : left->anyLevelArc)) {
+            node = left;
+        } else {
+            Node* right = node->right;
+            node = right && (nonTree ? right->anyNonTree : right->anyLevelArc) ? right : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// ---- Леса по уровням ----
+
+uint32_t DynamicConnectivity::nextPriority() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+DynamicConnectivity::Level& DynamicConnectivity::level(int index) {
+    if (static_cast<int>(levels.size()) <= index) {
+        levels.resize(index + 1);
+    }
+    return levels[index];
+}
+
+DynamicConnectivity::Node* DynamicConnectivity::vertexNode(int levelIndex, int64_t vertex) {
+    Node*& node = level(levelIndex).vertexNodes[vertex];
+    if (!node) {
+        node = new Node;
+        node->priority = nextPriority();
+        node->vertex = vertex;
+        update(node);
+    }
+    return node;
+}
+
+DynamicConnectivity::Node* DynamicConnectivity::findVertexNode(int levelIndex, int64_t vertex) const {
+    if (levelIndex >= static_cast<int>(levels.size())) {
+        return nullptr;
+    }
+    const auto& nodes = levels[levelIndex].vertexNodes;
+    auto it = nodes.find(vertex);
+    return it == nodes.end() ? nullptr : it->second;
+}
+
+bool DynamicConnectivity::connectedAt(int levelIndex, int64_t u, int64_t v) const {
+    if (u == v) {
+        return true;
+    }
+    Node* nodeU = findVertexNode(levelIndex, u);
+    Node* nodeV = findVertexNode(levelIndex, v);
+    return nodeU && nodeV && rootOf(nodeU) == rootOf(nodeV);
+}
+
+// Обход после связывания: [обход u] (u->v) [обход v] (v->u)
+void DynamicConnectivity::link(int levelIndex, int edgeId, Edge& edge) {
+    Node* treeU = reroot(vertexNode(levelIndex, edge.u));
+    Node* treeV = reroot(vertexNode(levelIndex, edge.v));
+
+    Node* forward = new Node;
+    Node* backward = new Node;
+    for (Node* arc : {forward, backward}) {
+        arc->priority = nextPriority();
+        arc->edgeId = edgeId;
+    }
+    forward->isLevelArc = edge.level == levelIndex;
+    update(forward);
+    update(backward);
+
+    if (static_cast<int>(edge.arcs.size()) <= levelIndex) {
+        edge.arcs.resize(levelIndex + 1, {nullptr, nullptr});
+    }
+    edge.arcs[levelIndex] = {forward, backward};
+    merge(merge(merge(treeU, forward), treeV), backward);
+}
+
+// Часть обхода между двумя дугами ребра - это поддерево одной из сторон
+void DynamicConnectivity::cut(int levelIndex, Edge& edge) {
+    Node* first = edge.arcs[levelIndex].first;
+    Node* second = edge.arcs[levelIndex].second;
+    Node* root = rootOf(first);
+    int firstPos = positionOf(first);
+    int secondPos = positionOf(second);
+    if (firstPos > secondPos) {
+        swap(firstPos, secondPos);
+    }
+
+    auto left = split(root, firstPos);
+    auto firstArc = split(left.second, 1);
+    auto middle = split(firstArc.second, secondPos - firstPos - 1);
+    auto secondArc = split(middle.second, 1);
+    merge(left.first, secondArc.second);
+
+    delete first;
+    delete second;
+    edge.arcs[levelIndex] = {nullptr, nullptr};
+}
+
+void DynamicConnectivity::setNonTreeFlag(int levelIndex, int64_t vertex) {
+    Level& lvl = level(levelIndex);
+    auto it = lvl.nonTreeEdges.find(vertex);
+    bool hasEdges = it != lvl.nonTreeEdges.end() && !it->second.empty();
+    if (it != lvl.nonTreeEdges.end() && !hasEdges) {
+        lvl.nonTreeEdges.erase(it);
+    }
+    Node* node = vertexNode(levelIndex, vertex);
+    if (node->hasNonTree != hasEdges) {
+        node->hasNonTree = hasEdges;
+        refreshUp(node);
+    }
+}
+
+void DynamicConnectivity::addNonTree(int levelIndex, int edgeId, const Edge& edge) {
+    Level& lvl = level(levelIndex);
+    lvl.nonTreeEdges[edge.u].insert(edgeId);
+    lvl.nonTreeEdges[edge.v].insert(edgeId);
+    setNonTreeFlag(levelIndex, edge.u);
+    setNonTreeFlag(levelIndex, edge.v);
+}
+
+void DynamicConnectivity::removeNonTree(int levelIndex, int edgeId, const Edge& edge) {
+    Level& lvl = level(levelIndex);
+    for (int64_t vertex : {edge.u, edge.v}) {
+        auto it = lvl.nonTreeEdges.find(vertex);
+        if (it != lvl.nonTreeEdges.end()) {
+            it->second.erase(edgeId);
+        }
+    }
+    setNonTreeFlag(levelIndex, edge.u);
+    setNonTreeFlag(levelIndex, edge.v);
+}
+
+// Поиск замены для удаленного ребра дерева уровня levelIndex между u и v.
+// Ребра меньшей части поднимаются на уровень выше, пока замена не найдена.
+bool DynamicConnectivity::replaceTreeEdge(int levelIndex, int64_t u, int64_t v) {
+    Node* rootU = rootOf(vertexNode(levelIndex, u));
+    Node* rootV = rootOf(vertexNode(levelIndex, v));
+    int64_t small = rootU->vertexCount <= rootV->vertexCount ? u : v;
+
+    // Ребра дерева этого уровня в меньшей части переходят на уровень выше
+    while (Node* arc = findFlagged(rootOf(vertexNode(levelIndex, small)), false)) {
+        arc->isLevelArc = false;
+        refreshUp(arc);
+        Edge& edge = edges[arc->edgeId];
+        edge.level = levelIndex + 1;
+        link(levelIndex + 1, arc->edgeId, edge);
+    }
+
+    while (Node* found = findFlagged(rootOf(vertexNode(levelIndex, small)), true)) {
+        int64_t vertex = found->vertex;
+        while (true) {
+            auto it = levels[levelIndex].nonTreeEdges.find(vertex);
+            if (it == levels[levelIndex].nonTreeEdges.end()) {
+                break;
+            }
+            int edgeId = *it->second.begin();
+            Edge& edge = edges[edgeId];
+            removeNonTree(levelIndex, edgeId, edge);
+
+            int64_t other = edge.u == vertex ? edge.v : edge.u;
+            if (!connectedAt(levelIndex, vertex, other)) {
+                edge.isTree = true;
+                edge.level = levelIndex;
+                for (int i = 0; i <= levelIndex; ++i) {
+                    link(i, edgeId, edge);
+                }
+                return true;
+            }
+            edge.level = levelIndex + 1;
+            addNonTree(levelIndex + 1, edgeId, edge);
+        }
+    }
+    return false;
+}
+
+// ---- Публичный интерфейс ----
+
+bool DynamicConnectivity::addEdge(int edgeId, int64_t u, int64_t v) {
+    if (edges.count(edgeId)) {
+        return false;
+    }
+    Edge& edge = edges[edgeId];
+    edge.u = u;
+    edge.v = v;
+    if (!connectedAt(0, u, v)) {
+        edge.isTree = true;
+        link(0, edgeId, edge);
+    } else {
+        addNonTree(0, edgeId, edge);
+    }
+    return true;
+}
+
+bool DynamicConnectivity::removeEdge(int edgeId) {
+    auto it = edges.find(edgeId);
+    if (it == edges.end()) {
+        return false;
+    }
+    Edge& edge = it->second;
+    int64_t u = edge.u;
+    int64_t v = edge.v;
+    int edgeLevel = edge.level;
+
+    if (!edge.isTree) {
+        removeNonTree(edgeLevel, edgeId, edge);
+        edges.erase(it);
+        return true;
+    }
+
+    for (int i = 0; i <= edgeLevel; ++i) {
+        cut(i, edge);
+    }
+    edges.erase(it);
+
+    for (int i = edgeLevel; i >= 0; --i) {
+        if (replaceTreeEdge(i, u, v)) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool DynamicConnectivity::connected(int64_t u, int64_t v) const {
+    return connectedAt(0, u, v);
+}
+
+int64_t DynamicConnectivity::representative(int64_t vertex) const {
+    Node* node = findVertexNode(0, vertex);
+    if (!node) {
+        return vertex;
+    }
+    // Первая вершина обхода
+    node = rootOf(node);
+    while (true) {
+        if (node->left && node->left->vertexCount > 0) {
+            node = node->left;
+        } else if (node->vertex >= 0) {
+            return node->vertex;
+        } else {
+            node = node->right;
+        }
+    }
+}
+
+size_t DynamicConnectivity::componentSize(int64_t vertex) const {
+    Node* node = findVertexNode(0, vertex);
+    return node ? rootOf(node)->vertexCount : 1;
+}
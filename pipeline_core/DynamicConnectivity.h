@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "MemoryAccounting.h"
+
+// Полностью динамическая связность неориентированного графа
+// (алгоритм Holm - de Lichtenberg - Thorup).
+// Вставка и удаление ребра - O(log^2 n) амортизированно, запрос связности - O(log n).
+//
+// Каждое ребро имеет уровень 0..log n. Лес F_i - остовный лес ребер уровня >= i,
+// каждый лес хранится эйлеровыми обходами в декартовых деревьях (treap).
+// При удалении ребра дерева замена ищется на уровнях от его уровня вниз;
+// просмотренные ребра меньшей части поднимаются на уровень выше, что
+// и дает амортизированную оценку: уровень ребра только растет.
+//
+// Вершины - неотрицательные целые числа, ребра идентифицируются edgeId.
+// Вся память структуры учитывается в MemoryTracker как Islands.
+class DynamicConnectivity {
+private:
+    template <typename T>
+    using Tracked = TrackedAllocator<T, MemoryCategory::Islands>;
+    template <typename Key, typename Value>
+    using Map = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>,
+                                   Tracked<std::pair<const Key, Value>>>;
+    using EdgeSet = std::unordered_set<int, std::hash<int>, std::equal_to<int>, Tracked<int>>;
+
+    struct Node {
+        Node* left = nullptr;
+        Node* right = nullptr;
+        Node* parent = nullptr;
+        uint32_t priority = 0;
+        int64_t vertex = -1;  // вершина, либо -1 для дуги ребра дерева
+        int edgeId = -1;   // ребро для дуги
+        bool hasNonTree = false;  // у вершины есть недревесные ребра этого уровня
+        bool isLevelArc = false;  // дуга ребра дерева, уровень которого равен уровню леса
+        int nodeCount = 1;
+        int vertexCount = 0;
+        bool anyNonTree = false;
+        bool anyLevelArc = false;
+
+        static void* operator new(size_t) { return Tracked<Node>().allocate(1); }
+        static void operator delete(void* pointer) { Tracked<Node>().deallocate(static_cast<Node*>(pointer), 1); }
+    };
+
+    struct Edge {
+        int64_t u = 0;
+        int64_t v = 0;
+        int level = 0;
+        bool isTree = false;
+        std::vector<std::pair<Node*, Node*>, Tracked<std::pair<Node*, Node*>>> arcs;  // дуги (u->v, v->u) в лесах 0..level
+    };
+
+    struct Level {
+        Map<int64_t, Node*> vertexNodes;
+        Map<int64_t, EdgeSet> nonTreeEdges;  // вершина -> ребра уровня
+    };
+
+    std::vector<Level, Tracked<Level>> levels;
+    Map<int, Edge> edges;
+    uint32_t randomState = 2463534242u;
+
+    // Операции над декартовым деревом
+    static int nodeCount(const Node* node) { return node ? node->nodeCount : 0; }
+    static void update(Node* node);
+    static void refreshUp(Node* node);
+    static Node* merge(Node* a, Node* b);
+    static std::pair<Node*, Node*> split(Node* root, int count);
+    static Node* rootOf(Node* node);
+    static int positionOf(Node* node);
+    static Node* reroot(Node* node);
+    static Node* findFlagged(Node* root, bool nonTree);
+
+    uint32_t nextPriority();
+    Level& level(int index);
+    Node* vertexNode(int levelIndex, int64_t vertex);
+    Node* findVertexNode(int levelIndex, int64_t vertex) const;
+    bool connectedAt(int levelIndex, int64_t u, int64_t v) const;
+
+    void link(int levelIndex, int edgeId, Edge& edge);
+    void cut(int levelIndex, Edge& edge);
+    void addNonTree(int levelIndex, int edgeId, const Edge& edge);
+    void removeNonTree(int levelIndex, int edgeId, const Edge& edge);
+    void setNonTreeFlag(int levelIndex, int64_t vertex);
+    bool replaceTreeEdge(int levelIndex, int64_t u, int64_t v);
+
+public:
+    DynamicConnectivity() = default;
+    ~DynamicConnectivity();
+
+    DynamicConnectivity(const DynamicConnectivity&) = delete;
+    DynamicConnectivity& operator=(const DynamicConnectivity&) = delete;
+
+    // false, если ребро с таким edgeId уже есть
+    bool addEdge(int edgeId, int64_t u, int64_t v);
+    // false, если ребра нет
+    bool removeEdge(int edgeId);
+    bool hasEdge(int edgeId) const { return edges.count(edgeId) != 0; }
+    // Концы ребра; false, если ребра нет
+    bool edgeEnds(int edgeId, int64_t& u, int64_t& v) const {
+        auto it = edges.find(edgeId);
+        if (it == edges.end()) {
+            return false;
+        }
+        u = it->second.u;
+        v = it->second.v;
+        return true;
+    }
+    template <typename Visit>
+    void forEachEdge(Visit visit) const {
+        for (const auto& entry : edges) {
+            visit(entry.first);
+        }
+    }
+    size_t edgeCount() const { return edges.size(); }
+
+    bool connected(int64_t u, int64_t v) const;
+    // Одинаков для всех вершин одной компоненты (до следующего изменения графа)
+    int64_t representative(int64_t vertex) const;
+    size_t componentSize(int64_t vertex) const;
+};
@@ -0,0 +1,347 @@
+#include "GasFlowSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+#include "GraphPartitioner.h"
+#include "NetworkIslands.h"
+#include "PipeIndex.h"
+
+using namespace std;
+
+namespace {
+
+// Сглаживание корня около нуля, МПа^2. Меньшие значения почти не
+// меняют расходы, но резко замедляют сходимость Ньютона.
+const double SMOOTHING = 1e-2;
+// Коэффициент Веймаута для млн м3/сут при D в мм, L в км, P в МПа
+const double WEYMOUTH = 0.8106e-6;
+
+// Точность линейных решений (относительная невязка): у первого
+// шага и в пределах по Эйзенштату - Уокеру
+const double FIRST_FORCING = 1e-2;
+const double MIN_FORCING = 1e-10;
+const double MAX_FORCING = 0.1;
+
+}
+
+double GasFlowSolver::pipeConductance(int diameter, double length) {
+    return WEYMOUTH * pow(static_cast<double>(diameter), 8.0 / 3.0) / sqrt(max(length, 1e-3));
+}
+
+double GasFlowSolver::compressionBoost(const FlowSettings& settings, int activeWorkshops) {
+    if (activeWorkshops <= 0) {
+        return 1.0;
+    }
+    double ratio = min(1.0 + settings.boostPerWorkshop * activeWorkshops, settings.maxCompressionRatio);
+    return ratio * ratio;
+}
+
+void GasFlowSolver::pipeFlow(double conductance, double drop, double& flow, double& derivative) {
+    double smoothed = drop * drop + SMOOTHING * SMOOTHING;
+    flow = conductance * drop / pow(smoothed, 0.25);
+    derivative = conductance * (0.5 * drop * drop + SMOOTHING * SMOOTHING) / pow(smoothed, 1.25);
+}
+
+GasFlowSolver::GasFlowSolver(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes,
+                             const PersistentVector<CompressorStation>& stations, const FlowSettings& settings)
+    : settings(settings) {
+    PipeIndex pipeById(pipes);
+    unordered_map<int, int> activeById;
+    for (const auto& station : stations) {
+        activeById[station.id] = station.activeWorkshops;
+    }
+
+    unordered_map<int64_t, int> localByNode;
+    auto localOf = [&](int id, bool isStation) {
+        auto [it, inserted] = localByNode.emplace(NetworkIslands::nodeIndex(id, isStation),
+                                                  static_cast<int>(objectIds.size()));
+        if (inserted) {
+            objectIds.push_back(id);
+            nodeIsStation.push_back(isStation);
+        }
+        return it->second;
+    };
+
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        bool fromStation = startIsStation(*pipe);
+        int from = localOf(pipe->startId, fromStation);
+        int to = localOf(pipe->endId, endIsStation(*pipe));
+        if (pipe->underRepair || from == to) {
+            continue;
+        }
+
+        Edge edge;
+        edge.from = from;
+        edge.to = to;
+        edge.pipeId = conn.pipeId;
+        edge.conductance = pipeConductance(pipe->diameter, pipe->length);
+        edge.boost = 1.0;
+        if (fromStation) {
+            auto active = activeById.find(pipe->startId);
+            if (active != activeById.end()) {
+                edge.boost = compressionBoost(settings, active->second);
+            }
+        }
+        edges.push_back(edge);
+    }
+
+    // Роли узлов: без входящих труб - вход сети, без исходящих - выход
+    const size_t nodeCount = objectIds.size();
+    vector<int> inDegree(nodeCount, 0), outDegree(nodeCount, 0);
+    vector<vector<int>> neighbors(nodeCount);
+    for (const Edge& edge : edges) {
+        outDegree[edge.from]++;
+        inDegree[edge.to]++;
+        neighbors[edge.from].push_back(edge.to);
+        neighbors[edge.to].push_back(edge.from);
+    }
+    roles.assign(nodeCount, FlowNodeRole::Undetermined);
+    queue<int> fixed;
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (inDegree[i] + outDegree[i] == 0) {
+            continue;
+        }
+        if (inDegree[i] == 0 || outDegree[i] == 0) {
+            roles[i] = inDegree[i] == 0 ? FlowNodeRole::Source : FlowNodeRole::Delivery;
+            fixed.push(static_cast<int>(i));
+        }
+    }
+
+    // Давление определено только в частях сети, связанных с входом или выходом
+    while (!fixed.empty()) {
+        int node = fixed.front();
+        fixed.pop();
+        for (int next : neighbors[node]) {
+            if (roles[next] == FlowNodeRole::Undetermined) {
+                roles[next] = FlowNodeRole::Junction;
+                fixed.push(next);
+            }
+        }
+    }
+
+    unknownOf.assign(nodeCount, -1);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (roles[i] == FlowNodeRole::Junction) {
+            unknownOf[i] = static_cast<int>(nodeOfUnknown.size());
+            nodeOfUnknown.push_back(static_cast<int>(i));
+        }
+    }
+
+    size_t threads = settings.threads ? settings.threads : TaskScheduler::instance().concurrency();
+    // На малых сетях потоки только мешают
+    threadCount = min(threads, max<size_t>(1, nodeOfUnknown.size() / 20000));
+
+    // Неизвестные нумеруются по частям разбиения, чтобы блок
+    // предобусловливателя каждого потока был связной областью сети
+    if (threadCount > 1) {
+        vector<pair<int, int>> links;
+        for (const Edge& edge : edges) {
+            if (unknownOf[edge.from] != -1 && unknownOf[edge.to] != -1) {
+                links.push_back({unknownOf[edge.from], unknownOf[edge.to]});
+            }
+        }
+        GraphPartition partition = partitionGraph(nodeOfUnknown.size(), links, threadCount);
+        vector<int> reordered(nodeOfUnknown.size());
+        for (size_t k = 0; k < reordered.size(); ++k) {
+            reordered[k] = nodeOfUnknown[partition.order[k]];
+            unknownOf[reordered[k]] = static_cast<int>(k);
+        }
+        nodeOfUnknown.swap(reordered);
+    }
+
+    buildPattern();
+}
+
+void GasFlowSolver::buildPattern() {
+    vector<pair<int, int>> offDiagonal;
+    for (const Edge& edge : edges) {
+        int u = unknownOf[edge.from];
+        int v = unknownOf[edge.to];
+        if (u != -1 && v != -1) {
+            offDiagonal.push_back({u, v});
+            offDiagonal.push_back({v, u});
+        }
+    }
+    pattern = SparsePattern(nodeOfUnknown.size(), offDiagonal);
+
+    edgeSlots.resize(edges.size() * 4);
+    for (size_t e = 0; e < edges.size(); ++e) {
+        int u = unknownOf[edges[e].from];
+        int v = unknownOf[edges[e].to];
+        edgeSlots[4 * e] = pattern.slot(u, u);
+        edgeSlots[4 * e + 1] = pattern.slot(u, v);
+        edgeSlots[4 * e + 2] = pattern.slot(v, u);
+        edgeSlots[4 * e + 3] = pattern.slot(v, v);
+    }
+}
+
+// Небаланс F (приток минус отток) в каждом внутреннем узле и якобиан dF/dP^2.
+// linear = true - линейная модель Q = C * dP^2 для начального приближения.
+void GasFlowSolver::assemble(const vector<double>& squared, bool linear, vector<double>& residual,
+                             vector<double>& values) const {
+    residual.assign(nodeOfUnknown.size(), 0.0);
+    values.assign(pattern.size(), 0.0);
+
+    for (size_t e = 0; e < edges.size(); ++e) {
+        const Edge& edge = edges[e];
+        double drop = edge.boost * squared[edge.from] - squared[edge.to];
+        double flow, derivative;
+        if (linear) {
+            flow = edge.conductance * drop;
+            derivative = edge.conductance;
+        } else {
+            pipeFlow(edge.conductance, drop, flow, derivative);
+        }
+
+        int u = unknownOf[edge.from];
+        int v = unknownOf[edge.to];
+        if (u != -1) residual[u] -= flow;
+        if (v != -1) residual[v] += flow;
+
+        const int* slots = &edgeSlots[4 * e];
+        if (slots[0] != -1) values[slots[0]] -= derivative * edge.boost;
+        if (slots[1] != -1) values[slots[1]] += derivative;
+        if (slots[2] != -1) values[slots[2]] += derivative * edge.boost;
+        if (slots[3] != -1) values[slots[3]] -= derivative;
+    }
+}
+
+FlowResult GasFlowSolver::solve() const {
+    FlowResult result;
+    const size_t nodeCount = objectIds.size();
+    const size_t unknowns = nodeOfUnknown.size();
+
+    double sourceSquared = settings.sourcePressure * settings.sourcePressure;
+    double deliverySquared = settings.deliveryPressure * settings.deliveryPressure;
+    vector<double> squared(nodeCount, 0.0);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        switch (roles[i]) {
+            case FlowNodeRole::Source: squared[i] = sourceSquared; break;
+            case FlowNodeRole::Delivery: squared[i] = deliverySquared; break;
+            case FlowNodeRole::Junction: squared[i] = 0.5 * (sourceSquared + deliverySquared); break;
+            case FlowNodeRole::Undetermined: break;
+        }
+    }
+
+    WorkerTeam team(threadCount);
+
+    vector<double> residual, values, step, negated;
+    auto maxImbalance = [](const vector<double>& values) {
+        double worst = 0;
+        for (double value : values) {
+            worst = max(worst, fabs(value));
+        }
+        return worst;
+    };
+    auto applyStep = [&](const vector<double>& base, double scale, vector<double>& target) {
+        target = base;
+        for (size_t k = 0; k < unknowns; ++k) {
+            int node = nodeOfUnknown[k];
+            target[node] = max(base[node] + scale * step[k], 0.0);
+        }
+    };
+
+    if (unknowns > 0) {
+        // Начальное приближение - точное решение линеаризованной задачи
+        assemble(squared, true, residual, values);
+        negated.resize(unknowns);
+        for (size_t k = 0; k < unknowns; ++k) {
+            negated[k] = -residual[k];
+        }
+        if (solveBiCGStab(team, pattern, values, negated, MIN_FORCING, step)) {
+            vector<double> start;
+            applyStep(squared, 1.0, start);
+            squared.swap(start);
+        }
+    }
+
+    // Неточный Ньютон с дроблением шага по норме небаланса
+    vector<double> trial, trialResidual, unusedValues;
+    double forcing = FIRST_FORCING;
+    double previousNorm = 0;
+    for (result.iterations = 0; ; ++result.iterations) {
+        assemble(squared, false, residual, values);
+        result.residual = maxImbalance(residual);
+        if (result.residual <= settings.tolerance) {
+            result.status = FlowStatus::Ok;
+            break;
+        }
+        if (result.iterations >= settings.maxIterations) {
+            result.status = FlowStatus::IterationLimit;
+            break;
+        }
+
+        double currentNorm = 0;
+        for (double value : residual) {
+            currentNorm += value * value;
+        }
+        if (previousNorm > 0) {
+            // Линейная задача решается тем точнее, чем быстрее падает небаланс
+            double ratio = currentNorm / previousNorm;  // квадраты норм
+            double safeguard = 0.9 * forcing * forcing;
+            forcing = 0.9 * ratio;
+            if (safeguard > 0.1) {
+                forcing = max(forcing, safeguard);
+            }
+            forcing = min(max(forcing, MIN_FORCING), MAX_FORCING);
+        }
+        previousNorm = currentNorm;
+
+        negated.resize(unknowns);
+        for (size_t k = 0; k < unknowns; ++k) {
+            negated[k] = -residual[k];
+        }
+        // Недорешенный шаг - не направление Ньютона, по нему не идем. Повтор с
+        // меньшим допуском не поможет: BiCGSTAB прошел бы те же итерации.
+        if (!solveBiCGStab(team, pattern, values, negated, forcing, step)) {
+            result.status = FlowStatus::LinearSolverFailed;
+            break;
+        }
+
+        bool accepted = false;
+        for (double scale = 1.0; scale >= 1e-4; scale *= 0.5) {
+            applyStep(squared, scale, trial);
+            assemble(trial, false, trialResidual, unusedValues);
+            double trialNorm = 0;
+            for (double value : trialResidual) {
+                trialNorm += value * value;
+            }
+            if (trialNorm < (1.0 - 1e-4 * scale) * currentNorm) {
+                accepted = true;
+                break;
+            }
+        }
+        if (!accepted) {
+            result.status = FlowStatus::StepRejected;
+            break;
+        }
+        squared.swap(trial);
+    }
+    result.converged = result.status == FlowStatus::Ok;
+
+    // Давления и расходы
+    result.nodes.reserve(nodeCount);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        double pressure = roles[i] == FlowNodeRole::Undetermined ? 0.0 : sqrt(max(squared[i], 0.0));
+        result.nodes.push_back({objectIds[i], nodeIsStation[i] != 0, roles[i], pressure});
+    }
+    result.pipes.reserve(edges.size());
+    for (const Edge& edge : edges) {
+        double flow = 0;
+        if (roles[edge.from] != FlowNodeRole::Undetermined) {
+            double derivative;
+            pipeFlow(edge.conductance, edge.boost * squared[edge.from] - squared[edge.to], flow, derivative);
+        }
+        result.pipes.push_back({edge.pipeId, flow});
+        if (roles[edge.from] == FlowNodeRole::Source) result.totalSupply += flow;
+        if (roles[edge.to] == FlowNodeRole::Source) result.totalSupply -= flow;
+    }
+    return result;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+#include "SparseSolver.h"
+
+// Параметры установившегося режима
+struct FlowSettings {
+    double sourcePressure = 7.5;        // МПа на входах сети (узлы без входящих труб)
+    double deliveryPressure = 3.0;      // МПа на выходах сети (узлы без исходящих труб)
+    double boostPerWorkshop = 0.1;      // прирост степени сжатия КС на каждый работающий цех
+    double maxCompressionRatio = 1.7;   // предельная степень сжатия КС
+    double tolerance = 1e-4;            // допустимый небаланс в узле, млн м3/сут (100 м3/сут)
+    int maxIterations = 50;             // итераций Ньютона
+    size_t threads = 0;                 // долей расчета; 0 - по числу потоков общего планировщика
+};
+
+enum class FlowNodeRole {
+    Source,       // вход сети, давление задано
+    Delivery,     // выход сети, давление задано
+    Junction,     // внутренний узел, давление рассчитано
+    Undetermined  // часть сети без входов и выходов - режим не определен
+};
+
+struct FlowNode {
+    int id;
+    bool isStation;
+    FlowNodeRole role;
+    double pressure;  // МПа
+};
+
+struct PipeFlow {
+    int pipeId;
+    double flow;      // млн м3/сут, положительно - от начала трубы к концу
+};
+
+enum class FlowStatus {
+    Ok,
+    IterationLimit,      // за maxIterations шагов Ньютона небаланс не опустился до tolerance
+    LinearSolverFailed,  // BiCGSTAB не решил систему шага Ньютона
+    StepRejected         // дробление шага не уменьшило небаланс
+};
+
+struct FlowResult {
+    FlowStatus status = FlowStatus::Ok;
+    bool converged = false;  // status == FlowStatus::Ok
+    int iterations = 0;
+    double residual = 0;   // максимальный небаланс в узле, млн м3/сут
+    double totalSupply = 0;
+    std::vector<FlowNode> nodes;
+    std::vector<PipeFlow> pipes;
+};
+
+// Расчет установившегося течения газа узловым методом Ньютона.
+// Неизвестные - квадраты давлений в узлах. Расход по трубе - уравнение
+// Веймаута: Q = 0.8106e-6 * D^(8/3) * sign(dP2) * sqrt(|dP2| / L)
+// (млн м3/сут; D - мм, L - км, P - МПа). Корень сглажен около нуля,
+// чтобы якобиан оставался конечным. КС с работающими цехами повышает
+// давление на выходе в 1 + boostPerWorkshop * activeWorkshops раз.
+// Трубы в ремонте не учитываются.
+//
+// Шаг Ньютона принимается, только если уменьшает небаланс. Если линейная
+// система не решена или дробление шага не помогло, расчет останавливается
+// на последнем принятом приближении с соответствующим status.
+//
+// Якобиан хранится в CSR, линейные системы решаются BiCGSTAB с
+// блочным ILU(0)-предобусловливанием (SparseSolver.h). При нескольких
+// потоках неизвестные нумеруются по частям разбиения сети (GraphPartitioner.h).
+class GasFlowSolver {
+private:
+    struct Edge {
+        int from;
+        int to;
+        int pipeId;
+        double conductance;  // коэффициент Веймаута трубы
+        double boost;        // квадрат степени сжатия на входе трубы
+    };
+
+    FlowSettings settings;
+    size_t threadCount = 1;
+    std::vector<int> objectIds;
+    std::vector<char> nodeIsStation;
+    std::vector<FlowNodeRole> roles;
+    std::vector<Edge> edges;
+
+    // Нумерация неизвестных: узел -> строка матрицы или -1 для заданного давления
+    std::vector<int> unknownOf;
+    std::vector<int> nodeOfUnknown;
+
+    // Структура якобиана и позиции вкладов каждой трубы (uu, uv, vu, vv), -1 - нет
+    SparsePattern pattern;
+    std::vector<int> edgeSlots;
+
+    void buildPattern();
+    void assemble(const std::vector<double>& squared, bool linear, std::vector<double>& residual,
+                  std::vector<double>& values) const;
+
+public:
+    GasFlowSolver(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes,
+                  const PersistentVector<CompressorStation>& stations, const FlowSettings& settings = {});
+
+    FlowResult solve() const;
+
+    // Коэффициент Веймаута трубы: D - мм, L - км
+    static double pipeConductance(int diameter, double length);
+    // Квадрат степени сжатия КС с activeWorkshops работающими цехами
+    static double compressionBoost(const FlowSettings& settings, int activeWorkshops);
+    // Расход по трубе и его производная по перепаду квадратов давлений
+    static void pipeFlow(double conductance, double drop, double& flow, double& derivative);
+};
@@ -0,0 +1,563 @@
+#include "GraphPartitioner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
+#include "NetworkIslands.h"
+#include "PipeIndex.h"
+
+using namespace std;
+
+namespace {
+
+// Допустимый перекос веса части относительно доли; делится между уровнями рекурсии
+const double IMBALANCE = 0.03;
+// Огрубление останавливается на этом числе вершин или когда граф почти не уменьшается
+const size_t COARSEST_SIZE = 128;
+const double MIN_COARSENING = 0.9;
+// Затравки начального деления и проходы уточнения
+const int INITIAL_TRIES = 8;
+const int REFINE_PASSES = 6;
+// Проход прерывается после стольких ходов без улучшения
+const int MAX_FRUITLESS_MOVES = 100;
+
+// Взвешенный граф в CSR без петель и кратных ребер
+struct Graph {
+    vector<int> start;
+    vector<int> adjacency;
+    vector<int> edgeWeight;
+    vector<int> vertexWeight;
+    long long totalWeight = 0;
+
+    size_t size() const { return vertexWeight.size(); }
+};
+
+// Граф из списка ребер; параллельные ребра сливаются с суммой весов
+Graph buildGraph(size_t n, const vector<int>& from, const vector<int>& to, const vector<int>& weight,
+                 vector<int> vertexWeight) {
+    Graph graph;
+    graph.vertexWeight = move(vertexWeight);
+    graph.totalWeight = accumulate(graph.vertexWeight.begin(), graph.vertexWeight.end(), 0LL);
+
+    vector<int> degree(n + 1, 0);
+    for (size_t e = 0; e < from.size(); ++e) {
+        if (from[e] != to[e]) {
+            degree[from[e] + 1]++;
+            degree[to[e] + 1]++;
+        }
+    }
+    for (size_t v = 0; v < n; ++v) {
+        degree[v + 1] += degree[v];
+    }
+    vector<int> rawAdjacency(degree[n]), rawWeight(degree[n]);
+    vector<int> fill(degree.begin(), degree.end() - 1);
+    for (size_t e = 0; e < from.size(); ++e) {
+        if (from[e] != to[e]) {
+            rawAdjacency[fill[from[e]]] = to[e];
+            rawWeight[fill[from[e]]++] = weight[e];
+            rawAdjacency[fill[to[e]]] = from[e];
+            rawWeight[fill[to[e]]++] = weight[e];
+        }
+    }
+
+    // Слияние кратных ребер через отметку позиции соседа
+    vector<int> slotOf(n, -1);
+    graph.start.assign(n + 1, 0);
+    graph.adjacency.reserve(rawAdjacency.size());
+    graph.edgeWeight.reserve(rawAdjacency.size());
+    for (size_t v = 0; v < n; ++v) {
+        size_t first = graph.adjacency.size();
+        for (int k = degree[v]; k < degree[v + 1]; ++k) {
+            int u = rawAdjacency[k];
+            if (slotOf[u] == -1) {
+                slotOf[u] = static_cast<int>(graph.adjacency.size());
+                graph.adjacency.push_back(u);
+                graph.edgeWeight.push_back(rawWeight[k]);
+            } else {
+                graph.edgeWeight[slotOf[u]] += rawWeight[k];
+            }
+        }
+        for (size_t k = first; k < graph.adjacency.size(); ++k) {
+            slotOf[graph.adjacency[k]] = -1;
+        }
+        graph.start[v + 1] = static_cast<int>(graph.adjacency.size());
+    }
+    return graph;
+}
+
+// Стягивание паросочетания по самым тяжелым ребрам; coarseOf - вершина грубого графа
+Graph coarsen(const Graph& graph, vector<int>& coarseOf, mt19937& rng) {
+    const size_t n = graph.size();
+    // Слишком тяжелые вершины мешают потом сбалансировать деление
+    const long long maxVertexWeight = max<long long>(1, 3 * graph.totalWeight / (2 * COARSEST_SIZE));
+
+    vector<int> visit(n);
+    iota(visit.begin(), visit.end(), 0);
+    shuffle(visit.begin(), visit.end(), rng);
+
+    vector<int> match(n, -1);
+    for (int v : visit) {
+        if (match[v] != -1) {
+            continue;
+        }
+        int best = v;
+        int bestWeight = -1;
+        for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+            int u = graph.adjacency[k];
+            if (match[u] == -1 && graph.edgeWeight[k] > bestWeight &&
+                graph.vertexWeight[v] + graph.vertexWeight[u] <= maxVertexWeight) {
+                best = u;
+                bestWeight = graph.edgeWeight[k];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    coarseOf.assign(n, -1);
+    int coarseCount = 0;
+    for (size_t v = 0; v < n; ++v) {
+        if (coarseOf[v] == -1) {
+            coarseOf[v] = coarseCount;
+            coarseOf[match[v]] = coarseCount;
+            coarseCount++;
+        }
+    }
+
+    vector<int> from, to, weight;
+    vector<int> vertexWeight(coarseCount, 0);
+    for (size_t v = 0; v < n; ++v) {
+        vertexWeight[coarseOf[v]] += graph.vertexWeight[v];
+        for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+            int u = graph.adjacency[k];
+            // Каждое ребро один раз; ребра внутри пары исчезают
+            if (static_cast<int>(v) < u && coarseOf[v] != coarseOf[u]) {
+                from.push_back(coarseOf[v]);
+                to.push_back(coarseOf[u]);
+                weight.push_back(graph.edgeWeight[k]);
+            }
+        }
+    }
+    return buildGraph(coarseCount, from, to, weight, move(vertexWeight));
+}
+
+long long cutOf(const Graph& graph, const vector<char>& side) {
+    long long cut = 0;
+    for (size_t v = 0; v < graph.size(); ++v) {
+        for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+            if (side[v] != side[graph.adjacency[k]]) {
+                cut += graph.edgeWeight[k];
+            }
+        }
+    }
+    return cut / 2;
+}
+
+// Граница деления: вес стороны s не больше limit[s]
+struct Balance {
+    long long target[2];
+    long long limit[2];
+
+    Balance(const Graph& graph, double fraction, double imbalance) {
+        int heaviest = graph.size() ? *max_element(graph.vertexWeight.begin(), graph.vertexWeight.end()) : 0;
+        target[0] = static_cast<long long>(graph.totalWeight * fraction + 0.5);
+        target[1] = graph.totalWeight - target[0];
+        for (int s = 0; s < 2; ++s) {
+            // На грубых уровнях точный баланс может быть недостижим из-за тяжелых вершин
+            limit[s] = max(static_cast<long long>(target[s] * (1 + imbalance)), target[s] + heaviest - 1);
+        }
+    }
+
+    // Насколько деление выходит за пределы (0 - сбалансировано)
+    long long excess(const long long weight[2]) const {
+        return max(0LL, weight[0] - limit[0]) + max(0LL, weight[1] - limit[1]);
+    }
+
+    // Отклонение от точных долей - последний критерий при равных разрезах
+    long long deviation(const long long weight[2]) const {
+        return weight[0] > target[0] ? weight[0] - target[0] : target[0] - weight[0];
+    }
+
+    // true, если состояние (excess, cut, deviation) лучше другого
+    static bool better(long long excess, long long cut, long long deviation,
+                       long long otherExcess, long long otherCut, long long otherDeviation) {
+        if (excess != otherExcess) {
+            return excess < otherExcess;
+        }
+        return cut != otherCut ? cut < otherCut : deviation < otherDeviation;
+    }
+};
+
+// Уточнение деления методом Фидуччи - Маттейсеса. Ходы с наибольшим
+// выигрышем выполняются даже при отрицательном выигрыше, затем проход
+// откатывается к лучшему состоянию; каждая вершина ходит за проход один раз.
+void refine(const Graph& graph, vector<char>& side, const Balance& balance) {
+    const size_t n = graph.size();
+    vector<long long> external(n), internal(n);
+    long long weight[2] = {0, 0};
+    for (size_t v = 0; v < n; ++v) {
+        weight[static_cast<int>(side[v])] += graph.vertexWeight[v];
+        external[v] = internal[v] = 0;
+        for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+            (side[graph.adjacency[k]] != side[v] ? external[v] : internal[v]) += graph.edgeWeight[k];
+        }
+    }
+    long long cut = cutOf(graph, side);
+
+    using Entry = pair<long long, int>;  // (выигрыш, вершина); устаревшие записи пропускаются
+    vector<char> locked(n);
+    vector<int> moves;
+    for (int pass = 0; pass < REFINE_PASSES; ++pass) {
+        priority_queue<Entry> queues[2];
+        for (size_t v = 0; v < n; ++v) {
+            if (external[v] > 0) {
+                queues[static_cast<int>(side[v])].push({external[v] - internal[v], static_cast<int>(v)});
+            }
+        }
+        fill(locked.begin(), locked.end(), 0);
+        moves.clear();
+
+        long long bestCut = cut;
+        long long bestExcess = balance.excess(weight);
+        long long bestDeviation = balance.deviation(weight);
+        size_t bestMoves = 0;
+
+        auto topOf = [&](int s) {
+            while (!queues[s].empty()) {
+                auto [gain, v] = queues[s].top();
+                if (!locked[v] && side[v] == s && gain == external[v] - internal[v]) {
+                    return v;
+                }
+                queues[s].pop();
+            }
+            return -1;
+        };
+
+        while (moves.size() - bestMoves < static_cast<size_t>(MAX_FRUITLESS_MOVES)) {
+            int candidate[2] = {topOf(0), topOf(1)};
+            int from = -1;
+            if (weight[0] > balance.limit[0]) {
+                from = 0;
+            } else if (weight[1] > balance.limit[1]) {
+                from = 1;
+            } else {
+                for (int s = 0; s < 2; ++s) {
+                    int v = candidate[s];
+                    if (v == -1 || weight[1 - s] + graph.vertexWeight[v] > balance.limit[1 - s]) {
+                        continue;
+                    }
+                    if (from == -1 || external[v] - internal[v] >
+                                          external[candidate[from]] - internal[candidate[from]]) {
+                        from = s;
+                    }
+                }
+            }
+            if (from == -1 || candidate[from] == -1) {
+                break;
+            }
+
+            int v = candidate[from];
+            queues[from].pop();
+            cut -= external[v] - internal[v];
+            weight[from] -= graph.vertexWeight[v];
+            weight[1 - from] += graph.vertexWeight[v];
+            side[v] = static_cast<char>(1 - from);
+            swap(external[v], internal[v]);
+            locked[v] = 1;
+            moves.push_back(v);
+
+            for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+                int u = graph.adjacency[k];
+                int w = graph.edgeWeight[k];
+                if (side[u] == side[v]) {
+                    external[u] -= w;
+                    internal[u] += w;
+                } else {
+                    external[u] += w;
+                    internal[u] -= w;
+                }
+                if (!locked[u] && external[u] > 0) {
+                    queues[static_cast<int>(side[u])].push({external[u] - internal[u], u});
+                }
+            }
+
+            long long currentExcess = balance.excess(weight);
+            long long currentDeviation = balance.deviation(weight);
+            if (Balance::better(currentExcess, cut, currentDeviation, bestExcess, bestCut, bestDeviation)) {
+                bestCut = cut;
+                bestExcess = currentExcess;
+                bestDeviation = currentDeviation;
+                bestMoves = moves.size();
+            }
+        }
+
+        // Откат ходов после лучшего состояния
+        for (size_t i = moves.size(); i-- > bestMoves;) {
+            int v = moves[i];
+            int from = side[v];
+            weight[from] -= graph.vertexWeight[v];
+            weight[1 - from] += graph.vertexWeight[v];
+            side[v] = static_cast<char>(1 - from);
+            swap(external[v], internal[v]);
+            for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+                int u = graph.adjacency[k];
+                int w = graph.edgeWeight[k];
+                if (side[u] == side[v]) {
+                    external[u] -= w;
+                    internal[u] += w;
+                } else {
+                    external[u] += w;
+                    internal[u] -= w;
+                }
+            }
+        }
+        cut = bestCut;
+        if (bestMoves == 0) {
+            break;
+        }
+    }
+}
+
+// Начальное деление грубого графа: сторона 0 растет обходом в ширину от
+// случайной затравки до своей доли веса; лучшая из попыток после уточнения
+vector<char> initialBisection(const Graph& graph, const Balance& balance, mt19937& rng) {
+    const size_t n = graph.size();
+    vector<char> best;
+    long long bestCut = 0, bestExcess = 0, bestDeviation = 0;
+    uniform_int_distribution<size_t> pick(0, n - 1);
+
+    for (int attempt = 0; attempt < INITIAL_TRIES; ++attempt) {
+        vector<char> side(n, 1);
+        long long grown = 0;
+        queue<int> frontier;
+        size_t nextSeed = pick(rng);
+        for (size_t scanned = 0; grown < balance.target[0] && scanned < n;) {
+            if (frontier.empty()) {
+                // Несвязный граф: следующая затравка - первая еще не взятая вершина
+                while (scanned < n && side[(nextSeed + scanned) % n] == 0) {
+                    scanned++;
+                }
+                if (scanned == n) {
+                    break;
+                }
+                int seed = static_cast<int>((nextSeed + scanned) % n);
+                side[seed] = 0;
+                grown += graph.vertexWeight[seed];
+                frontier.push(seed);
+                continue;
+            }
+            int v = frontier.front();
+            frontier.pop();
+            for (int k = graph.start[v]; k < graph.start[v + 1] && grown < balance.target[0]; ++k) {
+                int u = graph.adjacency[k];
+                if (side[u] == 1) {
+                    side[u] = 0;
+                    grown += graph.vertexWeight[u];
+                    frontier.push(u);
+                }
+            }
+        }
+
+        refine(graph, side, balance);
+        long long weight[2] = {0, 0};
+        for (size_t v = 0; v < n; ++v) {
+            weight[static_cast<int>(side[v])] += graph.vertexWeight[v];
+        }
+        long long cut = cutOf(graph, side);
+        long long excess = balance.excess(weight);
+        long long deviation = balance.deviation(weight);
+        if (best.empty() || Balance::better(excess, cut, deviation, bestExcess, bestCut, bestDeviation)) {
+            best = side;
+            bestCut = cut;
+            bestExcess = excess;
+            bestDeviation = deviation;
+        }
+    }
+    return best;
+}
+
+// Многоуровневое деление пополам: доля fraction веса - стороне 0
+vector<char> bisect(const Graph& graph, double fraction, double imbalance, mt19937& rng) {
+    vector<Graph> levels;
+    vector<vector<int>> coarseOf;
+    const Graph* current = &graph;
+    while (current->size() > COARSEST_SIZE) {
+        vector<int> mapping;
+        Graph coarse = coarsen(*current, mapping, rng);
+        if (coarse.size() > current->size() * MIN_COARSENING) {
+            break;
+        }
+        levels.push_back(move(coarse));
+        coarseOf.push_back(move(mapping));
+        current = &levels.back();
+    }
+
+    vector<char> side = initialBisection(*current, Balance(*current, fraction, imbalance), rng);
+    for (size_t level = levels.size(); level-- > 0;) {
+        const Graph& finer = level == 0 ? graph : levels[level - 1];
+        vector<char> projected(finer.size());
+        for (size_t v = 0; v < finer.size(); ++v) {
+            projected[v] = side[coarseOf[level][v]];
+        }
+        side.swap(projected);
+        refine(finer, side, Balance(finer, fraction, imbalance));
+    }
+    return side;
+}
+
+void partitionRecursive(const Graph& graph, const vector<int>& originalIds, size_t parts, int firstPart,
+                        double imbalance, vector<int>& partOf, mt19937& rng) {
+    if (parts == 1 || graph.size() <= 1) {
+        for (int id : originalIds) {
+            partOf[id] = firstPart;
+        }
+        return;
+    }
+
+    const size_t leftParts = parts / 2;
+    vector<char> side = bisect(graph, static_cast<double>(leftParts) / parts, imbalance, rng);
+
+    // Подграфы сторон; ребра между сторонами отбрасываются
+    for (int s = 0; s < 2; ++s) {
+        vector<int> localOf(graph.size(), -1);
+        vector<int> ids, vertexWeight;
+        for (size_t v = 0; v < graph.size(); ++v) {
+            if (side[v] == s) {
+                localOf[v] = static_cast<int>(ids.size());
+                ids.push_back(originalIds[v]);
+                vertexWeight.push_back(graph.vertexWeight[v]);
+            }
+        }
+        vector<int> from, to, weight;
+        for (size_t v = 0; v < graph.size(); ++v) {
+            if (side[v] != s) {
+                continue;
+            }
+            for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+                int u = graph.adjacency[k];
+                if (static_cast<int>(v) < u && side[u] == s) {
+                    from.push_back(localOf[v]);
+                    to.push_back(localOf[u]);
+                    weight.push_back(graph.edgeWeight[k]);
+                }
+            }
+        }
+        Graph sub = buildGraph(ids.size(), from, to, weight, move(vertexWeight));
+        size_t subParts = s == 0 ? leftParts : parts - leftParts;
+        partitionRecursive(sub, ids, subParts, s == 0 ? firstPart : firstPart + static_cast<int>(leftParts),
+                           imbalance, partOf, rng);
+    }
+}
+
+}
+
+GraphPartition partitionGraph(size_t vertexCount, const vector<pair<int, int>>& edges, size_t parts,
+                              const vector<int>& vertexWeights, const vector<int>& edgeWeights) {
+    GraphPartition result;
+    parts = max<size_t>(min(parts, vertexCount), 1);
+
+    vector<int> from(edges.size()), to(edges.size());
+    vector<int> weight = edgeWeights.empty() ? vector<int>(edges.size(), 1) : edgeWeights;
+    for (size_t e = 0; e < edges.size(); ++e) {
+        from[e] = edges[e].first;
+        to[e] = edges[e].second;
+    }
+    Graph graph = buildGraph(vertexCount, from, to, weight,
+                             vertexWeights.empty() ? vector<int>(vertexCount, 1) : vertexWeights);
+
+    result.part.assign(vertexCount, 0);
+    vector<int> ids(vertexCount);
+    iota(ids.begin(), ids.end(), 0);
+    // Перекосы уровней перемножаются: (1 + e)^levels = 1 + IMBALANCE
+    const double levels = ceil(log2(static_cast<double>(parts)));
+    const double imbalance = levels > 0 ? pow(1 + IMBALANCE, 1 / levels) - 1 : IMBALANCE;
+    mt19937 rng(1);
+    partitionRecursive(graph, ids, parts, 0, imbalance, result.part, rng);
+
+    for (size_t e = 0; e < edges.size(); ++e) {
+        if (result.part[edges[e].first] != result.part[edges[e].second]) {
+            result.cutEdges.push_back(static_cast<int>(e));
+            result.cutWeight += weight[e];
+        }
+    }
+
+    // Части подряд; внутри части - обход в ширину по ребрам части
+    result.partStart.assign(parts + 1, 0);
+    for (int p : result.part) {
+        result.partStart[p + 1]++;
+    }
+    for (size_t p = 0; p < parts; ++p) {
+        result.partStart[p + 1] += result.partStart[p];
+    }
+    vector<int> fill(result.partStart.begin(), result.partStart.end() - 1);
+    result.order.resize(vertexCount);
+    result.newIndex.assign(vertexCount, -1);
+    for (size_t root = 0; root < vertexCount; ++root) {
+        if (result.newIndex[root] != -1) {
+            continue;
+        }
+        const int p = result.part[root];
+        queue<int> pending;
+        pending.push(static_cast<int>(root));
+        result.newIndex[root] = fill[p]++;
+        while (!pending.empty()) {
+            int v = pending.front();
+            pending.pop();
+            result.order[result.newIndex[v]] = v;
+            for (int k = graph.start[v]; k < graph.start[v + 1]; ++k) {
+                int u = graph.adjacency[k];
+                if (result.newIndex[u] == -1 && result.part[u] == p) {
+                    result.newIndex[u] = fill[p]++;
+                    pending.push(u);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+NetworkPartition partitionNetwork(const PersistentVector<NetworkConnection>& network,
+                                  const PersistentVector<Pipe>& pipes, size_t parts) {
+    PipeIndex pipeById(pipes);
+    unordered_map<int64_t, int> localByNode;
+    vector<int64_t> nodes;
+    auto localOf = [&](int id, bool isStation) {
+        int64_t node = NetworkIslands::nodeIndex(id, isStation);
+        auto [it, inserted] = localByNode.emplace(node, static_cast<int>(nodes.size()));
+        if (inserted) {
+            nodes.push_back(node);
+        }
+        return it->second;
+    };
+
+    vector<pair<int, int>> edges;
+    vector<int> pipeIds;
+    edges.reserve(network.size());
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        edges.push_back({localOf(pipe->startId, startIsStation(*pipe)),
+                         localOf(pipe->endId, endIsStation(*pipe))});
+        pipeIds.push_back(conn.pipeId);
+    }
+
+    GraphPartition partition = partitionGraph(nodes.size(), edges, parts);
+    NetworkPartition result;
+    result.partStart = partition.partStart;
+    result.nodes.reserve(nodes.size());
+    result.part.reserve(nodes.size());
+    for (int local : partition.order) {
+        result.nodes.push_back(nodes[local]);
+        result.part.push_back(partition.part[local]);
+    }
+    for (int e : partition.cutEdges) {
+        result.cutPipeIds.push_back(pipeIds[e]);
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+// Разбиение вершин графа на части
+struct GraphPartition {
+    std::vector<int> part;       // часть каждой вершины
+    std::vector<int> cutEdges;   // индексы ребер, концы которых в разных частях
+    long long cutWeight = 0;     // суммарный вес разрезанных ребер
+    // Перенумерация: вершины частей идут подряд, внутри части - в порядке
+    // обхода в ширину. order[k] - вершина с новым номером k, newIndex - обратное.
+    std::vector<int> order;
+    std::vector<int> newIndex;
+    std::vector<int> partStart;  // вершины части p - order[partStart[p] .. partStart[p + 1])
+};
+
+// Многоуровневое разбиение неориентированного графа на parts частей с
+// равным (с допуском 3%) весом вершин и малым весом разрезанных ребер.
+// Каждое деление пополам: граф огрубляется стягиванием ребер с наибольшим
+// весом, грубый граф делится выращиванием области из нескольких затравок,
+// затем при развертывании на каждом уровне граница уточняется методом
+// Фидуччи - Маттейсеса. Части получаются рекурсивным делением пополам.
+// Пустые веса - все веса равны 1. Частей не больше, чем вершин (и не
+// меньше одной). Результат детерминирован.
+GraphPartition partitionGraph(size_t vertexCount, const std::vector<std::pair<int, int>>& edges, size_t parts,
+                              const std::vector<int>& vertexWeights = {}, const std::vector<int>& edgeWeights = {});
+
+// Разбиение сети: узлы - КС и трубы-узлы (NetworkIslands::nodeIndex), ребра - трубы
+struct NetworkPartition {
+    std::vector<int64_t> nodes;  // узлы в новой нумерации, части подряд
+    std::vector<int> part;       // часть каждого узла из nodes (не убывает)
+    std::vector<int> partStart;  // узлы части p - nodes[partStart[p] .. partStart[p + 1])
+    std::vector<int> cutPipeIds; // трубы между разными частями
+};
+
+NetworkPartition partitionNetwork(const PersistentVector<NetworkConnection>& network,
+                                  const PersistentVector<Pipe>& pipes, size_t parts);
@@ -0,0 +1,46 @@
+#include "Logger.h"
+
+#include <chrono>
+#include <ctime>
+
+using namespace std;
+
+// localtime_r вместо localtime: localtime возвращает указатель на общий
+// статический буфер и не может вызываться из нескольких потоков
+string Logger::formatTime(const char* format) {
+    auto now = chrono::system_clock::now();
+    auto time = chrono::system_clock::to_time_t(now);
+
+    tm localTime{};
+    localtime_r(&time, &localTime);
+
+    char timeStr[64];
+    strftime(timeStr, sizeof(timeStr), format, &localTime);
+    return timeStr;
+}
+
+Logger::Logger(const string& filename) {
+    logFile.open(filename, ios::app);
+    if (logFile.is_open()) {
+        // Формат совпадает с ctime(): "Mon Jan  1 12:00:00 2024"
+        logFile << "\n=== Сессия начата: " << formatTime("%a %b %e %H:%M:%S %Y") << endl;
+    }
+}
+
+Logger::~Logger() {
+    if (logFile.is_open()) {
+        logFile << "=== Сессия завершена: " << formatTime("%a %b %e %H:%M:%S %Y") << endl << endl;
+        logFile.close();
+    }
+}
+
+void Logger::log(const string& action, const string& details) const {
+    lock_guard<mutex> lock(logMutex);
+    if (logFile.is_open()) {
+        logFile << formatTime("%Y-%m-%d %H:%M:%S") << " | " << action;
+        if (!details.empty()) {
+            logFile << " | " << details;
+        }
+        logFile << endl;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// Журнал действий пользователя. Методы можно вызывать из разных потоков:
+// запись в файл сериализуется мьютексом, а время форматируется реентерабельно.
+class Logger {
+private:
+    mutable std::ofstream logFile;
+    mutable std::mutex logMutex;
+
+    static std::string formatTime(const char* format);
+
+public:
+    explicit Logger(const std::string& filename = "pipeline_log.txt");
+    ~Logger();
+
+    void log(const std::string& action, const std::string& details = "") const;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "MemoryAccounting.h"
+
+// Кэш с ограничением суммарного размера записей: при переполнении
+// вытесняются давно не использованные (LRU). Размер записи (cost) задает
+// вызывающий; он же учитывается в MemoryTracker. Поиск и вставка - O(1).
+// Не потокобезопасен: владелец защищает кэш своим мьютексом.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    std::list<Entry> entries;  // от недавно использованных к давним
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+    size_t capacity;
+    size_t used = 0;
+    MemoryCategory category;
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    uint64_t evictionCount = 0;
+
+    void evictLast() {
+        const Entry& last = entries.back();
+        used -= last.cost;
+        MemoryTracker::instance().released(category, last.cost);
+        index.erase(last.key);
+        entries.pop_back();
+        ++evictionCount;
+    }
+
+public:
+    explicit LruCache(size_t capacityBytes, MemoryCategory category = MemoryCategory::Other)
+        : capacity(capacityBytes), category(category) {}
+    ~LruCache() { MemoryTracker::instance().released(category, used); }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // Запись по ключу (становится самой свежей) или nullptr. Указатель
+    // действителен до следующего изменения кэша.
+    const Value* find(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            ++missCount;
+            return nullptr;
+        }
+        ++hitCount;
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    // Запись дороже всего кэша не сохраняется; прежняя запись с тем же ключом заменяется
+    void insert(const Key& key, Value value, size_t cost) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            used -= it->second->cost;
+            MemoryTracker::instance().released(category, it->second->cost);
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        if (cost > capacity) {
+            return;
+        }
+        while (used + cost > capacity) {
+            evictLast();
+        }
+        entries.push_front({key, std::move(value), cost});
+        index.emplace(key, entries.begin());
+        used += cost;
+        MemoryTracker::instance().allocated(category, cost);
+    }
+
+    void clear() {
+        MemoryTracker::instance().released(category, used);
+        entries.clear();
+        index.clear();
+        used = 0;
+    }
+
+    void resetStats() {
+        hitCount = 0;
+        missCount = 0;
+        evictionCount = 0;
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t bytesUsed() const { return used; }
+    size_t capacityBytes() const { return capacity; }
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    uint64_t evictions() const { return evictionCount; }
+};
@@ -0,0 +1,31 @@
+#include "MemoryAccounting.h"
+
+using namespace std;
+
+namespace {
+
+const char* const CATEGORY_NAMES[] = {
+    "pipes", "stations", "network", "names", "islands", "reachability", "query_cache", "scratch", "other"
+};
+static_assert(sizeof(CATEGORY_NAMES) / sizeof(CATEGORY_NAMES[0]) == static_cast<size_t>(MemoryCategory::Count),
+              "имя нужно каждой структуре");
+
+}
+
+const char* memoryCategoryName(MemoryCategory category) {
+    return CATEGORY_NAMES[static_cast<size_t>(category)];
+}
+
+// Объект не уничтожается: статические структуры освобождают память и
+// после выхода из main, в том числе позже разрушения обычных статиков
+MemoryTracker& MemoryTracker::instance() {
+    static MemoryTracker* tracker = new MemoryTracker;
+    return *tracker;
+}
+
+void MemoryTracker::resetPeaks() {
+    for (Counter& counter : counters) {
+        counter.peak.store(counter.current.load(memory_order_relaxed), memory_order_relaxed);
+    }
+    total.peak.store(total.current.load(memory_order_relaxed), memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Структуры, память которых учитывается отдельно
+enum class MemoryCategory {
+    Pipes,
+    Stations,
+    Network,       // соединения
+    Names,         // пул строк (StringPool)
+    Islands,       // динамическая связность для островов
+    Reachability,  // индексы достижимости
+    QueryCache,    // кэш результатов поиска пути и сортировки
+    Scratch,       // арены потоков для временных данных алгоритмов
+    Other,
+    Count
+};
+
+// Имя для вывода: pipes, names, ...
+const char* memoryCategoryName(MemoryCategory category);
+
+// Учет памяти процесса по структурам. Счетчики меняют учитывающие
+// аллокаторы при каждом выделении и освобождении, поэтому отчет не обходит
+// объекты и стоит O(число структур). Учитывается вся память структуры во
+// всех версиях: снимки для отмены и читателей, запас емкости блоков.
+class MemoryTracker {
+private:
+    struct Counter {
+        std::atomic<size_t> current{0};
+        std::atomic<size_t> peak{0};
+    };
+
+    std::array<Counter, static_cast<size_t>(MemoryCategory::Count)> counters;
+    Counter total;  // все структуры вместе: пик суммы меньше суммы пиков
+
+    static void add(Counter& counter, size_t bytes) {
+        const size_t now = counter.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t highest = counter.peak.load(std::memory_order_relaxed);
+        while (now > highest && !counter.peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {
+        }
+    }
+
+public:
+    static MemoryTracker& instance();
+
+    void allocated(MemoryCategory category, size_t bytes) {
+        add(counters[static_cast<size_t>(category)], bytes);
+        add(total, bytes);
+    }
+    void released(MemoryCategory category, size_t bytes) {
+        counters[static_cast<size_t>(category)].current.fetch_sub(bytes, std::memory_order_relaxed);
+        total.current.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t reserved(MemoryCategory category) const {
+        return counters[static_cast<size_t>(category)].current.load(std::memory_order_relaxed);
+    }
+    // Наибольшее значение reserved с запуска или с resetPeaks()
+    size_t peak(MemoryCategory category) const {
+        return counters[static_cast<size_t>(category)].peak.load(std::memory_order_relaxed);
+    }
+    size_t totalReserved() const { return total.current.load(std::memory_order_relaxed); }
+    size_t totalPeak() const { return total.peak.load(std::memory_order_relaxed); }
+    // Пики опускаются до текущих значений
+    void resetPeaks();
+};
+
+// Структура, к которой относится память элементов типа T
+// (специализации для записей сети - в PipelineTypes.h)
+template <typename T>
+struct MemoryCategoryOf {
+    static constexpr MemoryCategory value = MemoryCategory::Other;
+};
+
+// Аллокатор для стандартных контейнеров, ведущий счет в MemoryTracker
+template <typename T, MemoryCategory Category = MemoryCategoryOf<T>::value>
+class TrackedAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackedAllocator<U, Category>;
+    };
+
+    TrackedAllocator() = default;
+    template <typename U>
+    TrackedAllocator(const TrackedAllocator<U, Category>&) {}
+
+    T* allocate(size_t count) {
+        T* result = static_cast<T*>(::operator new(count * sizeof(T)));
+        MemoryTracker::instance().allocated(Category, count * sizeof(T));
+        return result;
+    }
+    void deallocate(T* pointer, size_t count) {
+        MemoryTracker::instance().released(Category, count * sizeof(T));
+        ::operator delete(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const TrackedAllocator<U, Category>&) const { return true; }
+    template <typename U>
+    bool operator!=(const TrackedAllocator<U, Category>&) const { return false; }
+};
+
+struct MemoryUsage {
+    MemoryCategory category = MemoryCategory::Other;
+    size_t used = 0;      // занято данными текущего состояния
+    size_t reserved = 0;  // выделено под структуру во всех версиях
+    size_t peak = 0;      // наибольшее reserved
+};
+
+struct MemoryReport {
+    std::vector<MemoryUsage> entries;  // по структурам в порядке перечисления
+    size_t totalUsed = 0;
+    size_t totalReserved = 0;
+    size_t totalPeak = 0;
+};
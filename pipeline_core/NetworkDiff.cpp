@@ -0,0 +1,483 @@
+#include "NetworkDiff.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <tuple>
+
+#include "PipeIndex.h"
+#include "TaskScheduler.h"
+
+using namespace std;
+
+namespace {
+
+// Пары (ID, индекс) в порядке ID; при равных ID - в порядке записей
+template <typename Record>
+vector<pair<int, uint32_t>> orderById(const PersistentVector<Record>& records) {
+    vector<pair<int, uint32_t>> order(records.size());
+    bool sorted = true;
+    for (size_t i = 0; i < records.size(); ++i) {
+        order[i] = {records[i].id, static_cast<uint32_t>(i)};
+        sorted = sorted && (i == 0 || order[i - 1].first <= order[i].first);
+    }
+    if (!sorted) {
+        sort(order.begin(), order.end());
+    }
+    return order;
+}
+
+// Соединение сравнивается по трубе и ее концам; последний элемент - индекс записи
+using ConnectionKey = tuple<int, int, int, int, int, uint32_t>;
+
+// Ключи соединений в порядке сравнения; connected[i] - труба i-го соединения
+vector<ConnectionKey> orderConnections(const PersistentVector<NetworkConnection>& network,
+                                       const PersistentVector<Pipe>& pipes, vector<const Pipe*>& connected) {
+    PipeIndex pipeById(pipes);
+    vector<ConnectionKey> order(network.size());
+    connected.resize(network.size());
+    for (size_t i = 0; i < network.size(); ++i) {
+        const int pipeId = network[i].pipeId;
+        const Pipe* pipe = connected[i] = pipeById.find(pipeId);
+        order[i] = pipe ? ConnectionKey{pipeId, pipe->startId, pipe->endId, pipe->startType, pipe->endType,
+                                        static_cast<uint32_t>(i)}
+                        : ConnectionKey{pipeId, 0, 0, -1, -1, static_cast<uint32_t>(i)};
+    }
+    sort(order.begin(), order.end());
+    return order;
+}
+
+bool sameFields(const ConnectionKey& a, const ConnectionKey& b) {
+    return get<0>(a) == get<0>(b) && get<1>(a) == get<1>(b) && get<2>(a) == get<2>(b) &&
+           get<3>(a) == get<3>(b) && get<4>(a) == get<4>(b);
+}
+
+bool sameRecord(const Pipe& a, const Pipe& b) {
+    return a.name == b.name && a.length == b.length && a.diameter == b.diameter &&
+           a.underRepair == b.underRepair && a.inUse == b.inUse && a.startId == b.startId &&
+           a.endId == b.endId && a.startType == b.startType && a.endType == b.endType;
+}
+
+bool sameRecord(const CompressorStation& a, const CompressorStation& b) {
+    return a.name == b.name && a.totalWorkshops == b.totalWorkshops && a.activeWorkshops == b.activeWorkshops &&
+           a.stationClass == b.stationClass;
+}
+
+// Сопоставленные записи - пары (номер в первом состоянии, номер во втором)
+// в порядке первого. true - пара входит в наибольшую подпоследовательность,
+// идущую в том же порядке и во втором состоянии (сортировка "пасьянсом",
+// O(n log n)); эти записи остаются на местах, прочие переносятся.
+vector<bool> keptInOrder(const vector<pair<uint32_t, uint32_t>>& matches) {
+    vector<uint32_t> tails;  // последняя пара лучшей цепочки каждой длины
+    vector<int64_t> previous(matches.size(), -1);
+    for (size_t m = 0; m < matches.size(); ++m) {
+        auto place = lower_bound(tails.begin(), tails.end(), matches[m].second,
+                                 [&matches](uint32_t tail, uint32_t value) { return matches[tail].second < value; });
+        if (place != tails.begin()) {
+            previous[m] = *(place - 1);
+        }
+        if (place == tails.end()) {
+            tails.push_back(static_cast<uint32_t>(m));
+        } else {
+            *place = static_cast<uint32_t>(m);
+        }
+    }
+    vector<bool> kept(matches.size(), false);
+    for (int64_t m = tails.empty() ? int64_t(-1) : int64_t(tails.back()); m != -1; m = previous[m]) {
+        kept[m] = true;
+    }
+    return kept;
+}
+
+const int64_t UNMATCHED = -1;
+
+// Для каждой записи первого состояния - номер ее пары во втором, если запись
+// остается на месте, иначе UNMATCHED; placed отмечает эти пары во втором
+vector<int64_t> stayingPartners(vector<pair<uint32_t, uint32_t>>& matches, size_t beforeCount,
+                                vector<bool>& placed) {
+    sort(matches.begin(), matches.end());
+    const vector<bool> kept = keptInOrder(matches);
+    vector<int64_t> partner(beforeCount, UNMATCHED);
+    for (size_t m = 0; m < matches.size(); ++m) {
+        if (kept[m]) {
+            partner[matches[m].first] = matches[m].second;
+            placed[matches[m].second] = true;
+        }
+    }
+    return partner;
+}
+
+// report(kind, до, после, место) для каждого различия секции, сопоставленной по ID
+template <typename Record, typename Report>
+void diffById(const PersistentVector<Record>& before, const PersistentVector<Record>& after,
+              const vector<pair<int, uint32_t>>& orderBefore, const vector<pair<int, uint32_t>>& orderAfter,
+              Report report) {
+    vector<pair<uint32_t, uint32_t>> matches;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < orderBefore.size() && j < orderAfter.size()) {
+        if (orderBefore[i].first < orderAfter[j].first) {
+            ++i;
+        } else if (orderAfter[j].first < orderBefore[i].first) {
+            ++j;
+        } else {
+            matches.push_back({orderBefore[i].second, orderAfter[j].second});
+            ++i;
+            ++j;
+        }
+    }
+    vector<bool> placed(after.size(), false);
+    const vector<int64_t> partner = stayingPartners(matches, before.size(), placed);
+
+    for (const auto& [id, index] : orderBefore) {
+        const Record& old = before[index];
+        if (partner[index] == UNMATCHED) {
+            report(ChangeKind::Removed, &old, nullptr, size_t(0));
+        } else if (!sameRecord(old, after[partner[index]])) {
+            report(ChangeKind::Modified, &old, &after[partner[index]], size_t(0));
+        }
+    }
+    for (size_t k = 0; k < after.size(); ++k) {
+        if (!placed[k]) {
+            report(ChangeKind::Added, nullptr, &after[k], k);
+        }
+    }
+}
+
+void appendNumber(string& line, int value) {
+    char buffer[16];
+    line.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+void appendNumber(string& line, double value) {
+    char buffer[32];
+    line.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+// Поля строки патча, разделенные одним пробелом; название - остаток строки
+class PatchFields {
+private:
+    string_view rest;
+    bool failed = false;
+    bool exhausted = false;
+
+    string_view next() {
+        const size_t space = rest.find(' ');
+        string_view field = rest.substr(0, space);
+        rest = space == string_view::npos ? string_view() : rest.substr(space + 1);
+        if (field.empty()) {
+            failed = true;
+        }
+        return field;
+    }
+
+public:
+    explicit PatchFields(string_view line) : rest(line) {}
+
+    template <typename Number>
+    Number number() {
+        string_view field = next();
+        Number value{};
+        auto [end, error] = from_chars(field.data(), field.data() + field.size(), value);
+        if (error != errc() || end != field.data() + field.size()) {
+            failed = true;
+        }
+        return value;
+    }
+
+    bool flag() {
+        const int value = number<int>();
+        if (value != 0 && value != 1) {
+            failed = true;
+        }
+        return value == 1;
+    }
+
+    ConnectionType type() {
+        const int value = number<int>();
+        if (value < 0 || value > 3) {
+            failed = true;
+        }
+        return toConnectionType(value);
+    }
+
+    void name(InternedName& target) {
+        if (!target.assign(rest)) {
+            failed = true;
+            exhausted = true;
+        }
+        rest = string_view();
+    }
+
+    // Все поля прочитаны без ошибок и лишнего текста не осталось
+    bool done() const { return !failed && rest.empty(); }
+    // Название не поместилось в пул строк
+    bool namesExhausted() const { return exhausted; }
+};
+
+Pipe readPipe(PatchFields& fields) {
+    Pipe pipe{};
+    pipe.id = fields.number<int>();
+    pipe.length = fields.number<double>();
+    pipe.diameter = fields.number<int>();
+    pipe.underRepair = fields.flag();
+    pipe.inUse = fields.flag();
+    pipe.startId = fields.number<int>();
+    pipe.endId = fields.number<int>();
+    pipe.startType = fields.type();
+    pipe.endType = fields.type();
+    fields.name(pipe.name);
+    return pipe;
+}
+
+CompressorStation readStation(PatchFields& fields) {
+    CompressorStation station{};
+    station.id = fields.number<int>();
+    station.totalWorkshops = fields.number<int>();
+    station.activeWorkshops = fields.number<int>();
+    station.stationClass = fields.number<int>();
+    fields.name(station.name);
+    return station;
+}
+
+ConnectionRecord readConnection(PatchFields& fields) {
+    ConnectionRecord conn;
+    conn.pipeId = fields.number<int>();
+    conn.startId = fields.number<int>();
+    conn.endId = fields.number<int>();
+    conn.startType = fields.type();
+    conn.endType = fields.type();
+    return conn;
+}
+
+}
+
+DiffSummary diffNetworks(const PersistentVector<Pipe>& pipesBefore,
+                         const PersistentVector<CompressorStation>& stationsBefore,
+                         const PersistentVector<NetworkConnection>& networkBefore,
+                         const PersistentVector<Pipe>& pipesAfter,
+                         const PersistentVector<CompressorStation>& stationsAfter,
+                         const PersistentVector<NetworkConnection>& networkAfter, const ChangeSink& sink) {
+    vector<pair<int, uint32_t>> pipeOrderBefore, pipeOrderAfter, stationOrderBefore, stationOrderAfter;
+    vector<ConnectionKey> connectionOrderBefore, connectionOrderAfter;
+    vector<const Pipe*> connectedBefore, connectedAfter;
+    TaskGroup group;
+    group.run([&]() { pipeOrderBefore = orderById(pipesBefore); });
+    group.run([&]() { pipeOrderAfter = orderById(pipesAfter); });
+    group.run([&]() { stationOrderBefore = orderById(stationsBefore); });
+    group.run([&]() { stationOrderAfter = orderById(stationsAfter); });
+    group.run([&]() { connectionOrderBefore = orderConnections(networkBefore, pipesBefore, connectedBefore); });
+    group.run([&]() { connectionOrderAfter = orderConnections(networkAfter, pipesAfter, connectedAfter); });
+    group.wait();
+
+    DiffSummary summary;
+    NetworkChange change;
+    auto emit = [&]() {
+        if (sink) {
+            sink(change);
+        }
+    };
+
+    diffById(pipesBefore, pipesAfter, pipeOrderBefore, pipeOrderAfter,
+             [&](ChangeKind kind, const Pipe* before, const Pipe* after, size_t position) {
+                 change = NetworkChange();
+                 change.kind = kind;
+                 change.pipeBefore = before;
+                 change.pipeAfter = after;
+                 change.position = position;
+                 ++(kind == ChangeKind::Added     ? summary.pipesAdded
+                    : kind == ChangeKind::Removed ? summary.pipesRemoved
+                                                  : summary.pipesModified);
+                 emit();
+             });
+    diffById(stationsBefore, stationsAfter, stationOrderBefore, stationOrderAfter,
+             [&](ChangeKind kind, const CompressorStation* before, const CompressorStation* after,
+                 size_t position) {
+                 change = NetworkChange();
+                 change.kind = kind;
+                 change.stationBefore = before;
+                 change.stationAfter = after;
+                 change.position = position;
+                 ++(kind == ChangeKind::Added     ? summary.stationsAdded
+                    : kind == ChangeKind::Removed ? summary.stationsRemoved
+                                                  : summary.stationsModified);
+                 emit();
+             });
+
+    // Соединения - мультимножества: повторы сопоставляются попарно в порядке записей
+    vector<pair<uint32_t, uint32_t>> matches;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < connectionOrderBefore.size() && j < connectionOrderAfter.size()) {
+        const ConnectionKey& before = connectionOrderBefore[i];
+        const ConnectionKey& after = connectionOrderAfter[j];
+        if (sameFields(before, after)) {
+            matches.push_back({get<5>(before), get<5>(after)});
+            ++i;
+            ++j;
+        } else if (after < before) {
+            ++j;
+        } else {
+            ++i;
+        }
+    }
+    vector<bool> placed(networkAfter.size(), false);
+    const vector<int64_t> partner = stayingPartners(matches, networkBefore.size(), placed);
+    for (size_t k = 0; k < networkBefore.size(); ++k) {
+        if (partner[k] == UNMATCHED) {
+            change = NetworkChange();
+            change.kind = ChangeKind::Removed;
+            change.connection = &networkBefore[k];
+            change.connectionPipe = connectedBefore[k];
+            change.position = k;
+            ++summary.connectionsRemoved;
+            emit();
+        }
+    }
+    for (size_t k = 0; k < networkAfter.size(); ++k) {
+        if (!placed[k]) {
+            change = NetworkChange();
+            change.kind = ChangeKind::Added;
+            change.connection = &networkAfter[k];
+            change.connectionPipe = connectedAfter[k];
+            change.position = k;
+            ++summary.connectionsAdded;
+            emit();
+        }
+    }
+    return summary;
+}
+
+void writePatchHeader(ostream& out, int nextPipeId, int nextStationId) {
+    out << "PATCH 2\nNEXT " << nextPipeId << ' ' << nextStationId << '\n';
+}
+
+void writePatchLine(ostream& out, const NetworkChange& change) {
+    const char sign = change.kind == ChangeKind::Added ? '+' : change.kind == ChangeKind::Removed ? '-' : '~';
+    string line(1, sign);
+    // Место пишется у добавленных записей и у удаляемых соединений
+    auto appendPosition = [&line, &change]() {
+        char buffer[24];
+        line.append(buffer, to_chars(buffer, buffer + sizeof(buffer), change.position).ptr);
+        line += ' ';
+    };
+    if (change.connection) {
+        // У соединения без трубы концов нет - вместо них пишутся нули
+        const Pipe* pipe = change.connectionPipe;
+        line += "LINK ";
+        appendPosition();
+        appendNumber(line, change.connection->pipeId);
+        for (int value : {pipe ? pipe->startId : 0, pipe ? pipe->endId : 0,
+                          pipe ? static_cast<int>(pipe->startType) : 0, pipe ? static_cast<int>(pipe->endType) : 0}) {
+            line += ' ';
+            appendNumber(line, value);
+        }
+    } else if (change.pipeBefore || change.pipeAfter) {
+        line += "PIPE ";
+        if (change.kind == ChangeKind::Removed) {
+            appendNumber(line, change.pipeBefore->id);
+        } else {
+            const Pipe& pipe = *change.pipeAfter;
+            if (change.kind == ChangeKind::Added) {
+                appendPosition();
+            }
+            appendNumber(line, pipe.id);
+            line += ' ';
+            appendNumber(line, pipe.length);
+            for (int value : {pipe.diameter, static_cast<int>(pipe.underRepair), static_cast<int>(pipe.inUse),
+                              pipe.startId, pipe.endId, static_cast<int>(pipe.startType),
+                              static_cast<int>(pipe.endType)}) {
+                line += ' ';
+                appendNumber(line, value);
+            }
+            line += ' ';
+            line += pipe.name.view();
+        }
+    } else {
+        line += "STATION ";
+        if (change.kind == ChangeKind::Removed) {
+            appendNumber(line, change.stationBefore->id);
+        } else {
+            const CompressorStation& station = *change.stationAfter;
+            if (change.kind == ChangeKind::Added) {
+                appendPosition();
+            }
+            appendNumber(line, station.id);
+            for (int value : {station.totalWorkshops, station.activeWorkshops, station.stationClass}) {
+                line += ' ';
+                appendNumber(line, value);
+            }
+            line += ' ';
+            line += station.name.view();
+        }
+    }
+    line += '\n';
+    out.write(line.data(), line.size());
+}
+
+bool readPatch(string_view text, NetworkPatch& patch) {
+    size_t lineNumber = 0;
+    bool sawNextIds = false;
+    while (!text.empty()) {
+        const size_t newline = text.find('\n');
+        string_view line = text.substr(0, newline);
+        text = newline == string_view::npos ? string_view() : text.substr(newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        ++lineNumber;
+        if (lineNumber == 1) {
+            if (line != "PATCH 1" && line != "PATCH 2") {
+                return false;
+            }
+            patch.version = line.back() - '0';
+            continue;
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        const size_t space = line.find(' ');
+        const string_view tag = line.substr(0, space);
+        PatchFields fields(space == string_view::npos ? string_view() : line.substr(space + 1));
+        // Место читается до полей записи; в версии 1 мест нет
+        auto readPosition = [&fields, &patch](vector<size_t>& positions) {
+            if (patch.version >= 2) {
+                positions.push_back(fields.number<size_t>());
+            }
+        };
+        if (tag == "NEXT") {
+            patch.nextPipeId = fields.number<int>();
+            patch.nextStationId = fields.number<int>();
+            sawNextIds = true;
+        } else if (tag == "+PIPE") {
+            readPosition(patch.addedPipesAt);
+            patch.addedPipes.push_back(readPipe(fields));
+        } else if (tag == "~PIPE") {
+            patch.modifiedPipes.push_back(readPipe(fields));
+        } else if (tag == "-PIPE") {
+            patch.removedPipes.push_back(fields.number<int>());
+        } else if (tag == "+STATION") {
+            readPosition(patch.addedStationsAt);
+            patch.addedStations.push_back(readStation(fields));
+        } else if (tag == "~STATION") {
+            patch.modifiedStations.push_back(readStation(fields));
+        } else if (tag == "-STATION") {
+            patch.removedStations.push_back(fields.number<int>());
+        } else if (tag == "+LINK") {
+            readPosition(patch.addedConnectionsAt);
+            patch.addedConnections.push_back(readConnection(fields));
+        } else if (tag == "-LINK") {
+            readPosition(patch.removedConnectionsAt);
+            patch.removedConnections.push_back(readConnection(fields));
+        } else {
+            return false;
+        }
+        if (!fields.done()) {
+            patch.namesExhausted = fields.namesExhausted();
+            return false;
+        }
+    }
+    return sawNextIds;
+}
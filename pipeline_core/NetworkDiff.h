@@ -0,0 +1,115 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+enum class ChangeKind {
+    Added,
+    Removed,
+    Modified
+};
+
+// Одно различие между двумя состояниями. Для труб и КС заполнены указатели
+// на запись до и/или после изменения; соединение сравнивается целиком
+// (труба, концы и типы ее подключения), поэтому бывает только добавленным
+// или удаленным. Запись, сменившая место
+// в порядке секции, - пара из удаления и добавления на новое место.
+struct NetworkChange {
+    ChangeKind kind = ChangeKind::Added;
+    const Pipe* pipeBefore = nullptr;
+    const Pipe* pipeAfter = nullptr;
+    const CompressorStation* stationBefore = nullptr;
+    const CompressorStation* stationAfter = nullptr;
+    const NetworkConnection* connection = nullptr;
+    // Труба соединения в его состоянии (концы и типы); nullptr - трубы нет
+    const Pipe* connectionPipe = nullptr;
+    // Добавленная запись - место во втором состоянии, удаленное соединение - в первом
+    size_t position = 0;
+};
+
+using ChangeSink = std::function<void(const NetworkChange& change)>;
+
+struct DiffSummary {
+    size_t pipesAdded = 0;
+    size_t pipesRemoved = 0;
+    size_t pipesModified = 0;
+    size_t stationsAdded = 0;
+    size_t stationsRemoved = 0;
+    size_t stationsModified = 0;
+    size_t connectionsAdded = 0;
+    size_t connectionsRemoved = 0;
+
+    size_t total() const {
+        return pipesAdded + pipesRemoved + pipesModified + stationsAdded + stationsRemoved + stationsModified +
+               connectionsAdded + connectionsRemoved;
+    }
+};
+
+// Сравнение двух состояний. Трубы и КС сопоставляются по ID слиянием
+// отсортированных номеров (уже упорядоченные по ID секции не сортируются),
+// соединения - по трубе и ее концам в своем состоянии с учетом повторов. Порядок записей тоже
+// входит в состояние (от него зависят обход графа и нумерация островов):
+// на местах остается наибольшая подпоследовательность сопоставленных
+// записей, идущая в обоих состояниях в одном порядке, остальные
+// сопоставленные записи переносятся удалением и добавлением.
+// Изменения передаются в sink: сначала удаленные и измененные (трубы и КС -
+// в порядке ID, соединения - в порядке первого состояния), затем добавленные
+// в порядке второго состояния. Сортировки секций идут параллельно, sink
+// вызывается из одного потока.
+DiffSummary diffNetworks(const PersistentVector<Pipe>& pipesBefore,
+                         const PersistentVector<CompressorStation>& stationsBefore,
+                         const PersistentVector<NetworkConnection>& networkBefore,
+                         const PersistentVector<Pipe>& pipesAfter,
+                         const PersistentVector<CompressorStation>& stationsAfter,
+                         const PersistentVector<NetworkConnection>& networkAfter, const ChangeSink& sink);
+
+// Текстовый патч: строка на изменение, название - последним полем.
+//   PATCH 2
+//   NEXT <след. ID трубы> <след. ID КС>
+//   +PIPE <место> <id> <длина> <диаметр> <ремонт> <в сети> <начало> <конец> <тип начала> <тип конца> <название>
+//   ~PIPE <id> <длина> ... <название>
+//   -PIPE <id>
+//   +STATION <место> <id> <цехов> <работает> <класс> <название>
+//   ~STATION <id> <цехов> <работает> <класс> <название>
+//   -STATION <id>
+//   +LINK|-LINK <место> <труба> <начало> <конец> <тип начала> <тип конца>
+// Место добавленной записи - ее номер во втором состоянии, удаляемого
+// соединения - в первом. Длины записываются кратчайшим точным
+// представлением, поэтому применение патча восстанавливает второе
+// состояние без потерь, включая порядок записей. Патчи версии 1 (без мест)
+// тоже читаются: добавленные записи идут в конец, удаляемые соединения
+// ищутся по полям.
+void writePatchHeader(std::ostream& out, int nextPipeId, int nextStationId);
+void writePatchLine(std::ostream& out, const NetworkChange& change);
+
+// Разобранный патч в порядке строк файла. Места (*At) идут параллельно
+// записям; в патче версии 1 их нет и векторы мест пусты.
+struct NetworkPatch {
+    int version = 2;
+    int nextPipeId = 1;
+    int nextStationId = 1;
+    std::vector<int> removedPipes;
+    std::vector<Pipe> modifiedPipes;
+    std::vector<Pipe> addedPipes;
+    std::vector<size_t> addedPipesAt;
+    std::vector<int> removedStations;
+    std::vector<CompressorStation> modifiedStations;
+    std::vector<CompressorStation> addedStations;
+    std::vector<size_t> addedStationsAt;
+    // Концы соединения - в состоянии, к которому относится строка:
+    // у удаляемых до изменения, у добавленных после
+    std::vector<ConnectionRecord> removedConnections;
+    std::vector<size_t> removedConnectionsAt;
+    std::vector<ConnectionRecord> addedConnections;
+    std::vector<size_t> addedConnectionsAt;
+    bool namesExhausted = false;  // readPatch отказал из-за переполнения пула строк
+};
+
+// false - текст не является патчем, строка испорчена или названию не хватило
+// места в пуле строк (namesExhausted)
+bool readPatch(std::string_view text, NetworkPatch& patch);
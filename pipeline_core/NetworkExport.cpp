@@ -0,0 +1,287 @@
+#include "NetworkExport.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Буфер вывода: запись в поток крупными блоками, числа - через to_chars
+class OutputBuffer {
+private:
+    static constexpr size_t CAPACITY = 1 << 20;
+    ostream& out;
+    vector<char> data;
+    size_t used = 0;
+
+    void reserve(size_t size) {
+        if (used + size > CAPACITY) {
+            flush();
+        }
+    }
+
+public:
+    explicit OutputBuffer(ostream& out) : out(out), data(CAPACITY) {}
+    ~OutputBuffer() { flush(); }
+
+    void flush() {
+        out.write(data.data(), used);
+        used = 0;
+    }
+
+    OutputBuffer& operator<<(string_view text) {
+        if (text.size() > CAPACITY) {
+            flush();
+            out.write(text.data(), text.size());
+            return *this;
+        }
+        reserve(text.size());
+        copy(text.begin(), text.end(), data.begin() + used);
+        used += text.size();
+        return *this;
+    }
+
+    OutputBuffer& operator<<(char c) {
+        reserve(1);
+        data[used++] = c;
+        return *this;
+    }
+
+    OutputBuffer& operator<<(int value) {
+        reserve(16);
+        used = to_chars(data.data() + used, data.data() + CAPACITY, value).ptr - data.data();
+        return *this;
+    }
+
+    // Кратчайшая запись, однозначно восстанавливающая число
+    OutputBuffer& operator<<(double value) {
+        reserve(32);
+        used = to_chars(data.data() + used, data.data() + CAPACITY, value).ptr - data.data();
+        return *this;
+    }
+
+    // Текст в кавычках DOT
+    void dotQuoted(string_view text) {
+        *this << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                *this << '\\';
+            }
+            *this << c;
+        }
+        *this << '"';
+    }
+
+    // Текст внутри элемента или атрибута XML
+    void xmlEscaped(string_view text) {
+        for (char c : text) {
+            switch (c) {
+                case '<': *this << "&lt;"; break;
+                case '>': *this << "&gt;"; break;
+                case '&': *this << "&amp;"; break;
+                case '"': *this << "&quot;"; break;
+                default: *this << c; break;
+            }
+        }
+    }
+};
+
+// Трубы, на которые ссылаются концы соединений, - узлы сети. При плотных ID
+// отметки лежат в битовой карте по смещению от наименьшего ID; если диапазон
+// ID намного больше их числа (ID у границ int), карта заняла бы сотни
+// мегабайт - тогда ID сортируются, а отметки хранятся по их позиции.
+class PipeNodeSet {
+private:
+    // Битовая карта выгоднее, пока на ID приходится не больше 32 бит диапазона
+    static constexpr long long DENSE_SPAN_PER_ID = 32;
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    long long minId = 0;
+    bool dense = true;
+    vector<int> sortedIds;
+    vector<bool> marks;
+
+    template <typename Visit>
+    static void forEachPipeEnd(const vector<const Pipe*>& connected, Visit visit) {
+        for (const Pipe* pipe : connected) {
+            if (!startIsStation(*pipe)) visit(pipe->startId);
+            if (!endIsStation(*pipe)) visit(pipe->endId);
+        }
+    }
+
+    size_t position(int id) const {
+        if (dense) {
+            const long long offset = id - minId;
+            return offset >= 0 && offset < static_cast<long long>(marks.size()) ? static_cast<size_t>(offset)
+                                                                                : NOT_FOUND;
+        }
+        auto it = lower_bound(sortedIds.begin(), sortedIds.end(), id);
+        return it != sortedIds.end() && *it == id ? static_cast<size_t>(it - sortedIds.begin()) : NOT_FOUND;
+    }
+
+public:
+    // connected - трубы соединений сети
+    explicit PipeNodeSet(const vector<const Pipe*>& connected) {
+        long long maxId = 0;
+        size_t count = 0;
+        forEachPipeEnd(connected, [&](int id) {
+            minId = count ? min<long long>(minId, id) : id;
+            maxId = count ? max<long long>(maxId, id) : id;
+            ++count;
+        });
+        if (count == 0) {
+            return;
+        }
+        const long long span = maxId - minId + 1;
+        dense = span <= DENSE_SPAN_PER_ID * static_cast<long long>(count);
+        if (dense) {
+            marks.assign(static_cast<size_t>(span), false);
+            forEachPipeEnd(connected, [&](int id) { marks[static_cast<size_t>(id - minId)] = true; });
+            return;
+        }
+        sortedIds.reserve(count);
+        forEachPipeEnd(connected, [&](int id) { sortedIds.push_back(id); });
+        sort(sortedIds.begin(), sortedIds.end());
+        sortedIds.erase(unique(sortedIds.begin(), sortedIds.end()), sortedIds.end());
+        marks.assign(sortedIds.size(), true);
+    }
+
+    bool contains(int id) const {
+        const size_t at = position(id);
+        return at != NOT_FOUND && marks[at];
+    }
+
+    // Снимает отметку; возвращает, была ли она
+    bool take(int id) {
+        const size_t at = position(id);
+        if (at == NOT_FOUND || !marks[at]) {
+            return false;
+        }
+        marks[at] = false;
+        return true;
+    }
+
+    template <typename Visit>
+    void forEachRemaining(Visit visit) const {
+        for (size_t i = 0; i < marks.size(); ++i) {
+            if (marks[i]) {
+                visit(dense ? static_cast<int>(minId + static_cast<long long>(i)) : sortedIds[i]);
+            }
+        }
+    }
+};
+
+void writeStation(OutputBuffer& buffer, ExportFormat format, const CompressorStation& station) {
+    if (format == ExportFormat::Dot) {
+        buffer << "  s" << station.id << " [shape=box, label=";
+        buffer.dotQuoted(station.name.view());
+        buffer << ", kind=station, workshops=" << station.totalWorkshops << ", active=" << station.activeWorkshops
+               << ", class=" << station.stationClass << "];\n";
+    } else {
+        buffer << "    <node id=\"s" << station.id << "\"><data key=\"kind\">station</data><data key=\"name\">";
+        buffer.xmlEscaped(station.name.view());
+        buffer << "</data><data key=\"workshops\">" << station.totalWorkshops << "</data><data key=\"active\">"
+               << station.activeWorkshops << "</data><data key=\"class\">" << station.stationClass
+               << "</data></node>\n";
+    }
+}
+
+// pipe == nullptr - труба-узел, которой нет в каталоге
+void writePipeNode(OutputBuffer& buffer, ExportFormat format, int id, const Pipe* pipe) {
+    if (format == ExportFormat::Dot) {
+        buffer << "  p" << id << " [shape=ellipse, kind=pipe";
+        if (pipe) {
+            buffer << ", label=";
+            buffer.dotQuoted(pipe->name.view());
+            buffer << ", diameter=" << pipe->diameter;
+        }
+        buffer << "];\n";
+    } else {
+        buffer << "    <node id=\"p" << id << "\"><data key=\"kind\">pipe</data>";
+        if (pipe) {
+            buffer << "<data key=\"name\">";
+            buffer.xmlEscaped(pipe->name.view());
+            buffer << "</data><data key=\"diameter\">" << pipe->diameter << "</data>";
+        }
+        buffer << "</node>\n";
+    }
+}
+
+void writeConnection(OutputBuffer& buffer, ExportFormat format, const Pipe& pipe) {
+    const char startPrefix = startIsStation(pipe) ? 's' : 'p';
+    const char endPrefix = endIsStation(pipe) ? 's' : 'p';
+    if (format == ExportFormat::Dot) {
+        buffer << "  " << startPrefix << pipe.startId << " -> " << endPrefix << pipe.endId
+               << " [label=\"" << pipe.id << "\", pipe=" << pipe.id << ", length=" << pipe.length
+               << ", diameter=" << pipe.diameter << ", repair=" << (pipe.underRepair ? "true, style=dashed" : "false")
+               << "];\n";
+    } else {
+        buffer << "    <edge source=\"" << startPrefix << pipe.startId << "\" target=\"" << endPrefix << pipe.endId
+               << "\"><data key=\"pipe\">" << pipe.id << "</data><data key=\"length\">" << pipe.length
+               << "</data><data key=\"diameter\">" << pipe.diameter << "</data><data key=\"repair\">"
+               << (pipe.underRepair ? "true" : "false") << "</data></edge>\n";
+    }
+}
+
+const char* const GRAPHML_HEADER =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+    "  <key id=\"kind\" for=\"node\" attr.name=\"kind\" attr.type=\"string\"/>\n"
+    "  <key id=\"name\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n"
+    "  <key id=\"workshops\" for=\"node\" attr.name=\"workshops\" attr.type=\"int\"/>\n"
+    "  <key id=\"active\" for=\"node\" attr.name=\"active\" attr.type=\"int\"/>\n"
+    "  <key id=\"class\" for=\"node\" attr.name=\"class\" attr.type=\"int\"/>\n"
+    "  <key id=\"diameter\" for=\"all\" attr.name=\"diameter\" attr.type=\"int\"/>\n"
+    "  <key id=\"pipe\" for=\"edge\" attr.name=\"pipe\" attr.type=\"int\"/>\n"
+    "  <key id=\"length\" for=\"edge\" attr.name=\"length\" attr.type=\"double\"/>\n"
+    "  <key id=\"repair\" for=\"edge\" attr.name=\"repair\" attr.type=\"boolean\"/>\n"
+    "  <graph id=\"network\" edgedefault=\"directed\">\n";
+
+}
+
+void exportNetwork(ostream& out, ExportFormat format, const PersistentVector<Pipe>& pipes,
+                   const PersistentVector<CompressorStation>& stations,
+                   const PersistentVector<NetworkConnection>& network) {
+    OutputBuffer buffer(out);
+    buffer << (format == ExportFormat::Dot ? "digraph network {\n" : GRAPHML_HEADER);
+
+    for (const auto& station : stations) {
+        writeStation(buffer, format, station);
+    }
+
+    // Трубы соединений (концы дуг хранит труба); соединения без трубы не выводятся
+    vector<pair<int, int>> pipeIndex;
+    pipeIndex.reserve(pipes.size());
+    for (size_t i = 0; i < pipes.size(); ++i) {
+        pipeIndex.push_back({pipes[i].id, static_cast<int>(i)});
+    }
+    sort(pipeIndex.begin(), pipeIndex.end());
+    vector<const Pipe*> connected;
+    connected.reserve(network.size());
+    for (const auto& conn : network) {
+        auto it = lower_bound(pipeIndex.begin(), pipeIndex.end(), make_pair(conn.pipeId, 0));
+        if (it != pipeIndex.end() && it->first == conn.pipeId) {
+            connected.push_back(&pipes[it->second]);
+        }
+    }
+
+    // Трубы-узлы - в порядке каталога; ссылки на трубы не из каталога - в конце
+    PipeNodeSet pipeNodes(connected);
+    for (const auto& pipe : pipes) {
+        if (pipeNodes.take(pipe.id)) {
+            writePipeNode(buffer, format, pipe.id, &pipe);
+        }
+    }
+    pipeNodes.forEachRemaining([&](int id) { writePipeNode(buffer, format, id, nullptr); });
+
+    for (const Pipe* pipe : connected) {
+        writeConnection(buffer, format, *pipe);
+    }
+
+    buffer << (format == ExportFormat::Dot ? "}\n" : "  </graph>\n</graphml>\n");
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <ostream>
+
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+// Формат выгрузки сети для внешних программ визуализации и анализа
+enum class ExportFormat {
+    Dot,     // Graphviz
+    GraphML  // yEd, Gephi, NetworkX и др.
+};
+
+// Потоковая выгрузка сети: узлы - все КС (название, цеха, класс) и трубы,
+// к которым подключены соединения; дуги - соединения сети с номером, длиной,
+// диаметром и состоянием ремонта трубы. Идентификаторы узлов: s<ID> для КС,
+// p<ID> для труб-узлов.
+//
+// Документ не строится в памяти: записи форматируются в буфер и уходят
+// в поток крупными блоками по мере обхода. Дополнительная память - только
+// таблица ID труб и отметки труб-узлов (битовая карта
+// по диапазону ID либо, при редких ID, их отсортированный список).
+void exportNetwork(std::ostream& out, ExportFormat format, const PersistentVector<Pipe>& pipes,
+                   const PersistentVector<CompressorStation>& stations,
+                   const PersistentVector<NetworkConnection>& network);
@@ -0,0 +1,272 @@
+#include "NetworkIslands.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "PipeIndex.h"
+#include "Tracing.h"
+
+using namespace std;
+
+namespace {
+
+int64_t startNode(const Pipe& pipe) {
+    return NetworkIslands::nodeIndex(pipe.startId, startIsStation(pipe));
+}
+
+int64_t endNode(const Pipe& pipe) {
+    return NetworkIslands::nodeIndex(pipe.endId, endIsStation(pipe));
+}
+
+// Труба соединения, если она дает ребро: соединения без трубы пропускаются
+const Pipe* workingPipe(const PipeIndex& pipeById, const NetworkConnection& conn) {
+    const Pipe* pipe = pipeById.find(conn.pipeId);
+    return pipe && !pipe->underRepair ? pipe : nullptr;
+}
+
+// Расчет компонент для копий, от которых разделяемый экземпляр ушел вперед
+class OfflineIslands {
+private:
+    unordered_map<int64_t, int64_t> parent;
+
+public:
+    int64_t find(int64_t node) {
+        auto it = parent.find(node);
+        if (it == parent.end()) {
+            return node;
+        }
+        // Сжатие путей делением пополам
+        while (it->second != node) {
+            auto next = parent.find(it->second);
+            it->second = next->second;
+            node = it->second;
+            it = parent.find(node);
+        }
+        return node;
+    }
+
+    OfflineIslands(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes) {
+        PipeIndex pipeById(pipes);
+        for (const auto& conn : network) {
+            const Pipe* pipe = workingPipe(pipeById, conn);
+            if (!pipe) {
+                continue;
+            }
+            int64_t a = startNode(*pipe);
+            int64_t b = endNode(*pipe);
+            parent.emplace(a, a);
+            parent.emplace(b, b);
+            parent[find(a)] = find(b);
+        }
+    }
+
+    // Представитель острова для каждого узла сети
+    template <typename Map>
+    void collectRoots(Map& roots) {
+        roots.reserve(parent.size());
+        for (const auto& entry : parent) {
+            roots.emplace(entry.first, find(entry.first));
+        }
+    }
+};
+
+// Приведение экземпляра к сети копии. Проход по всем соединениям остается
+// (O(E) обращений к хэш-таблицам), но в структуре меняются только ребра,
+// которых в ней нет или которые лишние, - после отмены это одно-два ребра
+// вместо O(E log^2 n) при построении заново. Повторные ID труб
+// пропускаются, как при построении: действует первое соединение.
+void resync(DynamicConnectivity& graph, const PersistentVector<NetworkConnection>& network,
+            const PersistentVector<Pipe>& pipes) {
+    PipeIndex pipeById(pipes);
+    unordered_set<int> wanted;
+    wanted.reserve(network.size());
+    for (const auto& conn : network) {
+        const Pipe* pipe = workingPipe(pipeById, conn);
+        if (!pipe || !wanted.insert(conn.pipeId).second) {
+            continue;
+        }
+        const int64_t a = startNode(*pipe);
+        const int64_t b = endNode(*pipe);
+        int64_t u;
+        int64_t v;
+        if (graph.edgeEnds(conn.pipeId, u, v)) {
+            if (u == a && v == b) {
+                continue;
+            }
+            graph.removeEdge(conn.pipeId);
+        }
+        graph.addEdge(conn.pipeId, a, b);
+    }
+    vector<int> extra;
+    graph.forEachEdge([&](int edgeId) {
+        if (!wanted.count(edgeId)) {
+            extra.push_back(edgeId);
+        }
+    });
+    for (int edgeId : extra) {
+        graph.removeEdge(edgeId);
+    }
+}
+
+// Узлы без соединений в карту не попадают - каждый из них сам себе остров
+template <typename Map>
+int64_t rootIn(const Map& roots, int64_t node) {
+    auto it = roots.find(node);
+    return it == roots.end() ? node : it->second;
+}
+
+// Группировка узлов сети по острову; islandOf(node) - ключ острова узла
+template <typename IslandOf>
+vector<IslandSummary> groupIslands(const PersistentVector<NetworkConnection>& network,
+                                   const PersistentVector<Pipe>& pipes, IslandOf islandOf) {
+    PipeIndex pipeById(pipes);
+    unordered_map<int64_t, size_t> islandByKey;
+    unordered_set<int64_t> seen;
+    vector<IslandSummary> islands;
+
+    auto addNode = [&](int id, bool isStation) {
+        int64_t node = NetworkIslands::nodeIndex(id, isStation);
+        auto [it, inserted] = islandByKey.emplace(islandOf(node), islands.size());
+        if (inserted) {
+            islands.emplace_back();
+        }
+        IslandSummary& island = islands[it->second];
+        if (seen.insert(node).second) {
+            (isStation ? island.stationIds : island.pipeIds).push_back(id);
+        }
+        return it->second;
+    };
+
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        size_t island = addNode(pipe->startId, startIsStation(*pipe));
+        addNode(pipe->endId, endIsStation(*pipe));
+        if (!pipe->underRepair) {
+            islands[island].connections++;
+        }
+    }
+
+    for (auto& island : islands) {
+        sort(island.stationIds.begin(), island.stationIds.end());
+        sort(island.pipeIds.begin(), island.pipeIds.end());
+    }
+    stable_sort(islands.begin(), islands.end(), [](const IslandSummary& a, const IslandSummary& b) {
+        return a.stationIds.size() + a.pipeIds.size() > b.stationIds.size() + b.pipeIds.size();
+    });
+    return islands;
+}
+
+}
+
+uint64_t NetworkIslands::nextVersion() {
+    static atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+shared_ptr<NetworkIslands::Shared> NetworkIslands::build(const PersistentVector<NetworkConnection>& network,
+                                                         const PersistentVector<Pipe>& pipes) {
+    auto result = make_shared<Shared>();
+    PipeIndex pipeById(pipes);
+    for (const auto& conn : network) {
+        if (const Pipe* pipe = workingPipe(pipeById, conn)) {
+            result->graph.addEdge(conn.pipeId, startNode(*pipe), endNode(*pipe));
+        }
+    }
+    result->version = nextVersion();
+    return result;
+}
+
+NetworkIslands::Editor::Editor(NetworkIslands& owner, const PersistentVector<NetworkConnection>& network,
+                               const PersistentVector<Pipe>& pipes)
+    : owner(owner) {
+    if (owner.shared) {
+        lock = unique_lock<shared_mutex>(owner.shared->mutex);
+        if (owner.shared->version != owner.version) {
+            // Экземпляр ушел вперед (копия - снимок до отмены): возвращаем
+            // его к этой версии, копии новой версии перейдут на offline-расчет
+            TraceSpan span("resync islands");
+            resync(owner.shared->graph, network, pipes);
+            owner.shared->version = owner.version;
+        }
+        return;
+    }
+    owner.shared = build(network, pipes);
+    owner.version = owner.shared->version;
+    lock = unique_lock<shared_mutex>(owner.shared->mutex);
+}
+
+NetworkIslands::Editor::~Editor() {
+    owner.version = nextVersion();
+    owner.shared->version = owner.version;
+    owner.offline = make_shared<OfflineCache>();
+}
+
+void NetworkIslands::Editor::addConnection(const Pipe& pipe) {
+    owner.shared->graph.addEdge(pipe.id, startNode(pipe), endNode(pipe));
+}
+
+void NetworkIslands::Editor::removeConnection(int pipeId) {
+    owner.shared->graph.removeEdge(pipeId);
+}
+
+NetworkIslands::Editor NetworkIslands::edit(const PersistentVector<NetworkConnection>& network,
+                                            const PersistentVector<Pipe>& pipes) {
+    return Editor(*this, network, pipes);
+}
+
+void NetworkIslands::rebuild(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes) {
+    shared = build(network, pipes);
+    version = shared->version;
+    offline = make_shared<OfflineCache>();
+}
+
+void NetworkIslands::clear() {
+    shared.reset();
+    version = 0;
+    offline = make_shared<OfflineCache>();
+}
+
+shared_ptr<const NetworkIslands::ComponentMap> NetworkIslands::offlineComponents(
+    const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes) const {
+    lock_guard<mutex> lock(offline->mutex);
+    if (!offline->components) {
+        TraceSpan span("build offline islands");
+        auto components = make_shared<ComponentMap>();
+        OfflineIslands(network, pipes).collectRoots(*components);
+        offline->components = move(components);
+    }
+    return offline->components;
+}
+
+bool NetworkIslands::sameIsland(int idA, bool isStationA, int idB, bool isStationB,
+                                const PersistentVector<NetworkConnection>& network,
+                                const PersistentVector<Pipe>& pipes) const {
+    int64_t a = nodeIndex(idA, isStationA);
+    int64_t b = nodeIndex(idB, isStationB);
+    if (shared) {
+        shared_lock<shared_mutex> lock(shared->mutex);
+        if (shared->version == version) {
+            return shared->graph.connected(a, b);
+        }
+    }
+    auto components = offlineComponents(network, pipes);
+    return rootIn(*components, a) == rootIn(*components, b);
+}
+
+vector<IslandSummary> NetworkIslands::summarize(const PersistentVector<NetworkConnection>& network,
+                                                const PersistentVector<Pipe>& pipes) const {
+    if (shared) {
+        shared_lock<shared_mutex> lock(shared->mutex);
+        if (shared->version == version) {
+            const DynamicConnectivity& graph = shared->graph;
+            return groupIslands(network, pipes, [&graph](int64_t node) { return graph.representative(node); });
+        }
+    }
+    auto components = offlineComponents(network, pipes);
+    return groupIslands(network, pipes, [&components](int64_t node) { return rootIn(*components, node); });
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "DynamicConnectivity.h"
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+// Остров - связная часть сети (направление труб не учитывается)
+struct IslandSummary {
+    std::vector<int> stationIds;  // КС острова
+    std::vector<int> pipeIds;     // трубы, выступающие узлами (соединения труба-труба и т.п.)
+    size_t connections = 0;       // рабочих соединений внутри острова
+};
+
+// Компоненты связности сети с поддержкой удаления ребер.
+// Ребро - соединение, труба которого не в ремонте: разрыв соединения,
+// удаление КС и вывод трубы в ремонт удаляют ребра, возврат из ремонта добавляет.
+// Номер узла - 64-битный: КС id -> 2*(id - INT_MIN), труба id -> 2*(id - INT_MIN)+1.
+// Для любого id номер неотрицателен (DynamicConnectivity помечает дуги -1) и
+// не переполняется, поэтому проверять диапазон ID при загрузке не нужно.
+//
+// Структура DynamicConnectivity не копируется, поэтому копии PipelineCore
+// разделяют один ее экземпляр. Каждое изменение сети получает новую версию;
+// экземпляр отвечает на запросы только той копии, чья версия совпадает с его.
+// Для остальных копий (снимки для отмены и читателей, состояние после
+// ленивой загрузки) острова их версии сети считаются один раз за O(E) при
+// первом запросе и дальше берутся из кэша.
+//
+// Первое изменение такой копии (правка после отмены) забирает экземпляр себе:
+// он сверяется с ее сетью и меняет только отличающиеся ребра. Сверка - O(E)
+// обращений к хэш-таблицам (около 10 мс на 80 тыс. соединений против 60 мс на
+// построение заново); дальше изменения снова O(log^2 n). Если две копии
+// по очереди меняют сеть, каждая смена владельца стоит такой сверки.
+// Запросы и изменения разделяемого экземпляра защищены shared_mutex.
+class NetworkIslands {
+private:
+    struct Shared {
+        mutable std::shared_mutex mutex;
+        DynamicConnectivity graph;
+        uint64_t version = 0;
+    };
+
+    // Узел -> представитель острова для одной версии сети
+    using ComponentMap =
+        std::unordered_map<int64_t, int64_t, std::hash<int64_t>, std::equal_to<int64_t>,
+                           TrackedAllocator<std::pair<const int64_t, int64_t>, MemoryCategory::Islands>>;
+
+    // Общий для копий одной версии; каждое изменение заводит новый
+    struct OfflineCache {
+        std::mutex mutex;
+        std::shared_ptr<const ComponentMap> components;
+    };
+
+    std::shared_ptr<Shared> shared;
+    uint64_t version = 0;
+    std::shared_ptr<OfflineCache> offline = std::make_shared<OfflineCache>();
+
+    static uint64_t nextVersion();
+    static std::shared_ptr<Shared> build(const PersistentVector<NetworkConnection>& network,
+                                         const PersistentVector<Pipe>& pipes);
+    std::shared_ptr<const ComponentMap> offlineComponents(const PersistentVector<NetworkConnection>& network,
+                                                          const PersistentVector<Pipe>& pipes) const;
+
+public:
+    static int64_t nodeIndex(int id, bool isStation) {
+        return 2 * (int64_t(id) - std::numeric_limits<int>::min()) + (isStation ? 0 : 1);
+    }
+
+    // Пакет изменений одной версии сети. Пока объект жив, разделяемый
+    // экземпляр заблокирован на запись; при уничтожении публикуется новая версия.
+    class Editor {
+    private:
+        NetworkIslands& owner;
+        std::unique_lock<std::shared_mutex> lock;
+
+    public:
+        Editor(NetworkIslands& owner, const PersistentVector<NetworkConnection>& network,
+               const PersistentVector<Pipe>& pipes);
+        ~Editor();
+
+        Editor(const Editor&) = delete;
+        Editor& operator=(const Editor&) = delete;
+
+        // Добавление рабочего соединения трубы pipe (новое соединение или возврат из ремонта)
+        void addConnection(const Pipe& pipe);
+        // Удаление соединения трубы pipeId (разрыв, удаление КС, ремонт)
+        void removeConnection(int pipeId);
+    };
+
+    // Начало изменения. Передается сеть ДО изменения: если экземпляр
+    // отстал от этой копии, он перестраивается по ней.
+    Editor edit(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes);
+
+    // Полная перестройка (после загрузки)
+    void rebuild(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes);
+    void clear();
+
+    bool sameIsland(int idA, bool isStationA, int idB, bool isStationB,
+                    const PersistentVector<NetworkConnection>& network,
+                    const PersistentVector<Pipe>& pipes) const;
+
+    // Острова, содержащие хотя бы одно соединение, от крупных к мелким
+    std::vector<IslandSummary> summarize(const PersistentVector<NetworkConnection>& network,
+                                         const PersistentVector<Pipe>& pipes) const;
+};
@@ -0,0 +1,159 @@
+#include "OperationMetrics.h"
+
+#include <iomanip>
+#include <string>
+#include <utility>
+
+#include "AtomicFile.h"
+
+using namespace std;
+
+namespace {
+
+const char* const OPERATION_NAMES[] = {
+    "add_pipe", "add_station", "edit_pipe", "edit_station", "remove_pipe", "remove_station",
+    "find_pipes", "find_stations", "connect", "disconnect", "find_path", "alt_routes", "topo_sort",
+    "save", "load", "build_graph", "id_lookup"
+};
+static_assert(sizeof(OPERATION_NAMES) / sizeof(OPERATION_NAMES[0]) == static_cast<size_t>(Operation::Count),
+              "имя нужно каждой операции");
+
+int highestBit(uint64_t value) {
+    return 63 - __builtin_clzll(value);
+}
+
+}
+
+const char* operationName(Operation operation) {
+    return OPERATION_NAMES[static_cast<size_t>(operation)];
+}
+
+// Ячейки 0..2*SubBuckets-1 - точные значения; значение v >= 2*SubBuckets
+// с показателем e = highestBit(v) попадает в ячейку (e - SubBucketBits) * SubBuckets
+// + старшие SubBucketBits+1 бит v, которые лежат в [SubBuckets, 2*SubBuckets)
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < 2 * SubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    const int shift = highestBit(value) - SubBucketBits;
+    return static_cast<size_t>(shift) * SubBuckets + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::valueOf(size_t bucket) {
+    if (bucket < 2 * SubBuckets) {
+        return bucket;
+    }
+    const size_t shift = bucket / SubBuckets - 1;
+    const uint64_t mantissa = bucket % SubBuckets + SubBuckets;
+    const uint64_t lower = mantissa << shift;
+    return lower + (uint64_t(1) << shift) / 2;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    sum.fetch_add(nanoseconds, memory_order_relaxed);
+    uint64_t current = maximum.load(memory_order_relaxed);
+    while (nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, memory_order_relaxed);
+    }
+    total.store(0, memory_order_relaxed);
+    sum.store(0, memory_order_relaxed);
+    maximum.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const {
+    // Счетчики читаются без остановки записи, поэтому сумма ячеек может
+    // немного разойтись с total - порог считается по сумме ячеек
+    uint64_t recorded = 0;
+    for (const auto& bucket : buckets) {
+        recorded += bucket.load(memory_order_relaxed);
+    }
+    if (recorded == 0) {
+        return 0;
+    }
+    quantile = quantile < 0 ? 0 : (quantile > 1 ? 1 : quantile);
+    uint64_t rank = static_cast<uint64_t>(quantile * recorded + 0.5);
+    rank = rank < 1 ? 1 : rank;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BucketCount; ++b) {
+        seen += buckets[b].load(memory_order_relaxed);
+        if (seen >= rank) {
+            // Оценка ячейки не может превышать наблюдавшийся максимум
+            const uint64_t value = valueOf(b);
+            const uint64_t observed = maxNanoseconds();
+            return observed != 0 && value > observed ? observed : value;
+        }
+    }
+    return maxNanoseconds();
+}
+
+OperationMetrics& OperationMetrics::instance() {
+    static OperationMetrics metrics;
+    return metrics;
+}
+
+void OperationMetrics::reset() {
+    for (auto& histogram : histograms) {
+        histogram.reset();
+    }
+}
+
+vector<OperationStats> OperationMetrics::collect() const {
+    vector<OperationStats> result;
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        const LatencyHistogram& histogram = histograms[i];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        OperationStats stats;
+        stats.operation = static_cast<Operation>(i);
+        stats.count = histogram.count();
+        stats.totalNanoseconds = histogram.totalNanoseconds();
+        stats.p50 = histogram.percentile(0.5);
+        stats.p90 = histogram.percentile(0.9);
+        stats.p99 = histogram.percentile(0.99);
+        stats.p999 = histogram.percentile(0.999);
+        stats.max = histogram.maxNanoseconds();
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void OperationMetrics::writePrometheus(ostream& out) const {
+    auto seconds = [](uint64_t nanoseconds) { return nanoseconds / 1e9; };
+    const vector<OperationStats> all = collect();
+    out << setprecision(9);
+    out << "# HELP pipeline_operation_seconds Длительность операций ядра трубопровода.\n";
+    out << "# TYPE pipeline_operation_seconds summary\n";
+    for (const OperationStats& stats : all) {
+        const string label = string("operation=\"") + operationName(stats.operation) + "\"";
+        const pair<const char*, uint64_t> quantiles[] = {
+            {"0.5", stats.p50}, {"0.9", stats.p90}, {"0.99", stats.p99}, {"0.999", stats.p999}
+        };
+        for (const auto& [quantile, value] : quantiles) {
+            out << "pipeline_operation_seconds{" << label << ",quantile=\"" << quantile << "\"} "
+                << seconds(value) << '\n';
+        }
+        out << "pipeline_operation_seconds_sum{" << label << "} " << seconds(stats.totalNanoseconds) << '\n';
+        out << "pipeline_operation_seconds_count{" << label << "} " << stats.count << '\n';
+    }
+    out << "# HELP pipeline_operation_max_seconds Самая долгая операция с последнего сброса.\n";
+    out << "# TYPE pipeline_operation_max_seconds gauge\n";
+    for (const OperationStats& stats : all) {
+        out << "pipeline_operation_max_seconds{operation=\"" << operationName(stats.operation) << "\"} "
+            << seconds(stats.max) << '\n';
+    }
+}
+
+bool OperationMetrics::exportPrometheus(const string& filename) const {
+    return writeFileAtomically(filename, [this](ostream& file) {
+        writePrometheus(file);
+        return file.good();
+    });
+}
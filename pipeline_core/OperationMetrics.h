@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Операции ядра, для которых ведется статистика. Вложенные операции
+// (поиск по ID внутри соединения и т.п.) учитываются отдельно.
+enum class Operation {
+    AddPipe,
+    AddStation,
+    EditPipe,       // изменение полей, ремонт, диаметр
+    EditStation,    // изменение полей, запуск и остановка цехов
+    RemovePipe,
+    RemoveStation,
+    FindPipes,
+    FindStations,
+    Connect,
+    Disconnect,
+    FindPath,       // кратчайший путь
+    AltRoutes,      // альтернативные маршруты (k кратчайших): на порядки дольше пути
+    TopoSort,
+    Save,
+    Load,
+    BuildGraph,
+    IdLookup,       // поиск индекса трубы или КС по ID
+    Count
+};
+
+// Имя для вывода и выгрузки: add_pipe, id_lookup, ...
+const char* operationName(Operation operation);
+
+// Гистограмма длительностей в наносекундах в духе HdrHistogram: значения
+// до 64 хранятся точно, дальше каждый интервал [2^k, 2^(k+1)) делится на 32
+// равные части, поэтому процентили считаются с ошибкой не больше 3% при
+// любом разбросе значений. Запись - несколько атомарных операций без
+// блокировок, ее можно вызывать из любых потоков.
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 5;
+    static constexpr size_t SubBuckets = size_t(1) << SubBucketBits;
+    static constexpr size_t BucketCount = (64 - SubBucketBits) * SubBuckets + SubBuckets;
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> maximum{0};
+
+    static size_t bucketOf(uint64_t value);
+    // Середина интервала значений ячейки
+    static uint64_t valueOf(size_t bucket);
+
+public:
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t totalNanoseconds() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t maxNanoseconds() const { return maximum.load(std::memory_order_relaxed); }
+    // Значение, которого не превышает доля quantile записей (0..1); 0 - записей нет
+    uint64_t percentile(double quantile) const;
+};
+
+struct OperationStats {
+    Operation operation = Operation::AddPipe;
+    uint64_t count = 0;
+    uint64_t totalNanoseconds = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+// Статистика операций процесса. По умолчанию выключена: тогда замер
+// операции сводится к одной проверке флага.
+class OperationMetrics {
+private:
+    std::atomic<bool> enabledFlag{false};
+    std::array<LatencyHistogram, static_cast<size_t>(Operation::Count)> histograms;
+
+public:
+    static OperationMetrics& instance();
+
+    bool enabled() const { return enabledFlag.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled) { enabledFlag.store(enabled, std::memory_order_relaxed); }
+
+    void record(Operation operation, uint64_t nanoseconds) {
+        histograms[static_cast<size_t>(operation)].record(nanoseconds);
+    }
+    const LatencyHistogram& histogram(Operation operation) const {
+        return histograms[static_cast<size_t>(operation)];
+    }
+    void reset();
+
+    // Операции, выполнявшиеся хотя бы раз, в порядке перечисления
+    std::vector<OperationStats> collect() const;
+
+    // Текстовый формат Prometheus: сводка pipeline_operation_seconds
+    // с квантилями 0.5/0.9/0.99/0.999, суммой и числом вызовов по операциям
+    void writePrometheus(std::ostream& out) const;
+    // То же в файл для сборщика метрик (запись атомарная)
+    bool exportPrometheus(const std::string& filename) const;
+};
+
+// Замер длительности области видимости. Включение статистики посреди
+// операции на нее не влияет: решение принимается в конструкторе.
+class OperationTimer {
+private:
+    Operation operation;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit OperationTimer(Operation operation)
+        : operation(operation), active(OperationMetrics::instance().enabled()) {
+        if (active) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~OperationTimer() {
+        if (active) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            OperationMetrics::instance().record(
+                operation,
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+};
@@ -0,0 +1,545 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "MemoryAccounting.h"
+
+// Показатель степени двойки value
+constexpr size_t binaryLog(size_t value) { return value == 1 ? 0 : 1 + binaryLog(value / 2); }
+
+// Вектор с копированием при записи и разделением структуры между версиями.
+// Элементы хранятся блоками до ChunkSize, блоки - листья дерева с ветвлением
+// BRANCHING. Копия вектора разделяет с оригиналом все дерево, поэтому
+// копирование стоит O(1). Запись копирует только путь от корня до блока:
+// O(log n) узлов и один блок, а не весь массив блоков. Удаление из середины
+// сдвигает элементы лишь внутри блока; неполные блоки и узлы сливаются с
+// соседями, как в B-дереве. Так снимки состояния для отмены действий и для
+// читателей почти бесплатны, а первое изменение после снимка не зависит от n.
+//
+// Каждый узел хранит накопленные размеры детей. Пока блоки полны, ребенок
+// находится сдвигом индекса; после удалений из середины - от той же оценки
+// двоичным поиском вправо (оценка никогда не больше нужного номера).
+//
+// Вектор может быть отложенным (deferred): элементы создает функция загрузки
+// при первом обращении к ним или к размеру. Загрузка выполняется один раз для
+// всех копий, разделяющих корень, и защищена мьютексом корня. Если загрузка
+// не удалась, вектор пуст и loadFailed() возвращает true.
+//
+// Блоки, узлы и корни выделяются через TrackedAllocator: память всех версий
+// учитывается в MemoryTracker по категории MemoryCategoryOf<T>.
+template <typename T, size_t ChunkSize = 128>
+class PersistentVector {
+private:
+    static_assert(ChunkSize >= 2 && (ChunkSize & (ChunkSize - 1)) == 0, "ChunkSize - степень двойки");
+
+    using Allocator = TrackedAllocator<T>;
+    template <typename U>
+    using AllocatorOf = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+    using Chunk = std::vector<T, Allocator>;
+    using ChunkPtr = std::shared_ptr<Chunk>;
+    struct Branch;
+    using BranchPtr = std::shared_ptr<Branch>;
+
+    static constexpr size_t BRANCHING = 32;
+    static constexpr size_t BRANCH_SHIFT = 5;
+
+    static constexpr size_t CHUNK_SHIFT = binaryLog(ChunkSize);
+
+public:
+    // Заполняет вектор элементами; false - данные повреждены
+    using Loader = std::function<bool(std::vector<T>&)>;
+
+private:
+    // Узел дерева: на уровне 1 дети - блоки, выше - узлы уровнем ниже.
+    // ends[k] - число элементов в детях 0..k.
+    struct Branch {
+        std::vector<ChunkPtr, AllocatorOf<ChunkPtr>> chunks;
+        std::vector<BranchPtr, AllocatorOf<BranchPtr>> branches;
+        std::vector<size_t, AllocatorOf<size_t>> ends;
+
+        size_t count() const { return ends.empty() ? 0 : ends.back(); }
+    };
+
+    struct Root {
+        BranchPtr top;      // nullptr у пустого вектора
+        size_t height = 0;  // уровень top
+        size_t count = 0;
+        // Пока pending, дерева нет и его создаст loader
+        std::atomic<bool> pending{false};
+        bool failed = false;  // загрузка не удалась; пишется до сброса pending
+        std::mutex loadMutex;
+        Loader loader;
+    };
+
+    std::shared_ptr<Root> root;
+
+    static std::shared_ptr<Root> newRoot() { return std::allocate_shared<Root>(Allocator()); }
+    static BranchPtr newBranch() { return std::allocate_shared<Branch>(Allocator()); }
+    static ChunkPtr newChunk() {
+        ChunkPtr chunk = std::allocate_shared<Chunk>(Allocator());
+        chunk->reserve(ChunkSize);
+        return chunk;
+    }
+
+    // Узел или блок, общий с другой версией, заменяется копией
+    static Branch& own(BranchPtr& branch) {
+        if (branch.use_count() > 1) {
+            branch = std::allocate_shared<Branch>(Allocator(), *branch);
+        }
+        return *branch;
+    }
+    static Chunk& own(ChunkPtr& chunk) {
+        if (chunk.use_count() > 1) {
+            ChunkPtr copy = newChunk();
+            copy->assign(chunk->begin(), chunk->end());
+            chunk = std::move(copy);
+        }
+        return *chunk;
+    }
+
+    // Номер ребенка узла с элементом index (в полном ребенке 1 << shift
+    // элементов); index становится номером внутри ребенка
+    static size_t childFor(const Branch& branch, size_t shift, size_t& index) {
+        size_t child = std::min(index >> shift, branch.ends.size() - 1);
+        if (branch.ends[child] <= index) {
+            child = std::upper_bound(branch.ends.begin() + child, branch.ends.end(), index) - branch.ends.begin();
+        }
+        if (child > 0) {
+            index -= branch.ends[child - 1];
+        }
+        return child;
+    }
+
+    static size_t childShift(size_t level) { return CHUNK_SHIFT + BRANCH_SHIFT * (level - 1); }
+
+    // Блок с элементом index; index становится номером в блоке
+    static const Chunk& chunkFor(const Root& r, size_t& index) {
+        const Branch* branch = r.top.get();
+        for (size_t shift = childShift(r.height); shift > CHUNK_SHIFT; shift -= BRANCH_SHIFT) {
+            branch = branch->branches[childFor(*branch, shift, index)].get();
+        }
+        return *branch->chunks[childFor(*branch, CHUNK_SHIFT, index)];
+    }
+
+    static size_t childCount(const Branch& branch, size_t level) {
+        return level == 1 ? branch.chunks.size() : branch.branches.size();
+    }
+
+    // Пересчет накопленных размеров начиная с ребенка from
+    static void recount(Branch& branch, size_t level, size_t from) {
+        const size_t children = childCount(branch, level);
+        branch.ends.resize(children);
+        for (size_t k = from; k < children; ++k) {
+            const size_t size = level == 1 ? branch.chunks[k]->size() : branch.branches[k]->count();
+            branch.ends[k] = (k > 0 ? branch.ends[k - 1] : 0) + size;
+        }
+    }
+
+    // Узлы уровня 1 над блоками, затем уровни выше - до одного корня
+    static BranchPtr buildTree(std::vector<ChunkPtr> chunks, size_t& height) {
+        height = 0;
+        if (chunks.empty()) {
+            return nullptr;
+        }
+        std::vector<BranchPtr> level;
+        for (size_t first = 0; first < chunks.size(); first += BRANCHING) {
+            BranchPtr branch = newBranch();
+            const size_t last = std::min(first + BRANCHING, chunks.size());
+            branch->chunks.assign(std::make_move_iterator(chunks.begin() + first),
+                                  std::make_move_iterator(chunks.begin() + last));
+            recount(*branch, 1, 0);
+            level.push_back(std::move(branch));
+        }
+        height = 1;
+        while (level.size() > 1) {
+            std::vector<BranchPtr> upper;
+            for (size_t first = 0; first < level.size(); first += BRANCHING) {
+                BranchPtr branch = newBranch();
+                const size_t last = std::min(first + BRANCHING, level.size());
+                branch->branches.assign(std::make_move_iterator(level.begin() + first),
+                                        std::make_move_iterator(level.begin() + last));
+                recount(*branch, 2, 0);
+                upper.push_back(std::move(branch));
+            }
+            level = std::move(upper);
+            ++height;
+        }
+        return std::move(level.front());
+    }
+
+    static void fillTree(Root& r, std::vector<T> values) {
+        std::vector<ChunkPtr> chunks;
+        chunks.reserve((values.size() + ChunkSize - 1) / ChunkSize);
+        for (size_t first = 0; first < values.size(); first += ChunkSize) {
+            const size_t last = std::min(first + ChunkSize, values.size());
+            ChunkPtr chunk = newChunk();
+            chunk->insert(chunk->end(), std::make_move_iterator(values.begin() + first),
+                          std::make_move_iterator(values.begin() + last));
+            chunks.push_back(std::move(chunk));
+        }
+        r.count = values.size();
+        r.top = buildTree(std::move(chunks), r.height);
+    }
+
+    template <typename Visit>
+    static void forEachChunk(const Branch& branch, size_t level, Visit& visit) {
+        if (level == 1) {
+            for (const ChunkPtr& chunk : branch.chunks) {
+                visit(chunk);
+            }
+            return;
+        }
+        for (const BranchPtr& child : branch.branches) {
+            forEachChunk(*child, level - 1, visit);
+        }
+    }
+
+    // Цепочка новых узлов от уровня level до блока с одним элементом
+    static BranchPtr singlePath(size_t level, const T& value) {
+        BranchPtr branch = newBranch();
+        if (level == 1) {
+            ChunkPtr chunk = newChunk();
+            chunk->push_back(value);
+            branch->chunks.push_back(std::move(chunk));
+        } else {
+            branch->branches.push_back(singlePath(level - 1, value));
+        }
+        branch->ends.push_back(1);
+        return branch;
+    }
+
+    // Добавление в конец поддерева; false - поддерево заполнено
+    static bool append(Branch& branch, size_t level, const T& value) {
+        if (level == 1) {
+            if (!branch.chunks.empty() && branch.chunks.back()->size() < ChunkSize) {
+                own(branch.chunks.back()).push_back(value);
+            } else if (branch.chunks.size() < BRANCHING) {
+                ChunkPtr chunk = newChunk();
+                chunk->push_back(value);
+                branch.chunks.push_back(std::move(chunk));
+                branch.ends.push_back(branch.count());
+            } else {
+                return false;
+            }
+        } else if (!branch.branches.empty() && append(own(branch.branches.back()), level - 1, value)) {
+            // элемент добавлен в последнего ребенка
+        } else if (branch.branches.size() < BRANCHING) {
+            branch.branches.push_back(singlePath(level - 1, value));
+            branch.ends.push_back(branch.count());
+        } else {
+            return false;
+        }
+        branch.ends.back()++;
+        return true;
+    }
+
+    // Слияние ребенка child, заполненного меньше чем наполовину, с соседом,
+    // если вместе они помещаются в одного ребенка; пустой ребенок удаляется
+    static void mergeSmall(Branch& branch, size_t level, size_t child) {
+        auto fill = [&](size_t k) {
+            return level == 1 ? branch.chunks[k]->size() : branch.branches[k]->ends.size();
+        };
+        const size_t limit = level == 1 ? ChunkSize : BRANCHING;
+        const size_t children = childCount(branch, level);
+        size_t from = child;
+        if (fill(child) == 0) {
+            if (level == 1) {
+                branch.chunks.erase(branch.chunks.begin() + child);
+            } else {
+                branch.branches.erase(branch.branches.begin() + child);
+            }
+        } else if (fill(child) < limit / 2 && children > 1) {
+            const size_t left = child + 1 < children ? child : child - 1;
+            if (fill(left) + fill(left + 1) <= limit) {
+                if (level == 1) {
+                    const Chunk& right = *branch.chunks[left + 1];
+                    Chunk& merged = own(branch.chunks[left]);
+                    merged.insert(merged.end(), right.begin(), right.end());
+                    branch.chunks.erase(branch.chunks.begin() + left + 1);
+                } else {
+                    const Branch& right = *branch.branches[left + 1];
+                    Branch& merged = own(branch.branches[left]);
+                    merged.chunks.insert(merged.chunks.end(), right.chunks.begin(), right.chunks.end());
+                    merged.branches.insert(merged.branches.end(), right.branches.begin(), right.branches.end());
+                    recount(merged, level - 1, merged.ends.size());
+                    branch.branches.erase(branch.branches.begin() + left + 1);
+                }
+            }
+            from = left;
+        }
+        recount(branch, level, from);
+    }
+
+    static void eraseAt(Branch& branch, size_t level, size_t index) {
+        const size_t child = childFor(branch, childShift(level), index);
+        if (level == 1) {
+            Chunk& chunk = own(branch.chunks[child]);
+            chunk.erase(chunk.begin() + index);
+        } else {
+            eraseAt(own(branch.branches[child]), level - 1, index);
+        }
+        mergeSmall(branch, level, child);
+    }
+
+    // Читатели видят дерево только после того, как pending сброшен,
+    // поэтому заполнение корня под мьютексом безопасно и в const-методах
+    void loadPending() const {
+        std::lock_guard<std::mutex> lock(root->loadMutex);
+        if (!root->pending.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::vector<T> values;
+        if (root->loader(values) && values.size() == root->count) {
+            fillTree(*root, std::move(values));
+        } else {
+            root->count = 0;
+            root->failed = true;
+        }
+        root->loader = nullptr;
+        root->pending.store(false, std::memory_order_release);
+    }
+
+    const Root* loadedRoot() const {
+        if (root && root->pending.load(std::memory_order_acquire)) {
+            loadPending();
+        }
+        return root.get();
+    }
+
+    // Корень копируется, только если им владеет еще какая-то версия;
+    // копия разделяет с ним все дерево
+    Root& mutableRoot() {
+        if (!root) {
+            root = newRoot();
+        } else {
+            loadedRoot();
+            if (root.use_count() > 1) {
+                auto copy = newRoot();
+                copy->top = root->top;
+                copy->height = root->height;
+                copy->count = root->count;
+                copy->failed = root->failed;
+                root = std::move(copy);
+            }
+        }
+        return *root;
+    }
+
+public:
+    class const_iterator {
+    private:
+        const Root* root = nullptr;
+        size_t index = 0;
+        // Блок с элементами [chunkBegin, chunkBegin + chunkLength): обход
+        // спускается по дереву один раз на блок, а не на каждый элемент.
+        // Блок ищется при сдвиге итератора, а не при разыменовании: алгоритмы
+        // стандартной библиотеки разыменовывают копии итератора.
+        const T* chunkData = nullptr;
+        size_t chunkBegin = 0;
+        size_t chunkLength = 0;
+
+        void locate() {
+            if (root && index < root->count) {
+                size_t offset = index;
+                const Chunk& chunk = chunkFor(*root, offset);
+                chunkData = chunk.data();
+                chunkBegin = index - offset;
+                chunkLength = chunk.size();
+            }
+        }
+        void follow() {
+            if (index - chunkBegin >= chunkLength) {
+                locate();
+            }
+        }
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const Root* root, size_t index) : root(root), index(index) { follow(); }
+
+        reference operator*() const { return chunkData[index - chunkBegin]; }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        const_iterator& operator++() { ++index; follow(); return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+        const_iterator& operator--() { --index; follow(); return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --*this; return old; }
+        const_iterator& operator+=(difference_type n) { index += n; follow(); return *this; }
+        const_iterator& operator-=(difference_type n) { index -= n; follow(); return *this; }
+        const_iterator operator+(difference_type n) const {
+            const_iterator result = *this;
+            return result += n;
+        }
+        const_iterator operator-(difference_type n) const {
+            const_iterator result = *this;
+            return result -= n;
+        }
+        friend const_iterator operator+(difference_type n, const const_iterator& it) { return it + n; }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+        }
+
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+        bool operator<(const const_iterator& other) const { return index < other.index; }
+        bool operator>(const const_iterator& other) const { return index > other.index; }
+        bool operator<=(const const_iterator& other) const { return index <= other.index; }
+        bool operator>=(const const_iterator& other) const { return index >= other.index; }
+    };
+
+    using value_type = T;
+    using iterator = const_iterator;
+
+    PersistentVector() = default;
+    PersistentVector(const std::vector<T>& values) {
+        if (!values.empty()) {
+            root = newRoot();
+            fillTree(*root, values);
+        }
+    }
+
+    // Отложенный вектор из count элементов; load вызывается при первом
+    // обращении к элементам или размеру и должна вернуть true и ровно count
+    // элементов, иначе вектор останется пустым. Размер до загрузки - лишь
+    // обещание источника, поэтому и size() выполняет загрузку: иначе цикл по
+    // размеру, взятому до нее, вышел бы за границы пустого вектора.
+    // Функция не должна обращаться к этому же вектору.
+    static PersistentVector deferred(size_t count, Loader load) {
+        PersistentVector result;
+        result.root = newRoot();
+        result.root->count = count;
+        result.root->loader = std::move(load);
+        result.root->pending.store(true, std::memory_order_relaxed);
+        return result;
+    }
+
+    // false - элементы отложенного вектора еще не загружены
+    bool isLoaded() const { return !root || !root->pending.load(std::memory_order_acquire); }
+    // Загрузка отложенного вектора не удалась (признак сохраняется и в измененных копиях)
+    bool loadFailed() const { return isLoaded() && root && root->failed; }
+
+    size_t size() const {
+        const Root* r = loadedRoot();
+        return r ? r->count : 0;
+    }
+    // Байт под элементы этой версии; отложенные элементы еще не занимают памяти
+    size_t bytesUsed() const { return isLoaded() ? size() * sizeof(T) : 0; }
+    bool empty() const { return size() == 0; }
+
+    const T& operator[](size_t index) const {
+        return chunkFor(*loadedRoot(), index)[index];
+    }
+
+    const_iterator begin() const { return const_iterator(loadedRoot(), 0); }
+    const_iterator end() const { return const_iterator(loadedRoot(), size()); }
+
+    // Изменяемый доступ к элементу (копирует путь к блоку и блок, если они
+    // разделяются с другими версиями)
+    T& mutableAt(size_t index) {
+        Root& r = mutableRoot();
+        Branch* branch = &own(r.top);
+        for (size_t level = r.height; level > 1; --level) {
+            branch = &own(branch->branches[childFor(*branch, childShift(level), index)]);
+        }
+        return own(branch->chunks[childFor(*branch, CHUNK_SHIFT, index)])[index];
+    }
+
+    void push_back(const T& value) {
+        Root& r = mutableRoot();
+        if (!r.top) {
+            r.top = singlePath(1, value);
+            r.height = 1;
+        } else if (!append(own(r.top), r.height, value)) {
+            BranchPtr top = newBranch();
+            top->branches.push_back(std::move(r.top));
+            top->branches.push_back(singlePath(r.height, value));
+            recount(*top, r.height + 1, 0);
+            r.top = std::move(top);
+            r.height++;
+        }
+        r.count++;
+    }
+
+    // Удаление элемента с сохранением порядка, как у std::vector::erase, но за
+    // O(ChunkSize + log n): сдвигается только хвост блока. Прежние версии
+    // разделяют с новой все, кроме пути к блоку.
+    void erase(size_t index) {
+        Root& r = mutableRoot();
+        eraseAt(own(r.top), r.height, index);
+        r.count--;
+        while (r.height > 1 && r.top->branches.size() == 1) {
+            BranchPtr only = r.top->branches.front();
+            r.top = std::move(only);
+            r.height--;
+        }
+        if (r.count == 0) {
+            r.top = nullptr;
+            r.height = 0;
+        }
+    }
+
+    // Удаление всех элементов, удовлетворяющих условию, с сохранением порядка.
+    // Условие проверяется для каждого элемента, но копируются только блоки,
+    // из которых что-то удалено; остальные остаются общими с прежней версией.
+    template <typename Predicate>
+    size_t removeIf(Predicate predicate) {
+        const Root* r = loadedRoot();
+        if (!r || !r->top) {
+            return 0;
+        }
+        std::vector<ChunkPtr> chunks;
+        bool lastIsNew = false;  // последний блок создан здесь и его можно дополнять
+        size_t kept = 0;
+        auto visit = [&](const ChunkPtr& chunk) {
+            auto removed = std::find_if(chunk->begin(), chunk->end(), predicate);
+            if (removed == chunk->end()) {
+                chunks.push_back(chunk);
+                lastIsNew = false;
+                kept += chunk->size();
+                return;
+            }
+            for (auto it = chunk->begin(); it != chunk->end(); ++it) {
+                if (it >= removed && predicate(*it)) {
+                    continue;
+                }
+                if (!lastIsNew || chunks.back()->size() == ChunkSize) {
+                    chunks.push_back(newChunk());
+                    lastIsNew = true;
+                }
+                chunks.back()->push_back(*it);
+                ++kept;
+            }
+        };
+        forEachChunk(*r->top, r->height, visit);
+        const size_t removed = r->count - kept;
+        if (removed == 0) {
+            return 0;
+        }
+        Root& result = mutableRoot();
+        result.top = buildTree(std::move(chunks), result.height);
+        result.count = kept;
+        return removed;
+    }
+
+    void popBack() { erase(size() - 1); }
+
+    void clear() { root.reset(); }
+
+    // true, если оба вектора - одна и та же версия (без сравнения элементов)
+    bool sharesStateWith(const PersistentVector& other) const { return root == other.root; }
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "PipelineTypes.h"
+
+// Трубы по ID. Концы соединения сети хранит только его труба, и обходы
+// сети находят ее здесь. Индекс держит указатели на записи, поэтому он
+// действителен, пока версия труб, по которой он построен, жива и не
+// менялась. При повторных ID находится первая труба, как в findPipeIndexById.
+class PipeIndex {
+private:
+    std::unordered_map<int, const Pipe*> byId;
+
+public:
+    // pipes - PersistentVector<Pipe> или std::vector<Pipe>
+    template <typename Pipes>
+    explicit PipeIndex(const Pipes& pipes) {
+        byId.reserve(pipes.size());
+        for (const Pipe& pipe : pipes) {
+            byId.emplace(pipe.id, &pipe);
+        }
+    }
+
+    // Труба с данным ID или nullptr
+    const Pipe* find(int pipeId) const {
+        auto it = byId.find(pipeId);
+        return it != byId.end() ? it->second : nullptr;
+    }
+
+    // Подключена ли труба записи в сеть именно так - для сверки концов,
+    // прочитанных из файла или патча, с трубами
+    bool connects(const ConnectionRecord& record) const {
+        const Pipe* pipe = find(record.pipeId);
+        return pipe && pipe->inUse && pipe->startId == record.startId && pipe->endId == record.endId &&
+               pipe->startType == record.startType && pipe->endType == record.endType;
+    }
+};
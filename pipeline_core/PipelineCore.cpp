@@ -0,0 +1,1683 @@
+#include "PipelineCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <variant>
+
+#include "Arena.h"
+#include "AtomicFile.h"
+#include "CompactSnapshot.h"
+#include "LruCache.h"
+#include "OperationMetrics.h"
+#include "PipeIndex.h"
+#include "TaskScheduler.h"
+#include "Tracing.h"
+
+using namespace std;
+
+namespace {
+
+// Оценки стоимости проверки одной записи (нс) для выбора между
+// последовательным и параллельным просмотром
+const double FLAG_MATCH_COST = 2;
+const double PERCENT_MATCH_COST = 4;
+const double NAME_MATCH_COST = 40;
+
+// Содержит ли text подстроку lowerPattern (уже в нижнем регистре) без учета
+// регистра. То же, что toLower(text).find(lowerPattern), но без копии строки:
+// при параллельном просмотре выделения памяти упираются в общий аллокатор.
+bool containsLower(string_view text, const string& lowerPattern) {
+    auto it = search(text.begin(), text.end(), lowerPattern.begin(), lowerPattern.end(),
+                     [](char a, char b) { return static_cast<char>(::tolower(static_cast<unsigned char>(a))) == b; });
+    return it != text.end() || lowerPattern.empty();
+}
+
+// Таблица ID -> плотный номер в памяти арены (открытая адресация).
+// Заменяет map/set в запросах: ни одного выделения памяти на элемент.
+// Занятость ячеек - в отдельном массиве: допустим любой ID, включая INT_MIN.
+class ArenaIdIndex {
+private:
+    int* keys;
+    int* values;
+    bool* used;
+    size_t mask;
+
+    size_t slotOf(int id) const {
+        uint32_t hash = static_cast<uint32_t>(id) * 2654435761u;
+        return (hash ^ (hash >> 16)) & mask;
+    }
+
+public:
+    ArenaIdIndex(Arena& arena, size_t expected) {
+        size_t capacity = 16;
+        while (capacity < 2 * expected) {
+            capacity *= 2;
+        }
+        mask = capacity - 1;
+        keys = arena.allocateArray<int>(capacity);
+        values = arena.allocateArray<int>(capacity);
+        used = arena.allocateArray<bool>(capacity, false);
+    }
+
+    int find(int id) const {
+        for (size_t slot = slotOf(id); used[slot]; slot = (slot + 1) & mask) {
+            if (keys[slot] == id) {
+                return values[slot];
+            }
+        }
+        return -1;
+    }
+
+    // Добавляет id, если его еще нет; возвращает false для повторного
+    bool insert(int id, int value) {
+        size_t slot = slotOf(id);
+        for (; used[slot]; slot = (slot + 1) & mask) {
+            if (keys[slot] == id) {
+                return false;
+            }
+        }
+        used[slot] = true;
+        keys[slot] = id;
+        values[slot] = value;
+        return true;
+    }
+};
+
+// Ориентированный граф для запросов в плотной нумерации (CSR) в памяти арены.
+// Узлы и дуги - те же, что в buildGraph: КС, трубы-узлы и соединения из
+// узлов графа в порядке сети. target дуги - номер узла или -1, если конец
+// соединения не узел графа. Концы соединений берутся из их труб.
+struct ArenaGraph {
+    size_t nodeCount = 0;
+    int* nodeIds = nullptr;
+    int* firstArc = nullptr;   // дуги узла v - [firstArc[v], firstArc[v + 1])
+    int* arcTarget = nullptr;
+    int* arcPipe = nullptr;
+
+    ArenaGraph(Arena& arena, const ArenaIdIndex& stationIndex, const ArenaIdIndex& nodeOf, size_t nodeCount,
+               const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes,
+               bool stationsOnly)
+        : nodeCount(nodeCount) {
+        // Трубы по ID (первая при повторе) и начало дуги каждого соединения:
+        // номер узла или -1, если соединение не дает дуги
+        ArenaIdIndex pipeAt(arena, pipes.size());
+        for (size_t i = 0; i < pipes.size(); ++i) {
+            pipeAt.insert(pipes[i].id, static_cast<int>(i));
+        }
+        int* fromOf = arena.allocateArray<int>(network.size(), -1);
+        int* toOf = arena.allocateArray<int>(network.size(), -1);
+        firstArc = arena.allocateArray<int>(nodeCount + 1, 0);
+        for (size_t c = 0; c < network.size(); ++c) {
+            const int at = pipeAt.find(network[c].pipeId);
+            if (at == -1) {
+                continue;
+            }
+            const Pipe& pipe = pipes[at];
+            if (accepts(stationIndex, pipe, stationsOnly)) {
+                fromOf[c] = nodeOf.find(pipe.startId);
+                toOf[c] = nodeOf.find(pipe.endId);
+                if (fromOf[c] != -1) {
+                    ++firstArc[fromOf[c] + 1];
+                }
+            }
+        }
+        for (size_t v = 0; v < nodeCount; ++v) {
+            firstArc[v + 1] += firstArc[v];
+        }
+        const size_t arcCount = firstArc[nodeCount];
+        arcTarget = arena.allocateArray<int>(arcCount);
+        arcPipe = arena.allocateArray<int>(arcCount);
+        int* cursor = arena.allocateArray<int>(nodeCount);
+        copy(firstArc, firstArc + nodeCount, cursor);
+        for (size_t c = 0; c < network.size(); ++c) {
+            const int from = fromOf[c];
+            if (from != -1) {
+                arcTarget[cursor[from]] = toOf[c];
+                arcPipe[cursor[from]++] = network[c].pipeId;
+            }
+        }
+    }
+
+    static bool accepts(const ArenaIdIndex& stationIndex, const Pipe& pipe, bool stationsOnly) {
+        return !stationsOnly || (stationIndex.find(pipe.startId) != -1 && stationIndex.find(pipe.endId) != -1);
+    }
+};
+
+// ID КС -> индекс в stations; при повторе ID побеждает первая, как в getObjectInfo
+ArenaIdIndex indexStations(Arena& arena, const PersistentVector<CompressorStation>& stations) {
+    ArenaIdIndex index(arena, stations.size());
+    for (size_t i = 0; i < stations.size(); ++i) {
+        index.insert(stations[i].id, static_cast<int>(i));
+    }
+    return index;
+}
+
+bool readWholeFile(const string& filename, string& contents) {
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// Оставшиеся записи в прежнем порядке и добавленные на свои места at
+// (номера во втором состоянии); пустой at - патч версии 1, добавленные в
+// конец. false - места не возрастают или выходят за пределы секции.
+template <typename Record>
+bool placeAdded(vector<Record>& kept, const vector<Record>& added, const vector<size_t>& at,
+                vector<Record>& result) {
+    if (at.empty()) {
+        result = move(kept);
+        result.insert(result.end(), added.begin(), added.end());
+        return true;
+    }
+    const size_t total = kept.size() + added.size();
+    result.reserve(total);
+    size_t nextKept = 0;
+    size_t nextAdded = 0;
+    for (size_t position = 0; position < total; ++position) {
+        if (nextAdded < added.size() && at[nextAdded] == position) {
+            result.push_back(added[nextAdded++]);
+        } else if (nextKept < kept.size()) {
+            result.push_back(kept[nextKept++]);
+        } else {
+            return false;
+        }
+    }
+    return nextAdded == added.size();
+}
+
+// Секция после патча: удаляемые и изменяемые ID должны быть в records,
+// добавляемые - отсутствовать. false - патч не подходит к состоянию.
+template <typename Record>
+bool patchRecords(const PersistentVector<Record>& records, const vector<int>& removed,
+                  const vector<Record>& modified, const vector<Record>& added, const vector<size_t>& addedAt,
+                  vector<Record>& result) {
+    ArenaScope scope;
+    ArenaIdIndex index(scope.arena(), records.size() + added.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        index.insert(records[i].id, static_cast<int>(i));
+    }
+    // Судьба записи: KEEP, REMOVE или номер новой версии в modified
+    const int KEEP = -1;
+    const int REMOVE = -2;
+    int* fate = scope.arena().allocateArray<int>(records.size(), KEEP);
+    for (int id : removed) {
+        const int at = index.find(id);
+        if (at == -1 || fate[at] != KEEP) {
+            return false;
+        }
+        fate[at] = REMOVE;
+    }
+    for (size_t k = 0; k < modified.size(); ++k) {
+        const int at = index.find(modified[k].id);
+        if (at == -1 || fate[at] != KEEP) {
+            return false;
+        }
+        fate[at] = static_cast<int>(k);
+    }
+    // Перенесенная запись удаляется и добавляется снова с тем же ID
+    ArenaIdIndex addedIds(scope.arena(), added.size());
+    for (const auto& record : added) {
+        const int at = index.find(record.id);
+        if ((at != -1 && fate[at] != REMOVE) || !addedIds.insert(record.id, 0)) {
+            return false;
+        }
+    }
+
+    vector<Record> kept;
+    kept.reserve(records.size() - removed.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (fate[i] == KEEP) {
+            kept.push_back(records[i]);
+        } else if (fate[i] != REMOVE) {
+            kept.push_back(modified[fate[i]]);
+        }
+    }
+    return placeAdded(kept, added, addedAt, result);
+}
+
+// Соединения после патча. Соединение сравнивается по трубе и ее концам:
+// у имеющихся концы берутся из труб до патча (pipes), у оставшихся они
+// должны совпасть с концами в трубах после патча (patchedPipes), добавленные
+// сверяются с patchedPipes. Удаляемые задаются местами в первом состоянии;
+// в патче версии 1 мест нет, и удаляемые ищутся по полям (повторы - попарно).
+bool patchConnections(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes,
+                      const vector<ConnectionRecord>& removed, const vector<size_t>& removedAt,
+                      const vector<ConnectionRecord>& added, const vector<size_t>& addedAt,
+                      const vector<Pipe>& patchedPipes, vector<NetworkConnection>& result) {
+    using Key = tuple<int, int, int, int, int>;
+    const PipeIndex pipesBefore(pipes);
+    const PipeIndex pipesAfter(patchedPipes);
+    auto keyIn = [](const PipeIndex& pipeById, const NetworkConnection& conn) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        return pipe ? Key(conn.pipeId, pipe->startId, pipe->endId, pipe->startType, pipe->endType)
+                    : Key(conn.pipeId, 0, 0, -1, -1);
+    };
+    auto keyOf = [](const ConnectionRecord& record) {
+        return Key(record.pipeId, record.startId, record.endId, record.startType, record.endType);
+    };
+    auto keep = [&](vector<NetworkConnection>& kept, const NetworkConnection& conn) {
+        const Key key = keyIn(pipesBefore, conn);
+        kept.push_back(conn);
+        return get<3>(key) != -1 && keyIn(pipesAfter, conn) == key;
+    };
+    vector<NetworkConnection> addedConnections;
+    addedConnections.reserve(added.size());
+    for (const ConnectionRecord& record : added) {
+        if (!pipesAfter.connects(record)) {
+            return false;
+        }
+        addedConnections.push_back({record.pipeId});
+    }
+
+    vector<NetworkConnection> kept;
+    if (!removedAt.empty()) {
+        vector<bool> removing(network.size(), false);
+        for (size_t k = 0; k < removed.size(); ++k) {
+            const size_t at = removedAt[k];
+            if (at >= network.size() || removing[at] || keyIn(pipesBefore, network[at]) != keyOf(removed[k])) {
+                return false;
+            }
+            removing[at] = true;
+        }
+        kept.reserve(network.size() - removed.size());
+        for (size_t i = 0; i < network.size(); ++i) {
+            if (!removing[i] && !keep(kept, network[i])) {
+                return false;
+            }
+        }
+        return placeAdded(kept, addedConnections, addedAt, result);
+    }
+
+    vector<Key> removedKeys(removed.size());
+    transform(removed.begin(), removed.end(), removedKeys.begin(), keyOf);
+    sort(removedKeys.begin(), removedKeys.end());
+    vector<bool> used(removedKeys.size(), false);
+    size_t usedCount = 0;
+
+    kept.reserve(network.size());
+    for (const auto& conn : network) {
+        auto [first, last] = equal_range(removedKeys.begin(), removedKeys.end(), keyIn(pipesBefore, conn));
+        auto free = find_if(first, last, [&](const Key& key) { return !used[&key - removedKeys.data()]; });
+        if (free != last) {
+            used[free - removedKeys.begin()] = true;
+            ++usedCount;
+        } else if (!keep(kept, conn)) {
+            return false;
+        }
+    }
+    return usedCount == removedKeys.size() && placeAdded(kept, addedConnections, addedAt, result);
+}
+
+// Записей на одну задачу разбора при загрузке
+const size_t LOAD_GRAIN = 1024;
+
+// Файл сохранения, разбитый на строки. Символы перевода строки заменены
+// нулями, поэтому каждая строка - готовая C-строка для strtol/strtod.
+class SavedLines {
+private:
+    string text;
+    vector<size_t> starts;
+
+    static bool blankTail(const char* rest) {
+        while (*rest != '\0' && isspace(static_cast<unsigned char>(*rest))) {
+            ++rest;
+        }
+        return *rest == '\0';
+    }
+
+public:
+    explicit SavedLines(string contents) : text(move(contents)) {
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (i == 0 || text[i - 1] == '\0') {
+                starts.push_back(i);
+            }
+            if (text[i] == '\n') {
+                text[i] = '\0';
+            }
+        }
+    }
+
+    size_t size() const { return starts.size(); }
+    const char* operator[](size_t line) const { return text.c_str() + starts[line]; }
+
+    bool startsWith(size_t line, const char* word) const {
+        return strncmp((*this)[line], word, strlen(word)) == 0;
+    }
+
+    // Строка вида "<word> <число>"
+    bool header(size_t line, const char* word, int& value) const {
+        if (line >= size() || !startsWith(line, word)) {
+            return false;
+        }
+        const char* rest = (*this)[line] + strlen(word);
+        return isspace(static_cast<unsigned char>(*rest)) && field(rest, value);
+    }
+
+    bool field(size_t line, int& value) const { return field((*this)[line], value); }
+    bool field(size_t line, double& value) const {
+        char* end = nullptr;
+        value = strtod((*this)[line], &end);
+        return end != (*this)[line] && blankTail(end);
+    }
+    bool field(size_t line, bool& value) const {
+        int number = 0;
+        if (!field(line, number) || (number != 0 && number != 1)) {
+            return false;
+        }
+        value = number == 1;
+        return true;
+    }
+    bool field(size_t line, ConnectionType& value) const {
+        int number = 0;
+        if (!field(line, number)) {
+            return false;
+        }
+        value = toConnectionType(number);
+        return true;
+    }
+
+    static bool field(const char* text, int& value) {
+        char* end = nullptr;
+        errno = 0;
+        long number = strtol(text, &end, 10);
+        if (end == text || errno != 0 || number < INT_MIN || number > INT_MAX) {
+            return false;
+        }
+        value = static_cast<int>(number);
+        return blankTail(end);
+    }
+};
+
+// Записей в одном куске секции при сохранении
+const size_t SAVE_CHUNK = 4096;
+
+// Записи секции форматируются кусками параллельно, а в поток пишутся по
+// порядку. Куски готовятся волнами, чтобы в памяти не копился текст всего файла.
+template <typename T, typename Advance, typename Format>
+void writeRecords(ostream& file, const PersistentVector<T>& records, Advance& advance, const Format& format) {
+    const size_t chunks = (records.size() + SAVE_CHUNK - 1) / SAVE_CHUNK;
+    const size_t wave = 2 * TaskScheduler::instance().concurrency();
+    vector<string> texts(min(wave, chunks));
+    for (size_t first = 0; first < chunks; first += wave) {
+        const size_t count = min(wave, chunks - first);
+        parallelFor(0, count, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                ostringstream out;
+                out.flags(file.flags());
+                out.precision(file.precision());
+                const size_t last = min(records.size(), (first + c + 1) * SAVE_CHUNK);
+                for (size_t i = (first + c) * SAVE_CHUNK; i < last; ++i) {
+                    format(out, records[i]);
+                }
+                texts[c] = out.str();
+            }
+        });
+        for (size_t c = 0; c < count; ++c) {
+            file << texts[c];
+            advance(min(SAVE_CHUNK, records.size() - (first + c) * SAVE_CHUNK));
+        }
+    }
+}
+
+
+// Объем кэша запросов. Порядок сортировки крупной сети (сотни тысяч КС)
+// занимает несколько мегабайт, поэтому в кэш помещается несколько версий.
+const size_t QUERY_CACHE_BYTES = 32 << 20;
+// Узел списка и хэш-таблицы кэша сверх самого результата
+const size_t QUERY_ENTRY_OVERHEAD = 64;
+
+uint64_t nextEpoch() {
+    static atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+size_t resultCost(const PathResult& result) {
+    return (result.nodes.capacity() + result.pipeIds.capacity()) * sizeof(int);
+}
+
+size_t resultCost(const TopoSortResult& result) {
+    return (result.order.capacity() + result.cyclicStations.capacity()) * sizeof(int);
+}
+
+}
+
+// Ключ - эпоха и параметры запроса; для сортировки параметров нет
+struct PipelineCore::QueryCache {
+    struct Key {
+        uint64_t epoch;
+        bool topology;
+        int startId;
+        int endId;
+
+        bool operator==(const Key& other) const {
+            return epoch == other.epoch && topology == other.topology && startId == other.startId &&
+                   endId == other.endId;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            uint64_t value = key.epoch * 0x9E3779B97F4A7C15ull;
+            value ^= (static_cast<uint64_t>(static_cast<uint32_t>(key.startId)) << 32 |
+                      static_cast<uint32_t>(key.endId)) + key.topology;
+            return hash<uint64_t>()(value * 0xC2B2AE3D27D4EB4Full);
+        }
+    };
+
+    using Result = variant<PathResult, TopoSortResult>;
+
+    std::mutex mutex;
+    LruCache<Key, Result, KeyHash> results{QUERY_CACHE_BYTES, MemoryCategory::QueryCache};
+
+    // Результат копируется под блокировкой: запись может быть вытеснена сразу после
+    template <typename T>
+    bool find(const Key& key, T& result) {
+        lock_guard<std::mutex> lock(mutex);
+        const Result* cached = results.find(key);
+        if (!cached) {
+            return false;
+        }
+        result = get<T>(*cached);
+        return true;
+    }
+
+    template <typename T>
+    void store(const Key& key, const T& result) {
+        const size_t cost = sizeof(Result) + QUERY_ENTRY_OVERHEAD + resultCost(result);
+        lock_guard<std::mutex> lock(mutex);
+        results.insert(key, result, cost);
+    }
+};
+
+shared_ptr<PipelineCore::QueryCache> PipelineCore::newQueryCache() {
+    return make_shared<QueryCache>();
+}
+
+QueryCacheStats PipelineCore::getQueryCacheStats() const {
+    lock_guard<mutex> lock(queryCache->mutex);
+    const auto& results = queryCache->results;
+    QueryCacheStats stats;
+    stats.hits = results.hits();
+    stats.misses = results.misses();
+    stats.evictions = results.evictions();
+    stats.entries = results.size();
+    stats.bytes = results.bytesUsed();
+    stats.capacityBytes = results.capacityBytes();
+    return stats;
+}
+
+void PipelineCore::clearQueryCache() const {
+    lock_guard<mutex> lock(queryCache->mutex);
+    queryCache->results.clear();
+    queryCache->results.resetStats();
+}
+
+int PipelineCore::findPipeIndexById(int id) const {
+    OperationTimer timer(Operation::IdLookup);
+    auto it = find_if(pipes.begin(), pipes.end(),
+                     [id](const Pipe& p) { return p.id == id; });
+    return it != pipes.end() ? distance(pipes.begin(), it) : -1;
+}
+
+int PipelineCore::findStationIndexById(int id) const {
+    OperationTimer timer(Operation::IdLookup);
+    auto it = find_if(stations.begin(), stations.end(),
+                     [id](const CompressorStation& s) { return s.id == id; });
+    return it != stations.end() ? distance(stations.begin(), it) : -1;
+}
+
+vector<int> PipelineCore::getPipeIds() const {
+    vector<int> ids;
+    for (const auto& pipe : pipes) {
+        ids.push_back(pipe.id);
+    }
+    return ids;
+}
+
+vector<int> PipelineCore::getStationIds() const {
+    vector<int> ids;
+    for (const auto& station : stations) {
+        ids.push_back(station.id);
+    }
+    return ids;
+}
+
+pair<bool, int> PipelineCore::getObjectInfo(int id) const {
+    // Проверяем, является ли ID станцией
+    int stationIndex = findStationIndexById(id);
+    if (stationIndex != -1) {
+        return {true, stationIndex}; // true = станция
+    }
+
+    // Проверяем, является ли ID трубой
+    int pipeIndex = findPipeIndexById(id);
+    if (pipeIndex != -1) {
+        return {false, pipeIndex}; // false = труба
+    }
+
+    return {false, -1}; // не найдено
+}
+
+const vector<int>& PipelineCore::allowedDiameters() {
+    static const vector<int> diameters = {500, 700, 1000, 1400};
+    return diameters;
+}
+
+bool PipelineCore::isAllowedDiameter(int diameter) {
+    const auto& diameters = allowedDiameters();
+    return find(diameters.begin(), diameters.end(), diameter) != diameters.end();
+}
+
+double PipelineCore::calculateInactivePercent(const CompressorStation& station) {
+    return station.totalWorkshops > 0 ?
+           100.0 * (station.totalWorkshops - station.activeWorkshops) / station.totalWorkshops : 0.0;
+}
+
+string PipelineCore::toLower(const string& str) {
+    string result = str;
+    transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
+ConnectionType PipelineCore::determineConnectionType(bool isStartStation, bool isEndStation) {
+    if (isStartStation && isEndStation) return STATION_TO_STATION;
+    if (!isStartStation && !isEndStation) return PIPE_TO_PIPE;
+    if (isStartStation && !isEndStation) return STATION_TO_PIPE;
+    return PIPE_TO_STATION;
+}
+
+// Трубы
+
+int PipelineCore::addPipe(const string& name, double length, int diameter) {
+    OperationTimer timer(Operation::AddPipe);
+    Pipe newPipe;
+    newPipe.id = nextPipeId++;
+    newPipe.name = name;
+    newPipe.length = length;
+    newPipe.diameter = diameter;
+    newPipe.underRepair = false;
+    newPipe.inUse = false;
+    newPipe.startId = 0;
+    newPipe.endId = 0;
+    newPipe.startType = STATION_TO_STATION;
+    newPipe.endType = STATION_TO_STATION;
+
+    editPipes().push_back(newPipe);
+    return newPipe.id;
+}
+
+RemoveStatus PipelineCore::removePipe(int id) {
+    OperationTimer timer(Operation::RemovePipe);
+    int index = findPipeIndexById(id);
+    if (index == -1) {
+        return RemoveStatus::NotFound;
+    }
+    if (pipes[index].inUse) {
+        return RemoveStatus::InUse;
+    }
+    editPipes().erase(index);
+    return RemoveStatus::Ok;
+}
+
+bool PipelineCore::setPipeRepair(int id, bool underRepair) {
+    OperationTimer timer(Operation::EditPipe);
+    int index = findPipeIndexById(id);
+    if (index == -1) {
+        return false;
+    }
+    // Труба в ремонте не проводит газ: ее соединение выпадает из островов
+    const Pipe& pipe = pipes[index];
+    if (pipe.inUse && pipe.underRepair != underRepair) {
+        auto editor = islands.edit(network, pipes);
+        for (const auto& conn : network) {
+            if (conn.pipeId != id) {
+                continue;
+            }
+            if (underRepair) {
+                editor.removeConnection(id);
+            } else {
+                editor.addConnection(pipe);
+            }
+        }
+    }
+    editPipes().mutableAt(index).underRepair = underRepair;
+    return true;
+}
+
+bool PipelineCore::updatePipe(int id, const string& name, double length) {
+    OperationTimer timer(Operation::EditPipe);
+    int index = findPipeIndexById(id);
+    if (index == -1) {
+        return false;
+    }
+    Pipe& pipe = editPipes().mutableAt(index);
+    pipe.name = name;
+    pipe.length = length;
+    return true;
+}
+
+bool PipelineCore::setPipeDiameter(int id, int diameter) {
+    OperationTimer timer(Operation::EditPipe);
+    int index = findPipeIndexById(id);
+    // Диаметр трубы, используемой в сети, менять нельзя
+    if (index == -1 || pipes[index].inUse) {
+        return false;
+    }
+    editPipes().mutableAt(index).diameter = diameter;
+    return true;
+}
+
+// КС
+
+int PipelineCore::addStation(const string& name, int totalWorkshops, int activeWorkshops, int stationClass) {
+    OperationTimer timer(Operation::AddStation);
+    CompressorStation newStation;
+    newStation.id = nextStationId++;
+    newStation.name = name;
+    newStation.totalWorkshops = totalWorkshops;
+    newStation.activeWorkshops = min(activeWorkshops, totalWorkshops);
+    newStation.stationClass = stationClass;
+
+    editStations().push_back(newStation);
+    return newStation.id;
+}
+
+bool PipelineCore::removeStation(int id) {
+    OperationTimer timer(Operation::RemoveStation);
+    int index = findStationIndexById(id);
+    if (index == -1) {
+        return false;
+    }
+
+    // При удалении станции удаляем все соединения с ней; концы соединений -
+    // в трубах, которые освобождаются ниже, после правки сети
+    {
+        const PipeIndex pipeById(pipes);
+        auto touches = [&pipeById, id](const NetworkConnection& conn) {
+            const Pipe* pipe = pipeById.find(conn.pipeId);
+            return pipe && (pipe->startId == id || pipe->endId == id);
+        };
+        {
+            auto editor = islands.edit(network, pipes);
+            for (const auto& conn : network) {
+                if (touches(conn)) {
+                    editor.removeConnection(conn.pipeId);
+                }
+            }
+        }
+        editNetwork().removeIf(touches);
+    }
+
+    // Освобождаем связанные трубы
+    for (size_t i = 0; i < pipes.size(); ++i) {
+        if (pipes[i].startId == id || pipes[i].endId == id) {
+            Pipe& pipe = editPipes().mutableAt(i);
+            pipe.inUse = false;
+            pipe.startId = 0;
+            pipe.endId = 0;
+        }
+    }
+
+    editStations().erase(index);
+    return true;
+}
+
+bool PipelineCore::startWorkshop(int id) {
+    OperationTimer timer(Operation::EditStation);
+    int index = findStationIndexById(id);
+    if (index == -1 || stations[index].activeWorkshops >= stations[index].totalWorkshops) {
+        return false;
+    }
+    editStations().mutableAt(index).activeWorkshops++;
+    return true;
+}
+
+bool PipelineCore::stopWorkshop(int id) {
+    OperationTimer timer(Operation::EditStation);
+    int index = findStationIndexById(id);
+    if (index == -1 || stations[index].activeWorkshops <= 0) {
+        return false;
+    }
+    editStations().mutableAt(index).activeWorkshops--;
+    return true;
+}
+
+bool PipelineCore::updateStation(int id, const string& name, int totalWorkshops, int stationClass) {
+    OperationTimer timer(Operation::EditStation);
+    int index = findStationIndexById(id);
+    if (index == -1) {
+        return false;
+    }
+    CompressorStation& station = editStations().mutableAt(index);
+    station.name = name;
+    if (totalWorkshops < station.activeWorkshops) {
+        station.activeWorkshops = totalWorkshops;
+    }
+    station.totalWorkshops = totalWorkshops;
+    station.stationClass = stationClass;
+    return true;
+}
+
+// Поиск
+
+vector<int> PipelineCore::findPipesByName(const string& searchName) const {
+    OperationTimer timer(Operation::FindPipes);
+    string searchLower = toLower(searchName);
+    return parallelFilter(pipes.size(), NAME_MATCH_COST, [&](size_t i) {
+        return containsLower(pipes[i].name.view(), searchLower);
+    });
+}
+
+vector<int> PipelineCore::findPipesByRepairStatus(bool repairStatus) const {
+    OperationTimer timer(Operation::FindPipes);
+    return parallelFilter(pipes.size(), FLAG_MATCH_COST, [&](size_t i) {
+        return pipes[i].underRepair == repairStatus;
+    });
+}
+
+vector<int> PipelineCore::findPipesByUseStatus(bool useStatus) const {
+    OperationTimer timer(Operation::FindPipes);
+    return parallelFilter(pipes.size(), FLAG_MATCH_COST, [&](size_t i) {
+        return pipes[i].inUse == useStatus;
+    });
+}
+
+vector<int> PipelineCore::findStationsByName(const string& searchName) const {
+    OperationTimer timer(Operation::FindStations);
+    string searchLower = toLower(searchName);
+    return parallelFilter(stations.size(), NAME_MATCH_COST, [&](size_t i) {
+        return containsLower(stations[i].name.view(), searchLower);
+    });
+}
+
+vector<int> PipelineCore::findStationsByInactivePercent(double targetPercent, int comparisonType) const {
+    OperationTimer timer(Operation::FindStations);
+    return parallelFilter(stations.size(), PERCENT_MATCH_COST, [&](size_t i) {
+        double inactivePercent = calculateInactivePercent(stations[i]);
+        switch (comparisonType) {
+            case 1: return inactivePercent > targetPercent;
+            case 2: return inactivePercent < targetPercent;
+            case 3: return abs(inactivePercent - targetPercent) < 0.01;
+        }
+        return false;
+    });
+}
+
+// Сеть
+
+int PipelineCore::findAvailablePipeByDiameter(int diameter) const {
+    for (size_t i = 0; i < pipes.size(); ++i) {
+        if (pipes[i].diameter == diameter && !pipes[i].inUse && !pipes[i].underRepair) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ConnectStatus PipelineCore::canConnectObjects(int startId, int endId, int diameter) const {
+    if (startId == endId) {
+        return ConnectStatus::SameObject;
+    }
+
+    auto [isStartStation, startIndex] = getObjectInfo(startId);
+    auto [isEndStation, endIndex] = getObjectInfo(endId);
+
+    if (startIndex == -1) {
+        return ConnectStatus::StartNotFound;
+    }
+    if (endIndex == -1) {
+        return ConnectStatus::EndNotFound;
+    }
+
+    // Проверка для труб
+    if (!isStartStation && pipes[startIndex].underRepair) {
+        return ConnectStatus::StartUnderRepair;
+    }
+    if (!isEndStation && pipes[endIndex].underRepair) {
+        return ConnectStatus::EndUnderRepair;
+    }
+
+    // Проверка на существующее соединение (в одну сторону); подключенные
+    // трубы - ровно трубы соединений сети
+    for (const auto& pipe : pipes) {
+        if (pipe.inUse && pipe.startId == startId && pipe.endId == endId) {
+            return ConnectStatus::AlreadyExists;
+        }
+    }
+
+    // Проверка диаметра для соединения труб с трубами
+    if (!isStartStation && !isEndStation) {
+        if (pipes[startIndex].diameter != diameter || pipes[endIndex].diameter != diameter) {
+            return ConnectStatus::DiameterMismatch;
+        }
+    }
+
+    return ConnectStatus::Ok;
+}
+
+void PipelineCore::attachPipe(int pipeIndex, int startId, int endId, bool isStartStation, bool isEndStation) {
+    Pipe& pipe = editPipes().mutableAt(pipeIndex);
+    pipe.inUse = true;
+    pipe.startId = startId;
+    pipe.endId = endId;
+    pipe.startType = determineConnectionType(isStartStation, isEndStation);
+    pipe.endType = pipe.startType; // для простоты
+
+    if (!pipe.underRepair) {
+        islands.edit(network, pipes).addConnection(pipe);
+    }
+    editNetwork().push_back({pipe.id});
+}
+
+ConnectResult PipelineCore::connectObjects(int startId, int endId, int diameter) {
+    OperationTimer timer(Operation::Connect);
+    ConnectResult result;
+    result.status = canConnectObjects(startId, endId, diameter);
+    if (result.status != ConnectStatus::Ok) {
+        return result;
+    }
+
+    int pipeIndex = findAvailablePipeByDiameter(diameter);
+    if (pipeIndex == -1) {
+        result.status = ConnectStatus::NoFreePipe;
+        return result;
+    }
+
+    bool isStartStation = getObjectInfo(startId).first;
+    bool isEndStation = getObjectInfo(endId).first;
+    attachPipe(pipeIndex, startId, endId, isStartStation, isEndStation);
+    result.pipeId = pipes[pipeIndex].id;
+    return result;
+}
+
+ConnectResult PipelineCore::connectWithNewPipe(int startId, int endId, int diameter,
+                                               const string& name, double length) {
+    OperationTimer timer(Operation::Connect);
+    ConnectResult result;
+    result.status = canConnectObjects(startId, endId, diameter);
+    if (result.status != ConnectStatus::Ok) {
+        return result;
+    }
+
+    bool isStartStation = getObjectInfo(startId).first;
+    bool isEndStation = getObjectInfo(endId).first;
+
+    result.pipeId = addPipe(name, length, diameter);
+    result.createdPipe = true;
+    attachPipe(static_cast<int>(pipes.size()) - 1, startId, endId, isStartStation, isEndStation);
+    return result;
+}
+
+RemoveStatus PipelineCore::disconnectPipe(int pipeId) {
+    OperationTimer timer(Operation::Disconnect);
+    int pipeIndex = findPipeIndexById(pipeId);
+    if (pipeIndex == -1) {
+        return RemoveStatus::NotFound;
+    }
+    if (!pipes[pipeIndex].inUse) {
+        return RemoveStatus::NotConnected;
+    }
+
+    // Удаляем из сети
+    islands.edit(network, pipes).removeConnection(pipeId);
+    editNetwork().removeIf([pipeId](const NetworkConnection& conn) { return conn.pipeId == pipeId; });
+
+    // Сбрасываем флаг использования в трубе
+    Pipe& pipe = editPipes().mutableAt(pipeIndex);
+    pipe.inUse = false;
+    pipe.startId = 0;
+    pipe.endId = 0;
+    return RemoveStatus::Ok;
+}
+
+map<int, GraphNode> PipelineCore::buildGraph() const {
+    OperationTimer timer(Operation::BuildGraph);
+    TraceSpan span("buildGraph");
+    TraceSpan phase("add stations");
+    map<int, GraphNode> graph;
+
+    // Добавляем станции
+    for (const auto& station : stations) {
+        GraphNode node;
+        node.id = station.id;
+        node.isStation = true;
+        graph[station.id] = node;
+    }
+
+    // Добавляем трубы, которые являются узлами при соединении труб.
+    phase.next("find pipe nodes");
+    // Проверка концов - линейный поиск по всем объектам, поэтому трубы проверяются параллельно.
+    const double endpointCost = 2.0 * (pipes.size() + stations.size());
+    vector<int> pipeNodes = parallelFilter(pipes.size(), endpointCost, [&](size_t i) {
+        const Pipe& pipe = pipes[i];
+        // Если труба соединена с другой трубой, она становится узлом
+        return pipe.inUse && (!getObjectInfo(pipe.startId).first || !getObjectInfo(pipe.endId).first);
+    });
+    for (int index : pipeNodes) {
+        const Pipe& pipe = pipes[index];
+        if (graph.find(pipe.id) == graph.end()) {
+            GraphNode node;
+            node.id = pipe.id;
+            node.isStation = false;
+            graph[pipe.id] = node;
+        }
+    }
+
+    // Добавляем соединения (граф ориентированный: от начала к концу)
+    phase.next("build adjacency");
+    const PipeIndex pipeById(pipes);
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (pipe && graph.find(pipe->startId) != graph.end()) {
+            graph[pipe->startId].connections.push_back({pipe->endId, conn.pipeId});
+        }
+    }
+
+    return graph;
+}
+
+NetworkStats PipelineCore::getNetworkStats() const {
+    NetworkStats stats;
+    stats.connections = network.size();
+
+    set<int> connectedStations;
+    set<int> connectedPipes;
+    const PipeIndex pipeById(pipes);
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        bool isStartStation = getObjectInfo(pipe->startId).first;
+        bool isEndStation = getObjectInfo(pipe->endId).first;
+
+        (isStartStation ? connectedStations : connectedPipes).insert(pipe->startId);
+        (isEndStation ? connectedStations : connectedPipes).insert(pipe->endId);
+    }
+
+    stats.connectedStations = connectedStations.size();
+    stats.connectedPipes = connectedPipes.size();
+    return stats;
+}
+
+TopoSortResult PipelineCore::topologicalSort() const {
+    OperationTimer timer(Operation::TopoSort);
+    TraceSpan span("topologicalSort");
+    const QueryCache::Key key{epoch, true, 0, 0};
+    TopoSortResult result;
+    if (!queryCache->find(key, result)) {
+        result = sortStations();
+        queryCache->store(key, result);
+    }
+    return result;
+}
+
+TopoSortResult PipelineCore::sortStations() const {
+    TraceSpan phase("index stations");
+    TopoSortResult result;
+    ArenaScope scope;
+    Arena& arena = scope.arena();
+
+    // Граф только для КС, узлы - КС в порядке возрастания ID
+    ArenaIdIndex stationIndex = indexStations(arena, stations);
+    int* nodeIds = arena.allocateArray<int>(stations.size());
+    size_t nodeCount = 0;
+    for (size_t i = 0; i < stations.size(); ++i) {
+        if (stationIndex.find(stations[i].id) == static_cast<int>(i)) {
+            nodeIds[nodeCount++] = stations[i].id;
+        }
+    }
+    sort(nodeIds, nodeIds + nodeCount);
+    ArenaIdIndex nodeOf(arena, nodeCount);
+    for (size_t v = 0; v < nodeCount; ++v) {
+        nodeOf.insert(nodeIds[v], static_cast<int>(v));
+    }
+
+    // Учитываем только соединения между станциями
+    phase.next("build adjacency");
+    ArenaGraph graph(arena, stationIndex, nodeOf, nodeCount, network, pipes, true);
+    int* inDegree = arena.allocateArray<int>(nodeCount, 0);
+    for (size_t arc = 0; arc < static_cast<size_t>(graph.firstArc[nodeCount]); ++arc) {
+        ++inDegree[graph.arcTarget[arc]];
+    }
+
+    // Алгоритм Кана
+    phase.next("Kahn frontier expansion");
+    int* zeroDegreeNodes = arena.allocateArray<int>(nodeCount);
+    size_t stackSize = 0;
+    for (size_t v = 0; v < nodeCount; ++v) {
+        if (inDegree[v] == 0) {
+            zeroDegreeNodes[stackSize++] = static_cast<int>(v);
+        }
+    }
+
+    char* sorted = arena.allocateArray<char>(nodeCount, 0);
+    while (stackSize > 0) {
+        int node = zeroDegreeNodes[--stackSize];
+        result.order.push_back(nodeIds[node]);
+        sorted[node] = 1;
+
+        for (int arc = graph.firstArc[node]; arc < graph.firstArc[node + 1]; ++arc) {
+            int neighbor = graph.arcTarget[arc];
+            if (--inDegree[neighbor] == 0) {
+                zeroDegreeNodes[stackSize++] = neighbor;
+            }
+        }
+    }
+
+    // Проверка на циклы
+    phase.next("collect cycles");
+    if (result.order.size() != stations.size()) {
+        result.hasCycle = true;
+        for (const auto& station : stations) {
+            if (!sorted[nodeOf.find(station.id)]) {
+                result.cyclicStations.push_back(station.id);
+            }
+        }
+    }
+
+    return result;
+}
+
+PathResult PipelineCore::findPath(int startId, int endId) const {
+    OperationTimer timer(Operation::FindPath);
+    TraceSpan span("findPath");
+    const QueryCache::Key key{epoch, false, startId, endId};
+    PathResult result;
+    if (!queryCache->find(key, result)) {
+        result = searchPath(startId, endId);
+        queryCache->store(key, result);
+    }
+    return result;
+}
+
+PathResult PipelineCore::searchPath(int startId, int endId) const {
+    TraceSpan phase("resolve endpoints");
+    PathResult result;
+    if (network.empty()) {
+        result.status = PathStatus::EmptyNetwork;
+        return result;
+    }
+    if (getObjectInfo(startId).second == -1) {
+        result.status = PathStatus::StartNotFound;
+        return result;
+    }
+    if (getObjectInfo(endId).second == -1) {
+        result.status = PathStatus::EndNotFound;
+        return result;
+    }
+
+    // Тот же граф, что строит buildGraph, но в арене потока: все рабочие
+    // массивы запроса освобождаются разом при выходе
+    phase.next("index nodes");
+    ArenaScope scope;
+    Arena& arena = scope.arena();
+    ArenaIdIndex stationIndex = indexStations(arena, stations);
+    ArenaIdIndex nodeOf(arena, stations.size() + pipes.size());
+    int* nodeIds = arena.allocateArray<int>(stations.size() + pipes.size());
+    size_t nodeCount = 0;
+    for (const auto& station : stations) {
+        if (nodeOf.insert(station.id, static_cast<int>(nodeCount))) {
+            nodeIds[nodeCount++] = station.id;
+        }
+    }
+    // Трубы, соединенные с другой трубой, - тоже узлы
+    for (const auto& pipe : pipes) {
+        if (pipe.inUse && (stationIndex.find(pipe.startId) == -1 || stationIndex.find(pipe.endId) == -1) &&
+            nodeOf.insert(pipe.id, static_cast<int>(nodeCount))) {
+            nodeIds[nodeCount++] = pipe.id;
+        }
+    }
+    phase.next("build adjacency");
+    ArenaGraph graph(arena, stationIndex, nodeOf, nodeCount, network, pipes, false);
+
+    const int start = nodeOf.find(startId);
+    const int target = nodeOf.find(endId);
+    if (start == -1 || target == -1) {
+        result.status = PathStatus::NotInNetwork;
+        return result;
+    }
+
+    // BFS для поиска пути; parent -2 - узел не посещен
+    phase.next("BFS frontier expansion");
+    int* parent = arena.allocateArray<int>(nodeCount, -2);
+    int* parentPipe = arena.allocateArray<int>(nodeCount);
+    int* queue = arena.allocateArray<int>(nodeCount);
+    size_t head = 0;
+    size_t tail = 0;
+    queue[tail++] = start;
+    parent[start] = -1;
+
+    while (head < tail) {
+        int current = queue[head++];
+        if (current == target) {
+            break;
+        }
+        for (int arc = graph.firstArc[current]; arc < graph.firstArc[current + 1]; ++arc) {
+            int neighbor = graph.arcTarget[arc];
+            // Конец вне графа - тупик, он не ведет к цели
+            if (neighbor != -1 && parent[neighbor] == -2) {
+                parent[neighbor] = current;
+                parentPipe[neighbor] = graph.arcPipe[arc];
+                queue[tail++] = neighbor;
+            }
+        }
+    }
+
+    // Восстановление пути
+    phase.next("reconstruct path");
+    if (parent[target] == -2) {
+        result.status = PathStatus::NoPath;
+        return result;
+    }
+
+    for (int current = target; current != -1; current = parent[current]) {
+        result.nodes.push_back(nodeIds[current]);
+        if (current != start) {
+            result.pipeIds.push_back(parentPipe[current]);
+        }
+    }
+
+    reverse(result.nodes.begin(), result.nodes.end());
+    reverse(result.pipeIds.begin(), result.pipeIds.end());
+
+    for (int pipeId : result.pipeIds) {
+        int pipeIdx = findPipeIndexById(pipeId);
+        if (pipeIdx != -1) {
+            result.totalLength += pipes[pipeIdx].length;
+        }
+    }
+
+    result.status = PathStatus::Found;
+    return result;
+}
+
+RoutesResult PipelineCore::findAlternativeRoutes(int startId, int endId, size_t maxRoutes) const {
+    OperationTimer timer(Operation::AltRoutes);
+    TraceSpan span("findAlternativeRoutes");
+    RoutesResult result;
+    if (network.empty()) {
+        result.status = PathStatus::EmptyNetwork;
+        return result;
+    }
+    auto [isStartStation, startIndex] = getObjectInfo(startId);
+    auto [isEndStation, endIndex] = getObjectInfo(endId);
+    if (startIndex == -1) {
+        result.status = PathStatus::StartNotFound;
+        return result;
+    }
+    if (endIndex == -1) {
+        result.status = PathStatus::EndNotFound;
+        return result;
+    }
+
+    RouteGraph graph(network, pipes);
+    int64_t startNode = NetworkIslands::nodeIndex(startId, isStartStation);
+    int64_t endNode = NetworkIslands::nodeIndex(endId, isEndStation);
+    if (!graph.contains(startNode) || !graph.contains(endNode)) {
+        result.status = PathStatus::NotInNetwork;
+        return result;
+    }
+
+    result.routes = graph.kShortestPaths(startNode, endNode, maxRoutes);
+    result.status = result.routes.empty() ? PathStatus::NoPath : PathStatus::Found;
+    return result;
+}
+
+bool PipelineCore::sameIsland(int idA, int idB) const {
+    auto [isStationA, indexA] = getObjectInfo(idA);
+    auto [isStationB, indexB] = getObjectInfo(idB);
+    if (indexA == -1 || indexB == -1) {
+        return false;
+    }
+    return islands.sameIsland(idA, isStationA, idB, isStationB, network, pipes);
+}
+
+PersistentVector<Pipe>& PipelineCore::editPipes() {
+    epoch = nextEpoch();
+    return pipes;
+}
+
+PersistentVector<CompressorStation>& PipelineCore::editStations() {
+    epoch = nextEpoch();
+    return stations;
+}
+
+PersistentVector<NetworkConnection>& PipelineCore::editNetwork() {
+    // Копии, снятые до изменения, сохраняют свой кэш - он для них по-прежнему верен
+    reachability = make_shared<ReachabilityCache>();
+    epoch = nextEpoch();
+    return network;
+}
+
+shared_ptr<const ReachabilityIndex> PipelineCore::getReachabilityIndex() const {
+    promise<shared_ptr<const ReachabilityIndex>> built;
+    shared_future<shared_ptr<const ReachabilityIndex>> index;
+    bool builder = false;
+    {
+        lock_guard<mutex> lock(reachability->mutex);
+        if (!reachability->index.valid()) {
+            reachability->index = built.get_future().share();
+            builder = true;
+        }
+        index = reachability->index;
+    }
+    if (builder) {
+        TraceSpan span("build reachability index");
+        built.set_value(make_shared<const ReachabilityIndex>(network, pipes));
+    }
+    return index.get();
+}
+
+bool PipelineCore::canReach(int startId, int endId) const {
+    auto [isStartStation, startIndex] = getObjectInfo(startId);
+    auto [isEndStation, endIndex] = getObjectInfo(endId);
+    if (startIndex == -1 || endIndex == -1) {
+        return false;
+    }
+    return getReachabilityIndex()->canReach(NetworkIslands::nodeIndex(startId, isStartStation),
+                                            NetworkIslands::nodeIndex(endId, isEndStation));
+}
+
+vector<IslandSummary> PipelineCore::getIslands() const {
+    return islands.summarize(network, pipes);
+}
+
+FlowResult PipelineCore::solveFlow(const FlowSettings& settings) const {
+    return GasFlowSolver(network, pipes, stations, settings).solve();
+}
+
+NetworkPartition PipelineCore::partitionNetwork(size_t parts) const {
+    return ::partitionNetwork(network, pipes, parts);
+}
+
+TransientSimulator PipelineCore::createTransientSimulation(const TransientSettings& settings) const {
+    return TransientSimulator(network, pipes, stations, settings);
+}
+
+// Файлы
+
+MemoryReport PipelineCore::memoryReport() const {
+    const MemoryTracker& tracker = MemoryTracker::instance();
+    MemoryReport report;
+    for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); ++i) {
+        MemoryUsage usage;
+        usage.category = static_cast<MemoryCategory>(i);
+        usage.reserved = tracker.reserved(usage.category);
+        usage.peak = tracker.peak(usage.category);
+        switch (usage.category) {
+            case MemoryCategory::Pipes: usage.used = pipes.bytesUsed(); break;
+            case MemoryCategory::Stations: usage.used = stations.bytesUsed(); break;
+            case MemoryCategory::Network: usage.used = network.bytesUsed(); break;
+            case MemoryCategory::Names: usage.used = StringPool::bytesUsed(); break;
+            default: usage.used = usage.reserved; break;
+        }
+        report.totalUsed += usage.used;
+        report.entries.push_back(usage);
+    }
+    report.totalReserved = tracker.totalReserved();
+    report.totalPeak = tracker.totalPeak();
+    return report;
+}
+
+void PipelineCore::saveToStream(ostream& file, SaveFormat format, const SaveProgress& progress) const {
+    const size_t total = pipes.size() + stations.size() + (format != SaveFormat::Basic ? network.size() : 0);
+    const size_t progressStep = 4096;
+    size_t written = 0;
+    auto advance = [&](size_t count) {
+        if (progress && (written + count) / progressStep != written / progressStep) {
+            progress((written + count) / progressStep * progressStep, total);
+        }
+        written += count;
+    };
+
+    if (format == SaveFormat::Compact) {
+        writeCompactSnapshot(file, pipes, stations, network, nextPipeId, nextStationId);
+        if (progress) {
+            progress(total, total);
+        }
+        return;
+    }
+
+    file << "NEXT_PIPE_ID " << nextPipeId << '\n';
+    file << "NEXT_STATION_ID " << nextStationId << '\n';
+
+    file << "PIPES " << pipes.size() << '\n';
+    writeRecords(file, pipes, advance, [format](ostream& out, const Pipe& pipe) {
+        out << pipe.id << '\n' << pipe.name << '\n' << pipe.length << '\n'
+            << pipe.diameter << '\n' << pipe.underRepair << '\n';
+        if (format == SaveFormat::Network) {
+            out << pipe.inUse << '\n' << pipe.startId << '\n' << pipe.endId << '\n'
+                << pipe.startType << '\n' << pipe.endType << '\n';
+        }
+    });
+
+    file << "STATIONS " << stations.size() << '\n';
+    writeRecords(file, stations, advance, [](ostream& out, const CompressorStation& station) {
+        out << station.id << '\n' << station.name << '\n' << station.totalWorkshops << '\n'
+            << station.activeWorkshops << '\n' << station.stationClass << '\n';
+    });
+
+    if (format == SaveFormat::Network) {
+        // Формат прежний: концы соединения пишутся из его трубы
+        file << "NETWORK " << network.size() << '\n';
+        const PipeIndex pipeById(pipes);
+        writeRecords(file, network, advance, [&pipeById](ostream& out, const NetworkConnection& conn) {
+            const Pipe* pipe = pipeById.find(conn.pipeId);
+            out << conn.pipeId << '\n' << (pipe ? pipe->startId : 0) << '\n' << (pipe ? pipe->endId : 0) << '\n'
+                << (pipe ? pipe->startType : 0) << '\n' << (pipe ? pipe->endType : 0) << '\n';
+        });
+    }
+
+    if (progress) {
+        progress(total, total);
+    }
+}
+
+bool PipelineCore::saveToFile(const string& filename, SaveFormat format, const SaveProgress& progress) const {
+    OperationTimer timer(Operation::Save);
+    TraceSpan span("saveToFile");
+    return writeFileAtomically(filename, [&](ostream& file) {
+        saveToStream(file, format, progress);
+        return file.good();
+    });
+}
+
+bool PipelineCore::deferredLoadFailed() const {
+    return pipes.loadFailed() || network.loadFailed();
+}
+
+LoadStatus PipelineCore::loadFromFile(const string& filename, SaveFormat format, LoadMode mode) {
+    OperationTimer timer(Operation::Load);
+    TraceSpan span("loadFromFile");
+    TraceSpan phase("read file");
+    string contents;
+    if (!readWholeFile(filename, contents)) {
+        return LoadStatus::FileNotFound;
+    }
+    if (isCompactSnapshot(contents)) {
+        auto bytes = make_shared<const string>(move(contents));
+        SnapshotContents snapshot;
+        DeferredSections deferred;
+        phase.next("open snapshot");
+        if (mode == LoadMode::Lazy && openCompactSnapshot(bytes, snapshot, deferred)) {
+            phase.next("build sections");
+            editPipes() = PersistentVector<Pipe>::deferred(deferred.pipeCount, move(deferred.loadPipes));
+            editStations() = PersistentVector<CompressorStation>(snapshot.stations);
+            editNetwork() = PersistentVector<NetworkConnection>::deferred(deferred.connectionCount,
+                                                                          move(deferred.loadNetwork));
+            islands.clear();
+            nextPipeId = snapshot.nextPipeId;
+            nextStationId = snapshot.nextStationId;
+            return LoadStatus::Ok;
+        }
+        phase.next("decode snapshot");
+        if (!readCompactSnapshot(*bytes, snapshot)) {
+            return LoadStatus::BadFormat;
+        }
+        phase.next("build sections");
+        editPipes() = PersistentVector<Pipe>(snapshot.pipes);
+        editStations() = PersistentVector<CompressorStation>(snapshot.stations);
+        editNetwork() = PersistentVector<NetworkConnection>(snapshot.network);
+        phase.next("rebuild islands");
+        islands.rebuild(network, pipes);
+        nextPipeId = snapshot.nextPipeId;
+        nextStationId = snapshot.nextStationId;
+        return LoadStatus::Ok;
+    }
+    phase.next("split lines");
+    SavedLines lines(move(contents));
+
+    // Разбор идет во временные векторы, чтобы ошибка формата не портила текущие данные.
+    // Записи занимают фиксированное число строк, поэтому границы секций известны
+    // заранее и секции (и куски внутри них) разбираются параллельно.
+    int loadedNextPipeId = 1;
+    int loadedNextStationId = 1;
+    size_t line = 0;
+    if (lines.size() > 0 && lines.startsWith(0, "NEXT_PIPE_ID")) {
+        if (lines.size() < 2 || !lines.header(0, "NEXT_PIPE_ID", loadedNextPipeId) ||
+            !lines.header(1, "NEXT_STATION_ID", loadedNextStationId)) {
+            return LoadStatus::BadFormat;
+        }
+        line = 2;
+    }
+
+    const size_t pipeLines = format == SaveFormat::Network ? 10 : 5;
+    int pipeCount = 0;
+    if (!lines.header(line, "PIPES", pipeCount) || pipeCount < 0 ||
+        lines.size() - line - 1 < static_cast<size_t>(pipeCount) * pipeLines) {
+        return LoadStatus::BadFormat;
+    }
+    const size_t pipesLine = line + 1;
+    line = pipesLine + pipeCount * pipeLines;
+
+    int stationCount = 0;
+    if (!lines.header(line, "STATIONS", stationCount) || stationCount < 0 ||
+        lines.size() - line - 1 < static_cast<size_t>(stationCount) * 5) {
+        return LoadStatus::BadFormat;
+    }
+    const size_t stationsLine = line + 1;
+    line = stationsLine + stationCount * 5;
+
+    // Сеть необязательна: другой заголовок после КС не считается ошибкой
+    int connectionCount = 0;
+    const size_t networkLine = line + 1;
+    if (format == SaveFormat::Network && line < lines.size() && lines.startsWith(line, "NETWORK")) {
+        if (!lines.header(line, "NETWORK", connectionCount) || connectionCount < 0 ||
+            lines.size() - networkLine < static_cast<size_t>(connectionCount) * 5) {
+            return LoadStatus::BadFormat;
+        }
+    }
+
+    phase.next("parse sections");
+    vector<Pipe> loadedPipes(pipeCount);
+    vector<CompressorStation> loadedStations(stationCount);
+    vector<ConnectionRecord> loadedNetwork(connectionCount);
+    atomic<bool> failed{false};
+    PersistentVector<Pipe> builtPipes;
+    PersistentVector<CompressorStation> builtStations;
+    PersistentVector<NetworkConnection> builtNetwork;
+    NetworkIslands builtIslands;
+
+    // Секции разбираются независимо; вектор секции строится сразу после ее
+    // разбора, не дожидаясь остальных, а острова - когда готовы трубы и сеть
+    TaskGraph sections;
+    const size_t parsePipes = sections.add([&]() {
+        parallelFor(0, loadedPipes.size(), LOAD_GRAIN, [&](size_t first, size_t last) {
+            TraceSpan chunk("parse pipes");
+            for (size_t i = first; i < last && !failed; ++i) {
+                const size_t at = pipesLine + i * pipeLines;
+                Pipe& pipe = loadedPipes[i];
+                // Флаги и типы - битовые поля, читаются через локальные переменные
+                bool underRepair = false;
+                bool inUse = false;
+                ConnectionType startType = STATION_TO_STATION;
+                ConnectionType endType = STATION_TO_STATION;
+                bool ok = lines.field(at, pipe.id) && lines.field(at + 2, pipe.length) &&
+                          lines.field(at + 3, pipe.diameter) && lines.field(at + 4, underRepair) &&
+                          pipe.name.assign(lines[at + 1]);
+                if (format == SaveFormat::Network) {
+                    ok = ok && lines.field(at + 5, inUse) && lines.field(at + 6, pipe.startId) &&
+                         lines.field(at + 7, pipe.endId) && lines.field(at + 8, startType) &&
+                         lines.field(at + 9, endType);
+                } else {
+                    pipe.startId = 0;
+                    pipe.endId = 0;
+                }
+                pipe.underRepair = underRepair;
+                pipe.inUse = inUse;
+                pipe.startType = startType;
+                pipe.endType = endType;
+                if (!ok) {
+                    failed = true;
+                }
+            }
+        });
+    });
+    const size_t parseStations = sections.add([&]() {
+        parallelFor(0, loadedStations.size(), LOAD_GRAIN, [&](size_t first, size_t last) {
+            TraceSpan chunk("parse stations");
+            for (size_t i = first; i < last && !failed; ++i) {
+                const size_t at = stationsLine + i * 5;
+                CompressorStation& station = loadedStations[i];
+                if (!station.name.assign(lines[at + 1]) || !lines.field(at, station.id) || !lines.field(at + 2, station.totalWorkshops) ||
+                    !lines.field(at + 3, station.activeWorkshops) || !lines.field(at + 4, station.stationClass)) {
+                    failed = true;
+                }
+                if (station.activeWorkshops > station.totalWorkshops) {
+                    station.activeWorkshops = station.totalWorkshops;
+                }
+            }
+        });
+    });
+    const size_t parseNetwork = sections.add([&]() {
+        parallelFor(0, loadedNetwork.size(), LOAD_GRAIN, [&](size_t first, size_t last) {
+            TraceSpan chunk("parse network");
+            for (size_t i = first; i < last && !failed; ++i) {
+                const size_t at = networkLine + i * 5;
+                ConnectionRecord& conn = loadedNetwork[i];
+                if (!lines.field(at, conn.pipeId) || !lines.field(at + 1, conn.startId) ||
+                    !lines.field(at + 2, conn.endId) || !lines.field(at + 3, conn.startType) ||
+                    !lines.field(at + 4, conn.endType)) {
+                    failed = true;
+                }
+            }
+        });
+    });
+    // После ошибки формата строить уже нечего
+    const size_t buildPipes = sections.add([&]() {
+        if (!failed) {
+            TraceSpan span("build pipes");
+            builtPipes = PersistentVector<Pipe>(loadedPipes);
+        }
+    });
+    const size_t buildStations = sections.add([&]() {
+        if (!failed) {
+            TraceSpan span("build stations");
+            builtStations = PersistentVector<CompressorStation>(loadedStations);
+        }
+    });
+    // Концы соединений хранит труба: записанные в файле лишь сверяются с ней
+    const size_t buildNetwork = sections.add([&]() {
+        if (failed) {
+            return;
+        }
+        TraceSpan span("build network");
+        const PipeIndex pipeById(loadedPipes);
+        vector<NetworkConnection> connections;
+        connections.reserve(loadedNetwork.size());
+        for (const auto& record : loadedNetwork) {
+            if (!pipeById.connects(record)) {
+                failed = true;
+                return;
+            }
+            connections.push_back({record.pipeId});
+        }
+        builtNetwork = PersistentVector<NetworkConnection>(connections);
+    });
+    const size_t buildIslands = sections.add([&]() {
+        if (!failed) {
+            TraceSpan span("rebuild islands");
+            builtIslands.rebuild(builtNetwork, builtPipes);
+        }
+    });
+    sections.precede(parsePipes, buildPipes);
+    sections.precede(parseStations, buildStations);
+    sections.precede(parseNetwork, buildNetwork);
+    sections.precede(parsePipes, buildNetwork);
+    sections.precede(buildPipes, buildIslands);
+    sections.precede(buildNetwork, buildIslands);
+    sections.run();
+    if (failed) {
+        return LoadStatus::BadFormat;
+    }
+
+    editPipes() = move(builtPipes);
+    editStations() = move(builtStations);
+    editNetwork() = move(builtNetwork);
+    islands = move(builtIslands);
+    nextPipeId = loadedNextPipeId;
+    nextStationId = loadedNextStationId;
+    return LoadStatus::Ok;
+}
+
+bool PipelineCore::exportNetwork(const string& filename, ExportFormat format) const {
+    return writeFileAtomically(filename, [&](ostream& file) {
+        ::exportNetwork(file, format, pipes, stations, network);
+        return file.good();
+    });
+}
+
+DiffSummary PipelineCore::diff(const PipelineCore& target, const ChangeSink& sink) const {
+    return diffNetworks(pipes, stations, network, target.pipes, target.stations, target.network, sink);
+}
+
+bool PipelineCore::savePatch(const PipelineCore& target, const string& filename, DiffSummary& summary) const {
+    return writeFileAtomically(filename, [&](ostream& file) {
+        writePatchHeader(file, target.nextPipeId, target.nextStationId);
+        summary = diff(target, [&file](const NetworkChange& change) { writePatchLine(file, change); });
+        return file.good();
+    });
+}
+
+PatchStatus PipelineCore::applyPatch(const string& filename) {
+    string contents;
+    if (!readWholeFile(filename, contents)) {
+        return PatchStatus::FileNotFound;
+    }
+    NetworkPatch patch;
+    if (!readPatch(contents, patch)) {
+        return patch.namesExhausted ? PatchStatus::NamesExhausted : PatchStatus::BadFormat;
+    }
+
+    vector<Pipe> patchedPipes;
+    vector<CompressorStation> patchedStations;
+    vector<NetworkConnection> patchedNetwork;
+    if (!patchRecords(pipes, patch.removedPipes, patch.modifiedPipes, patch.addedPipes, patch.addedPipesAt,
+                      patchedPipes) ||
+        !patchRecords(stations, patch.removedStations, patch.modifiedStations, patch.addedStations,
+                      patch.addedStationsAt, patchedStations) ||
+        !patchConnections(network, pipes, patch.removedConnections, patch.removedConnectionsAt,
+                          patch.addedConnections, patch.addedConnectionsAt, patchedPipes, patchedNetwork)) {
+        return PatchStatus::Conflict;
+    }
+
+    editPipes() = PersistentVector<Pipe>(patchedPipes);
+    editStations() = PersistentVector<CompressorStation>(patchedStations);
+    editNetwork() = PersistentVector<NetworkConnection>(patchedNetwork);
+    islands.rebuild(network, pipes);
+    nextPipeId = patch.nextPipeId;
+    nextStationId = patch.nextStationId;
+    return PatchStatus::Ok;
+}
+
+bool PipelineCore::sharesStateWith(const PipelineCore& other) const {
+    return pipes.sharesStateWith(other.pipes) && stations.sharesStateWith(other.stations) &&
+           network.sharesStateWith(other.network) && nextPipeId == other.nextPipeId &&
+           nextStationId == other.nextStationId;
+}
+
+void PipelineCore::clear() {
+    editPipes().clear();
+    editStations().clear();
+    editNetwork().clear();
+    islands.clear();
+    nextPipeId = 1;
+    nextStationId = 1;
+}
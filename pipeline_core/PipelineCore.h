@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GasFlowSolver.h"
+#include "GraphPartitioner.h"
+#include "MemoryAccounting.h"
+#include "NetworkDiff.h"
+#include "NetworkExport.h"
+#include "NetworkIslands.h"
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+#include "ReachabilityIndex.h"
+#include "RouteSearch.h"
+#include "TransientSimulator.h"
+
+// Результат проверки/создания соединения
+enum class ConnectStatus {
+    Ok,
+    SameObject,        // попытка соединить объект с самим собой
+    StartNotFound,
+    EndNotFound,
+    StartUnderRepair,
+    EndUnderRepair,
+    AlreadyExists,     // такое соединение уже есть
+    DiameterMismatch,  // диаметры соединяемых труб не совпадают
+    NoFreePipe         // нет свободной трубы нужного диаметра
+};
+
+struct ConnectResult {
+    ConnectStatus status = ConnectStatus::Ok;
+    int pipeId = 0;           // труба, через которую выполнено соединение
+    bool createdPipe = false; // true - труба создана специально для соединения
+};
+
+enum class RemoveStatus {
+    Ok,
+    NotFound,
+    InUse,        // труба используется в сети
+    NotConnected  // труба не подключена к сети
+};
+
+enum class PathStatus {
+    Found,
+    EmptyNetwork,
+    StartNotFound,
+    EndNotFound,
+    NotInNetwork,  // одна из точек не подключена к сети
+    NoPath
+};
+
+struct PathResult {
+    PathStatus status = PathStatus::NoPath;
+    std::vector<int> nodes;    // ID объектов на пути от начала к концу
+    std::vector<int> pipeIds;  // трубы, по которым проходит путь
+    double totalLength = 0.0;
+};
+
+// Несколько маршрутов от кратчайшего к длинному (Route - из RouteSearch.h)
+struct RoutesResult {
+    PathStatus status = PathStatus::NoPath;
+    std::vector<Route> routes;
+};
+
+struct TopoSortResult {
+    bool hasCycle = false;
+    std::vector<int> order;           // ID КС в топологическом порядке
+    std::vector<int> cyclicStations;  // КС, не вошедшие в порядок из-за циклов
+};
+
+// Состояние кэша результатов findPath и topologicalSort (общего для копий ядра)
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;  // вытеснено при нехватке места
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t capacityBytes = 0;
+};
+
+struct NetworkStats {
+    size_t connections = 0;
+    size_t connectedStations = 0;
+    size_t connectedPipes = 0;
+};
+
+enum class LoadStatus {
+    Ok,
+    FileNotFound,
+    BadFormat  // в том числе названия, которым не хватило места в пуле строк
+};
+
+// Формат файла сохранения
+enum class SaveFormat {
+    Network,  // полный формат: трубы с данными о подключении и секция NETWORK
+    Basic,    // только трубы и КС (формат govorukhina_lab3)
+    Compact   // двоичный поколоночный снимок (CompactSnapshot.h); загрузка распознает его сама
+};
+
+// Режим загрузки снимка (CompactSnapshot.h); текстовые файлы всегда читаются целиком
+enum class LoadMode {
+    Full,
+    Lazy  // КС - сразу, трубы и соединения - при первом обращении к ним
+};
+
+using SaveProgress = std::function<void(size_t written, size_t total)>;
+
+enum class PatchStatus {
+    Ok,
+    FileNotFound,
+    BadFormat,
+    Conflict,  // патч не подходит к текущему состоянию - ничего не изменено
+    NamesExhausted  // в пуле строк нет места для новых названий - ничего не изменено
+};
+
+// Таблица для массового импорта из CSV. Первая строка - заголовок с именами
+// столбцов (регистр не важен, лишние столбцы пропускаются, порядок любой):
+//   Pipes:       name, length, diameter[, repair]
+//   Stations:    name, workshops, active, class
+//   Connections: start, end, diameter[, name, length] - название и длина
+//                нужны, чтобы создать трубу, если свободной нет
+// Разделитель - запятая или точка с запятой (тогда допускается десятичная
+// запятая). Поля в двойных кавычках могут содержать разделитель.
+enum class CsvTable {
+    Pipes,
+    Stations,
+    Connections
+};
+
+enum class CsvImportStatus {
+    Ok,            // файл разобран; отдельные строки могли быть отклонены
+    FileNotFound,
+    BadHeader      // нет обязательного столбца - ничего не импортировано
+};
+
+// Причина отказа в строке; правила те же, что при вводе с клавиатуры
+enum class CsvRowProblem {
+    MissingField,  // в строке нет обязательного поля
+    BadNumber,
+    EmptyName,
+    BadLength,     // длина меньше 0.001 км
+    BadDiameter,   // диаметр не из allowedDiameters
+    BadWorkshops,  // цехов меньше 1 или работающих больше, чем всего
+    BadClass,      // класс меньше 1
+    BadFlag,       // ремонт - не 0/1/true/false
+    NamesExhausted,  // в пуле строк нет места для нового названия
+    Connect        // соединение отклонено, причина в connectStatus
+};
+
+struct CsvRowError {
+    size_t line = 0;  // номер строки файла, с 1
+    CsvRowProblem problem = CsvRowProblem::BadNumber;
+    ConnectStatus connectStatus = ConnectStatus::Ok;
+};
+
+struct CsvImportReport {
+    CsvImportStatus status = CsvImportStatus::Ok;
+    size_t imported = 0;
+    size_t rejected = 0;
+    std::vector<CsvRowError> errors;  // первые отклоненные строки (не больше 1000)
+};
+
+// Ядро системы управления трубопроводом без консольного ввода-вывода.
+// Все операции принимают аргументы и возвращают результат, поэтому ядро
+// можно встраивать в другие программы; консольные меню - лишь оболочки над ним.
+// Данные хранятся в PersistentVector, поэтому копия PipelineCore - это
+// согласованный снимок, который создается за O(1) и разделяет память с оригиналом.
+class PipelineCore {
+private:
+    PersistentVector<Pipe> pipes;
+    PersistentVector<CompressorStation> stations;
+    PersistentVector<NetworkConnection> network;
+    NetworkIslands islands;  // обновляется при соединении, разрыве и ремонте труб
+    int nextPipeId = 1;
+    int nextStationId = 1;
+
+    // Индекс достижимости строится лениво при первом запросе.
+    // Копии разделяют кэш, пока не изменят сеть. Мьютекс охраняет только
+    // публикацию: первый запрос строит индекс без блокировки, а запросы из
+    // других потоков ждут того же результата, не строя свой.
+    struct ReachabilityCache {
+        std::mutex mutex;
+        std::shared_future<std::shared_ptr<const ReachabilityIndex>> index;
+    };
+    std::shared_ptr<ReachabilityCache> reachability = std::make_shared<ReachabilityCache>();
+
+    // Эпоха изменений: каждое изменение труб, КС или сети получает новый
+    // номер, единый для процесса, поэтому равные эпохи - одно и то же
+    // состояние. Результаты запросов кэшируются по эпохе и параметрам и
+    // разделяются всеми копиями ядра: после отмены действия снова
+    // подходят результаты, посчитанные для прежней эпохи.
+    uint64_t epoch = 0;
+    struct QueryCache;
+    std::shared_ptr<QueryCache> queryCache = newQueryCache();
+
+    static std::shared_ptr<QueryCache> newQueryCache();
+
+    static std::string toLower(const std::string& str);
+    static ConnectionType determineConnectionType(bool isStartStation, bool isEndStation);
+
+    void attachPipe(int pipeIndex, int startId, int endId, bool isStartStation, bool isEndStation);
+    // Сами запросы, без кэша
+    TopoSortResult sortStations() const;
+    PathResult searchPath(int startId, int endId) const;
+    // Все изменения идут через эти методы: они начинают новую эпоху,
+    // а editNetwork еще и сбрасывает кэш достижимости
+    PersistentVector<Pipe>& editPipes();
+    PersistentVector<CompressorStation>& editStations();
+    PersistentVector<NetworkConnection>& editNetwork();
+
+public:
+    // Доступ к данным
+    const PersistentVector<Pipe>& getPipes() const { return pipes; }
+    const PersistentVector<CompressorStation>& getStations() const { return stations; }
+    const PersistentVector<NetworkConnection>& getNetwork() const { return network; }
+    int getNextPipeId() const { return nextPipeId; }
+    int getNextStationId() const { return nextStationId; }
+
+    // true, если other - копия этого состояния без последующих изменений
+    bool sharesStateWith(const PipelineCore& other) const;
+
+    int findPipeIndexById(int id) const;
+    int findStationIndexById(int id) const;
+    std::vector<int> getPipeIds() const;
+    std::vector<int> getStationIds() const;
+
+    // Получение типа объекта по ID: (true - КС / false - труба, индекс или -1)
+    std::pair<bool, int> getObjectInfo(int id) const;
+
+    static const std::vector<int>& allowedDiameters();
+    static bool isAllowedDiameter(int diameter);
+    static double calculateInactivePercent(const CompressorStation& station);
+
+    // Трубы
+    int addPipe(const std::string& name, double length, int diameter);
+    RemoveStatus removePipe(int id);
+    bool setPipeRepair(int id, bool underRepair);
+    bool updatePipe(int id, const std::string& name, double length);
+    bool setPipeDiameter(int id, int diameter);  // false, если труба в сети
+
+    // КС
+    int addStation(const std::string& name, int totalWorkshops, int activeWorkshops, int stationClass);
+    bool removeStation(int id);  // вместе со всеми соединениями КС
+    bool startWorkshop(int id);
+    bool stopWorkshop(int id);
+    bool updateStation(int id, const std::string& name, int totalWorkshops, int stationClass);
+
+    // Поиск (возвращают индексы в getPipes()/getStations())
+    std::vector<int> findPipesByName(const std::string& searchName) const;
+    std::vector<int> findPipesByRepairStatus(bool repairStatus) const;
+    std::vector<int> findPipesByUseStatus(bool useStatus) const;
+    std::vector<int> findStationsByName(const std::string& searchName) const;
+    // comparisonType: 1 - больше, 2 - меньше, 3 - равно
+    std::vector<int> findStationsByInactivePercent(double targetPercent, int comparisonType) const;
+
+    // Сеть
+    int findAvailablePipeByDiameter(int diameter) const;
+    ConnectStatus canConnectObjects(int startId, int endId, int diameter) const;
+    // Соединение свободной трубой нужного диаметра (NoFreePipe, если такой нет)
+    ConnectResult connectObjects(int startId, int endId, int diameter);
+    // Соединение новой трубой, созданной специально для него
+    ConnectResult connectWithNewPipe(int startId, int endId, int diameter,
+                                     const std::string& name, double length);
+    RemoveStatus disconnectPipe(int pipeId);
+
+    std::map<int, GraphNode> buildGraph() const;
+    NetworkStats getNetworkStats() const;
+    // Повторные запросы без изменений между ними отвечаются из кэша
+    TopoSortResult topologicalSort() const;
+    PathResult findPath(int startId, int endId) const;
+    // До maxRoutes кратчайших по длине труб маршрутов без повторов узлов,
+    // в обход труб в ремонте. Статусы - как у findPath.
+    RoutesResult findAlternativeRoutes(int startId, int endId, size_t maxRoutes) const;
+
+    // Острова (подсети, связные по трубам не в ремонте). ID разрешаются так же, как в getObjectInfo.
+    bool sameIsland(int idA, int idB) const;
+    std::vector<IslandSummary> getIslands() const;
+
+    // Дойдет ли газ из startId в endId по направлению соединений (проверка бита в индексе).
+    // ID разрешаются так же, как в getObjectInfo; ненайденные объекты недостижимы.
+    bool canReach(int startId, int endId) const;
+    std::shared_ptr<const ReachabilityIndex> getReachabilityIndex() const;
+
+    // Установившийся режим течения газа: давления в узлах и расходы по трубам
+    FlowResult solveFlow(const FlowSettings& settings = {}) const;
+    // Разбиение сети на parts связных областей равного размера с малым числом труб между ними
+    NetworkPartition partitionNetwork(size_t parts) const;
+    // Модель переходного режима, начинающаяся с установившегося режима текущей сети
+    TransientSimulator createTransientSimulation(const TransientSettings& settings = {}) const;
+
+    // Память по структурам: used - данные этого состояния (для островов,
+    // индексов и арен - то же, что reserved), reserved и peak - из
+    // MemoryTracker по всему процессу, включая снимки и историю отмены.
+    // Объекты не обходятся, отчет строится за O(число структур).
+    MemoryReport memoryReport() const;
+
+    QueryCacheStats getQueryCacheStats() const;
+    // Очистка кэша запросов и его счетчиков; результаты запросов не меняются
+    void clearQueryCache() const;
+
+    // Файлы. Сохранение атомарное: при сбое прежний файл не повреждается.
+    // progress(записано, всего) вызывается периодически по ходу записи.
+    void saveToStream(std::ostream& file, SaveFormat format = SaveFormat::Network,
+                      const SaveProgress& progress = {}) const;
+    bool saveToFile(const std::string& filename, SaveFormat format = SaveFormat::Network,
+                    const SaveProgress& progress = {}) const;
+    // В ленивом режиме размеры секций известны сразу, а острова строятся при
+    // первом изменении сети (до того запросы о них считают острова по сети).
+    // Снимок без каталога контрольных сумм загружается целиком.
+    LoadStatus loadFromFile(const std::string& filename, SaveFormat format = SaveFormat::Network,
+                            LoadMode mode = LoadMode::Full);
+    // Отложенная секция ленивой загрузки при разборе оказалась поврежденной и
+    // осталась пустой. Загрузку не вызывает: секции, к которым еще не
+    // обращались, поврежденными не считаются.
+    bool deferredLoadFailed() const;
+    // Массовый импорт: корректные строки добавляются, ошибочные попадают в отчет.
+    // Соединения проверяются по тем же правилам, что и в connectObjects.
+    CsvImportReport importCsv(const std::string& filename, CsvTable table);
+    // Выгрузка сети в DOT/GraphML для внешних программ (тоже атомарная)
+    bool exportNetwork(const std::string& filename, ExportFormat format) const;
+
+    // Различия между этим состоянием и target (см. diffNetworks)
+    DiffSummary diff(const PipelineCore& target, const ChangeSink& sink = {}) const;
+    // Патч, превращающий это состояние в target; запись атомарная
+    bool savePatch(const PipelineCore& target, const std::string& filename, DiffSummary& summary) const;
+    // Применение патча целиком или никак: удаленные и измененные записи должны
+    // существовать, добавленные - отсутствовать (кроме перенесенных: они
+    // удаляются и добавляются в том же патче). Сохранившиеся записи идут в
+    // прежнем порядке, добавленные встают на места из патча, так что
+    // состояние совпадает с target вместе с порядком записей.
+    PatchStatus applyPatch(const std::string& filename);
+    void clear();
+};
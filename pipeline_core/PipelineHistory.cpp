@@ -0,0 +1,44 @@
+#include "PipelineHistory.h"
+
+#include <utility>
+
+using namespace std;
+
+bool PipelineHistory::commit(const PipelineCore& before, const PipelineCore& after) {
+    if (before.sharesStateWith(after)) {
+        return false;
+    }
+
+    undoStack.push_back(before);
+    if (undoStack.size() > limit) {
+        undoStack.pop_front();
+    }
+    // Новое изменение делает отмененную ветку недостижимой
+    redoStack.clear();
+    return true;
+}
+
+bool PipelineHistory::undo(PipelineCore& current) {
+    if (undoStack.empty()) {
+        return false;
+    }
+    redoStack.push_back(move(current));
+    current = move(undoStack.back());
+    undoStack.pop_back();
+    return true;
+}
+
+bool PipelineHistory::redo(PipelineCore& current) {
+    if (redoStack.empty()) {
+        return false;
+    }
+    undoStack.push_back(move(current));
+    current = move(redoStack.back());
+    redoStack.pop_back();
+    return true;
+}
+
+void PipelineHistory::clear() {
+    undoStack.clear();
+    redoStack.clear();
+}
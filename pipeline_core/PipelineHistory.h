@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+
+#include "PipelineCore.h"
+
+// История изменений для отмены и повтора действий.
+// Хранит предыдущие версии PipelineCore целиком; благодаря разделению структуры
+// каждая версия занимает память только под реально измененные блоки,
+// а шаг отмены или повтора - это обмен снимками за O(1).
+class PipelineHistory {
+private:
+    std::deque<PipelineCore> undoStack;
+    std::deque<PipelineCore> redoStack;
+    size_t limit;
+
+public:
+    explicit PipelineHistory(size_t limit = 100) : limit(limit) {}
+
+    // Фиксирует операцию: before - снимок до нее, after - текущее состояние.
+    // Если состояние не изменилось, запись не создается.
+    bool commit(const PipelineCore& before, const PipelineCore& after);
+
+    bool undo(PipelineCore& current);
+    bool redo(PipelineCore& current);
+
+    bool canUndo() const { return !undoStack.empty(); }
+    bool canRedo() const { return !redoStack.empty(); }
+    size_t undoDepth() const { return undoStack.size(); }
+    size_t redoDepth() const { return redoStack.size(); }
+    void clear();
+};
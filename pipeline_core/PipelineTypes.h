@@ -0,0 +1,127 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MemoryAccounting.h"
+#include "StringPool.h"
+
+// Перечисление для типов соединений
+enum ConnectionType {
+    STATION_TO_STATION,
+    STATION_TO_PIPE,
+    PIPE_TO_STATION,
+    PIPE_TO_PIPE
+};
+
+// Оператор вывода для ConnectionType
+inline std::ostream& operator<<(std::ostream& os, const ConnectionType& type) {
+    switch (type) {
+        case STATION_TO_STATION: os << "0"; break;
+        case STATION_TO_PIPE: os << "1"; break;
+        case PIPE_TO_STATION: os << "2"; break;
+        case PIPE_TO_PIPE: os << "3"; break;
+    }
+    return os;
+}
+
+// Тип соединения по сохраненному числу; неизвестное число - STATION_TO_STATION
+inline ConnectionType toConnectionType(int value) {
+    switch (value) {
+        case 1: return STATION_TO_PIPE;
+        case 2: return PIPE_TO_STATION;
+        case 3: return PIPE_TO_PIPE;
+        default: return STATION_TO_STATION;
+    }
+}
+
+// Оператор ввода для ConnectionType
+inline std::istream& operator>>(std::istream& is, ConnectionType& type) {
+    int value;
+    is >> value;
+    type = toConnectionType(value);
+    return is;
+}
+
+// Является ли начало/конец соединения данного типа станцией
+inline bool startsAtStation(ConnectionType type) {
+    return type == STATION_TO_STATION || type == STATION_TO_PIPE;
+}
+
+inline bool endsAtStation(ConnectionType type) {
+    return type == STATION_TO_STATION || type == PIPE_TO_STATION;
+}
+
+// Записи хранятся плотно: название - номер в общем пуле строк, флаги и
+// типы соединений - битовые поля (тип занимает 2 бита). Порядок полей
+// подобран без дыр выравнивания.
+struct Pipe {
+    int id;
+    InternedName name;
+    double length;
+    int diameter;
+    int startId;  // ID начальной точки (КС или трубы)
+    int endId;   // ID конечной точки (КС или трубы)
+    bool underRepair : 1;
+    bool inUse : 1;  // используется ли в сети
+    ConnectionType startType : 2;  // тип начальной точки
+    ConnectionType endType : 2;    // тип конечной точки
+};
+
+struct CompressorStation {
+    int id;
+    InternedName name;
+    int totalWorkshops;
+    int activeWorkshops;
+    int stationClass;
+};
+
+// Концы трубы в сети. Тип соединения целиком хранится в startType
+// (endType - его копия), поэтому оба конца определяются по нему.
+inline bool startIsStation(const Pipe& pipe) {
+    return startsAtStation(pipe.startType);
+}
+
+inline bool endIsStation(const Pipe& pipe) {
+    return endsAtStation(pipe.startType);
+}
+
+// Соединение сети - труба в порядке подключения. Концы и типы хранит
+// только Pipe (PipeIndex.h находит трубу по ID), поэтому копии не расходятся.
+struct NetworkConnection {
+    int pipeId;
+};
+
+// Соединение в сохраненном виде (текстовый файл, снимок, патч): форматы
+// хранят и концы, при чтении они сверяются с трубой (PipeIndex::connects)
+struct ConnectionRecord {
+    int pipeId = 0;
+    int startId = 0;
+    int endId = 0;
+    ConnectionType startType = STATION_TO_STATION;
+    ConnectionType endType = STATION_TO_STATION;
+};
+
+template <>
+struct MemoryCategoryOf<Pipe> {
+    static constexpr MemoryCategory value = MemoryCategory::Pipes;
+};
+
+template <>
+struct MemoryCategoryOf<CompressorStation> {
+    static constexpr MemoryCategory value = MemoryCategory::Stations;
+};
+
+template <>
+struct MemoryCategoryOf<NetworkConnection> {
+    static constexpr MemoryCategory value = MemoryCategory::Network;
+};
+
+// Структура для графа
+struct GraphNode {
+    int id;
+    bool isStation;  // true - КС, false - труба
+    std::vector<std::pair<int, int>> connections; // пары (id соседа, id трубы)
+};
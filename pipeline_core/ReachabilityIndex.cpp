@@ -0,0 +1,187 @@
+#include "ReachabilityIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "NetworkIslands.h"
+#include "PipeIndex.h"
+
+using namespace std;
+
+ReachabilityIndex::ReachabilityIndex(const PersistentVector<NetworkConnection>& network,
+                                     const PersistentVector<Pipe>& pipes)
+    : source(network) {
+    // Плотная нумерация узлов сети
+    unordered_map<int64_t, int> localIndex;
+    vector<pair<int, int>> arcs;
+    arcs.reserve(network.size());
+    auto localOf = [&localIndex](int64_t node) {
+        return localIndex.emplace(node, static_cast<int>(localIndex.size())).first->second;
+    };
+    PipeIndex pipeById(pipes);
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        int from = localOf(NetworkIslands::nodeIndex(pipe->startId, startIsStation(*pipe)));
+        int to = localOf(NetworkIslands::nodeIndex(pipe->endId, endIsStation(*pipe)));
+        arcs.push_back({from, to});
+    }
+    const int nodeCount = static_cast<int>(localIndex.size());
+
+    // Списки смежности в сжатом виде (CSR)
+    vector<int> firstArc(nodeCount + 1, 0);
+    for (const auto& arc : arcs) {
+        firstArc[arc.first + 1]++;
+    }
+    for (int i = 0; i < nodeCount; ++i) {
+        firstArc[i + 1] += firstArc[i];
+    }
+    vector<int> targets(arcs.size());
+    vector<int> fill(firstArc.begin(), firstArc.end() - 1);
+    for (const auto& arc : arcs) {
+        targets[fill[arc.first]++] = arc.second;
+    }
+
+    // Тарьян без рекурсии. Компоненты получают номера в обратном
+    // топологическом порядке: преемники нумеруются раньше.
+    const int unvisited = -1;
+    vector<int> order(nodeCount, unvisited);
+    vector<int> lowLink(nodeCount, 0);
+    vector<int> component(nodeCount, unvisited);
+    vector<int> stack;
+    vector<pair<int, int>> callStack;  // (узел, следующая дуга)
+    int counter = 0;
+    int components = 0;
+
+    for (int root = 0; root < nodeCount; ++root) {
+        if (order[root] != unvisited) {
+            continue;
+        }
+        callStack.push_back({root, firstArc[root]});
+        order[root] = lowLink[root] = counter++;
+        stack.push_back(root);
+
+        while (!callStack.empty()) {
+            auto& [node, next] = callStack.back();
+            if (next < firstArc[node + 1]) {
+                int target = targets[next++];
+                if (order[target] == unvisited) {
+                    order[target] = lowLink[target] = counter++;
+                    stack.push_back(target);
+                    callStack.push_back({target, firstArc[target]});
+                } else if (component[target] == unvisited) {
+                    lowLink[node] = min(lowLink[node], order[target]);
+                }
+                continue;
+            }
+
+            int finished = node;
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                int parent = callStack.back().first;
+                lowLink[parent] = min(lowLink[parent], lowLink[finished]);
+            }
+            if (lowLink[finished] == order[finished]) {
+                int member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    component[member] = components;
+                } while (member != finished);
+                components++;
+            }
+        }
+    }
+
+    componentCount = components;
+
+    // Дуги между компонентами без повторов
+    vector<pair<int, int>> componentArcs;
+    for (const auto& arc : arcs) {
+        int from = component[arc.first];
+        int to = component[arc.second];
+        if (from != to) {
+            componentArcs.push_back({from, to});
+        }
+    }
+    sort(componentArcs.begin(), componentArcs.end());
+    componentArcs.erase(unique(componentArcs.begin(), componentArcs.end()), componentArcs.end());
+    successorStart.assign(componentCount + 1, 0);
+    successors.reserve(componentArcs.size());
+    for (const auto& [from, to] : componentArcs) {
+        successorStart[from + 1]++;
+        successors.push_back(to);
+    }
+    for (size_t c = 0; c < componentCount; ++c) {
+        successorStart[c + 1] += successorStart[c];
+    }
+
+    componentOfNode.reserve(localIndex.size());
+    for (const auto& [node, local] : localIndex) {
+        componentOfNode[node] = component[local];
+    }
+    if (componentCount > MAX_CLOSURE_COMPONENTS) {
+        return;
+    }
+
+    wordsPerRow = (componentCount + 63) / 64;
+    closure.assign(componentCount * wordsPerRow, 0);
+
+    // Компоненты идут в обратном топологическом порядке, так что строки
+    // преемников (с меньшими номерами) уже готовы
+    for (size_t c = 0; c < componentCount; ++c) {
+        uint64_t* row = &closure[c * wordsPerRow];
+        row[c / 64] |= uint64_t(1) << (c % 64);
+
+        for (int k = successorStart[c]; k < successorStart[c + 1]; ++k) {
+            const int successor = successors[k];
+            const uint64_t* other = &closure[successor * wordsPerRow];
+            // Дальше последнего слова с битами преемника строка пуста
+            size_t words = successor / 64 + 1;
+            for (size_t w = 0; w < words; ++w) {
+                row[w] |= other[w];
+            }
+        }
+    }
+}
+
+// Обход графа компонент. Номера преемников меньше номера компоненты,
+// поэтому компоненты с номером меньше to пропускаются
+bool ReachabilityIndex::searchComponents(int from, int to) const {
+    vector<char> seen(from + 1, 0);
+    vector<int> frontier = {from};
+    seen[from] = 1;
+    while (!frontier.empty()) {
+        const int c = frontier.back();
+        frontier.pop_back();
+        if (c == to) {
+            return true;
+        }
+        for (int k = successorStart[c]; k < successorStart[c + 1]; ++k) {
+            const int next = successors[k];
+            if (next >= to && !seen[next]) {
+                seen[next] = 1;
+                frontier.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+bool ReachabilityIndex::canReach(int64_t fromNode, int64_t toNode) const {
+    if (fromNode == toNode) {
+        return true;
+    }
+    auto from = componentOfNode.find(fromNode);
+    auto to = componentOfNode.find(toNode);
+    if (from == componentOfNode.end() || to == componentOfNode.end()) {
+        return false;
+    }
+    if (closure.empty()) {
+        return to->second <= from->second && searchComponents(from->second, to->second);
+    }
+    size_t target = to->second;
+    return (closure[from->second * wordsPerRow + target / 64] >> (target % 64)) & 1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "MemoryAccounting.h"
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+// Транзитивное замыкание ориентированной сети для мгновенной проверки
+// "дойдет ли газ из X в Y". Узлы - КС и трубы-узлы (нумерация как в
+// NetworkIslands::nodeIndex), дуги - соединения от начала к концу.
+//
+// Сильно связные компоненты (циклы) сжимаются в одну вершину (Тарьян),
+// получившийся ациклический граф обходится в обратном топологическом
+// порядке, и строка достижимости компоненты - это OR строк ее преемников
+// по 64 бита за операцию. Запрос - одна проверка бита, O(1).
+// Память - C^2/8 байт для C компонент, поэтому замыкание строится только
+// до MAX_CLOSURE_COMPONENTS компонент (32 МБ). В большей сети хранится лишь
+// граф компонент, и запрос обходит его от начала, не заходя в компоненты с
+// номером меньше конечной: из них конечная недостижима. Такой запрос -
+// O(C + дуг) в худшем случае.
+//
+// Индекс неизменяем и строится по конкретной версии сети; builtFrom
+// сравнивает версии без сравнения элементов. Концы дуг берутся из труб,
+// но меняются они только вместе с сетью (подключение и разрыв), поэтому
+// версии сети достаточно. Память индекса учитывается
+// в MemoryTracker как Reachability.
+class ReachabilityIndex {
+private:
+    template <typename T>
+    using Tracked = TrackedAllocator<T, MemoryCategory::Reachability>;
+
+    PersistentVector<NetworkConnection> source;
+    std::unordered_map<int64_t, int, std::hash<int64_t>, std::equal_to<int64_t>, Tracked<std::pair<const int64_t, int>>>
+        componentOfNode;
+    size_t componentCount = 0;
+    size_t wordsPerRow = 0;
+    std::vector<uint64_t, Tracked<uint64_t>> closure;  // строка на компоненту; пусто без замыкания
+    // Граф компонент (CSR): преемники компоненты c - [successorStart[c], successorStart[c + 1])
+    std::vector<int, Tracked<int>> successorStart;
+    std::vector<int, Tracked<int>> successors;
+
+    bool searchComponents(int from, int to) const;
+
+public:
+    static constexpr size_t MAX_CLOSURE_COMPONENTS = 16384;
+
+    ReachabilityIndex(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes);
+
+    bool builtFrom(const PersistentVector<NetworkConnection>& network) const {
+        return source.sharesStateWith(network);
+    }
+
+    // Узел в сети (участвует хотя бы в одном соединении)
+    bool contains(int64_t node) const { return componentOfNode.count(node) != 0; }
+    // Узел достижим сам из себя; узлы вне сети ничего не достигают
+    bool canReach(int64_t fromNode, int64_t toNode) const;
+    size_t getComponentCount() const { return componentCount; }
+    // false - компонент больше MAX_CLOSURE_COMPONENTS, запросы обходят граф
+    bool hasClosure() const { return !closure.empty() || componentCount == 0; }
+};
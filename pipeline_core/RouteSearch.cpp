@@ -0,0 +1,319 @@
+#include "RouteSearch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <tuple>
+
+#include "NetworkIslands.h"
+#include "PipeIndex.h"
+#include "TaskScheduler.h"
+
+using namespace std;
+
+namespace {
+
+const double INF = numeric_limits<double>::infinity();
+
+// Меньше этого числа дуг параллельные задачи не окупают накладных расходов
+const size_t PARALLEL_MIN_ARCS = 4096;
+
+}
+
+// Рабочие массивы одного поиска; переиспользуются между поисками
+struct RouteGraph::SearchScratch {
+    vector<double> dist;
+    vector<int> prevArc;
+    vector<char> blockedNode;
+    vector<int> touched;
+
+    explicit SearchScratch(size_t nodeCount)
+        : dist(nodeCount, INF), prevArc(nodeCount, -1), blockedNode(nodeCount, 0) {}
+
+    void reset() {
+        for (int node : touched) {
+            dist[node] = INF;
+            prevArc[node] = -1;
+        }
+        touched.clear();
+    }
+};
+
+// Запреты для поиска ответвления: узлы корневого пути и дуги,
+// которыми уже найденные пути с тем же корнем уходят из spur-узла
+struct RouteGraph::Blocked {
+    vector<int> nodes;
+    vector<int> arcs;  // отсортированы
+};
+
+RouteGraph::RouteGraph(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes) {
+    PipeIndex pipeById(pipes);
+
+    auto localOf = [this](int id, bool isStation) {
+        int64_t node = NetworkIslands::nodeIndex(id, isStation);
+        auto [it, inserted] = localByNode.emplace(node, static_cast<int>(objectIds.size()));
+        if (inserted) {
+            objectIds.push_back(id);
+        }
+        return it->second;
+    };
+
+    vector<Arc> unordered;
+    unordered.reserve(network.size());
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        int from = localOf(pipe->startId, startIsStation(*pipe));
+        int to = localOf(pipe->endId, endIsStation(*pipe));
+        if (pipe->underRepair) {
+            continue;
+        }
+        unordered.push_back({from, to, conn.pipeId, pipe->length});
+    }
+
+    // Прямые дуги группируются по началу, обратные - по концу
+    const size_t nodeCount = objectIds.size();
+    firstArc.assign(nodeCount + 1, 0);
+    firstReverse.assign(nodeCount + 1, 0);
+    for (const Arc& arc : unordered) {
+        firstArc[arc.source + 1]++;
+        firstReverse[arc.target + 1]++;
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        firstArc[i + 1] += firstArc[i];
+        firstReverse[i + 1] += firstReverse[i];
+    }
+
+    arcs.resize(unordered.size());
+    vector<int> fill(firstArc.begin(), firstArc.end() - 1);
+    for (const Arc& arc : unordered) {
+        arcs[fill[arc.source]++] = arc;
+    }
+    reverseArcs.resize(arcs.size());
+    fill.assign(firstReverse.begin(), firstReverse.end() - 1);
+    for (size_t i = 0; i < arcs.size(); ++i) {
+        reverseArcs[fill[arcs[i].target]++] = static_cast<int>(i);
+    }
+}
+
+vector<double> RouteGraph::distancesTo(int target) const {
+    vector<double> dist(objectIds.size(), INF);
+    using Entry = pair<double, int>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+    dist[target] = 0;
+    queue.push({0, target});
+
+    while (!queue.empty()) {
+        auto [d, node] = queue.top();
+        queue.pop();
+        if (d > dist[node]) {
+            continue;
+        }
+        for (int i = firstReverse[node]; i < firstReverse[node + 1]; ++i) {
+            const Arc& arc = arcs[reverseArcs[i]];
+            double candidate = d + arc.length;
+            if (candidate < dist[arc.source]) {
+                dist[arc.source] = candidate;
+                queue.push({candidate, arc.source});
+            }
+        }
+    }
+    return dist;
+}
+
+// Расстояния до цели в полном графе - согласованная эвристика и для графа
+// с запретами (запреты только удлиняют пути), поэтому A* остается точным
+bool RouteGraph::spurSearch(int spur, int target, const vector<double>& heuristic, const Blocked& blocked,
+                            SearchScratch& scratch, vector<int>& arcPath) const {
+    scratch.reset();
+    for (int node : blocked.nodes) {
+        scratch.blockedNode[node] = 1;
+    }
+
+    using Entry = tuple<double, double, int>;  // (оценка, пройдено, узел)
+    priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+    scratch.dist[spur] = 0;
+    scratch.touched.push_back(spur);
+    queue.push({heuristic[spur], 0, spur});
+
+    bool found = false;
+    while (!queue.empty()) {
+        auto [estimate, d, node] = queue.top();
+        queue.pop();
+        if (d > scratch.dist[node]) {
+            continue;
+        }
+        if (node == target) {
+            found = true;
+            break;
+        }
+        for (int i = firstArc[node]; i < firstArc[node + 1]; ++i) {
+            const Arc& arc = arcs[i];
+            if (scratch.blockedNode[arc.target] || heuristic[arc.target] == INF ||
+                binary_search(blocked.arcs.begin(), blocked.arcs.end(), i)) {
+                continue;
+            }
+            double candidate = d + arc.length;
+            if (candidate < scratch.dist[arc.target]) {
+                if (scratch.dist[arc.target] == INF) {
+                    scratch.touched.push_back(arc.target);
+                }
+                scratch.dist[arc.target] = candidate;
+                scratch.prevArc[arc.target] = i;
+                queue.push({candidate + heuristic[arc.target], candidate, arc.target});
+            }
+        }
+    }
+
+    for (int node : blocked.nodes) {
+        scratch.blockedNode[node] = 0;
+    }
+
+    arcPath.clear();
+    if (!found) {
+        return false;
+    }
+    for (int node = target; node != spur; node = arcs[scratch.prevArc[node]].source) {
+        arcPath.push_back(scratch.prevArc[node]);
+    }
+    reverse(arcPath.begin(), arcPath.end());
+    return true;
+}
+
+Route RouteGraph::toRoute(int start, const vector<int>& arcPath) const {
+    Route route;
+    route.nodes.push_back(objectIds[start]);
+    for (int index : arcPath) {
+        const Arc& arc = arcs[index];
+        route.nodes.push_back(objectIds[arc.target]);
+        route.pipeIds.push_back(arc.pipeId);
+        route.totalLength += arc.length;
+    }
+    return route;
+}
+
+vector<Route> RouteGraph::kShortestPaths(int64_t fromNode, int64_t toNode, size_t k) const {
+    vector<Route> routes;
+    auto fromIt = localByNode.find(fromNode);
+    auto toIt = localByNode.find(toNode);
+    if (k == 0 || fromIt == localByNode.end() || toIt == localByNode.end()) {
+        return routes;
+    }
+    const int start = fromIt->second;
+    const int target = toIt->second;
+
+    const vector<double> heuristic = distancesTo(target);
+    if (heuristic[start] == INF) {
+        return routes;
+    }
+
+    auto arcsLength = [this](const vector<int>& arcPath) {
+        double total = 0;
+        for (int index : arcPath) {
+            total += arcs[index].length;
+        }
+        return total;
+    };
+
+    // A - найденные пути, B - кандидаты (длина, дуги)
+    vector<vector<int>> accepted;
+    vector<pair<double, vector<int>>> candidates;
+    set<vector<int>> known;
+
+    SearchScratch mainScratch(objectIds.size());
+    vector<int> firstPath;
+    spurSearch(start, target, heuristic, Blocked(), mainScratch, firstPath);
+    accepted.push_back(firstPath);
+    known.insert(firstPath);
+
+    // Рабочие массивы задач ответвлений живут между итерациями: задача берет
+    // свободные, а не выделяет массивы на все узлы сети заново
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    mutex spareMutex;
+    vector<unique_ptr<SearchScratch>> spareScratches;
+    auto acquireScratch = [&]() {
+        lock_guard<mutex> lock(spareMutex);
+        if (spareScratches.empty()) {
+            return make_unique<SearchScratch>(objectIds.size());
+        }
+        unique_ptr<SearchScratch> scratch = move(spareScratches.back());
+        spareScratches.pop_back();
+        return scratch;
+    };
+
+    while (accepted.size() < k) {
+        const vector<int>& last = accepted.back();
+        vector<int> lastNodes = {start};
+        for (int index : last) {
+            lastNodes.push_back(arcs[index].target);
+        }
+
+        // Ответвление от каждого узла последнего пути, кроме цели
+        const size_t spurCount = last.size();
+        vector<vector<int>> spurResults(spurCount);
+        vector<char> spurFound(spurCount, 0);
+
+        auto runSpur = [&](size_t i, SearchScratch& scratch) {
+            Blocked blocked;
+            blocked.nodes.assign(lastNodes.begin(), lastNodes.begin() + i);
+            for (const auto& path : accepted) {
+                if (path.size() > i && equal(last.begin(), last.begin() + i, path.begin())) {
+                    blocked.arcs.push_back(path[i]);
+                }
+            }
+            sort(blocked.arcs.begin(), blocked.arcs.end());
+
+            vector<int> spurPath;
+            if (spurSearch(lastNodes[i], target, heuristic, blocked, scratch, spurPath)) {
+                vector<int>& candidate = spurResults[i];
+                candidate.assign(last.begin(), last.begin() + i);
+                candidate.insert(candidate.end(), spurPath.begin(), spurPath.end());
+                spurFound[i] = 1;
+            }
+        };
+
+        if (spurCount <= 1 || arcs.size() < PARALLEL_MIN_ARCS || scheduler.concurrency() == 1) {
+            for (size_t i = 0; i < spurCount; ++i) {
+                runSpur(i, mainScratch);
+            }
+        } else {
+            // По одному ответвлению на задачу: поиски сильно разнятся по
+            // длительности, свободные потоки забирают оставшиеся
+            parallelFor(0, spurCount, 1, [&](size_t first, size_t last) {
+                unique_ptr<SearchScratch> scratch = acquireScratch();
+                for (size_t i = first; i < last; ++i) {
+                    runSpur(i, *scratch);
+                }
+                lock_guard<mutex> lock(spareMutex);
+                spareScratches.push_back(move(scratch));
+            }, scheduler);
+        }
+
+        // Слияние в порядке spur-узлов, чтобы результат не зависел от потоков
+        for (size_t i = 0; i < spurCount; ++i) {
+            if (spurFound[i] && known.insert(spurResults[i]).second) {
+                candidates.push_back({arcsLength(spurResults[i]), move(spurResults[i])});
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+
+        auto best = min_element(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first < b.first : a.second.size() < b.second.size();
+        });
+        accepted.push_back(move(best->second));
+        candidates.erase(best);
+    }
+
+    for (const auto& path : accepted) {
+        routes.push_back(toRoute(start, path));
+    }
+    return routes;
+}
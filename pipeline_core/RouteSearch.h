@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+// Маршрут по сети: узлы (ID КС или труб-узлов), трубы между ними и общая длина
+struct Route {
+    std::vector<int> nodes;
+    std::vector<int> pipeIds;
+    double totalLength = 0;
+};
+
+// Взвешенный ориентированный граф сети для поиска маршрутов.
+// Вес дуги - длина трубы; трубы в ремонте в граф не входят, так что
+// найденные маршруты - это обходы выведенных в ремонт участков.
+// Узлы нумеруются как в NetworkIslands::nodeIndex.
+class RouteGraph {
+private:
+    struct Arc {
+        int source;
+        int target;
+        int pipeId;
+        double length;
+    };
+
+    std::unordered_map<int64_t, int> localByNode;
+    std::vector<int> objectIds;     // ID объекта для локального узла
+    std::vector<int> firstArc;      // CSR: дуги узла i - [firstArc[i], firstArc[i+1])
+    std::vector<Arc> arcs;
+    std::vector<int> firstReverse;  // входящие дуги, индексы в arcs
+    std::vector<int> reverseArcs;
+
+    struct SearchScratch;
+    struct Blocked;
+
+    // Расстояния до цели по обратному графу - дерево кратчайших путей,
+    // общее для всех итераций Йена
+    std::vector<double> distancesTo(int target) const;
+    // A* от spur до target в обход заблокированных узлов и дуг; дуги пути - в arcPath
+    bool spurSearch(int spur, int target, const std::vector<double>& heuristic, const Blocked& blocked,
+                    SearchScratch& scratch, std::vector<int>& arcPath) const;
+    Route toRoute(int start, const std::vector<int>& arcPath) const;
+
+public:
+    RouteGraph(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes);
+
+    bool contains(int64_t node) const { return localByNode.count(node) != 0; }
+
+    // До k кратчайших простых путей (алгоритм Йена) по возрастанию длины.
+    // Поиски ответвлений одной итерации независимы и идут в нескольких потоках.
+    std::vector<Route> kShortestPaths(int64_t fromNode, int64_t toNode, size_t k) const;
+};
@@ -0,0 +1,244 @@
+#include "SparseSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+const int MAX_LINEAR_ITERATIONS = 20000;
+
+// Частичные суммы потоков разнесены по разным кэш-линиям
+const size_t PAD = 8;
+
+}
+
+WorkerTeam::WorkerTeam(size_t count, TaskScheduler& scheduler) : count(max<size_t>(count, 1)), scheduler(scheduler) {}
+
+void WorkerTeam::run(const function<void(size_t)>& body) {
+    if (count == 1) {
+        body(0);
+        return;
+    }
+    TaskGroup group(scheduler);
+    for (size_t worker = 1; worker < count; ++worker) {
+        group.run([&body, worker] { body(worker); });
+    }
+    body(0);
+    group.wait();
+}
+
+SparsePattern::SparsePattern(size_t rows, const vector<pair<int, int>>& offDiagonal) {
+    vector<vector<int>> rowColumns(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        rowColumns[row].push_back(static_cast<int>(row));
+    }
+    for (const auto& [row, column] : offDiagonal) {
+        rowColumns[row].push_back(column);
+    }
+
+    rowStart.assign(rows + 1, 0);
+    diagonalSlot.assign(rows, 0);
+    for (size_t row = 0; row < rows; ++row) {
+        auto& cols = rowColumns[row];
+        sort(cols.begin(), cols.end());
+        cols.erase(unique(cols.begin(), cols.end()), cols.end());
+        diagonalSlot[row] = static_cast<int>(columns.size() + (lower_bound(cols.begin(), cols.end(), row) - cols.begin()));
+        columns.insert(columns.end(), cols.begin(), cols.end());
+        rowStart[row + 1] = static_cast<int>(columns.size());
+    }
+}
+
+int SparsePattern::slot(int row, int column) const {
+    if (row == -1 || column == -1) {
+        return -1;
+    }
+    auto first = columns.begin() + rowStart[row];
+    auto last = columns.begin() + rowStart[row + 1];
+    auto it = lower_bound(first, last, column);
+    return it != last && *it == column ? static_cast<int>(it - columns.begin()) : -1;
+}
+
+// За итерацию - пять параллельных проходов, скалярные произведения считаются в них же
+bool solveBiCGStab(WorkerTeam& team, const SparsePattern& pattern, const vector<double>& values,
+                   const vector<double>& rhs, double tolerance, vector<double>& x) {
+    const vector<int>& rowStart = pattern.rowStart;
+    const vector<int>& columns = pattern.columns;
+    const vector<int>& diagonalSlot = pattern.diagonalSlot;
+    const size_t n = rhs.size();
+    const size_t workers = team.size();
+    x.assign(n, 0.0);
+
+    // ILU(0) блока [begin, end): связи с другими блоками отбрасываются
+    vector<double> factors(values);
+    team.run([&](size_t w) {
+        auto [begin, end] = team.chunk(w, n);
+        vector<int> slotOfColumn(end - begin, -1);
+        for (size_t row = begin; row < end; ++row) {
+            for (int k = rowStart[row]; k < rowStart[row + 1]; ++k) {
+                if (columns[k] >= static_cast<int>(begin) && columns[k] < static_cast<int>(end)) {
+                    slotOfColumn[columns[k] - begin] = k;
+                }
+            }
+            for (int k = rowStart[row]; k < diagonalSlot[row]; ++k) {
+                int pivotRow = columns[k];
+                if (pivotRow < static_cast<int>(begin)) {
+                    continue;
+                }
+                factors[k] /= factors[diagonalSlot[pivotRow]];
+                for (int j = diagonalSlot[pivotRow] + 1; j < rowStart[pivotRow + 1]; ++j) {
+                    int column = columns[j];
+                    if (column < static_cast<int>(end) && slotOfColumn[column - begin] != -1) {
+                        factors[slotOfColumn[column - begin]] -= factors[k] * factors[j];
+                    }
+                }
+            }
+            if (factors[diagonalSlot[row]] == 0) {
+                factors[diagonalSlot[row]] = 1e-12;
+            }
+            for (int k = rowStart[row]; k < rowStart[row + 1]; ++k) {
+                if (columns[k] >= static_cast<int>(begin) && columns[k] < static_cast<int>(end)) {
+                    slotOfColumn[columns[k] - begin] = -1;
+                }
+            }
+        }
+    });
+
+    // out = (LU)^-1 in для строк блока
+    auto precondition = [&](const vector<double>& in, vector<double>& out, size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            double sum = in[row];
+            for (int k = rowStart[row]; k < diagonalSlot[row]; ++k) {
+                if (columns[k] >= static_cast<int>(begin)) {
+                    sum -= factors[k] * out[columns[k]];
+                }
+            }
+            out[row] = sum;
+        }
+        for (size_t row = end; row-- > begin;) {
+            double sum = out[row];
+            for (int k = diagonalSlot[row] + 1; k < rowStart[row + 1]; ++k) {
+                if (columns[k] < static_cast<int>(end)) {
+                    sum -= factors[k] * out[columns[k]];
+                }
+            }
+            out[row] = sum / factors[diagonalSlot[row]];
+        }
+    };
+
+    vector<double> r(rhs), rHat(rhs), p(n, 0.0), v(n, 0.0), s(n), t(n), y(n), z(n);
+    vector<double> partial(workers * PAD, 0.0);
+
+    auto multiply = [&](const vector<double>& in, vector<double>& out, size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            double sum = 0;
+            for (int k = rowStart[row]; k < rowStart[row + 1]; ++k) {
+                sum += values[k] * in[columns[k]];
+            }
+            out[row] = sum;
+        }
+    };
+    auto total = [&](size_t index) {
+        double sum = 0;
+        for (size_t w = 0; w < workers; ++w) {
+            sum += partial[w * PAD + index];
+        }
+        return sum;
+    };
+
+    double rhsNorm = 0;
+    for (double value : rhs) {
+        rhsNorm += value * value;
+    }
+    rhsNorm = sqrt(rhsNorm);
+    if (rhsNorm == 0) {
+        return true;
+    }
+    const double limit = tolerance * rhsNorm;
+
+    double rho = rhsNorm * rhsNorm;  // (rHat, r) при r = rHat = rhs
+    double alpha = 1, omega = 1, rhoPrevious = 1;
+
+    for (int iteration = 0; iteration < MAX_LINEAR_ITERATIONS; ++iteration) {
+        double beta = (rho / rhoPrevious) * (alpha / omega);
+        team.run([&](size_t w) {
+            auto [begin, end] = team.chunk(w, n);
+            for (size_t i = begin; i < end; ++i) {
+                p[i] = r[i] + beta * (p[i] - omega * v[i]);
+            }
+            precondition(p, y, begin, end);
+        });
+
+        team.run([&](size_t w) {
+            auto [begin, end] = team.chunk(w, n);
+            multiply(y, v, begin, end);
+            double dot = 0;
+            for (size_t i = begin; i < end; ++i) {
+                dot += rHat[i] * v[i];
+            }
+            partial[w * PAD] = dot;
+        });
+        double rHatV = total(0);
+        if (rHatV == 0) {
+            return false;
+        }
+        alpha = rho / rHatV;
+
+        team.run([&](size_t w) {
+            auto [begin, end] = team.chunk(w, n);
+            double dot = 0;
+            for (size_t i = begin; i < end; ++i) {
+                s[i] = r[i] - alpha * v[i];
+                dot += s[i] * s[i];
+            }
+            precondition(s, z, begin, end);
+            partial[w * PAD] = dot;
+        });
+        if (sqrt(total(0)) <= limit) {
+            for (size_t i = 0; i < n; ++i) {
+                x[i] += alpha * y[i];
+            }
+            return true;
+        }
+
+        team.run([&](size_t w) {
+            auto [begin, end] = team.chunk(w, n);
+            multiply(z, t, begin, end);
+            double ts = 0, tt = 0;
+            for (size_t i = begin; i < end; ++i) {
+                ts += t[i] * s[i];
+                tt += t[i] * t[i];
+            }
+            partial[w * PAD] = ts;
+            partial[w * PAD + 1] = tt;
+        });
+        double tt = total(1);
+        if (tt == 0) {
+            return false;
+        }
+        omega = total(0) / tt;
+
+        team.run([&](size_t w) {
+            auto [begin, end] = team.chunk(w, n);
+            double rr = 0, rHatR = 0;
+            for (size_t i = begin; i < end; ++i) {
+                x[i] += alpha * y[i] + omega * z[i];
+                r[i] = s[i] - omega * t[i];
+                rr += r[i] * r[i];
+                rHatR += rHat[i] * r[i];
+            }
+            partial[w * PAD] = rr;
+            partial[w * PAD + 1] = rHatR;
+        });
+        if (sqrt(total(0)) <= limit) {
+            return true;
+        }
+        rhoPrevious = rho;
+        rho = total(1);
+        if (rho == 0 || omega == 0) {
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "TaskScheduler.h"
+
+// Расчет, поделенный на count долей. Доля 0 выполняется в вызывающем
+// потоке, остальные - задачами общего планировщика (TaskScheduler.h):
+// одновременные расчеты делят его рабочие потоки и не заводят своих, так
+// что потоков не становится больше, чем ядер. Число долей задает деление
+// работы (блоки предобусловливателя), а не число потоков.
+class WorkerTeam {
+private:
+    size_t count;
+    TaskScheduler& scheduler;
+
+public:
+    explicit WorkerTeam(size_t count, TaskScheduler& scheduler = TaskScheduler::instance());
+
+    WorkerTeam(const WorkerTeam&) = delete;
+    WorkerTeam& operator=(const WorkerTeam&) = delete;
+
+    size_t size() const { return count; }
+
+    // body(worker) для каждого worker в [0, size()); доли не должны ждать друг друга
+    void run(const std::function<void(size_t)>& body);
+
+    // Доля worker из count элементов: [first, second)
+    std::pair<size_t, size_t> chunk(size_t worker, size_t count) const {
+        return {worker * count / size(), (worker + 1) * count / size()};
+    }
+};
+
+// Структура разреженной матрицы в CSR; столбцы строки отсортированы,
+// диагональ присутствует всегда
+struct SparsePattern {
+    std::vector<int> rowStart;
+    std::vector<int> columns;
+    std::vector<int> diagonalSlot;
+
+    // rows строк и внедиагональные позиции (строка, столбец)
+    SparsePattern(size_t rows, const std::vector<std::pair<int, int>>& offDiagonal);
+    SparsePattern() = default;
+
+    size_t rows() const { return diagonalSlot.size(); }
+    size_t size() const { return columns.size(); }
+    // Номер элемента (row, column) в values или -1, если его нет в структуре
+    int slot(int row, int column) const;
+};
+
+// BiCGSTAB с блочно-якобиевым предобусловливанием: каждый поток команды
+// строит неполное LU-разложение (ILU(0)) своего диагонального блока строк
+// и применяет его независимо от остальных. tolerance - относительная
+// невязка. Блоки совпадают с долями team.chunk, так что при нумерации
+// неизвестных по областям сети каждый поток работает со своей областью.
+bool solveBiCGStab(WorkerTeam& team, const SparsePattern& pattern, const std::vector<double>& values,
+                   const std::vector<double>& rhs, double tolerance, std::vector<double>& x);
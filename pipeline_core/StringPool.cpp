@@ -0,0 +1,181 @@
+#include "StringPool.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "MemoryAccounting.h"
+
+using namespace std;
+
+namespace {
+
+// Номер строки делится на номер куска и место в куске. Таблица кусков
+// выделена целиком и не перемещается, поэтому читатели обходятся без
+// блокировки: кусок публикуется атомарно до выдачи первого номера в нем.
+const size_t ENTRY_BITS = 16;
+const size_t ENTRIES_PER_CHUNK = size_t(1) << ENTRY_BITS;
+const size_t MAX_CHUNKS = size_t(1) << 12;  // до 2^28 номеров, номер 0 - пустая строка
+static_assert(MAX_CHUNKS * ENTRIES_PER_CHUNK == StringPool::MAX_STRINGS + 1, "номера пула не влезают в куски");
+// Текст строк лежит подряд в крупных блоках: длина (4 байта), затем байты
+const size_t TEXT_BLOCK = 1 << 20;
+
+// Память пула учитывается в MemoryTracker как Names. Текст и куски не
+// освобождаются; таблицу поиска учитывает ее аллокатор.
+void trackNames(size_t bytes) {
+    MemoryTracker::instance().allocated(MemoryCategory::Names, bytes);
+}
+
+// Номера не переиспользуются, поэтому переполнение пула не исправить на ходу
+[[noreturn]] void poolExhausted() {
+    fprintf(stderr, "Пул строк: исчерпаны номера строк или строка длиннее 4 ГБ\n");
+    abort();
+}
+
+struct Pool {
+    unique_ptr<atomic<const char**>[]> chunks{newChunkTable()};
+    vector<unique_ptr<const char*[]>> ownedChunks;
+    vector<unique_ptr<char[]>> blocks;
+    char* textBlock = nullptr;   // блок, в который дописываются короткие строки
+    size_t blockUsed = TEXT_BLOCK;
+    size_t count = 1;  // номер 0 - пустая строка, в таблице его нет
+    size_t bytes = 0;
+
+    // Открытая адресация по номерам строк; 0 - пустое место
+    using Table = vector<uint32_t, TrackedAllocator<uint32_t, MemoryCategory::Names>>;
+    Table table = Table(1024, 0);
+
+    static atomic<const char**>* newChunkTable() {
+        trackNames(MAX_CHUNKS * sizeof(atomic<const char**>));
+        return new atomic<const char**>[MAX_CHUNKS]();
+    }
+    mutex writeMutex;
+
+    string_view text(uint32_t handle) const {
+        const char* entry = chunks[handle >> ENTRY_BITS].load(memory_order_acquire)[handle & (ENTRIES_PER_CHUNK - 1)];
+        uint32_t size;
+        memcpy(&size, entry, sizeof(size));
+        return string_view(entry + sizeof(size), size);
+    }
+
+    const char* store(string_view value) {
+        const size_t need = sizeof(uint32_t) + value.size();
+        char* place;
+        if (need > TEXT_BLOCK / 4) {
+            // Длинная строка получает отдельный блок по размеру
+            blocks.push_back(unique_ptr<char[]>(new char[need]));
+            trackNames(need);
+            place = blocks.back().get();
+        } else {
+            if (blockUsed + need > TEXT_BLOCK) {
+                blocks.push_back(unique_ptr<char[]>(new char[TEXT_BLOCK]));
+                trackNames(TEXT_BLOCK);
+                textBlock = blocks.back().get();
+                blockUsed = 0;
+            }
+            place = textBlock + blockUsed;
+            blockUsed += need;
+        }
+        const uint32_t size = static_cast<uint32_t>(value.size());
+        memcpy(place, &size, sizeof(size));
+        memcpy(place + sizeof(size), value.data(), value.size());
+        bytes += value.size();
+        return place;
+    }
+
+    void grow() {
+        Table old(table.size() * 2, 0);
+        old.swap(table);
+        for (uint32_t handle : old) {
+            if (handle != 0) {
+                size_t slot = hash<string_view>()(text(handle)) & (table.size() - 1);
+                while (table[slot] != 0) {
+                    slot = (slot + 1) & (table.size() - 1);
+                }
+                table[slot] = handle;
+            }
+        }
+    }
+
+    bool intern(string_view value, uint32_t& result) {
+        // Хэш считается до блокировки: параллельная загрузка интернирует названия из многих потоков
+        const size_t valueHash = hash<string_view>()(value);
+        lock_guard<mutex> lock(writeMutex);
+        size_t slot = valueHash & (table.size() - 1);
+        for (; table[slot] != 0; slot = (slot + 1) & (table.size() - 1)) {
+            if (text(table[slot]) == value) {
+                result = table[slot];
+                return true;
+            }
+        }
+
+        if (count > StringPool::MAX_STRINGS || value.size() > UINT32_MAX) {
+            return false;
+        }
+        const uint32_t handle = static_cast<uint32_t>(count);
+        const size_t chunk = handle >> ENTRY_BITS;
+        if (chunks[chunk].load(memory_order_relaxed) == nullptr) {
+            ownedChunks.push_back(unique_ptr<const char*[]>(new const char*[ENTRIES_PER_CHUNK]));
+            trackNames(ENTRIES_PER_CHUNK * sizeof(const char*));
+            chunks[chunk].store(ownedChunks.back().get(), memory_order_release);
+        }
+        chunks[chunk].load(memory_order_relaxed)[handle & (ENTRIES_PER_CHUNK - 1)] = store(value);
+        ++count;
+
+        table[slot] = handle;
+        if (2 * count > table.size()) {
+            grow();
+        }
+        result = handle;
+        return true;
+    }
+};
+
+Pool& pool() {
+    static Pool instance;
+    return instance;
+}
+
+}
+
+uint32_t StringPool::intern(string_view text) {
+    uint32_t handle = 0;
+    if (!tryIntern(text, handle)) {
+        poolExhausted();
+    }
+    return handle;
+}
+
+bool StringPool::tryIntern(string_view text, uint32_t& handle) {
+    if (text.empty()) {
+        handle = 0;
+        return true;
+    }
+    return pool().intern(text, handle);
+}
+
+string_view StringPool::view(uint32_t handle) {
+    return handle == 0 ? string_view() : pool().text(handle);
+}
+
+size_t StringPool::stringCount() {
+    Pool& instance = pool();
+    lock_guard<mutex> lock(instance.writeMutex);
+    return instance.count - 1;
+}
+
+size_t StringPool::bytesUsed() {
+    Pool& instance = pool();
+    lock_guard<mutex> lock(instance.writeMutex);
+    return instance.bytes + (instance.count - 1) * sizeof(uint32_t);
+}
+
+ostream& operator<<(ostream& os, const InternedName& name) {
+    return os << name.view();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// Общий для процесса пул строк: каждая различная строка хранится один раз,
+// а записи держат ее 4-байтовый номер. Названия вроде "Магистраль" у тысяч
+// труб занимают память одной строки.
+//
+// Пул только растет: номер, однажды выданный, действителен до конца
+// процесса, поэтому снимки состояния и копии записей не следят за
+// временем жизни строк. Чтение по номеру - без блокировок; добавление
+// новой строки берет мьютекс.
+//
+// Рост: каждая различная строка, встреченная процессом (ввод, загрузки,
+// импорт, патчи), занимает длину + 4 байта текста, 8 байт в куске номеров
+// и 4-8 байт таблицы поиска и не освобождается - даже если ни одна запись
+// на нее уже не ссылается. Объем виден в отчете MEMORY как names. Более
+// MAX_STRINGS различных строк пул не вмещает. Названия из внешних данных
+// (запросы сервера, импорт, патчи, загрузки) проходят через tryIntern и при
+// переполнении отклоняются с ошибкой; intern на новой строке сверх предела
+// завершает процесс, а не выдает номер вне таблицы кусков.
+class StringPool {
+public:
+    static constexpr size_t MAX_STRINGS = (size_t(1) << 28) - 1;
+
+    // Номер строки; равные строки получают один номер. 0 - пустая строка.
+    static uint32_t intern(std::string_view text);
+    // То же без завершения процесса: false, если новой строке не хватило
+    // номеров или она длиннее 4 ГБ. Уже известная строка находится всегда.
+    static bool tryIntern(std::string_view text, uint32_t& handle);
+    static std::string_view view(uint32_t handle);
+
+    // Различных строк и байт под их текст
+    static size_t stringCount();
+    static size_t bytesUsed();
+};
+
+// Название записи - номер строки в StringPool. Ведет себя как строка только
+// для чтения: выводится в поток, приводится к std::string, сравнивается.
+class InternedName {
+private:
+    uint32_t handle = 0;
+
+public:
+    InternedName() = default;
+    InternedName(const std::string& text) : handle(StringPool::intern(text)) {}
+    InternedName(const char* text) : handle(StringPool::intern(text)) {}
+
+    // Название из внешних данных: false - пул строк переполнен, название не изменено
+    bool assign(std::string_view text) { return StringPool::tryIntern(text, handle); }
+
+    std::string_view view() const { return StringPool::view(handle); }
+    std::string str() const { return std::string(view()); }
+    operator std::string() const { return str(); }
+
+    // Номер в пуле: равные строки - равные номера
+    uint32_t handleValue() const { return handle; }
+
+    size_t length() const { return view().size(); }
+    bool empty() const { return handle == 0; }
+
+    // Равные строки интернируются в один номер
+    bool operator==(const InternedName& other) const { return handle == other.handle; }
+    bool operator!=(const InternedName& other) const { return handle != other.handle; }
+};
+
+std::ostream& operator<<(std::ostream& os, const InternedName& name);
@@ -0,0 +1,280 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Рабочий поток знает свой планировщик и свою очередь
+struct WorkerIdentity {
+    const TaskScheduler* scheduler = nullptr;
+    size_t index = 0;
+};
+
+thread_local WorkerIdentity currentWorker;
+
+// Модель стоимости просмотра: запуск задач и пробуждение потоков стоят
+// десятки микросекунд, поэтому меньшую работу (нс) выгоднее сделать сразу
+const double PARALLEL_MIN_WORK = 200000;
+// Кусок просмотра не меньше этого числа записей
+const size_t FILTER_MIN_CHUNK = 4096;
+// Кусков на поток: запас на неравномерные куски, которые перехватывают свободные потоки
+const size_t FILTER_CHUNKS_PER_THREAD = 4;
+
+void splitRange(TaskGroup& group, size_t begin, size_t end, size_t grain,
+                const function<void(size_t, size_t)>& body) {
+    while (end - begin > grain) {
+        const size_t middle = begin + (end - begin) / 2;
+        group.run([&group, &body, middle, end, grain]() { splitRange(group, middle, end, grain, body); });
+        end = middle;
+    }
+    body(begin, end);
+}
+
+}
+
+TaskScheduler::TaskScheduler(size_t threadCount) {
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread& worker : threads) {
+        worker.join();
+    }
+}
+
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler([]() {
+        const unsigned cores = thread::hardware_concurrency();
+        return cores > 1 ? static_cast<size_t>(cores - 1) : size_t(0);
+    }());
+    return scheduler;
+}
+
+void TaskScheduler::spawn(Task task) {
+    if (currentWorker.scheduler == this) {
+        WorkerQueue& own = *queues[currentWorker.index];
+        lock_guard<mutex> lock(own.mutex);
+        own.tasks.push_back(move(task));
+    } else {
+        lock_guard<mutex> lock(injectedMutex);
+        injected.push_back(move(task));
+    }
+    queued.fetch_add(1);
+    if (!threads.empty()) {
+        // Пустая блокировка не дает уведомлению проскочить между проверкой
+        // условия и засыпанием рабочего потока
+        { lock_guard<mutex> lock(sleepMutex); }
+        wakeUp.notify_one();
+    }
+}
+
+bool TaskScheduler::takeTask(Task& task) {
+    if (queued.load() == 0) {
+        return false;
+    }
+    const bool isWorker = currentWorker.scheduler == this;
+    if (isWorker) {
+        WorkerQueue& own = *queues[currentWorker.index];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    {
+        lock_guard<mutex> lock(injectedMutex);
+        if (!injected.empty()) {
+            task = move(injected.front());
+            injected.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    const size_t first = isWorker ? currentWorker.index + 1 : 0;
+    for (size_t k = 0; k < queues.size(); ++k) {
+        WorkerQueue& victim = *queues[(first + k) % queues.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::runPending() {
+    Task task;
+    if (!takeTask(task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    currentWorker.scheduler = this;
+    currentWorker.index = index;
+    while (true) {
+        if (runPending()) {
+            continue;
+        }
+        unique_lock<mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    // Задачи ссылаются на группу - дожидаемся их даже при исключении
+    while (pending.load() > 0) {
+        if (!scheduler.runPending()) {
+            this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::run(function<void()> task) {
+    pending.fetch_add(1);
+    scheduler.spawn([this, task = move(task)]() {
+        try {
+            task();
+        } catch (...) {
+            lock_guard<mutex> lock(errorMutex);
+            if (!error) {
+                error = current_exception();
+            }
+        }
+        pending.fetch_sub(1);
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending.load() > 0) {
+        if (!scheduler.runPending()) {
+            this_thread::yield();
+        }
+    }
+    exception_ptr failure;
+    {
+        lock_guard<mutex> lock(errorMutex);
+        swap(failure, error);
+    }
+    if (failure) {
+        rethrow_exception(failure);
+    }
+}
+
+size_t TaskGraph::add(function<void()> work) {
+    Node node;
+    node.work = move(work);
+    nodes.push_back(move(node));
+    return nodes.size() - 1;
+}
+
+void TaskGraph::precede(size_t before, size_t after) {
+    nodes[before].successors.push_back(after);
+    ++nodes[after].predecessors;
+}
+
+bool TaskGraph::run(TaskScheduler& scheduler) {
+    unique_ptr<atomic<size_t>[]> remaining(new atomic<size_t>[nodes.size()]);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        remaining[i].store(nodes[i].predecessors);
+    }
+    atomic<size_t> finished{0};
+    TaskGroup group(scheduler);
+
+    function<void(size_t)> launch = [&](size_t index) {
+        group.run([&, index]() {
+            nodes[index].work();
+            finished.fetch_add(1);
+            for (size_t next : nodes[index].successors) {
+                if (remaining[next].fetch_sub(1) == 1) {
+                    launch(next);
+                }
+            }
+        });
+    };
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].predecessors == 0) {
+            launch(i);
+        }
+    }
+    group.wait();
+    return finished.load() == nodes.size();
+}
+
+void parallelFor(size_t begin, size_t end, size_t grain, const function<void(size_t, size_t)>& body,
+                 TaskScheduler& scheduler) {
+    if (begin >= end) {
+        return;
+    }
+    grain = max<size_t>(grain, 1);
+    if (end - begin <= grain || scheduler.concurrency() == 1) {
+        body(begin, end);
+        return;
+    }
+    TaskGroup group(scheduler);
+    splitRange(group, begin, end, grain, body);
+    group.wait();
+}
+
+vector<int> parallelFilter(size_t count, double itemCost, const function<bool(size_t)>& match,
+                           TaskScheduler& scheduler) {
+    vector<int> result;
+    const size_t threadCount = scheduler.concurrency();
+    if (threadCount == 1 || count < 2 * FILTER_MIN_CHUNK || count * itemCost < PARALLEL_MIN_WORK) {
+        for (size_t i = 0; i < count; ++i) {
+            if (match(i)) {
+                result.push_back(static_cast<int>(i));
+            }
+        }
+        return result;
+    }
+
+    const size_t chunks = min(count / FILTER_MIN_CHUNK, threadCount * FILTER_CHUNKS_PER_THREAD);
+    auto chunkStart = [&](size_t chunk) { return count * chunk / chunks; };
+    vector<vector<int>> found(chunks);
+    parallelFor(0, chunks, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) {
+            vector<int>& buffer = found[chunk];
+            const size_t end = chunkStart(chunk + 1);
+            for (size_t i = chunkStart(chunk); i < end; ++i) {
+                if (match(i)) {
+                    buffer.push_back(static_cast<int>(i));
+                }
+            }
+        }
+    }, scheduler);
+
+    vector<size_t> offset(chunks + 1, 0);
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        offset[chunk + 1] = offset[chunk] + found[chunk].size();
+    }
+    result.resize(offset[chunks]);
+    // Слияние тоже параллельное: при частых совпадениях копирование сравнимо с просмотром
+    parallelFor(0, chunks, 1, [&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) {
+            copy(found[chunk].begin(), found[chunk].end(), result.begin() + offset[chunk]);
+        }
+    }, scheduler);
+    return result;
+}
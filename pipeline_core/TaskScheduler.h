@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Планировщик задач с перехватом работы (work stealing). У каждого рабочего
+// потока своя очередь: свои задачи он берет с конца (последняя порожденная
+// задача еще в кэше), простаивающие потоки забирают задачи с начала чужих
+// очередей - там самые крупные, еще не поделенные куски. Задачи из потоков
+// вне планировщика попадают в общую входную очередь.
+//
+// Поток, ожидающий группу задач, не спит, а выполняет задачи сам, поэтому
+// вложенный параллелизм (параллельный цикл внутри задачи) не блокируется.
+// При одном ядре рабочих потоков нет и все задачи выполняет ожидающий поток.
+class TaskScheduler {
+private:
+    using Task = std::function<void()>;
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex injectedMutex;
+    std::deque<Task> injected;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<size_t> queued{0};
+    bool stopping = false;
+
+    void workerLoop(size_t index);
+    bool takeTask(Task& task);
+
+public:
+    // threads - число рабочих потоков (вызывающий поток помогает им при ожидании)
+    explicit TaskScheduler(size_t threads);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Общий планировщик процесса: рабочих потоков на один меньше, чем ядер
+    static TaskScheduler& instance();
+
+    // Потоков, одновременно выполняющих задачи: рабочие и ожидающий
+    size_t concurrency() const { return threads.size() + 1; }
+
+    void spawn(Task task);
+    // Выполняет одну ожидающую задачу; false - задач нет
+    bool runPending();
+};
+
+// Группа задач с общим ожиданием. Исключение задачи передается из wait();
+// остальные задачи группы при этом доработают.
+class TaskGroup {
+private:
+    TaskScheduler& scheduler;
+    std::atomic<size_t> pending{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance()) : scheduler(scheduler) {}
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    // Ждет завершения всех задач группы, выполняя ожидающие задачи
+    void wait();
+};
+
+// Граф задач: задача запускается, когда выполнены все ее предшественники.
+// Независимые задачи идут параллельно.
+class TaskGraph {
+private:
+    struct Node {
+        std::function<void()> work;
+        std::vector<size_t> successors;
+        size_t predecessors = 0;
+    };
+    std::vector<Node> nodes;
+
+public:
+    size_t add(std::function<void()> work);
+    // after начнется только после завершения before
+    void precede(size_t before, size_t after);
+    size_t size() const { return nodes.size(); }
+
+    // Выполняет граф и ждет завершения; false - в графе цикл, часть задач не выполнена
+    bool run(TaskScheduler& scheduler = TaskScheduler::instance());
+};
+
+// body(first, last) для кусков [begin, end) не крупнее grain элементов.
+// Диапазон делится пополам: половина отдается планировщику, другая
+// делится дальше, так что свободные потоки крадут крупные куски.
+void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body,
+                 TaskScheduler& scheduler = TaskScheduler::instance());
+
+// Индексы из [0, count), для которых match(i) истинно, по возрастанию -
+// в том же порядке, что и при последовательном просмотре.
+// itemCost - оценка стоимости одной проверки в наносекундах. По ней решается,
+// окупится ли параллельность: малые просмотры идут в вызывающем потоке без
+// единой задачи. Большие делятся на несколько кусков на поток, у каждого
+// куска свой буфер результатов, буферы затем сливаются по порядку.
+std::vector<int> parallelFilter(size_t count, double itemCost, const std::function<bool(size_t)>& match,
+                                TaskScheduler& scheduler = TaskScheduler::instance());
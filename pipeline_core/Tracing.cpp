@@ -0,0 +1,127 @@
+#include "Tracing.h"
+
+#include <cstdio>
+
+#include "AtomicFile.h"
+
+using namespace std;
+
+namespace {
+
+int64_t nanoseconds(TraceRecorder::Clock::time_point point) {
+    return chrono::duration_cast<chrono::nanoseconds>(point.time_since_epoch()).count();
+}
+
+// Время в микросекундах с точностью до наносекунды - единица формата
+void writeMicroseconds(ostream& out, int64_t value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%lld.%03lld", static_cast<long long>(value / 1000),
+             static_cast<long long>(value % 1000));
+    out << text;
+}
+
+void writeJsonString(ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+}
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+// Буфер регистрируется при первом событии потока. Реестр держит его и
+// после завершения потока, поэтому события рабочих потоков не теряются.
+TraceRecorder::ThreadBuffer& TraceRecorder::localBuffer() {
+    thread_local shared_ptr<ThreadBuffer> local;
+    if (!local) {
+        local = make_shared<ThreadBuffer>();
+        lock_guard<mutex> lock(registryMutex);
+        local->threadId = static_cast<uint32_t>(buffers.size() + 1);
+        buffers.push_back(local);
+    }
+    return *local;
+}
+
+void TraceRecorder::start() {
+    lock_guard<mutex> lock(registryMutex);
+    for (const auto& buffer : buffers) {
+        lock_guard<mutex> bufferLock(buffer->mutex);
+        buffer->events.clear();
+        buffer->dropped = 0;
+    }
+    origin.store(nanoseconds(Clock::now()), memory_order_relaxed);
+    active.store(true, memory_order_relaxed);
+}
+
+void TraceRecorder::stop() {
+    active.store(false, memory_order_relaxed);
+}
+
+void TraceRecorder::record(const char* name, Clock::time_point begin, Clock::time_point end) {
+    ThreadBuffer& buffer = localBuffer();
+    lock_guard<mutex> lock(buffer.mutex);
+    if (buffer.events.size() >= MaxEventsPerThread) {
+        ++buffer.dropped;
+        return;
+    }
+    const int64_t startNs = nanoseconds(begin);
+    buffer.events.push_back({name, startNs, nanoseconds(end) - startNs});
+}
+
+size_t TraceRecorder::eventCount() const {
+    lock_guard<mutex> lock(registryMutex);
+    size_t count = 0;
+    for (const auto& buffer : buffers) {
+        lock_guard<mutex> bufferLock(buffer->mutex);
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+// Объектный формат: события полного отрезка (ph "X") и имена потоков (ph "M")
+void TraceRecorder::writeChromeTrace(ostream& out) const {
+    const int64_t base = origin.load(memory_order_relaxed);
+    size_t dropped = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"pipeline\"}}";
+
+    lock_guard<mutex> lock(registryMutex);
+    for (const auto& buffer : buffers) {
+        lock_guard<mutex> bufferLock(buffer->mutex);
+        dropped += buffer->dropped;
+        if (buffer->events.empty()) {
+            continue;
+        }
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"поток " << buffer->threadId << "\"}}";
+        for (const Event& event : buffer->events) {
+            if (event.start < base) {
+                continue;  // отрезок начался до start() и закрылся после
+            }
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":";
+            writeMicroseconds(out, event.start - base);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.duration);
+            out << ",\"pid\":1,\"tid\":" << buffer->threadId << '}';
+        }
+    }
+    out << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+}
+
+bool TraceRecorder::saveChromeTrace(const string& filename) const {
+    return writeFileAtomically(filename, [this](ostream& file) {
+        writeChromeTrace(file);
+        return file.good();
+    });
+}
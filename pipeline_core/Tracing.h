@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Запись трассы выполнения в формате Chrome trace events (открывается в
+// Perfetto и chrome://tracing). Отрезки пишутся в буфер своего потока без
+// общих блокировок; буферы собираются в файл по запросу. Запись включается
+// и выключается во время работы, выключенный отрезок - одна проверка флага.
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Больше событий на поток не хранится, лишние только считаются
+    static constexpr size_t MaxEventsPerThread = size_t(1) << 20;
+
+private:
+    struct Event {
+        const char* name;  // строковый литерал
+        int64_t start;     // нс от начала эпохи Clock
+        int64_t duration;
+    };
+
+    // Мьютекс буфера нужен только на время выгрузки и очистки: пишет в
+    // буфер один поток, поэтому блокировка почти всегда свободна
+    struct ThreadBuffer {
+        uint32_t threadId = 0;
+        std::mutex mutex;
+        std::vector<Event> events;
+        size_t dropped = 0;
+    };
+
+    std::atomic<bool> active{false};
+    std::atomic<int64_t> origin{0};
+    mutable std::mutex registryMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    ThreadBuffer& localBuffer();
+
+public:
+    static TraceRecorder& instance();
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+    // Начинает новую трассу: прежние события удаляются
+    void start();
+    // Останавливает запись; собранные события остаются для выгрузки
+    void stop();
+
+    void record(const char* name, Clock::time_point begin, Clock::time_point end);
+
+    size_t eventCount() const;
+    void writeChromeTrace(std::ostream& out) const;
+    // Атомарная запись JSON-файла трассы
+    bool saveChromeTrace(const std::string& filename) const;
+};
+
+// Отрезок трассы на время жизни объекта. Вложенные отрезки одного потока
+// Perfetto показывает как вложенные фазы. next() закрывает текущую фазу и
+// открывает следующую, чтобы не дробить код функции на блоки.
+// name должно жить до выгрузки трассы (используются литералы).
+class TraceSpan {
+private:
+    const char* name;
+    bool active;
+    TraceRecorder::Clock::time_point start;
+
+    void finish() {
+        if (active) {
+            TraceRecorder::instance().record(name, start, TraceRecorder::Clock::now());
+            active = false;
+        }
+    }
+
+public:
+    explicit TraceSpan(const char* name) : name(name), active(TraceRecorder::instance().enabled()) {
+        if (active) {
+            start = TraceRecorder::Clock::now();
+        }
+    }
+
+    ~TraceSpan() { finish(); }
+
+    void next(const char* nextName) {
+        finish();
+        name = nextName;
+        active = TraceRecorder::instance().enabled();
+        if (active) {
+            start = TraceRecorder::Clock::now();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
@@ -0,0 +1,687 @@
+#include "TransientSimulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#include "AtomicFile.h"
+#include "GraphPartitioner.h"
+#include "NetworkIslands.h"
+#include "PipeIndex.h"
+
+using namespace std;
+
+namespace {
+
+const double SECONDS_PER_DAY = 86400;
+// Нормальное давление, МПа: запас газа в млн м3 = объем * P / P_STD / 1e6
+const double P_STD = 0.101325;
+const double PI = 3.14159265358979323846;
+
+// Совпадение моментов времени, с
+const double TIME_EPS = 1e-6;
+
+// Явная схема берет эту долю предельного по устойчивости шага
+const double EXPLICIT_SAFETY = 0.9;
+
+// Неявный шаг: итерации Ньютона, точность линейных решений и
+// наименьший шаг, до которого дробится несошедшийся шаг, с
+const int MAX_NEWTON_ITERATIONS = 8;
+const double LINEAR_TOLERANCE = 1e-8;
+const double MIN_IMPLICIT_STEP = 1e-2;
+
+const double MIN_PRESSURE = 1e-3;
+
+// Частичные минимумы потоков разнесены по разным кэш-линиям
+const size_t PAD = 8;
+
+}
+
+TransientSimulator::TransientSimulator(const PersistentVector<NetworkConnection>& network,
+                                       const PersistentVector<Pipe>& pipes,
+                                       const PersistentVector<CompressorStation>& stations,
+                                       const TransientSettings& settings)
+    : settings(settings) {
+    const FlowResult steady = GasFlowSolver(network, pipes, stations, settings.flow).solve();
+    unordered_map<int64_t, const FlowNode*> steadyByNode;
+    for (const FlowNode& node : steady.nodes) {
+        steadyByNode[NetworkIslands::nodeIndex(node.id, node.isStation)] = &node;
+    }
+
+    PipeIndex pipeById(pipes);
+    unordered_map<int, int> activeById;
+    for (const auto& station : stations) {
+        activeById[station.id] = station.activeWorkshops;
+    }
+
+    // Узлы во временной нумерации; после построения они перенумеровываются
+    // по частям разбиения сети (partitionGraph), узлы каждой части - подряд
+    vector<char> fixed;
+    unordered_map<int64_t, int> localByNode;
+    auto addNode = [&](double p, bool isFixed) {
+        pressure.push_back(p);
+        capacity.push_back(0.0);
+        fixed.push_back(isFixed);
+        return static_cast<int>(pressure.size() - 1);
+    };
+    auto localOf = [&](int id, bool isStation) {
+        int64_t key = NetworkIslands::nodeIndex(id, isStation);
+        auto found = localByNode.find(key);
+        if (found != localByNode.end()) {
+            return found->second;
+        }
+        double p = settings.flow.deliveryPressure;
+        bool isFixed = false;
+        auto node = steadyByNode.find(key);
+        if (node != steadyByNode.end() && node->second->role != FlowNodeRole::Undetermined) {
+            p = node->second->pressure;
+            isFixed = node->second->role != FlowNodeRole::Junction;
+        }
+        int local = addNode(p, isFixed);
+        localByNode[key] = local;
+        if (isStation) {
+            stationIndexById[id] = static_cast<int>(stationIds.size());
+            stationIds.push_back(id);
+            stationNode.push_back(local);
+            auto active = activeById.find(id);
+            stationActive.push_back(active != activeById.end() ? active->second : 0);
+        }
+        return local;
+    };
+
+    pipeFirstLink.push_back(0);
+    for (const auto& conn : network) {
+        const Pipe* pipe = pipeById.find(conn.pipeId);
+        if (!pipe) {
+            continue;
+        }
+        bool fromStation = startIsStation(*pipe);
+        int from = localOf(pipe->startId, fromStation);
+        int to = localOf(pipe->endId, endIsStation(*pipe));
+        if (from == to) {
+            continue;
+        }
+
+        int station = fromStation ? stationIndexById[pipe->startId] : -1;
+        pipeIndexById[conn.pipeId] = static_cast<int>(pipeIds.size());
+        pipeIds.push_back(conn.pipeId);
+        pipeStation.push_back(station);
+        pipeOpen.push_back(!pipe->underRepair);
+
+        // Внутренние точки - по профилю установившегося течения: квадрат
+        // давления линейно убывает вдоль трубы
+        const double length = max(pipe->length, 1e-3);
+        const int cells = max(1, static_cast<int>(ceil(length / settings.cellLength)));
+        const double boost = station != -1 ? GasFlowSolver::compressionBoost(settings.flow, stationActive[station]) : 1.0;
+        const double inlet = boost * pressure[from] * pressure[from];
+        const double outlet = pressure[to] * pressure[to];
+        const double conductance = GasFlowSolver::pipeConductance(pipe->diameter, length / cells);
+        const double diameter = pipe->diameter / 1000.0;
+        const double cellCapacity = PI / 4 * diameter * diameter * (length / cells * 1000) / (P_STD * 1e6);
+
+        int previous = from;
+        for (int cell = 1; cell <= cells; ++cell) {
+            int next = to;
+            if (cell < cells) {
+                double squared = inlet - (inlet - outlet) * cell / cells;
+                next = addNode(sqrt(max(squared, MIN_PRESSURE * MIN_PRESSURE)), false);
+            }
+            linkFrom.push_back(previous);
+            linkTo.push_back(next);
+            linkConductance.push_back(conductance);
+            linkOpen.push_back(pipeOpen.back() ? 1.0 : 0.0);
+            capacity[previous] += cellCapacity / 2;
+            capacity[next] += cellCapacity / 2;
+            previous = next;
+        }
+        pipeFirstLink.push_back(static_cast<int>(linkFrom.size()));
+    }
+
+    const size_t nodeCount = pressure.size();
+    const size_t linkCount = linkFrom.size();
+
+    size_t threads = settings.flow.threads ? settings.flow.threads : TaskScheduler::instance().concurrency();
+    // На малых сетях потоки только мешают
+    threadCount = min(threads, max<size_t>(1, nodeCount / 20000));
+
+    // Перестановка узлов: каждая часть разбиения - связная область сети с
+    // малым числом разрезанных труб, узлы части идут подряд
+    vector<pair<int, int>> edges(linkCount);
+    for (size_t l = 0; l < linkCount; ++l) {
+        edges[l] = {linkFrom[l], linkTo[l]};
+    }
+    const vector<int> newIndex = partitionGraph(nodeCount, edges, threadCount).newIndex;
+    auto permute = [&](auto& values) {
+        auto old = values;
+        for (size_t i = 0; i < nodeCount; ++i) {
+            values[newIndex[i]] = old[i];
+        }
+    };
+    permute(pressure);
+    permute(capacity);
+    permute(fixed);
+    for (size_t l = 0; l < linkCount; ++l) {
+        linkFrom[l] = newIndex[linkFrom[l]];
+        linkTo[l] = newIndex[linkTo[l]];
+    }
+    for (int& node : stationNode) {
+        node = newIndex[node];
+    }
+    nodeOrder = newIndex;
+
+    // Узел без единой трубы (петля на себя) не имеет объема - его давление не меняется
+    unknownOf.assign(nodeCount, -1);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (!fixed[i] && capacity[i] > 0) {
+            unknownOf[i] = static_cast<int>(nodeOfUnknown.size());
+            nodeOfUnknown.push_back(static_cast<int>(i));
+        }
+    }
+
+    vector<pair<int, int>> offDiagonal;
+    incidentStart.assign(nodeCount + 1, 0);
+    for (size_t l = 0; l < linkCount; ++l) {
+        incidentStart[linkFrom[l] + 1]++;
+        incidentStart[linkTo[l] + 1]++;
+        int u = unknownOf[linkFrom[l]];
+        int v = unknownOf[linkTo[l]];
+        if (u != -1 && v != -1) {
+            offDiagonal.push_back({u, v});
+            offDiagonal.push_back({v, u});
+        }
+    }
+    for (size_t i = 0; i < nodeCount; ++i) {
+        incidentStart[i + 1] += incidentStart[i];
+    }
+    pattern = SparsePattern(nodeOfUnknown.size(), offDiagonal);
+
+    incident.resize(2 * linkCount);
+    incidentSlot.resize(2 * linkCount);
+    vector<int> fill(incidentStart.begin(), incidentStart.end() - 1);
+    for (size_t l = 0; l < linkCount; ++l) {
+        int from = linkFrom[l];
+        int to = linkTo[l];
+        incidentSlot[fill[from]] = pattern.slot(unknownOf[from], unknownOf[to]);
+        incident[fill[from]++] = 2 * static_cast<int>(l) + 1;
+        incidentSlot[fill[to]] = pattern.slot(unknownOf[to], unknownOf[from]);
+        incident[fill[to]++] = 2 * static_cast<int>(l);
+    }
+
+    linkBoost.assign(linkCount, 1.0);
+    linkFlow.assign(linkCount, 0.0);
+    linkDerivative.assign(linkCount, 0.0);
+    updateBoosts();
+}
+
+int TransientSimulator::findPipe(int pipeId) const {
+    auto it = pipeIndexById.find(pipeId);
+    return it != pipeIndexById.end() ? it->second : -1;
+}
+
+int TransientSimulator::findStation(int stationId) const {
+    auto it = stationIndexById.find(stationId);
+    return it != stationIndexById.end() ? it->second : -1;
+}
+
+void TransientSimulator::updateBoosts() {
+    for (size_t p = 0; p < pipeIds.size(); ++p) {
+        if (pipeStation[p] != -1) {
+            linkBoost[pipeFirstLink[p]] = GasFlowSolver::compressionBoost(settings.flow, stationActive[pipeStation[p]]);
+        }
+    }
+}
+
+bool TransientSimulator::scheduleWorkshops(double at, int stationId, int activeWorkshops) {
+    int index = findStation(stationId);
+    if (index == -1) {
+        return false;
+    }
+    Event event{at, true, index, max(activeWorkshops, 0)};
+    auto position = upper_bound(events.begin(), events.end(), at,
+                                [](double value, const Event& other) { return value < other.time; });
+    events.insert(position, event);
+    return true;
+}
+
+bool TransientSimulator::schedulePipeRepair(double at, int pipeId, bool underRepair) {
+    int index = findPipe(pipeId);
+    if (index == -1) {
+        return false;
+    }
+    Event event{at, false, index, underRepair ? 1 : 0};
+    auto position = upper_bound(events.begin(), events.end(), at,
+                                [](double value, const Event& other) { return value < other.time; });
+    events.insert(position, event);
+    return true;
+}
+
+void TransientSimulator::applyEvent(const Event& event) {
+    if (event.isStation) {
+        stationActive[event.index] = event.value;
+        updateBoosts();
+        return;
+    }
+    pipeOpen[event.index] = event.value == 0;
+    for (int l = pipeFirstLink[event.index]; l < pipeFirstLink[event.index + 1]; ++l) {
+        linkOpen[l] = pipeOpen[event.index] ? 1.0 : 0.0;
+    }
+}
+
+bool TransientSimulator::watchStation(int stationId) {
+    int index = findStation(stationId);
+    if (index == -1 || !sampleTimes.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (series[i].isStation && seriesIndex[i] == index) {
+            return true;
+        }
+    }
+    series.push_back({stationId, true, {}});
+    seriesIndex.push_back(index);
+    return true;
+}
+
+bool TransientSimulator::watchPipe(int pipeId) {
+    int index = findPipe(pipeId);
+    if (index == -1 || !sampleTimes.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (!series[i].isStation && seriesIndex[i] == index) {
+            return true;
+        }
+    }
+    series.push_back({pipeId, false, {}});
+    seriesIndex.push_back(index);
+    return true;
+}
+
+// Цикл по участкам без ветвлений по массивам подряд - векторизуется компилятором
+void TransientSimulator::computeFlows(WorkerTeam& team) {
+    team.run([&](size_t w) {
+        auto [begin, end] = team.chunk(w, linkFrom.size());
+        for (size_t l = begin; l < end; ++l) {
+            double from = pressure[linkFrom[l]];
+            double to = pressure[linkTo[l]];
+            GasFlowSolver::pipeFlow(linkConductance[l] * linkOpen[l], linkBoost[l] * from * from - to * to,
+                                    linkFlow[l], linkDerivative[l]);
+        }
+    });
+}
+
+void TransientSimulator::record(WorkerTeam& team) {
+    computeFlows(team);
+    sampleTimes.push_back(time);
+    for (size_t i = 0; i < series.size(); ++i) {
+        int index = seriesIndex[i];
+        series[i].values.push_back(series[i].isStation ? pressure[stationNode[index]] : linkFlow[pipeFirstLink[index]]);
+    }
+}
+
+double TransientSimulator::explicitStep(WorkerTeam& team, double limit) {
+    computeFlows(team);
+
+    // Предел устойчивости узла - емкость, деленная на производную его небаланса по давлению
+    const size_t workers = team.size();
+    vector<double> partial(workers * PAD, numeric_limits<double>::infinity());
+    team.run([&](size_t w) {
+        auto [begin, end] = team.chunk(w, nodeOfUnknown.size());
+        double smallest = numeric_limits<double>::infinity();
+        for (size_t row = begin; row < end; ++row) {
+            int node = nodeOfUnknown[row];
+            double stiffness = 0;
+            for (int k = incidentStart[node]; k < incidentStart[node + 1]; ++k) {
+                int l = incident[k] >> 1;
+                double factor = (incident[k] & 1) ? linkBoost[l] : 1.0;
+                stiffness += 2 * linkDerivative[l] * factor * pressure[node];
+            }
+            if (stiffness > 0) {
+                smallest = min(smallest, capacity[node] / stiffness);
+            }
+        }
+        partial[w * PAD] = smallest;
+    });
+    double stable = numeric_limits<double>::infinity();
+    for (size_t w = 0; w < workers; ++w) {
+        stable = min(stable, partial[w * PAD]);
+    }
+    const double dt = min(limit, EXPLICIT_SAFETY * stable * SECONDS_PER_DAY);
+    const double days = dt / SECONDS_PER_DAY;
+
+    team.run([&](size_t w) {
+        auto [begin, end] = team.chunk(w, nodeOfUnknown.size());
+        for (size_t row = begin; row < end; ++row) {
+            int node = nodeOfUnknown[row];
+            double inflow = 0;
+            for (int k = incidentStart[node]; k < incidentStart[node + 1]; ++k) {
+                double flow = linkFlow[incident[k] >> 1];
+                inflow += (incident[k] & 1) ? -flow : flow;
+            }
+            // Другие потоки читают pressure только в computeFlows, так что запись безопасна
+            pressure[node] = max(pressure[node] + days * inflow / capacity[node], MIN_PRESSURE);
+        }
+    });
+    return dt;
+}
+
+// Неявный шаг Эйлера: C (p - pOld) / dt = приток - отток, решается методом Ньютона
+bool TransientSimulator::implicitStep(WorkerTeam& team, double dt) {
+    const size_t unknowns = nodeOfUnknown.size();
+    const size_t workers = team.size();
+    const double days = dt / SECONDS_PER_DAY;
+
+    vector<double> previous(unknowns);
+    for (size_t row = 0; row < unknowns; ++row) {
+        previous[row] = pressure[nodeOfUnknown[row]];
+    }
+
+    vector<double> values(pattern.size()), rhs(unknowns), step;
+    vector<double> partial(workers * PAD, 0.0);
+    for (int iteration = 0; iteration < MAX_NEWTON_ITERATIONS; ++iteration) {
+        computeFlows(team);
+
+        // Каждый поток собирает строки своей области - без гонок за общие элементы
+        team.run([&](size_t w) {
+            auto [begin, end] = team.chunk(w, unknowns);
+            double worst = 0;
+            for (size_t row = begin; row < end; ++row) {
+                int node = nodeOfUnknown[row];
+                fill(values.begin() + pattern.rowStart[row], values.begin() + pattern.rowStart[row + 1], 0.0);
+                double residual = capacity[node] * (pressure[node] - previous[row]) / days;
+                double diagonal = capacity[node] / days;
+                for (int k = incidentStart[node]; k < incidentStart[node + 1]; ++k) {
+                    int l = incident[k] >> 1;
+                    double derivative = 2 * linkDerivative[l];
+                    double offDiagonal;
+                    if (incident[k] & 1) {
+                        residual += linkFlow[l];
+                        diagonal += derivative * linkBoost[l] * pressure[node];
+                        offDiagonal = -derivative * pressure[linkTo[l]];
+                    } else {
+                        residual -= linkFlow[l];
+                        diagonal += derivative * pressure[node];
+                        offDiagonal = -derivative * linkBoost[l] * pressure[linkFrom[l]];
+                    }
+                    if (incidentSlot[k] != -1) {
+                        values[incidentSlot[k]] += offDiagonal;
+                    }
+                }
+                values[pattern.diagonalSlot[row]] = diagonal;
+                rhs[row] = -residual;
+                worst = max(worst, fabs(residual));
+            }
+            partial[w * PAD] = worst;
+        });
+
+        double worst = 0;
+        for (size_t w = 0; w < workers; ++w) {
+            worst = max(worst, partial[w * PAD]);
+        }
+        if (worst <= settings.flow.tolerance) {
+            return true;
+        }
+
+        if (!solveBiCGStab(team, pattern, values, rhs, LINEAR_TOLERANCE, step)) {
+            return false;
+        }
+        for (size_t row = 0; row < unknowns; ++row) {
+            int node = nodeOfUnknown[row];
+            pressure[node] = max(pressure[node] + step[row], MIN_PRESSURE);
+        }
+    }
+    return false;
+}
+
+void TransientSimulator::advance(WorkerTeam& team, double duration) {
+    if (settings.scheme == TimeScheme::Explicit) {
+        for (double done = 0; done < duration - TIME_EPS;) {
+            done += explicitStep(team, duration - done);
+            steps++;
+        }
+        return;
+    }
+
+    // Несошедшийся шаг дробится пополам, после удачного шаг снова растет.
+    // Не сошедшийся и на наименьшем шаге принимается, но учитывается
+    double dt = min(settings.timeStep, duration);
+    vector<double> saved;
+    for (double remaining = duration; remaining > TIME_EPS;) {
+        dt = min(dt, remaining);
+        saved = pressure;
+        const bool converged = implicitStep(team, dt);
+        if (converged || dt <= MIN_IMPLICIT_STEP) {
+            unconvergedSteps += !converged;
+            remaining -= dt;
+            steps++;
+            dt = min(2 * dt, settings.timeStep);
+        } else {
+            pressure.swap(saved);
+            dt /= 2;
+        }
+    }
+}
+
+TransientStatus TransientSimulator::run(double duration) {
+    // При нулевом периоде записи или шаге цикл ниже не продвигался бы
+    if (!(settings.sampleInterval > 0) || !(settings.timeStep > 0) || !isfinite(duration)) {
+        return TransientStatus::BadSettings;
+    }
+    WorkerTeam team(threadCount);
+    const size_t unconvergedBefore = unconvergedSteps;
+
+    const double end = time + max(duration, 0.0);
+    while (true) {
+        while (!events.empty() && events.front().time <= time + TIME_EPS) {
+            applyEvent(events.front());
+            events.erase(events.begin());
+        }
+        if (time + TIME_EPS >= nextSample) {
+            record(team);
+            nextSample += settings.sampleInterval;
+        }
+        if (time >= end - TIME_EPS) {
+            break;
+        }
+
+        // Шаги не перешагивают события и моменты записи
+        double target = min(end, nextSample);
+        if (!events.empty()) {
+            target = min(target, events.front().time);
+        }
+        advance(team, target - time);
+        time = target;
+    }
+    return unconvergedSteps == unconvergedBefore ? TransientStatus::Ok : TransientStatus::NotConverged;
+}
+
+bool TransientSimulator::saveCheckpoint(const string& filename) const {
+    return writeFileAtomically(filename, [&](ostream& file) {
+        file << setprecision(17);
+        file << "CHECKPOINT 2\n";
+        file << "TRANSIENT " << pressure.size() << ' ' << linkFrom.size() << '\n';
+        file << "TIME " << time << ' ' << nextSample << ' ' << steps << ' ' << unconvergedSteps << '\n';
+
+        file << "PIPES " << pipeIds.size();
+        for (size_t p = 0; p < pipeIds.size(); ++p) {
+            file << ' ' << pipeIds[p] << ' ' << static_cast<int>(pipeOpen[p]);
+        }
+        file << "\nSTATIONS " << stationIds.size();
+        for (size_t s = 0; s < stationIds.size(); ++s) {
+            file << ' ' << stationIds[s] << ' ' << stationActive[s];
+        }
+        file << "\nPRESSURE";
+        for (int node : nodeOrder) {
+            file << ' ' << pressure[node];
+        }
+
+        file << "\nEVENTS " << events.size();
+        for (const Event& event : events) {
+            file << ' ' << event.time << ' ' << event.isStation << ' '
+                 << (event.isStation ? stationIds[event.index] : pipeIds[event.index]) << ' ' << event.value;
+        }
+        file << "\nSAMPLES " << sampleTimes.size();
+        for (double t : sampleTimes) {
+            file << ' ' << t;
+        }
+        file << "\nSERIES " << series.size() << '\n';
+        for (const TransientSeries& item : series) {
+            file << item.objectId << ' ' << item.isStation;
+            for (double value : item.values) {
+                file << ' ' << value;
+            }
+            file << '\n';
+        }
+        return static_cast<bool>(file);
+    });
+}
+
+CheckpointStatus TransientSimulator::loadCheckpoint(const string& filename) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        return CheckpointStatus::FileNotFound;
+    }
+    file.seekg(0, ios::end);
+    const streamoff fileSize = file.tellg();
+    file.seekg(0);
+
+    auto expect = [&file](const char* keyword) {
+        string word;
+        return file >> word && word == keyword;
+    };
+    // Каждое число в файле занимает не меньше двух символов (с разделителем),
+    // поэтому счетчик, которому не хватает остатка файла, - порча; память под
+    // элементы выделяется только после этой проверки
+    auto fits = [&file, fileSize](size_t count, size_t numbersPerItem) {
+        const streamoff position = file.tellg();
+        return position >= 0 && count <= static_cast<size_t>(fileSize - position) / (2 * numbersPerItem);
+    };
+
+    // Версия 1 хранила давления в зависящей от числа потоков нумерации
+    int version = 0;
+    size_t nodeCount = 0, linkCount = 0;
+    if (!expect("CHECKPOINT") || !(file >> version) || version != 2 || !expect("TRANSIENT") ||
+        !(file >> nodeCount >> linkCount)) {
+        return CheckpointStatus::BadFormat;
+    }
+    if (nodeCount != pressure.size() || linkCount != linkFrom.size()) {
+        return CheckpointStatus::Mismatch;
+    }
+
+    double newTime = 0, newNextSample = 0;
+    size_t newSteps = 0, newUnconverged = 0;
+    if (!expect("TIME") || !(file >> newTime >> newNextSample >> newSteps >> newUnconverged)) {
+        return CheckpointStatus::BadFormat;
+    }
+
+    size_t count = 0;
+    if (!expect("PIPES") || !(file >> count)) {
+        return CheckpointStatus::BadFormat;
+    }
+    if (count != pipeIds.size()) {
+        return CheckpointStatus::Mismatch;
+    }
+    vector<char> newOpen(count);
+    for (size_t p = 0; p < count; ++p) {
+        int id = 0, open = 0;
+        if (!(file >> id >> open)) {
+            return CheckpointStatus::BadFormat;
+        }
+        if (id != pipeIds[p]) {
+            return CheckpointStatus::Mismatch;
+        }
+        newOpen[p] = open != 0;
+    }
+
+    if (!expect("STATIONS") || !(file >> count)) {
+        return CheckpointStatus::BadFormat;
+    }
+    if (count != stationIds.size()) {
+        return CheckpointStatus::Mismatch;
+    }
+    vector<int> newActive(count);
+    for (size_t s = 0; s < count; ++s) {
+        int id = 0;
+        if (!(file >> id >> newActive[s])) {
+            return CheckpointStatus::BadFormat;
+        }
+        if (id != stationIds[s]) {
+            return CheckpointStatus::Mismatch;
+        }
+    }
+
+    vector<double> newPressure(nodeCount);
+    if (!expect("PRESSURE")) {
+        return CheckpointStatus::BadFormat;
+    }
+    for (int node : nodeOrder) {
+        if (!(file >> newPressure[node])) {
+            return CheckpointStatus::BadFormat;
+        }
+    }
+
+    if (!expect("EVENTS") || !(file >> count) || !fits(count, 4)) {
+        return CheckpointStatus::BadFormat;
+    }
+    vector<Event> newEvents(count);
+    for (Event& event : newEvents) {
+        int id = 0;
+        if (!(file >> event.time >> event.isStation >> id >> event.value)) {
+            return CheckpointStatus::BadFormat;
+        }
+        event.index = event.isStation ? findStation(id) : findPipe(id);
+        if (event.index == -1) {
+            return CheckpointStatus::Mismatch;
+        }
+    }
+
+    if (!expect("SAMPLES") || !(file >> count) || !fits(count, 1)) {
+        return CheckpointStatus::BadFormat;
+    }
+    vector<double> newSampleTimes(count);
+    for (double& t : newSampleTimes) {
+        if (!(file >> t)) {
+            return CheckpointStatus::BadFormat;
+        }
+    }
+
+    if (!expect("SERIES") || !(file >> count) || !fits(count, 2)) {
+        return CheckpointStatus::BadFormat;
+    }
+    vector<TransientSeries> newSeries(count);
+    vector<int> newSeriesIndex(count);
+    for (size_t i = 0; i < count; ++i) {
+        TransientSeries& item = newSeries[i];
+        if (!(file >> item.objectId >> item.isStation) || !fits(newSampleTimes.size(), 1)) {
+            return CheckpointStatus::BadFormat;
+        }
+        newSeriesIndex[i] = item.isStation ? findStation(item.objectId) : findPipe(item.objectId);
+        if (newSeriesIndex[i] == -1) {
+            return CheckpointStatus::Mismatch;
+        }
+        item.values.resize(newSampleTimes.size());
+        for (double& value : item.values) {
+            if (!(file >> value)) {
+                return CheckpointStatus::BadFormat;
+            }
+        }
+    }
+
+    time = newTime;
+    nextSample = newNextSample;
+    steps = newSteps;
+    unconvergedSteps = newUnconverged;
+    pressure.swap(newPressure);
+    events.swap(newEvents);
+    sampleTimes.swap(newSampleTimes);
+    series.swap(newSeries);
+    seriesIndex.swap(newSeriesIndex);
+    stationActive.swap(newActive);
+    updateBoosts();
+    for (size_t p = 0; p < pipeIds.size(); ++p) {
+        applyEvent({time, false, static_cast<int>(p), newOpen[p] ? 0 : 1});
+    }
+    return CheckpointStatus::Ok;
+}
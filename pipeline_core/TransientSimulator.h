@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GasFlowSolver.h"
+#include "PersistentVector.h"
+#include "PipelineTypes.h"
+
+enum class TimeScheme {
+    Explicit,  // явная схема; шаг дробится до предела устойчивости
+    Implicit   // неявная схема Эйлера, шаг ограничен только timeStep
+};
+
+struct TransientSettings {
+    FlowSettings flow;            // давления на границах, сжатие КС, число потоков
+    TimeScheme scheme = TimeScheme::Implicit;
+    double timeStep = 60;         // с, наибольший шаг по времени
+    double cellLength = 10;       // км, длина расчетной ячейки трубы
+    double sampleInterval = 600;  // с, период записи временных рядов
+};
+
+enum class CheckpointStatus {
+    Ok,
+    FileNotFound,
+    BadFormat,
+    Mismatch  // контрольная точка записана для другой сети
+};
+
+enum class TransientStatus {
+    Ok,
+    BadSettings,  // timeStep или sampleInterval не положительны - моделирование не выполнялось
+    NotConverged  // часть неявных шагов наименьшей длины принята без сходимости метода Ньютона
+};
+
+// Временной ряд одного объекта с шагом sampleInterval
+struct TransientSeries {
+    int objectId;
+    bool isStation;  // true - давление на входе КС, МПа; false - расход на входе трубы, млн м3/сут
+    std::vector<double> values;
+};
+
+// Переходный режим течения газа. Трубы делятся на ячейки длиной около
+// cellLength; в узлах сети и ячейках хранится давление, по участкам между
+// ними течет газ по закону Веймаута (инерция газа не учитывается). Запас
+// газа в ячейке пропорционален ее объему и давлению. Начальное состояние -
+// установившийся режим GasFlowSolver, роли узлов (вход, выход) фиксируются
+// по нему. Трубы в ремонте перекрыты с обоих концов, газ в них сохраняется.
+//
+// Состояние хранится структурой массивов: давления и емкости узлов,
+// концы, проводимости и расходы участков - подряд, без указателей.
+// Узлы нумеруются по частям разбиения сети (GraphPartitioner.h) по числу
+// потоков: явный шаг и блоки предобусловливателя неявного шага каждый
+// поток считает в своей области. Эта нумерация зависит от машины, поэтому
+// контрольная точка хранит давления в порядке построения узлов по сети.
+class TransientSimulator {
+private:
+    struct Event {
+        double time;
+        bool isStation;  // true - число работающих цехов, false - ремонт трубы
+        int index;       // индекс КС или трубы в stationIds / pipeIds
+        int value;
+    };
+
+    TransientSettings settings;
+    size_t threadCount = 1;
+
+    // Узлы: узлы сети и внутренние точки труб
+    std::vector<double> pressure;  // МПа
+    std::vector<double> capacity;  // млн м3 на МПа
+    std::vector<int> nodeOrder;    // узел по номеру в порядке построения (не зависит от потоков)
+    std::vector<int> unknownOf;    // строка неявной системы или -1 для заданного давления
+    std::vector<int> nodeOfUnknown;
+    std::vector<int> incidentStart;  // CSR: участки узла; 2 * участок + 1, если узел - начало участка
+    std::vector<int> incident;
+    std::vector<int> incidentSlot;   // позиция (узел, сосед) в матрице неявной схемы или -1
+
+    // Участки труб между соседними узлами
+    std::vector<int> linkFrom;
+    std::vector<int> linkTo;
+    std::vector<double> linkConductance;
+    std::vector<double> linkBoost;  // квадрат степени сжатия; не 1 только у первого участка после КС
+    std::vector<double> linkOpen;   // 0 - труба в ремонте
+    std::vector<double> linkFlow;   // млн м3/сут
+    std::vector<double> linkDerivative;  // dQ по перепаду квадратов давлений
+
+    // Трубы: участки трубы i - [pipeFirstLink[i], pipeFirstLink[i + 1])
+    std::vector<int> pipeIds;
+    std::vector<int> pipeFirstLink;
+    std::vector<int> pipeStation;  // КС в начале трубы (индекс в stationIds) или -1
+    std::vector<char> pipeOpen;
+
+    std::vector<int> stationIds;
+    std::vector<int> stationNode;
+    std::vector<int> stationActive;
+
+    std::unordered_map<int, int> pipeIndexById;
+    std::unordered_map<int, int> stationIndexById;
+
+    SparsePattern pattern;
+
+    double time = 0;
+    double nextSample = 0;
+    size_t steps = 0;
+    size_t unconvergedSteps = 0;
+    std::vector<Event> events;  // ожидающие, по возрастанию времени
+    std::vector<double> sampleTimes;
+    std::vector<TransientSeries> series;
+    std::vector<int> seriesIndex;  // индекс КС или трубы ряда
+
+    int findPipe(int pipeId) const;
+    int findStation(int stationId) const;
+    void applyEvent(const Event& event);
+    void updateBoosts();
+    void record(WorkerTeam& team);
+
+    void computeFlows(WorkerTeam& team);
+    void advance(WorkerTeam& team, double duration);
+    // Шаг явной схемы не длиннее limit; возвращает сделанный шаг
+    double explicitStep(WorkerTeam& team, double limit);
+    bool implicitStep(WorkerTeam& team, double dt);
+
+public:
+    TransientSimulator(const PersistentVector<NetworkConnection>& network, const PersistentVector<Pipe>& pipes,
+                       const PersistentVector<CompressorStation>& stations, const TransientSettings& settings = {});
+
+    // Изменения в момент time (с от начала моделирования). false - объекта нет в сети.
+    bool scheduleWorkshops(double time, int stationId, int activeWorkshops);
+    bool schedulePipeRepair(double time, int pipeId, bool underRepair);
+
+    // Объекты, для которых пишутся временные ряды. false - объекта нет
+    // в сети или запись уже начата (наблюдения задаются до первого run).
+    bool watchStation(int stationId);
+    bool watchPipe(int pipeId);
+
+    // Продвигает моделирование на duration секунд
+    TransientStatus run(double duration);
+
+    double getTime() const { return time; }
+    size_t getStepCount() const { return steps; }
+    // Шаги, принятые без сходимости, за все время моделирования
+    size_t getUnconvergedStepCount() const { return unconvergedSteps; }
+    size_t getNodeCount() const { return pressure.size(); }
+    const std::vector<double>& getSampleTimes() const { return sampleTimes; }
+    const std::vector<TransientSeries>& getSeries() const { return series; }
+
+    // Контрольная точка: состояние, ожидающие события и накопленные ряды.
+    // Восстанавливать можно только в модель, построенную по той же сети
+    // (число потоков может быть другим).
+    bool saveCheckpoint(const std::string& filename) const;
+    CheckpointStatus loadCheckpoint(const std::string& filename);
+};
@@ -0,0 +1,621 @@
+#include "QueryProtocol.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+#include "pipeline_core/OperationMetrics.h"
+#include "pipeline_core/StringPool.h"
+#include "pipeline_core/Tracing.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Разбор запроса: command и count аргументов, остаток строки - в rest (если нужен)
+bool splitArgs(const string& line, size_t count, vector<string>& args, string* rest = nullptr) {
+    istringstream ss(line);
+    string token;
+    ss >> token;  // команда
+    args.clear();
+    while (args.size() < count && ss >> token) {
+        args.push_back(token);
+    }
+    if (args.size() != count) {
+        return false;
+    }
+
+    string tail;
+    getline(ss, tail);
+    size_t first = tail.find_first_not_of(" \t");
+    tail = first == string::npos ? "" : tail.substr(first);
+    if (rest) {
+        *rest = tail;
+        return !tail.empty();
+    }
+    return tail.empty();
+}
+
+bool parseInt(const string& str, int& value) {
+    try {
+        size_t pos = 0;
+        value = stoi(str, &pos);
+        return pos == str.size();
+    } catch (const exception&) {
+        return false;
+    }
+}
+
+bool parseDouble(const string& str, double& value) {
+    try {
+        size_t pos = 0;
+        value = stod(str, &pos);
+        return pos == str.size();
+    } catch (const exception&) {
+        return false;
+    }
+}
+
+string toUpper(string str) {
+    transform(str.begin(), str.end(), str.begin(), ::toupper);
+    return str;
+}
+
+string idList(const vector<int>& ids) {
+    ostringstream out;
+    out << ids.size();
+    for (int id : ids) {
+        out << ' ' << id;
+    }
+    return out.str();
+}
+
+// Поиск возвращает индексы, а клиенту нужны ID
+template <typename Records>
+string indicesToIds(const Records& records, const vector<int>& indices) {
+    vector<int> ids;
+    ids.reserve(indices.size());
+    for (int index : indices) {
+        ids.push_back(records[index].id);
+    }
+    return "OK " + idList(ids);
+}
+
+const string ERR_SYNTAX = "ERR SYNTAX";
+const string ERR_NOT_FOUND = "ERR NOT_FOUND";
+const string ERR_BAD_PATH = "ERR BAD_PATH";
+const string ERR_NAMES_EXHAUSTED = "ERR NAMES_EXHAUSTED";
+
+string connectStatusName(ConnectStatus status) {
+    switch (status) {
+        case ConnectStatus::Ok: return "OK";
+        case ConnectStatus::SameObject: return "SAME_OBJECT";
+        case ConnectStatus::StartNotFound: return "START_NOT_FOUND";
+        case ConnectStatus::EndNotFound: return "END_NOT_FOUND";
+        case ConnectStatus::StartUnderRepair: return "START_UNDER_REPAIR";
+        case ConnectStatus::EndUnderRepair: return "END_UNDER_REPAIR";
+        case ConnectStatus::AlreadyExists: return "ALREADY_EXISTS";
+        case ConnectStatus::DiameterMismatch: return "DIAMETER_MISMATCH";
+        case ConnectStatus::NoFreePipe: return "NO_FREE_PIPE";
+    }
+    return "UNKNOWN";
+}
+
+string removeStatusReply(RemoveStatus status) {
+    switch (status) {
+        case RemoveStatus::Ok: return "OK";
+        case RemoveStatus::NotFound: return ERR_NOT_FOUND;
+        case RemoveStatus::InUse: return "ERR IN_USE";
+        case RemoveStatus::NotConnected: return "ERR NOT_CONNECTED";
+    }
+    return "ERR UNKNOWN";
+}
+
+// Файлы клиентов - только внутри каталога данных: путь относительный, без
+// "..", и после раскрытия символических ссылок остается в каталоге
+bool resolvePath(const string& dataDir, const string& name, string& path) {
+    const fs::path relative(name);
+    if (relative.empty() || relative.has_root_path()) {
+        return false;
+    }
+    for (const fs::path& part : relative) {
+        if (part == "..") {
+            return false;
+        }
+    }
+    error_code error;
+    const fs::path root = fs::canonical(dataDir, error);
+    if (error) {
+        return false;
+    }
+    const fs::path full = fs::weakly_canonical(root / relative, error);
+    if (error) {
+        return false;
+    }
+    auto [rootEnd, fullRest] = mismatch(root.begin(), root.end(), full.begin(), full.end());
+    if (rootEnd != root.end() || fullRest == full.end()) {
+        return false;
+    }
+    path = full.string();
+    return true;
+}
+
+string pathStatusError(PathStatus status) {
+    switch (status) {
+        case PathStatus::Found: return "OK";
+        case PathStatus::EmptyNetwork: return "ERR EMPTY_NETWORK";
+        case PathStatus::StartNotFound: return "ERR START_NOT_FOUND";
+        case PathStatus::EndNotFound: return "ERR END_NOT_FOUND";
+        case PathStatus::NotInNetwork: return "ERR NOT_IN_NETWORK";
+        case PathStatus::NoPath: return "ERR NO_PATH";
+    }
+    return "ERR UNKNOWN";
+}
+
+}
+
+namespace QueryProtocol {
+
+string commandOf(const string& line) {
+    istringstream ss(line);
+    string command;
+    ss >> command;
+    return toUpper(command);
+}
+
+bool isMutation(const string& command) {
+    static const vector<string> mutations = {
+        "ADDPIPE", "ADDSTATION", "DELPIPE", "DELSTATION", "REPAIR",
+        "WORKSHOP", "CONNECT", "DISCONNECT", "LOAD", "IMPORT", "PATCH"
+    };
+    return find(mutations.begin(), mutations.end(), command) != mutations.end();
+}
+
+bool isBulkFile(const string& command) {
+    static const vector<string> commands = {"SAVE", "EXPORT", "DIFF", "LOAD", "IMPORT"};
+    return find(commands.begin(), commands.end(), command) != commands.end();
+}
+
+bool isBarrier(const string& line) {
+    istringstream ss(line);
+    string command, action;
+    ss >> command >> action;
+    command = toUpper(command);
+    action = toUpper(action);
+    if (command == "METRICS") {
+        return action == "ON" || action == "OFF" || action == "RESET";
+    }
+    if (command == "TRACE") {
+        return true;
+    }
+    if (command == "MEMORY") {
+        return action == "RESET";
+    }
+    if (command == "CACHE") {
+        return action == "CLEAR";
+    }
+    return false;
+}
+
+namespace {
+
+string readRequest(const PipelineCore& core, const string& line, const string& dataDir) {
+    string command = commandOf(line);
+    vector<string> args;
+    string rest;
+    string path;
+    int id = 0;
+
+    if (command == "PING") {
+        return "OK PONG";
+    }
+
+    if (command == "PIPE") {
+        if (!splitArgs(line, 1, args) || !parseInt(args[0], id)) return ERR_SYNTAX;
+        int index = core.findPipeIndexById(id);
+        if (index == -1) return ERR_NOT_FOUND;
+        const Pipe& pipe = core.getPipes()[index];
+        ostringstream out;
+        out << "OK " << pipe.id << ' ' << pipe.length << ' ' << pipe.diameter << ' '
+            << pipe.underRepair << ' ' << pipe.inUse << ' ' << pipe.startId << ' '
+            << pipe.endId << ' ' << pipe.name;
+        return out.str();
+    }
+
+    if (command == "STATION") {
+        if (!splitArgs(line, 1, args) || !parseInt(args[0], id)) return ERR_SYNTAX;
+        int index = core.findStationIndexById(id);
+        if (index == -1) return ERR_NOT_FOUND;
+        const CompressorStation& station = core.getStations()[index];
+        ostringstream out;
+        out << "OK " << station.id << ' ' << station.totalWorkshops << ' '
+            << station.activeWorkshops << ' ' << station.stationClass << ' ' << station.name;
+        return out.str();
+    }
+
+    if (command == "FINDPIPES") {
+        if (!splitArgs(line, 1, args, &rest)) return ERR_SYNTAX;
+        string mode = toUpper(args[0]);
+        if (mode == "NAME") {
+            return indicesToIds(core.getPipes(), core.findPipesByName(rest));
+        }
+        int flag = 0;
+        if (!parseInt(rest, flag)) return ERR_SYNTAX;
+        if (mode == "REPAIR") {
+            return indicesToIds(core.getPipes(), core.findPipesByRepairStatus(flag != 0));
+        }
+        if (mode == "INUSE") {
+            return indicesToIds(core.getPipes(), core.findPipesByUseStatus(flag != 0));
+        }
+        return ERR_SYNTAX;
+    }
+
+    if (command == "FINDSTATIONS") {
+        if (!splitArgs(line, 1, args, &rest)) return ERR_SYNTAX;
+        string mode = toUpper(args[0]);
+        if (mode == "NAME") {
+            return indicesToIds(core.getStations(), core.findStationsByName(rest));
+        }
+        if (mode == "INACTIVE") {
+            int comparisonType = 0;
+            double percent = 0;
+            if (!splitArgs(line, 3, args) || !parseInt(args[1], comparisonType) ||
+                !parseDouble(args[2], percent) || comparisonType < 1 || comparisonType > 3) {
+                return ERR_SYNTAX;
+            }
+            return indicesToIds(core.getStations(), core.findStationsByInactivePercent(percent, comparisonType));
+        }
+        return ERR_SYNTAX;
+    }
+
+    if (command == "PATH") {
+        int startId = 0, endId = 0;
+        if (!splitArgs(line, 2, args) || !parseInt(args[0], startId) || !parseInt(args[1], endId)) {
+            return ERR_SYNTAX;
+        }
+        PathResult result = core.findPath(startId, endId);
+        if (result.status != PathStatus::Found) {
+            return pathStatusError(result.status);
+        }
+        ostringstream out;
+        out << "OK " << result.totalLength << ' ' << idList(result.nodes) << ' ' << idList(result.pipeIds);
+        return out.str();
+    }
+
+    if (command == "ROUTES") {
+        int startId = 0, endId = 0, count = 0;
+        if (!splitArgs(line, 3, args) || !parseInt(args[0], startId) || !parseInt(args[1], endId) ||
+            !parseInt(args[2], count) || count < 1) {
+            return ERR_SYNTAX;
+        }
+        RoutesResult result = core.findAlternativeRoutes(startId, endId, count);
+        if (result.status != PathStatus::Found) {
+            return pathStatusError(result.status);
+        }
+        ostringstream out;
+        out << "OK " << result.routes.size();
+        for (const Route& route : result.routes) {
+            out << ' ' << route.totalLength << ' ' << idList(route.pipeIds);
+        }
+        return out.str();
+    }
+
+    if (command == "TOPO") {
+        TopoSortResult result = core.topologicalSort();
+        if (result.hasCycle) {
+            string reply = "ERR CYCLE";
+            for (int stationId : result.cyclicStations) {
+                reply += ' ' + to_string(stationId);
+            }
+            return reply;
+        }
+        return "OK " + idList(result.order);
+    }
+
+    if (command == "NETSTATS") {
+        NetworkStats stats = core.getNetworkStats();
+        ostringstream out;
+        out << "OK " << stats.connections << ' ' << stats.connectedStations << ' ' << stats.connectedPipes;
+        return out.str();
+    }
+
+    if (command == "SAMEISLAND") {
+        int idA = 0, idB = 0;
+        if (!splitArgs(line, 2, args) || !parseInt(args[0], idA) || !parseInt(args[1], idB)) return ERR_SYNTAX;
+        if (core.getObjectInfo(idA).second == -1 || core.getObjectInfo(idB).second == -1) return ERR_NOT_FOUND;
+        return core.sameIsland(idA, idB) ? "OK 1" : "OK 0";
+    }
+
+    if (command == "ISLANDS") {
+        auto islands = core.getIslands();
+        ostringstream out;
+        out << "OK " << islands.size();
+        for (const auto& island : islands) {
+            out << ' ' << island.stationIds.size() + island.pipeIds.size();
+        }
+        return out.str();
+    }
+
+    if (command == "REACH") {
+        int startId = 0, endId = 0;
+        if (!splitArgs(line, 2, args) || !parseInt(args[0], startId) || !parseInt(args[1], endId)) {
+            return ERR_SYNTAX;
+        }
+        if (core.getObjectInfo(startId).second == -1 || core.getObjectInfo(endId).second == -1) return ERR_NOT_FOUND;
+        return core.canReach(startId, endId) ? "OK 1" : "OK 0";
+    }
+
+    if (command == "FLOW") {
+        FlowSettings settings;
+        if (!splitArgs(line, 0, args)) {
+            if (!splitArgs(line, 2, args) || !parseDouble(args[0], settings.sourcePressure) ||
+                !parseDouble(args[1], settings.deliveryPressure) || settings.deliveryPressure <= 0 ||
+                settings.sourcePressure <= settings.deliveryPressure) {
+                return ERR_SYNTAX;
+            }
+        }
+        FlowResult result = core.solveFlow(settings);
+        ostringstream out;
+        out << "OK " << result.converged << ' ' << result.iterations << ' ' << result.residual << ' '
+            << result.totalSupply;
+        return out.str();
+    }
+
+    if (command == "PARTITION") {
+        int parts = 0;
+        if (!splitArgs(line, 1, args) || !parseInt(args[0], parts) || parts < 1) return ERR_SYNTAX;
+        NetworkPartition partition = core.partitionNetwork(parts);
+        ostringstream out;
+        const size_t count = partition.partStart.size() - 1;
+        out << "OK " << partition.cutPipeIds.size() << ' ' << count;
+        for (size_t p = 0; p < count; ++p) {
+            out << ' ' << partition.partStart[p + 1] - partition.partStart[p];
+        }
+        return out.str();
+    }
+
+    if (command == "SAVE") {
+        if (!splitArgs(line, 0, args, &rest)) return ERR_SYNTAX;
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        const bool compact = rest.size() > 5 && rest.compare(rest.size() - 5, 5, ".snap") == 0;
+        return core.saveToFile(path, compact ? SaveFormat::Compact : SaveFormat::Network) ? "OK" : "ERR IO";
+    }
+
+    if (command == "EXPORT") {
+        if (!splitArgs(line, 1, args, &rest)) return ERR_SYNTAX;
+        string format = toUpper(args[0]);
+        if (format != "DOT" && format != "GRAPHML") return ERR_SYNTAX;
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        return core.exportNetwork(path, format == "DOT" ? ExportFormat::Dot : ExportFormat::GraphML) ? "OK" : "ERR IO";
+    }
+
+    // Статистика процесса, а не состояния сети, поэтому команда - чтение
+    if (command == "METRICS") {
+        OperationMetrics& metrics = OperationMetrics::instance();
+        if (splitArgs(line, 0, args)) {
+            vector<OperationStats> all = metrics.collect();
+            ostringstream out;
+            out << "OK " << all.size();
+            for (const OperationStats& stats : all) {
+                out << ' ' << operationName(stats.operation) << ' ' << stats.count << ' ' << stats.p50 << ' '
+                    << stats.p99 << ' ' << stats.max;
+            }
+            return out.str();
+        }
+        if (splitArgs(line, 1, args, &rest) && toUpper(args[0]) == "EXPORT") {
+            if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+            return metrics.exportPrometheus(path) ? "OK" : "ERR IO";
+        }
+        if (!splitArgs(line, 1, args)) return ERR_SYNTAX;
+        string action = toUpper(args[0]);
+        if (action == "ON" || action == "OFF") {
+            metrics.setEnabled(action == "ON");
+        } else if (action == "RESET") {
+            metrics.reset();
+        } else {
+            return ERR_SYNTAX;
+        }
+        return "OK";
+    }
+
+    if (command == "TRACE") {
+        TraceRecorder& recorder = TraceRecorder::instance();
+        if (splitArgs(line, 1, args) && toUpper(args[0]) == "START") {
+            recorder.start();
+            return "OK";
+        }
+        if (!splitArgs(line, 1, args, &rest) || toUpper(args[0]) != "STOP") return ERR_SYNTAX;
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        recorder.stop();
+        if (!recorder.saveChromeTrace(path)) return "ERR IO";
+        return "OK " + to_string(recorder.eventCount());
+    }
+
+    if (command == "MEMORY") {
+        if (splitArgs(line, 1, args) && toUpper(args[0]) == "RESET") {
+            MemoryTracker::instance().resetPeaks();
+            return "OK";
+        }
+        if (!splitArgs(line, 0, args)) return ERR_SYNTAX;
+        MemoryReport report = core.memoryReport();
+        ostringstream out;
+        out << "OK " << report.totalUsed << ' ' << report.totalReserved << ' ' << report.totalPeak << ' '
+            << report.entries.size();
+        for (const MemoryUsage& usage : report.entries) {
+            out << ' ' << memoryCategoryName(usage.category) << ' ' << usage.used << ' ' << usage.reserved << ' '
+                << usage.peak;
+        }
+        return out.str();
+    }
+
+    if (command == "CACHE") {
+        if (splitArgs(line, 1, args) && toUpper(args[0]) == "CLEAR") {
+            core.clearQueryCache();
+            return "OK";
+        }
+        if (!splitArgs(line, 0, args)) return ERR_SYNTAX;
+        QueryCacheStats stats = core.getQueryCacheStats();
+        ostringstream out;
+        out << "OK " << stats.hits << ' ' << stats.misses << ' ' << stats.evictions << ' ' << stats.entries << ' '
+            << stats.bytes << ' ' << stats.capacityBytes;
+        return out.str();
+    }
+
+    if (command == "DIFF") {
+        if (!splitArgs(line, 0, args, &rest)) return ERR_SYNTAX;
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        PipelineCore target;
+        switch (target.loadFromFile(path)) {
+            case LoadStatus::Ok: break;
+            case LoadStatus::FileNotFound: return "ERR FILE_NOT_FOUND";
+            case LoadStatus::BadFormat: return "ERR BAD_FORMAT";
+        }
+        DiffSummary summary = core.diff(target);
+        ostringstream out;
+        out << "OK " << summary.pipesAdded << ' ' << summary.pipesRemoved << ' ' << summary.pipesModified << ' '
+            << summary.stationsAdded << ' ' << summary.stationsRemoved << ' ' << summary.stationsModified << ' '
+            << summary.connectionsAdded << ' ' << summary.connectionsRemoved;
+        return out.str();
+    }
+
+    return "ERR UNKNOWN_COMMAND";
+}
+
+string writeRequest(PipelineCore& core, const string& line, const string& dataDir) {
+    string command = commandOf(line);
+    vector<string> args;
+    string rest;
+    string path;
+    int id = 0;
+
+    if (command == "ADDPIPE") {
+        double length = 0;
+        int diameter = 0;
+        if (!splitArgs(line, 2, args, &rest) || !parseDouble(args[0], length) ||
+            !parseInt(args[1], diameter) || length <= 0 || !PipelineCore::isAllowedDiameter(diameter)) {
+            return ERR_SYNTAX;
+        }
+        uint32_t handle = 0;
+        if (!StringPool::tryIntern(rest, handle)) return ERR_NAMES_EXHAUSTED;
+        return "OK " + to_string(core.addPipe(rest, length, diameter));
+    }
+
+    if (command == "ADDSTATION") {
+        int total = 0, active = 0, stationClass = 0;
+        if (!splitArgs(line, 3, args, &rest) || !parseInt(args[0], total) || !parseInt(args[1], active) ||
+            !parseInt(args[2], stationClass) || total < 1 || active < 0 || active > total || stationClass < 1) {
+            return ERR_SYNTAX;
+        }
+        uint32_t handle = 0;
+        if (!StringPool::tryIntern(rest, handle)) return ERR_NAMES_EXHAUSTED;
+        return "OK " + to_string(core.addStation(rest, total, active, stationClass));
+    }
+
+    if (command == "DELPIPE") {
+        if (!splitArgs(line, 1, args) || !parseInt(args[0], id)) return ERR_SYNTAX;
+        return removeStatusReply(core.removePipe(id));
+    }
+
+    if (command == "DELSTATION") {
+        if (!splitArgs(line, 1, args) || !parseInt(args[0], id)) return ERR_SYNTAX;
+        return core.removeStation(id) ? "OK" : ERR_NOT_FOUND;
+    }
+
+    if (command == "REPAIR") {
+        int flag = 0;
+        if (!splitArgs(line, 2, args) || !parseInt(args[0], id) || !parseInt(args[1], flag)) return ERR_SYNTAX;
+        return core.setPipeRepair(id, flag != 0) ? "OK" : ERR_NOT_FOUND;
+    }
+
+    if (command == "WORKSHOP") {
+        if (!splitArgs(line, 2, args) || !parseInt(args[0], id)) return ERR_SYNTAX;
+        string action = toUpper(args[1]);
+        if (core.findStationIndexById(id) == -1) return ERR_NOT_FOUND;
+        if (action == "START") return core.startWorkshop(id) ? "OK" : "ERR LIMIT";
+        if (action == "STOP") return core.stopWorkshop(id) ? "OK" : "ERR LIMIT";
+        return ERR_SYNTAX;
+    }
+
+    if (command == "CONNECT") {
+        int startId = 0, endId = 0, diameter = 0;
+        if (!splitArgs(line, 3, args) || !parseInt(args[0], startId) || !parseInt(args[1], endId) ||
+            !parseInt(args[2], diameter)) {
+            return ERR_SYNTAX;
+        }
+        ConnectResult result = core.connectObjects(startId, endId, diameter);
+        if (result.status != ConnectStatus::Ok) {
+            return "ERR " + connectStatusName(result.status);
+        }
+        return "OK " + to_string(result.pipeId);
+    }
+
+    if (command == "DISCONNECT") {
+        if (!splitArgs(line, 1, args) || !parseInt(args[0], id)) return ERR_SYNTAX;
+        return removeStatusReply(core.disconnectPipe(id));
+    }
+
+    if (command == "LOAD") {
+        if (!splitArgs(line, 0, args, &rest)) return ERR_SYNTAX;
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        switch (core.loadFromFile(path, SaveFormat::Network, LoadMode::Lazy)) {
+            case LoadStatus::Ok: return "OK";
+            case LoadStatus::FileNotFound: return "ERR FILE_NOT_FOUND";
+            case LoadStatus::BadFormat: return "ERR BAD_FORMAT";
+        }
+    }
+
+    if (command == "IMPORT") {
+        if (!splitArgs(line, 1, args, &rest)) return ERR_SYNTAX;
+        string table = toUpper(args[0]);
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        CsvImportReport report;
+        if (table == "PIPES") {
+            report = core.importCsv(path, CsvTable::Pipes);
+        } else if (table == "STATIONS") {
+            report = core.importCsv(path, CsvTable::Stations);
+        } else if (table == "CONNECTIONS") {
+            report = core.importCsv(path, CsvTable::Connections);
+        } else {
+            return ERR_SYNTAX;
+        }
+        switch (report.status) {
+            case CsvImportStatus::Ok: return "OK " + to_string(report.imported) + ' ' + to_string(report.rejected);
+            case CsvImportStatus::FileNotFound: return "ERR FILE_NOT_FOUND";
+            case CsvImportStatus::BadHeader: return "ERR BAD_HEADER";
+        }
+    }
+
+    if (command == "PATCH") {
+        if (!splitArgs(line, 0, args, &rest)) return ERR_SYNTAX;
+        if (!resolvePath(dataDir, rest, path)) return ERR_BAD_PATH;
+        switch (core.applyPatch(path)) {
+            case PatchStatus::Ok: return "OK";
+            case PatchStatus::FileNotFound: return "ERR FILE_NOT_FOUND";
+            case PatchStatus::BadFormat: return "ERR BAD_FORMAT";
+            case PatchStatus::Conflict: return "ERR CONFLICT";
+            case PatchStatus::NamesExhausted: return ERR_NAMES_EXHAUSTED;
+        }
+    }
+
+    return "ERR UNKNOWN_COMMAND";
+}
+
+}
+
+// Поврежденная секция ленивого снимка обнаруживается при первом обращении к
+// ней и остается пустой: ответы по такому состоянию были бы неверны, поэтому
+// до следующей загрузки все запросы получают ошибку
+string executeRead(const PipelineCore& core, const string& line, const string& dataDir) {
+    string reply = readRequest(core, line, dataDir);
+    return core.deferredLoadFailed() ? "ERR BAD_SNAPSHOT" : reply;
+}
+
+string executeWrite(PipelineCore& core, const string& line, const string& dataDir) {
+    string reply = writeRequest(core, line, dataDir);
+    return core.deferredLoadFailed() ? "ERR BAD_SNAPSHOT" : reply;
+}
+
+}
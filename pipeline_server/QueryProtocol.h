@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+
+#include "pipeline_core/PipelineCore.h"
+
+// Текстовый протокол сервера: один запрос - одна строка, один ответ - одна строка.
+// Аргументы разделяются пробелами, название объекта всегда идет последним и
+// может содержать пробелы. Ответ начинается с "OK" или "ERR <код>".
+//
+// Чтение:
+//   PING
+//   PIPE <id>                       -> OK <id> <длина> <диаметр> <ремонт> <в сети> <начало> <конец> <название>
+//   STATION <id>                    -> OK <id> <цехов> <работает> <класс> <название>
+//   FINDPIPES NAME <текст>          -> OK <n> <id>...
+//   FINDPIPES REPAIR|INUSE <0|1>
+//   FINDSTATIONS NAME <текст>
+//   FINDSTATIONS INACTIVE <1|2|3> <процент>
+//   PATH <начало> <конец>           -> OK <длина> <n> <узлы>... <m> <трубы>...
+//   ROUTES <начало> <конец> <k>     -> OK <r> (<длина> <m> <трубы>...)...
+//   TOPO                            -> OK <n> <id>... | ERR CYCLE <id>...
+//   NETSTATS                        -> OK <соединений> <КС в сети> <труб в сети>
+//   SAMEISLAND <id> <id>            -> OK <0|1>
+//   ISLANDS                         -> OK <n> <узлов в острове>...
+//   REACH <начало> <конец>          -> OK <0|1>
+//   FLOW [<P входа> <P выхода>]     -> OK <сошелся> <итераций> <небаланс> <подача>
+//   PARTITION <k>                   -> OK <разрезано труб> <частей> <узлов в части>...
+//   SAVE <файл>                     (*.snap - сжатый двоичный снимок)
+//   EXPORT DOT|GRAPHML <файл>
+//   DIFF <файл>                     -> OK <труб +> <-> <~> <КС +> <-> <~> <соединений +> <->
+//   METRICS                         -> OK <n> (<операция> <вызовов> <p50> <p99> <макс>)... - время в нс
+//   METRICS ON|OFF|RESET            (сбор статистики операций; по умолчанию выключен)
+//   METRICS EXPORT <файл>           (текстовый формат Prometheus)
+//   TRACE START                     (запись трассы в буферы потоков)
+//   TRACE STOP <файл>               -> OK <событий> - трасса в формате Chrome trace events
+//   MEMORY                          -> OK <занято> <выделено> <пик> <n> (<структура> <занято> <выделено> <пик>)... - байты
+//   MEMORY RESET                    (пики опускаются до текущих значений)
+//   CACHE                           -> OK <попаданий> <промахов> <вытеснено> <записей> <байт> <объем> - кэш PATH и TOPO
+//   CACHE CLEAR                     (удаляет записи и обнуляет счетчики)
+// Изменение:
+//   ADDPIPE <длина> <диаметр> <название>             -> OK <id>
+//   ADDSTATION <цехов> <работает> <класс> <название> -> OK <id>
+//   DELPIPE <id> | DELSTATION <id>
+//   REPAIR <id> <0|1>
+//   WORKSHOP <id> START|STOP
+//   CONNECT <начало> <конец> <диаметр>               -> OK <id трубы>
+//   DISCONNECT <id трубы>
+//   LOAD <файл>                                      (текст или снимок - по содержимому; снимок - лениво)
+//   IMPORT PIPES|STATIONS|CONNECTIONS <файл.csv>     -> OK <импортировано> <отклонено>
+//   PATCH <файл>                                     (ERR CONFLICT - патч не к этому состоянию)
+// Если в пуле строк не осталось места для нового названия, ADDPIPE, ADDSTATION
+// и PATCH получают ERR NAMES_EXHAUSTED и ничего не меняют, IMPORT отклоняет
+// такие строки, LOAD - ERR BAD_FORMAT.
+// Файлы указываются относительно каталога данных сервера; абсолютный путь,
+// ".." или ссылка за пределы каталога - ERR BAD_PATH.
+// Если при первом обращении к трубам или соединениям лениво загруженного
+// снимка он оказался поврежден, любой запрос до следующего LOAD получает
+// ERR BAD_SNAPSHOT.
+namespace QueryProtocol {
+
+// Первое слово запроса в верхнем регистре
+std::string commandOf(const std::string& line);
+
+// true для команд, изменяющих состояние
+bool isMutation(const std::string& command);
+
+// true для команд, читающих или пишущих файл со всей сетью (SAVE, LOAD и т.п.):
+// на больших сетях они идут секунды, поэтому сервер выполняет их в фоне
+bool isBulkFile(const std::string& command);
+
+// true для запросов, меняющих состояние процесса, а не сети (METRICS ON, TRACE и т.п.).
+// В пакете такой запрос выполняется отдельно: после всех предыдущих запросов
+// и до всех последующих, как и изменения
+bool isBarrier(const std::string& line);
+
+// dataDir - каталог, внутри которого разрешаются имена файлов из запросов
+std::string executeRead(const PipelineCore& core, const std::string& line, const std::string& dataDir);
+std::string executeWrite(PipelineCore& core, const std::string& line, const std::string& dataDir);
+
+}
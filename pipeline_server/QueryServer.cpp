@@ -0,0 +1,478 @@
+#include "QueryServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "pipeline_core/TaskScheduler.h"
+#include "QueryProtocol.h"
+
+using namespace std;
+
+namespace {
+
+enum class RequestKind {
+    Read,
+    Mutation,
+    Barrier,    // управляющий запрос: выполняется отдельно от остальных
+    Background  // выполняется файловым потоком, ответ - по готовности
+};
+
+RequestKind requestKind(const string& line) {
+    const string command = QueryProtocol::commandOf(line);
+    if (QueryProtocol::isBulkFile(command)) {
+        return RequestKind::Background;
+    }
+    if (QueryProtocol::isMutation(command)) {
+        return RequestKind::Mutation;
+    }
+    return QueryProtocol::isBarrier(line) ? RequestKind::Barrier : RequestKind::Read;
+}
+
+}
+
+QueryServer::QueryServer(ConcurrentPipelineCore& core, const Logger& logger, const string& dataDir)
+    : core(core), logger(logger), dataDir(dataDir) {}
+
+QueryServer::~QueryServer() {
+    for (auto& [fd, client] : clients) {
+        close(fd);
+    }
+    if (listenFd != -1) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (epollFd != -1) {
+        close(epollFd);
+    }
+    if (wakeFd != -1) {
+        close(wakeFd);
+    }
+}
+
+bool QueryServer::listen(const string& path, mode_t mode) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd == -1) {
+        return false;
+    }
+
+    // Файл сокета сразу создается с нужными правами: подключиться к нему
+    // успели бы и в промежутке между bind и chmod
+    unlink(path.c_str());
+    const mode_t previousMask = umask(~mode & 0777);
+    const bool bound = bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    umask(previousMask);
+    if (!bound || ::listen(listenFd, SOMAXCONN) == -1) {
+        return false;
+    }
+    socketPath = path;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == -1) {
+        return false;
+    }
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd == -1) {
+        return false;
+    }
+    event.data.fd = wakeFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) == 0;
+}
+
+void QueryServer::run(const atomic<bool>& stopFlag) {
+    logger.log("Запуск сервера", "Сокет: " + socketPath);
+
+    vector<epoll_event> events(256);
+    vector<PendingRequest> batch;
+
+    fileStopping = false;
+    fileThread = thread(&QueryServer::fileLoop, this);
+
+    while (!stopFlag) {
+        // Таймаут нужен, чтобы периодически проверять флаг остановки
+        int ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 200);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            logger.log("Ошибка сервера", string("epoll_wait: ") + strerror(errno));
+            break;
+        }
+
+        batch.clear();
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            if (fd == wakeFd) {
+                takeFileReplies(batch);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                readClient(fd, batch);
+            }
+            // При обрыве отправка завершится ошибкой, и клиент будет закрыт
+            if ((events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && clients.count(fd)) {
+                flushClient(fd);
+            }
+            // Клиент оборвал соединение, не дождавшись фонового ответа. Закрыть
+            // его до ответа нельзя (номер сокета достался бы новому клиенту),
+            // а об обрыве epoll сообщал бы на каждом проходе - снимаем с наблюдения
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) && clients.count(fd) && clients[fd].busy) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            }
+        }
+
+        if (!batch.empty()) {
+            processBatch(batch);
+        }
+        vector<int> answered;
+        for (const auto& request : batch) {
+            answered.push_back(request.fd);
+        }
+        for (auto& [fd, client] : clients) {
+            if (client.lineTooLong) {
+                client.output += "ERR LINE_TOO_LONG\n";
+                client.lineTooLong = false;
+                answered.push_back(fd);
+            }
+        }
+        for (int fd : answered) {
+            if (clients.count(fd)) {
+                flushClient(fd);
+            }
+        }
+
+        // Закрываем клиентов, которые отключились и получили все ответы
+        vector<int> finished;
+        for (const auto& [fd, client] : clients) {
+            if (client.closing && client.output.empty() && !client.busy) {
+                finished.push_back(fd);
+            }
+        }
+        for (int fd : finished) {
+            closeClient(fd);
+        }
+    }
+
+    // Принятые изменения доводятся до конца: клиентам уже не ответить,
+    // но состояние не должно зависеть от момента остановки
+    {
+        lock_guard<mutex> lock(fileMutex);
+        fileStopping = true;
+    }
+    fileReady.notify_one();
+    fileThread.join();
+
+    logger.log("Остановка сервера", "Сокет: " + socketPath);
+}
+
+void QueryServer::acceptClients() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            // EAGAIN - очередь подключений разобрана
+            return;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            close(fd);
+            continue;
+        }
+        clients[fd] = Client();
+    }
+}
+
+void QueryServer::readClient(int fd, vector<PendingRequest>& batch) {
+    auto it = clients.find(fd);
+    if (it == clients.end()) {
+        return;
+    }
+    Client& client = it->second;
+
+    char buffer[16 * 1024];
+    size_t budget = READ_BUDGET;
+    while (!client.closing && budget > 0 && client.output.size() < MAX_OUTPUT) {
+        ssize_t received = recv(fd, buffer, min(sizeof(buffer), budget), 0);
+        if (received > 0) {
+            budget -= received;
+            client.input.append(buffer, received);
+            takeLines(fd, client, batch);
+            continue;
+        }
+        if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (received == -1 && errno == EINTR) {
+            continue;
+        }
+        // 0 - клиент закрыл соединение, иначе ошибка; ответы на уже полученное все равно отправим
+        client.closing = true;
+    }
+    updateInterest(fd, client);
+}
+
+// Выделяет полные строки запросов; остаток без перевода строки ограничен MAX_LINE
+void QueryServer::takeLines(int fd, Client& client, vector<PendingRequest>& batch) {
+    size_t start = 0;
+    size_t newline;
+    while ((newline = client.input.find('\n', start)) != string::npos) {
+        string line = client.input.substr(start, newline - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            batch.push_back({fd, move(line)});
+        }
+        start = newline + 1;
+    }
+    client.input.erase(0, start);
+
+    if (client.input.size() > MAX_LINE) {
+        client.input.clear();
+        client.lineTooLong = true;
+        client.closing = true;
+    }
+}
+
+void QueryServer::processBatch(const vector<PendingRequest>& incoming) {
+    // Запросы клиента, ждущего фонового ответа, откладываются до этого ответа.
+    // Пока в фоне есть изменения, новые изменения встают в ту же очередь:
+    // опубликованная здесь версия не должна обогнать их или потеряться при LOAD
+    vector<PendingRequest> batch;
+    vector<RequestKind> kinds;
+    bool writesQueued = fileWritesPending > 0;
+    for (const auto& request : incoming) {
+        auto it = clients.find(request.fd);
+        if (it == clients.end()) {
+            continue;
+        }
+        Client& client = it->second;
+        if (client.busy) {
+            client.held.push_back(request.line);
+            continue;
+        }
+        RequestKind kind = requestKind(request.line);
+        if (kind == RequestKind::Mutation && writesQueued) {
+            kind = RequestKind::Background;
+        }
+        if (kind == RequestKind::Background) {
+            client.busy = true;
+            writesQueued = writesQueued || QueryProtocol::isMutation(QueryProtocol::commandOf(request.line));
+        }
+        batch.push_back(request);
+        kinds.push_back(kind);
+    }
+
+    vector<string> replies(batch.size());
+
+    size_t i = 0;
+    while (i < batch.size()) {
+        size_t end = i + 1;
+        if (kinds[i] != RequestKind::Barrier && kinds[i] != RequestKind::Background) {
+            while (end < batch.size() && kinds[end] == kinds[i]) {
+                ++end;
+            }
+        }
+
+        if (kinds[i] == RequestKind::Mutation) {
+            // Все подряд идущие изменения - одна новая версия состояния
+            core.write([&](PipelineCore& state) {
+                for (size_t j = i; j < end; ++j) {
+                    replies[j] = QueryProtocol::executeWrite(state, batch[j].line, dataDir);
+                }
+            });
+            logger.log("Пакет изменений", "Запросов: " + to_string(end - i));
+        } else if (kinds[i] == RequestKind::Barrier) {
+            // Управляющий запрос меняет общее состояние процесса: чтения до него
+            // уже завершены, последующие начнутся после него
+            replies[i] = QueryProtocol::executeRead(*core.snapshot(), batch[i].line, dataDir);
+        } else if (kinds[i] == RequestKind::Background) {
+            // Чтению нужен снимок на его месте в пакете - после предыдущих изменений
+            if (QueryProtocol::isMutation(QueryProtocol::commandOf(batch[i].line))) {
+                ++fileWritesPending;
+                startFileJob({batch[i].fd, batch[i].line, nullptr});
+            } else {
+                startFileJob({batch[i].fd, batch[i].line, core.snapshot()});
+            }
+        } else {
+            // Чтения одного снимка независимы и выполняются параллельно;
+            // ответы ложатся по своим местам, так что порядок сохраняется
+            ConcurrentPipelineCore::Snapshot snapshot = core.snapshot();
+            parallelFor(i, end, 1, [&](size_t first, size_t last) {
+                for (size_t j = first; j < last; ++j) {
+                    replies[j] = QueryProtocol::executeRead(*snapshot, batch[j].line, dataDir);
+                }
+            });
+        }
+        i = end;
+    }
+
+    for (size_t j = 0; j < batch.size(); ++j) {
+        auto it = clients.find(batch[j].fd);
+        if (kinds[j] != RequestKind::Background && it != clients.end()) {
+            it->second.output += replies[j];
+            it->second.output += '\n';
+        }
+    }
+}
+
+void QueryServer::startFileJob(FileJob job) {
+    {
+        lock_guard<mutex> lock(fileMutex);
+        fileJobs.push_back(move(job));
+    }
+    fileReady.notify_one();
+}
+
+// Задачи выполняются по очереди; подряд идущие изменения, как и в пакете
+// реактора, дают одну новую версию. Ответ каждой группы отдается сразу,
+// не дожидаясь остальных задач
+void QueryServer::fileLoop() {
+    unique_lock<mutex> lock(fileMutex);
+    while (true) {
+        fileReady.wait(lock, [&] { return fileStopping || !fileJobs.empty(); });
+        if (fileJobs.empty()) {
+            return;
+        }
+        size_t end = 1;
+        if (!fileJobs.front().snapshot) {
+            while (end < fileJobs.size() && !fileJobs[end].snapshot) {
+                ++end;
+            }
+        }
+        vector<FileJob> jobs(make_move_iterator(fileJobs.begin()), make_move_iterator(fileJobs.begin() + end));
+        fileJobs.erase(fileJobs.begin(), fileJobs.begin() + end);
+        lock.unlock();
+
+        vector<FileReply> replies;
+        if (const FileJob& job = jobs.front(); job.snapshot) {
+            replies.push_back({job.fd, QueryProtocol::executeRead(*job.snapshot, job.line, dataDir), false});
+        } else {
+            core.write([&](PipelineCore& state) {
+                for (const FileJob& job : jobs) {
+                    replies.push_back({job.fd, QueryProtocol::executeWrite(state, job.line, dataDir), true});
+                }
+            });
+            logger.log("Пакет изменений", "Запросов: " + to_string(jobs.size()) + ", в фоне");
+        }
+        jobs.clear();  // снимок отпускается до ожидания следующей задачи
+
+        lock.lock();
+        fileReplies.insert(fileReplies.end(), make_move_iterator(replies.begin()), make_move_iterator(replies.end()));
+        const uint64_t signal = 1;
+        // EAGAIN - счетчик переполнен, реактор и так проснется
+        if (write(wakeFd, &signal, sizeof(signal)) == -1 && errno != EAGAIN) {
+            logger.log("Ошибка сервера", string("eventfd: ") + strerror(errno));
+        }
+    }
+}
+
+// Готовые фоновые ответы - клиентам; отложенные запросы клиента идут в текущий пакет
+void QueryServer::takeFileReplies(vector<PendingRequest>& batch) {
+    // Сбрасываем счетчик eventfd; ответы, пришедшие после сброса, разбудят еще раз
+    uint64_t signals = 0;
+    while (read(wakeFd, &signals, sizeof(signals)) == -1 && errno == EINTR) {
+    }
+
+    vector<FileReply> replies;
+    {
+        lock_guard<mutex> lock(fileMutex);
+        replies.swap(fileReplies);
+    }
+    for (FileReply& done : replies) {
+        if (done.mutation) {
+            --fileWritesPending;
+        }
+        // Клиент не закрывается, пока ждет ответа
+        Client& client = clients[done.fd];
+        client.output += done.reply;
+        client.output += '\n';
+        client.busy = false;
+        for (string& line : client.held) {
+            batch.push_back({done.fd, move(line)});
+        }
+        client.held.clear();
+        flushClient(done.fd);
+    }
+}
+
+void QueryServer::flushClient(int fd) {
+    Client& client = clients[fd];
+    size_t sent = 0;
+    while (sent < client.output.size()) {
+        ssize_t written = send(fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+        if (written > 0) {
+            sent += written;
+            continue;
+        }
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        if (written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        // Клиент недоступен - отбрасываем неотправленное
+        client.output.clear();
+        client.closing = true;
+        sent = 0;
+        break;
+    }
+    client.output.erase(0, sent);
+    updateInterest(fd, client);
+}
+
+// Чтение не ждем после отключения клиента (иначе epoll сообщал бы о конце
+// потока на каждом проходе), пока вывод переполнен - клиент не забирает ответы,
+// и пока клиент ждет фонового ответа - иначе отложенные запросы копились бы без предела
+void QueryServer::updateInterest(int fd, Client& client) {
+    bool wantRead = !client.closing && !client.busy && client.output.size() < MAX_OUTPUT;
+    bool wantWrite = !client.output.empty();
+    if (wantRead == client.wantRead && wantWrite == client.wantWrite) {
+        return;
+    }
+    epoll_event event{};
+    if (wantRead) {
+        event.events |= EPOLLIN;
+    }
+    if (wantWrite) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+    client.wantRead = wantRead;
+    client.wantWrite = wantWrite;
+}
+
+void QueryServer::closeClient(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
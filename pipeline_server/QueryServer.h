@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "pipeline_core/ConcurrentPipelineCore.h"
+#include "pipeline_core/Logger.h"
+
+// Сервер запросов на Unix-сокете (реактор на epoll, Linux).
+// За один проход цикла событий сервер читает все готовые запросы всех клиентов
+// и выполняет их одним пакетом: подряд идущие запросы чтения обслуживаются
+// одним снимком состояния, подряд идущие изменения - одной публикацией новой версии.
+// Управляющие запросы (METRICS ON и т.п.) выполняются по одному между группами.
+//
+// Запросы с файлом всей сети (SAVE, LOAD, IMPORT и т.п.) передаются фоновому
+// файловому потоку, и цикл событий их не ждет; ответ отправляется по готовности.
+// Чтение (SAVE, EXPORT, DIFF) получает снимок, взятый в порядке пакета.
+// Изменения выполняются фоновым потоком по очереди, и пока там есть изменения,
+// новые изменения встают в ту же очередь; чтения тем временем обслуживаются
+// по последней опубликованной версии. Следующие запросы клиента, ждущего
+// фонового ответа, откладываются до него, так что порядок ответов сохраняется.
+class QueryServer {
+private:
+    struct Client {
+        std::string input;   // непрочитанный остаток (неполная строка)
+        std::string output;  // ответы, еще не отправленные клиенту
+        bool closing = false;
+        bool lineTooLong = false;  // ответить ошибкой после ответов на прочитанные запросы
+        bool wantRead = true;
+        bool wantWrite = false;
+        bool busy = false;              // запрос клиента выполняется в фоне
+        std::vector<std::string> held;  // запросы, пришедшие после него
+    };
+
+    struct PendingRequest {
+        int fd;
+        std::string line;
+    };
+
+    // Задача файлового потока; snapshot пуст у изменений
+    struct FileJob {
+        int fd;
+        std::string line;
+        ConcurrentPipelineCore::Snapshot snapshot;
+    };
+
+    struct FileReply {
+        int fd;
+        std::string reply;
+        bool mutation;
+    };
+
+    static constexpr size_t MAX_LINE = 64 * 1024;
+    // Пока неотправленных ответов больше, запросы клиента не читаются
+    static constexpr size_t MAX_OUTPUT = 4 * 1024 * 1024;
+    // Не больше стольких байт запросов одного клиента за проход цикла
+    static constexpr size_t READ_BUDGET = 4 * MAX_LINE;
+
+    ConcurrentPipelineCore& core;
+    const Logger& logger;
+    std::string dataDir;
+    int listenFd = -1;
+    int epollFd = -1;
+    std::string socketPath;
+    std::unordered_map<int, Client> clients;
+
+    // Файловый поток: задачи и готовые ответы под одним мьютексом,
+    // о готовых ответах реактор узнает через eventfd
+    int wakeFd = -1;
+    std::thread fileThread;
+    std::mutex fileMutex;
+    std::condition_variable fileReady;
+    std::deque<FileJob> fileJobs;
+    std::vector<FileReply> fileReplies;
+    bool fileStopping = false;
+    size_t fileWritesPending = 0;  // изменений в фоне; только поток реактора
+
+    void acceptClients();
+    void readClient(int fd, std::vector<PendingRequest>& batch);
+    void takeLines(int fd, Client& client, std::vector<PendingRequest>& batch);
+    void processBatch(const std::vector<PendingRequest>& incoming);
+    void startFileJob(FileJob job);
+    void fileLoop();
+    void takeFileReplies(std::vector<PendingRequest>& batch);
+    void flushClient(int fd);
+    void updateInterest(int fd, Client& client);
+    void closeClient(int fd);
+
+public:
+    // Файлы из запросов (SAVE, LOAD и т.п.) ищутся только внутри dataDir
+    QueryServer(ConcurrentPipelineCore& core, const Logger& logger, const std::string& dataDir);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // Создает сокет по указанному пути (старый файл сокета удаляется)
+    // с правами mode; по умолчанию подключиться может только владелец
+    bool listen(const std::string& path, mode_t mode = 0600);
+    // Цикл обработки событий; завершается, когда stopFlag становится true
+    void run(const std::atomic<bool>& stopFlag);
+};
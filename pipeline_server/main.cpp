@@ -0,0 +1,95 @@
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "pipeline_core/ConcurrentPipelineCore.h"
+#include "pipeline_core/Logger.h"
+#include "QueryServer.h"
+
+using namespace std;
+
+namespace {
+atomic<bool> stopRequested{false};
+
+void handleStopSignal(int) {
+    stopRequested = true;
+}
+}
+
+int main(int argc, char* argv[]) {
+    // Позиционные аргументы - сокет и файл данных, между ними и после могут идти ключи
+    string socketPath;
+    string dataFile;
+    string dataDir = ".";
+    mode_t socketMode = 0600;
+    bool badArguments = false;
+    for (int i = 1; i < argc && !badArguments; ++i) {
+        const string arg = argv[i];
+        if (arg == "--data-dir" && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (arg == "--mode" && i + 1 < argc) {
+            char* end = nullptr;
+            const unsigned long mode = strtoul(argv[++i], &end, 8);
+            badArguments = *argv[i] == '\0' || *end != '\0' || mode > 0777;
+            socketMode = static_cast<mode_t>(mode);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            badArguments = true;
+        } else if (socketPath.empty()) {
+            socketPath = arg;
+        } else if (dataFile.empty()) {
+            dataFile = arg;
+        } else {
+            badArguments = true;
+        }
+    }
+    if (badArguments || socketPath.empty()) {
+        cerr << "Использование: " << argv[0]
+             << " <путь к сокету> [файл данных] [--data-dir <каталог>] [--mode <права, 0600>]\n"
+             << "  --data-dir - каталог файлов из запросов SAVE, LOAD и т.п. (по умолчанию текущий)\n";
+        return 1;
+    }
+    error_code error;
+    if (!filesystem::is_directory(dataDir, error)) {
+        cerr << "Ошибка: нет каталога данных " << dataDir << endl;
+        return 1;
+    }
+
+    Logger logger;
+    ConcurrentPipelineCore core;
+
+    if (!dataFile.empty()) {
+        PipelineCore initial;
+        LoadStatus status = initial.loadFromFile(dataFile, SaveFormat::Network, LoadMode::Lazy);
+        if (status != LoadStatus::Ok) {
+            cerr << "Ошибка: не удалось загрузить файл " << dataFile << endl;
+            return 1;
+        }
+        // Трубы и соединения снимка читаются при первом запросе к ним
+        if (initial.getPipes().isLoaded()) {
+            cout << "Загружено труб: " << initial.getPipes().size() << ", КС: " << initial.getStations().size()
+                 << ", Соединений: " << initial.getNetwork().size() << endl;
+        } else {
+            cout << "Загружено КС: " << initial.getStations().size() << ", трубы и соединения - по запросу" << endl;
+        }
+        core.replace(move(initial));
+    }
+
+    signal(SIGINT, handleStopSignal);
+    signal(SIGTERM, handleStopSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    QueryServer server(core, logger, dataDir);
+    if (!server.listen(socketPath, socketMode)) {
+        cerr << "Ошибка: невозможно открыть сокет " << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    cout << "Сервер слушает " << socketPath << endl;
+    server.run(stopRequested);
+    cout << "Сервер остановлен.\n";
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Проверка атомарной записи: при сбое и исключении из функции записи
+// не остается временных файлов, права существующего файла сохраняются.
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+
+#include "pipeline_core/AtomicFile.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+string contents(const fs::path& path) {
+    ifstream file(path);
+    ostringstream out;
+    out << file.rdbuf();
+    return out.str();
+}
+
+// В каталоге только целевой файл - временных не осталось
+bool onlyTarget(const fs::path& directory) {
+    size_t count = 0;
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        count += entry.path().filename() == "data.txt" ? 0 : 1;
+    }
+    return count == 0;
+}
+
+}
+
+int main() {
+    const fs::path directory = fs::absolute("atomic_file_test_dir");
+    fs::remove_all(directory);
+    fs::create_directory(directory);
+    const string target = (directory / "data.txt").string();
+
+    auto write = [&](const string& text) {
+        return writeFileAtomically(target, [&](ostream& file) {
+            file << text;
+            return true;
+        });
+    };
+
+    check(write("первая версия"), "запись нового файла");
+    check(contents(target) == "первая версия", "содержимое нового файла");
+
+    check(!writeFileAtomically(target, [](ostream& file) {
+              file << "недописанное";
+              return false;
+          }),
+          "отказ функции записи");
+    check(contents(target) == "первая версия", "после отказа прежняя версия");
+    check(onlyTarget(directory), "после отказа временный файл удален");
+
+    bool thrown = false;
+    try {
+        writeFileAtomically(target, [](ostream& file) -> bool {
+            file << "недописанное";
+            throw runtime_error("сбой");
+        });
+    } catch (const runtime_error&) {
+        thrown = true;
+    }
+    check(thrown, "исключение доходит до вызывающего");
+    check(contents(target) == "первая версия", "после исключения прежняя версия");
+    check(onlyTarget(directory), "после исключения временный файл удален");
+
+    chmod(target.c_str(), 0640);
+    check(write("вторая версия"), "перезапись файла");
+    struct stat info;
+    check(stat(target.c_str(), &info) == 0 && (info.st_mode & 07777) == 0640, "права файла сохранены");
+    check(contents(target) == "вторая версия", "содержимое после перезаписи");
+    check(onlyTarget(directory), "после перезаписи временных файлов нет");
+
+    fs::remove_all(directory);
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
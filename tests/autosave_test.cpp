@@ -0,0 +1,126 @@
+// Проверка автосохранения: flush записывает последний снимок, не дожидаясь
+// интервала, неизмененное состояние повторно не пишется, деструктор
+// дописывает последний снимок, а сбой записи виден в состоянии и
+// повторяется, когда запись снова возможна.
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "pipeline_core/AutoSaver.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+string dump(const PipelineCore& core) {
+    ostringstream out;
+    core.saveToStream(out);
+    return out.str();
+}
+
+string savedDump(const string& file) {
+    PipelineCore loaded;
+    return loaded.loadFromFile(file) == LoadStatus::Ok ? dump(loaded) : string();
+}
+
+// Фоновый поток не сообщает о завершении: ждем состояния не дольше 10 секунд
+template <typename Condition>
+bool waitFor(const AutoSaver& saver, Condition condition) {
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    while (!condition(saver.getStatus())) {
+        if (chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    return true;
+}
+
+}
+
+int main() {
+    const string file = "autosave_test.txt";
+    remove(file.c_str());
+    PipelineCore core;
+    const int a = core.addStation("КС 1", 4, 2, 1);
+    const int b = core.addStation("КС 2", 4, 2, 1);
+    core.connectWithNewPipe(a, b, 700, "Магистраль", 12.5);
+
+    {
+        // Интервал в час: все записи в тесте - только по flush и в деструкторе
+        AutoSaver saver(file, chrono::hours(1));
+        check(saver.getStatus().savesCompleted == 0, "до изменений ничего не записано");
+        saver.update(core);
+        saver.flush();
+        check(waitFor(saver, [](const AutoSaveStatus& status) { return status.savesCompleted == 1; }),
+              "flush записывает снимок");
+        const AutoSaveStatus status = saver.getStatus();
+        check(!status.inProgress && !status.lastSaveFailed, "запись завершена без ошибки");
+        check(status.total > 0 && status.written == status.total, "ход записи дошел до конца");
+        check(savedDump(file) == dump(core), "в файле сохраненное состояние");
+
+        // Тот же снимок повторно не пишется
+        saver.update(core);
+        saver.flush();
+        this_thread::sleep_for(chrono::milliseconds(100));
+        check(saver.getStatus().savesCompleted == 1, "неизмененное состояние не сохраняется");
+
+        // Снимок отдается копией: изменения после update не попадают в файл
+        core.addPipe("Резерв", 3, 500);
+        saver.update(core);
+        core.addPipe("После update", 1, 500);
+        saver.flush();
+        check(waitFor(saver, [](const AutoSaveStatus& status) { return status.savesCompleted == 2; }),
+              "измененное состояние сохраняется");
+        PipelineCore expected;
+        expected.loadFromFile(file);
+        check(expected.getPipes().size() == core.getPipes().size() - 1, "сохранен снимок на момент update");
+
+        // Последний снимок без flush дописывается при остановке
+        saver.update(core);
+    }
+    check(savedDump(file) == dump(core), "деструктор дописывает последний снимок");
+    remove(file.c_str());
+
+    const string missingDir = "autosave_test_missing_dir";
+    const string brokenFile = missingDir + "/data.txt";
+    filesystem::remove_all(missingDir);
+    {
+        AutoSaver broken(brokenFile, chrono::hours(1));
+        broken.update(core);
+        broken.flush();
+        check(waitFor(broken, [](const AutoSaveStatus& status) { return status.lastSaveFailed; }),
+              "сбой записи виден в состоянии");
+        check(broken.getStatus().savesCompleted == 0, "неудачная запись не считается");
+
+        // Снимок после сбоя не теряется: следующий flush пишет его без нового update
+        filesystem::create_directory(missingDir);
+        broken.flush();
+        check(waitFor(broken, [](const AutoSaveStatus& status) { return status.savesCompleted == 1; }),
+              "снимок после сбоя записывается повторно");
+        check(!broken.getStatus().lastSaveFailed, "повторная запись без ошибки");
+        check(savedDump(brokenFile) == dump(core), "повторно записан последний снимок");
+    }
+    filesystem::remove_all(missingDir);
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
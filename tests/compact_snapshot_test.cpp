@@ -0,0 +1,259 @@
+// Проверка сжатого снимка: сохранение и загрузка (целиком и лениво) дают
+// ту же сеть, а поврежденные и подделанные файлы отклоняются без падения.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+string dump(const PipelineCore& core) {
+    ostringstream out;
+    core.saveToStream(out);
+    return out.str();
+}
+
+string readFile(const string& file) {
+    ifstream in(file, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void writeFile(const string& file, const string& bytes) {
+    ofstream out(file, ios::binary);
+    out.write(bytes.data(), bytes.size());
+}
+
+void varint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Снимок из заданных счетчиков и столбцов, минуя запись из PipelineCore
+string craftSnapshot(uint64_t pipes, uint64_t stations, uint64_t connections, const vector<string>& columns) {
+    string bytes = "PIPESNAP";
+    varint(bytes, 1);
+    varint(bytes, 2);  // zigzag(1)
+    varint(bytes, 2);
+    varint(bytes, pipes);
+    varint(bytes, stations);
+    varint(bytes, connections);
+    varint(bytes, columns.size());
+    for (const string& column : columns) {
+        varint(bytes, column.size());
+    }
+    for (const string& column : columns) {
+        bytes += column;
+    }
+    return bytes;
+}
+
+// Контрольная сумма столбца - как в CompactSnapshot.cpp
+uint64_t checksum(const string& bytes) {
+    const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+    uint64_t hash = bytes.size() * multiplier;
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes.data() + i, sizeof(word));
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ static_cast<uint8_t>(bytes[i])) * multiplier;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// Каталог INDEX: названий КС нет, суммы всех остальных столбцов
+void addIndex(vector<string>& columns) {
+    string index;
+    varint(index, 0);
+    for (const string& column : columns) {
+        varint(index, checksum(column));
+    }
+    columns.push_back(index);
+}
+
+// Столбцы пустого снимка без каталога: словарь из 0 строк и 0 диаметров,
+// разности без значений; битовые столбцы (длины, флаги, типы) пусты
+vector<string> emptyColumns() {
+    vector<string> columns(17, string(1, '\0'));
+    for (size_t c : {3, 5, 16}) {
+        columns[c].clear();
+    }
+    return columns;
+}
+
+LoadStatus loadBytes(PipelineCore& core, const string& bytes, LoadMode mode) {
+    const string file = "compact_snapshot_test_input.snap";
+    writeFile(file, bytes);
+    LoadStatus status = core.loadFromFile(file, SaveFormat::Network, mode);
+    remove(file.c_str());
+    return status;
+}
+
+}
+
+int main() {
+    mt19937 random(11);
+    PipelineCore source;
+    vector<int> stationIds;
+    for (int i = 0; i < 200; ++i) {
+        stationIds.push_back(source.addStation("КС " + to_string(i % 37), 5 + i % 7, i % 5, 1 + i % 3));
+    }
+    for (int i = 0; i < 300; ++i) {
+        const int a = stationIds[random() % stationIds.size()];
+        const int b = stationIds[random() % stationIds.size()];
+        if (a != b) {
+            source.connectWithNewPipe(a, b, i % 2 ? 500 : 1000, "Магистраль " + to_string(i % 11), 1 + i % 4);
+        }
+    }
+    for (int i = 0; i < 40; ++i) {
+        source.addPipe("Резерв", 1.5 + i * 0.25, 700);
+    }
+    for (size_t i = 0; i < source.getPipes().size(); i += 9) {
+        source.setPipeRepair(source.getPipes()[i].id, true);
+    }
+
+    const string file = "compact_snapshot_test.snap";
+    check(source.saveToFile(file, SaveFormat::Compact), "сохранение снимка");
+    const string snapshot = readFile(file);
+    remove(file.c_str());
+    check(!snapshot.empty(), "снимок записан");
+
+    PipelineCore full;
+    check(loadBytes(full, snapshot, LoadMode::Full) == LoadStatus::Ok, "загрузка целиком");
+    check(dump(full) == dump(source), "загрузка целиком восстанавливает сеть");
+    PipelineCore lazy;
+    check(loadBytes(lazy, snapshot, LoadMode::Lazy) == LoadStatus::Ok, "ленивая загрузка");
+    check(!lazy.getPipes().isLoaded() && !lazy.getNetwork().isLoaded(), "трубы и соединения отложены");
+    check(lazy.getStations().size() == source.getStations().size(), "КС загружены сразу");
+    check(dump(lazy) == dump(source), "ленивая загрузка восстанавливает сеть");
+    check(!lazy.deferredLoadFailed(), "отложенные секции разобраны без ошибок");
+
+    // Усеченный снимок отклоняется при любой длине, прежние данные не меняются
+    const string before = dump(full);
+    for (size_t size = 0; size < snapshot.size(); size += 1 + size / 64) {
+        check(loadBytes(full, snapshot.substr(0, size), LoadMode::Full) == LoadStatus::BadFormat,
+              "усечение до " + to_string(size) + " байт");
+    }
+    check(dump(full) == before, "отклоненный снимок не меняет сеть");
+
+    // Испорченные байты: загрузка либо отклоняет снимок, либо дает согласованную сеть
+    for (int trial = 0; trial < 300; ++trial) {
+        string damaged = snapshot;
+        damaged[8 + random() % (damaged.size() - 8)] ^= static_cast<char>(1 + random() % 255);
+        PipelineCore core;
+        const LoadMode mode = trial % 2 ? LoadMode::Lazy : LoadMode::Full;
+        if (loadBytes(core, damaged, mode) == LoadStatus::Ok) {
+            check(core.getPipes().size() <= snapshot.size() * 2, "испорченный снимок: число труб");
+        }
+    }
+
+    // Серия из 2^40 одинаковых разностей ID обещала триллион труб в 48 байтах:
+    // счетчик должен сверяться со столбцом флагов до выделения памяти
+    vector<string> columns = emptyColumns();
+    columns[1] = string(1, '\1');
+    varint(columns[1], 2);
+    varint(columns[1], uint64_t(1) << 40);
+    const string huge = craftSnapshot(uint64_t(1) << 40, 0, 0, columns);
+    check(huge.size() <= 64, "подделанный снимок мал");
+    PipelineCore crafted;
+    check(loadBytes(crafted, huge, LoadMode::Full) == LoadStatus::BadFormat, "триллион труб отклонен");
+    check(loadBytes(crafted, huge, LoadMode::Lazy) == LoadStatus::BadFormat, "триллион труб отклонен лениво");
+
+    // То же для соединений и КС
+    columns = emptyColumns();
+    columns[13] = string(1, '\1');
+    varint(columns[13], 2);
+    varint(columns[13], uint64_t(1) << 40);
+    check(loadBytes(crafted, craftSnapshot(0, 0, uint64_t(1) << 40, columns), LoadMode::Full) ==
+              LoadStatus::BadFormat, "триллион соединений отклонен");
+    columns = emptyColumns();
+    columns[8] = string(1, '\1');
+    varint(columns[8], 2);
+    varint(columns[8], uint64_t(1) << 40);
+    check(loadBytes(crafted, craftSnapshot(0, uint64_t(1) << 40, 0, columns), LoadMode::Full) ==
+              LoadStatus::BadFormat, "триллион КС отклонен");
+
+    // Сумма серий, переполняющая 64 бита, не подгоняется под счетчик заголовка
+    columns = emptyColumns();
+    columns[1] = string(1, '\1');
+    for (int run = 0; run < 2; ++run) {
+        varint(columns[1], 2);
+        varint(columns[1], uint64_t(1) << 63);
+    }
+    varint(columns[1], 2);
+    varint(columns[1], 1);
+    columns[5] = string(1, '\0');
+    check(loadBytes(crafted, craftSnapshot(1, 0, 0, columns), LoadMode::Full) == LoadStatus::BadFormat,
+          "переполнение суммы серий отклонено");
+
+    // Подделка с верными контрольными суммами: название трубы ссылается за
+    // пределы пустого словаря. Ленивое открытие ее не видит, а разбор секции
+    // должен сообщить об ошибке, а не дополнить трубы пустыми записями
+    columns = emptyColumns();
+    columns[1] = string(1, '\0');
+    varint(columns[1], 2);
+    columns[2] = string(1, '\0');
+    varint(columns[2], 10);
+    columns[5] = string(1, '\0');
+    addIndex(columns);
+    const string forged = craftSnapshot(1, 0, 0, columns);
+    check(loadBytes(crafted, forged, LoadMode::Full) == LoadStatus::BadFormat, "подделка отклонена целиком");
+    check(loadBytes(crafted, forged, LoadMode::Lazy) == LoadStatus::Ok, "подделка открыта лениво");
+    check(!crafted.deferredLoadFailed(), "до обращения к трубам порча не видна");
+    check(crafted.getPipes().empty(), "поврежденная секция пуста");
+    check(crafted.deferredLoadFailed(), "порча секции сообщается");
+    check(crafted.getNetwork().empty() && !crafted.getNetwork().loadFailed(), "целая секция не помечена");
+
+    // Пустой подделанный снимок корректен - проверка выше отклоняет именно счетчики
+    check(loadBytes(crafted, craftSnapshot(0, 0, 0, emptyColumns()), LoadMode::Full) == LoadStatus::Ok,
+          "пустой снимок");
+    check(crafted.getPipes().empty() && crafted.getStations().empty(), "пустой снимок без записей");
+
+    // Концы соединений хранит труба; в текстовом файле они сверяются с ней
+    const string text = dump(source);
+    PipelineCore fromText;
+    check(loadBytes(fromText, text, LoadMode::Full) == LoadStatus::Ok && dump(fromText) == text,
+          "текстовый файл восстанавливает сеть");
+    const size_t networkAt = text.find("\nNETWORK ");
+    size_t endAt = networkAt;  // конец строки с концом первого соединения
+    for (int line = 0; line < 3 && endAt != string::npos; ++line) {
+        endAt = text.find('\n', endAt + 1);
+    }
+    check(endAt != string::npos, "в файле есть соединения");
+    if (endAt != string::npos) {
+        const string mismatched = text.substr(0, endAt + 1) + "-7" + text.substr(text.find('\n', endAt + 1));
+        check(loadBytes(fromText, mismatched, LoadMode::Full) == LoadStatus::BadFormat && dump(fromText) == text,
+              "конец соединения не совпадает с трубой");
+    }
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
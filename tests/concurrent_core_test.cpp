@@ -0,0 +1,97 @@
+// Проверка ConcurrentPipelineCore: читатели во время записей из нескольких
+// потоков видят только целые версии, удержанный снимок не меняется, а все
+// записи применяются по одной.
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_core/ConcurrentPipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+}
+
+int main() {
+    ConcurrentPipelineCore shared;
+    const ConcurrentPipelineCore::Snapshot empty = shared.snapshot();
+    const uint64_t firstVersion = shared.version();
+
+    // Каждая запись добавляет КС и трубу: в любой целой версии их поровну
+    const int writers = 3;
+    const int writesPerThread = 200;
+    atomic<bool> writing{true};
+    atomic<int> torn{0};
+    atomic<int> backwards{0};
+    vector<thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            ConcurrentPipelineCore::Reader reader(shared);
+            size_t last = 0;
+            while (writing.load()) {
+                const PipelineCore& core = reader.current();
+                const size_t stations = core.getStations().size();
+                torn += core.getPipes().size() != stations;
+                backwards += stations < last;
+                last = stations;
+            }
+        });
+    }
+    vector<thread> threads;
+    vector<int> wrongIds(writers, 0);
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w] {
+            for (int i = 0; i < writesPerThread; ++i) {
+                const int id = shared.write([&](PipelineCore& core) {
+                    core.addPipe("Труба " + to_string(w), 1, 500);
+                    return core.addStation("КС " + to_string(w), 2, 1, 1);
+                });
+                wrongIds[w] += id <= 0;
+            }
+        });
+    }
+    for (thread& writer : threads) {
+        writer.join();
+    }
+    writing = false;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+
+    check(torn == 0, "читатели не видят половину записи");
+    check(backwards == 0, "версии у читателя не идут назад");
+    for (int count : wrongIds) {
+        check(count == 0, "write возвращает результат изменения");
+    }
+    const ConcurrentPipelineCore::Snapshot latest = shared.snapshot();
+    const size_t total = static_cast<size_t>(writers * writesPerThread);
+    check(latest->getStations().size() == total && latest->getPipes().size() == total, "все записи применены");
+    check(shared.version() == firstVersion + total, "по версии на запись");
+    check(empty->getStations().empty() && empty->getPipes().empty(), "удержанный снимок не меняется");
+
+    // Дескриптор читателя замечает замену состояния
+    ConcurrentPipelineCore::Reader reader(shared);
+    check(&reader.current() == latest.get(), "читатель получает текущий снимок");
+    shared.replace(PipelineCore());
+    check(reader.current().getStations().empty(), "читатель видит замену состояния");
+    check(latest->getStations().size() == total, "прежний снимок жив, пока на него есть ссылка");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
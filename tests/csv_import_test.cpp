@@ -0,0 +1,133 @@
+// Проверка импорта CSV: заголовок в любом порядке и регистре, кавычки,
+// метка порядка байт, разделитель ';' с десятичной запятой, причины отказа
+// по строкам, а соединения - как последовательные connectObjects.
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+string dump(const PipelineCore& core) {
+    ostringstream out;
+    core.saveToStream(out);
+    return out.str();
+}
+
+CsvImportReport importText(PipelineCore& core, const string& text, CsvTable table) {
+    const string file = "csv_import_test.csv";
+    {
+        ofstream out(file, ios::binary);
+        out << text;
+    }
+    CsvImportReport report = core.importCsv(file, table);
+    remove(file.c_str());
+    return report;
+}
+
+bool rejectedAs(const CsvImportReport& report, size_t index, size_t line, CsvRowProblem problem) {
+    return index < report.errors.size() && report.errors[index].line == line && report.errors[index].problem == problem;
+}
+
+}
+
+int main() {
+    PipelineCore core;
+    CsvImportReport report = importText(core,
+        "\xEF\xBB\xBF" "Diameter,NAME,comment,Length,repair\n"
+        "500,\"Магистраль, участок \"\"Север\"\"\",x,12.5,1\n"
+        "\n"
+        "700,Отвод,,3,0\n"
+        "500,,,3\n"
+        "500,Труба,,abc\n"
+        "500,Труба,,0.0001\n"
+        "123,Труба,,4\n"
+        "500,Труба,,4,да\n"
+        "500\n",
+        CsvTable::Pipes);
+    check(report.status == CsvImportStatus::Ok, "трубы: файл разобран");
+    check(report.imported == 2 && report.rejected == 6, "трубы: 2 принято, 6 отклонено");
+    check(report.errors.size() == 6, "трубы: причины всех отказов");
+    check(rejectedAs(report, 0, 5, CsvRowProblem::EmptyName), "пустое название, строка 5");
+    check(rejectedAs(report, 1, 6, CsvRowProblem::BadNumber), "некорректная длина");
+    check(rejectedAs(report, 2, 7, CsvRowProblem::BadLength), "слишком короткая труба");
+    check(rejectedAs(report, 3, 8, CsvRowProblem::BadDiameter), "недопустимый диаметр");
+    check(rejectedAs(report, 4, 9, CsvRowProblem::BadFlag), "некорректный признак ремонта");
+    check(rejectedAs(report, 5, 10, CsvRowProblem::MissingField), "не хватает полей");
+    check(core.getPipes().size() == 2, "добавлены две трубы");
+    const Pipe& first = core.getPipes()[0];
+    check(first.name.str() == "Магистраль, участок \"Север\"", "название в кавычках");
+    check(first.length == 12.5 && first.diameter == 500 && first.underRepair, "поля первой трубы");
+    check(core.getPipes()[1].name.str() == "Отвод" && !core.getPipes()[1].underRepair, "вторая труба");
+
+    // ';' - разделитель, дробная часть через запятую
+    report = importText(core, "name;length;diameter\nЛиния;2,75;700\n", CsvTable::Pipes);
+    check(report.imported == 1 && core.getPipes()[2].length == 2.75, "десятичная запятая при ';'");
+
+    report = importText(core,
+        "name;workshops;active;class\n"
+        "КС Север;10;4;2\n"
+        "КС Юг;3;5;1\n"
+        "КС Восток;3;1;0\n"
+        "КС Запад;6;6;1\n",
+        CsvTable::Stations);
+    check(report.imported == 2 && report.rejected == 2, "КС: 2 принято, 2 отклонено");
+    check(rejectedAs(report, 0, 3, CsvRowProblem::BadWorkshops), "работающих больше, чем всего");
+    check(rejectedAs(report, 1, 4, CsvRowProblem::BadClass), "класс меньше 1");
+    const CompressorStation& north = core.getStations()[0];
+    check(north.name.str() == "КС Север" && north.totalWorkshops == 10 && north.activeWorkshops == 4 &&
+              north.stationClass == 2, "поля КС");
+
+    check(importText(core, "name,length\nТруба,3\n", CsvTable::Pipes).status == CsvImportStatus::BadHeader,
+          "нет обязательного столбца");
+    check(core.importCsv("csv_import_test_missing.csv", CsvTable::Pipes).status == CsvImportStatus::FileNotFound,
+          "нет файла");
+
+    // Соединения: импорт дает то же, что connectObjects и connectWithNewPipe по строкам
+    const int c = core.addStation("КС Центр", 2, 1, 1);
+    PipelineCore manual = core;
+    const int a = core.getStations()[0].id;
+    const int b = core.getStations()[1].id;
+    const string s = to_string(a);
+    const string t = to_string(b);
+    report = importText(core,
+        "start,end,diameter,name,length\n" +
+        s + "," + t + ",700\n" +                // свободная труба 700 - Отвод
+        s + "," + t + ",700\n" +                // повтор
+        t + "," + s + ",500,Обратная,4\n" +     // свободная 500 в ремонте - создается новая
+        s + "," + s + ",500\n" +
+        "999," + t + ",500\n" +
+        t + "," + to_string(c) + ",1000\n",      // нет свободной и не задано название
+        CsvTable::Connections);
+    check(report.imported == 2 && report.rejected == 4, "соединения: 2 принято, 4 отклонено");
+    check(report.errors.size() == 4 && report.errors[0].connectStatus == ConnectStatus::AlreadyExists &&
+              report.errors[1].connectStatus == ConnectStatus::SameObject &&
+              report.errors[2].connectStatus == ConnectStatus::StartNotFound &&
+              report.errors[3].connectStatus == ConnectStatus::NoFreePipe, "причины отказа соединений");
+    manual.connectObjects(a, b, 700);
+    manual.connectWithNewPipe(b, a, 500, "Обратная", 4);
+    check(dump(core) == dump(manual), "импорт соединений совпадает с построчным соединением");
+    check(core.sameIsland(a, b), "острова обновлены после пакета");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,202 @@
+// Проверка установившегося режима: баланс расхода во внутренних узлах,
+// повышение давления работающей КС, трубы в ремонте без расхода и
+// сходимость на сетке из 100 тысяч узлов.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+double pressureOf(const FlowResult& result, int stationId) {
+    for (const FlowNode& node : result.nodes) {
+        if (node.isStation && node.id == stationId) {
+            return node.pressure;
+        }
+    }
+    return NAN;
+}
+
+// Расход трубы; трубы, не попавшие в расчет, газ не проводят
+double flowOf(const FlowResult& result, int pipeId) {
+    for (const PipeFlow& pipe : result.pipes) {
+        if (pipe.pipeId == pipeId) {
+            return pipe.flow;
+        }
+    }
+    return 0;
+}
+
+// Наибольший небаланс (приток минус отток) во внутренних узлах
+double worstJunctionImbalance(const PipelineCore& core, const FlowResult& result) {
+    unordered_map<int, const Pipe*> pipeById;
+    for (const Pipe& pipe : core.getPipes()) {
+        pipeById[pipe.id] = &pipe;
+    }
+    unordered_map<int, double> balance;
+    for (const PipeFlow& flow : result.pipes) {
+        const Pipe& pipe = *pipeById.at(flow.pipeId);
+        balance[pipe.startId] -= flow.flow;
+        balance[pipe.endId] += flow.flow;
+    }
+    double worst = 0;
+    for (const FlowNode& node : result.nodes) {
+        if (node.role == FlowNodeRole::Junction) {
+            worst = max(worst, fabs(balance[node.id]));
+        }
+    }
+    return worst;
+}
+
+// Сетка rows x columns КС: трубы вправо и вниз, слева в каждую строку
+// подает своя КС-вход, справа из каждой строки забирает своя КС-выход.
+// У двух КС из трех работают цеха, так что режим заметно нелинеен.
+// Строится через импорт CSV: connectWithNewPipe проверяет повторы
+// соединений перебором всей сети.
+void buildGrid(PipelineCore& core, int rows, int columns) {
+    const string file = "gas_flow_test.csv";
+    const int first = core.getNextStationId();
+    auto node = [&](int row, int column) { return first + row * columns + column; };
+    const int sources = first + rows * columns;
+    const int deliveries = sources + rows;
+    {
+        ofstream out(file);
+        out << "name,workshops,active,class\n";
+        for (int i = 0; i < rows * columns + 2 * rows; ++i) {
+            out << "КС,4," << i % 3 << ",1\n";
+        }
+    }
+    core.importCsv(file, CsvTable::Stations);
+    {
+        ofstream out(file);
+        out << "start,end,diameter,name,length\n";
+        for (int row = 0; row < rows; ++row) {
+            out << sources + row << ',' << node(row, 0) << ",1000,Подача,10\n";
+            out << node(row, columns - 1) << ',' << deliveries + row << ",1000,Отбор,10\n";
+            for (int column = 0; column < columns; ++column) {
+                if (column + 1 < columns) {
+                    out << node(row, column) << ',' << node(row, column + 1) << ",700,Участок,"
+                        << 5 + (row * 7 + column * 3) % 11 << '\n';
+                }
+                if (row + 1 < rows) {
+                    out << node(row, column) << ',' << node(row + 1, column) << ",500,Перемычка,"
+                        << 3 + (row * 5 + column) % 7 << '\n';
+                }
+            }
+        }
+    }
+    core.importCsv(file, CsvTable::Connections);
+    remove(file.c_str());
+}
+
+}
+
+int main() {
+    // Ромб с двумя ветвями и хвостом: вход -> A -> (B | C) -> D -> выход
+    PipelineCore core;
+    const int source = core.addStation("Вход", 2, 0, 1);
+    const int a = core.addStation("A", 4, 0, 1);
+    const int b = core.addStation("B", 4, 0, 1);
+    const int c = core.addStation("C", 4, 0, 1);
+    const int d = core.addStation("D", 4, 0, 1);
+    const int delivery = core.addStation("Выход", 2, 0, 1);
+    core.connectWithNewPipe(source, a, 1000, "Подача", 40);
+    const int upper = core.connectWithNewPipe(a, b, 700, "Верх", 60).pipeId;
+    core.connectWithNewPipe(a, c, 500, "Низ", 25);
+    const int upperOut = core.connectWithNewPipe(b, d, 700, "Верх 2", 30).pipeId;
+    const int lower = core.connectWithNewPipe(c, d, 500, "Низ 2", 35).pipeId;
+    const int outlet = core.connectWithNewPipe(d, delivery, 1000, "Отбор", 50).pipeId;
+
+    FlowSettings settings;
+    FlowResult result = core.solveFlow(settings);
+    check(result.converged && result.status == FlowStatus::Ok, "ромб: расчет сошелся");
+    check(result.residual <= settings.tolerance, "ромб: небаланс в допуске");
+    check(worstJunctionImbalance(core, result) <= settings.tolerance, "ромб: баланс расхода во внутренних узлах");
+    check(result.totalSupply > 0 && fabs(result.totalSupply - flowOf(result, outlet)) <=
+              settings.tolerance, "ромб: подача равна отбору");
+    check(pressureOf(result, source) > pressureOf(result, a) && pressureOf(result, a) > pressureOf(result, d) &&
+              pressureOf(result, d) > pressureOf(result, delivery), "ромб: давление падает по ходу газа");
+
+    FlowSettings oneStep = settings;
+    oneStep.maxIterations = 0;
+    FlowResult cut = core.solveFlow(oneStep);
+    check(!cut.converged && cut.status == FlowStatus::IterationLimit, "предел итераций виден в status");
+
+    // Труба в ремонте выпадает из расчета: в D газ приходит только по верхней
+    // ветви, а C без исходящих труб становится выходом сети
+    core.setPipeRepair(lower, true);
+    FlowResult repaired = core.solveFlow(settings);
+    check(repaired.converged, "ремонт: расчет сошелся");
+    check(flowOf(repaired, lower) == 0, "ремонт: труба в ремонте без расхода");
+    check(flowOf(repaired, upper) > 0 &&
+              fabs(flowOf(repaired, upperOut) - flowOf(repaired, outlet)) <= settings.tolerance,
+          "ремонт: D питается только верхней ветвью");
+    check(worstJunctionImbalance(core, repaired) <= settings.tolerance, "ремонт: баланс расхода");
+    core.setPipeRepair(lower, false);
+
+    // Цепочка одинаковых труб вход -> КС -> M -> выход: при остановленной КС
+    // квадраты давлений убывают равными шагами, работающая КС поднимает
+    // давление за собой
+    PipelineCore chain;
+    const int chainSource = chain.addStation("Вход", 2, 0, 1);
+    const int station = chain.addStation("КС", 4, 0, 1);
+    const int middle = chain.addStation("M", 2, 0, 1);
+    const int chainDelivery = chain.addStation("Выход", 2, 0, 1);
+    chain.connectWithNewPipe(chainSource, station, 1000, "1", 50);
+    chain.connectWithNewPipe(station, middle, 1000, "2", 50);
+    chain.connectWithNewPipe(middle, chainDelivery, 1000, "3", 50);
+
+    FlowResult idle = chain.solveFlow(settings);
+    check(idle.converged, "КС остановлена: расчет сошелся");
+    const double sourceSquared = settings.sourcePressure * settings.sourcePressure;
+    const double dropSquared = (sourceSquared - settings.deliveryPressure * settings.deliveryPressure) / 3;
+    check(fabs(pow(pressureOf(idle, station), 2) - (sourceSquared - dropSquared)) < 1e-3 &&
+              fabs(pow(pressureOf(idle, middle), 2) - (sourceSquared - 2 * dropSquared)) < 1e-3,
+          "КС остановлена: давление не повышается");
+
+    chain.startWorkshop(station);
+    chain.startWorkshop(station);
+    FlowResult active = chain.solveFlow(settings);
+    check(active.converged, "КС работает: расчет сошелся");
+    check(pressureOf(active, middle) > pressureOf(idle, middle), "КС работает: давление за КС выше");
+    check(active.totalSupply > idle.totalSupply, "КС работает: подача выросла");
+    const double outletSquared = GasFlowSolver::compressionBoost(settings, 2) * pow(pressureOf(active, station), 2);
+    check(outletSquared > pow(pressureOf(active, middle), 2) &&
+              pow(pressureOf(active, middle), 2) > pow(settings.deliveryPressure, 2),
+          "КС работает: газ идет от выхода КС дальше");
+
+    // Сетка 316 x 316 с входами и выходами - около 100 тысяч узлов
+    PipelineCore grid;
+    buildGrid(grid, 316, 316);
+    check(grid.getStations().size() >= 100000, "сетка построена");
+    const auto started = chrono::steady_clock::now();
+    FlowResult gridResult = grid.solveFlow(settings);
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    check(gridResult.converged && gridResult.residual <= settings.tolerance, "сетка: расчет сошелся");
+    check(worstJunctionImbalance(grid, gridResult) <= settings.tolerance, "сетка: баланс расхода");
+    cout << "Сетка: " << grid.getStations().size() << " узлов, " << gridResult.iterations
+         << " итераций Ньютона, " << seconds << " с" << endl;
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,211 @@
+// Проверка разбиения: для 1, 2, 3 и 7 частей на сетке и на несвязной сети
+// части укладываются в допуск 3%, разрезанные ребра (трубы) - ровно те, чьи
+// концы в разных частях, а новая нумерация - перестановка с частями подряд.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pipeline_core/GraphPartitioner.h"
+#include "pipeline_core/NetworkIslands.h"
+#include "pipeline_core/PipeIndex.h"
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+const size_t PART_COUNTS[] = {1, 2, 3, 7};
+
+// Наибольший допустимый размер части при единичных весах
+size_t sizeLimit(size_t vertices, size_t parts) {
+    return static_cast<size_t>(floor(1.03 * vertices / parts));
+}
+
+// partStart задает parts непустых отрезков, покрывающих [0, vertices)
+bool validStarts(const vector<int>& partStart, size_t vertices, size_t parts) {
+    if (partStart.size() != parts + 1 || partStart.front() != 0 ||
+        partStart.back() != static_cast<int>(vertices)) {
+        return false;
+    }
+    for (size_t p = 0; p < parts; ++p) {
+        if (partStart[p + 1] <= partStart[p]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t largestPart(const vector<int>& partStart) {
+    size_t largest = 0;
+    for (size_t p = 0; p + 1 < partStart.size(); ++p) {
+        largest = max(largest, static_cast<size_t>(partStart[p + 1] - partStart[p]));
+    }
+    return largest;
+}
+
+vector<pair<int, int>> gridEdges(int rows, int columns) {
+    vector<pair<int, int>> edges;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            const int v = row * columns + column;
+            if (column + 1 < columns) edges.push_back({v, v + 1});
+            if (row + 1 < rows) edges.push_back({v, v + columns});
+        }
+    }
+    return edges;
+}
+
+void checkGraph(const string& name, size_t vertices, const vector<pair<int, int>>& edges, size_t parts) {
+    const string what = name + ", частей " + to_string(parts) + ": ";
+    GraphPartition partition = partitionGraph(vertices, edges, parts);
+
+    check(partition.part.size() == vertices && partition.order.size() == vertices &&
+              partition.newIndex.size() == vertices, what + "размеры");
+    check(validStarts(partition.partStart, vertices, parts), what + "части непусты и покрывают все вершины");
+    check(largestPart(partition.partStart) <= sizeLimit(vertices, parts), what + "баланс в пределах 3%");
+
+    vector<int> sorted = partition.order;
+    sort(sorted.begin(), sorted.end());
+    bool permutation = true;
+    for (size_t k = 0; k < vertices; ++k) {
+        permutation = permutation && sorted[k] == static_cast<int>(k) &&
+                      partition.newIndex[partition.order[k]] == static_cast<int>(k);
+    }
+    check(permutation, what + "order - перестановка, newIndex - обратная");
+
+    bool contiguous = true;
+    for (size_t p = 0; p < parts; ++p) {
+        for (int k = partition.partStart[p]; k < partition.partStart[p + 1]; ++k) {
+            contiguous = contiguous && partition.part[partition.order[k]] == static_cast<int>(p);
+        }
+    }
+    check(contiguous, what + "вершины каждой части идут подряд");
+
+    vector<int> cut;
+    for (size_t e = 0; e < edges.size(); ++e) {
+        if (partition.part[edges[e].first] != partition.part[edges[e].second]) {
+            cut.push_back(static_cast<int>(e));
+        }
+    }
+    check(partition.cutEdges == cut && partition.cutWeight == static_cast<long long>(cut.size()),
+          what + "разрез совпадает с фактическим");
+    check(parts > 1 || cut.empty(), what + "одна часть без разреза");
+}
+
+void checkNetwork(const string& name, const PipelineCore& core, size_t parts) {
+    const string what = name + ", частей " + to_string(parts) + ": ";
+    NetworkPartition partition = core.partitionNetwork(parts);
+
+    const PipeIndex pipeById(core.getPipes());
+    set<int64_t> expected;
+    for (const auto& conn : core.getNetwork()) {
+        const Pipe& pipe = *pipeById.find(conn.pipeId);
+        expected.insert(NetworkIslands::nodeIndex(pipe.startId, startIsStation(pipe)));
+        expected.insert(NetworkIslands::nodeIndex(pipe.endId, endIsStation(pipe)));
+    }
+    const size_t vertices = expected.size();
+    check(partition.nodes.size() == vertices &&
+              set<int64_t>(partition.nodes.begin(), partition.nodes.end()) == expected,
+          what + "nodes - перестановка узлов сети");
+    check(validStarts(partition.partStart, vertices, parts), what + "части непусты и покрывают все узлы");
+    check(largestPart(partition.partStart) <= sizeLimit(vertices, parts), what + "баланс в пределах 3%");
+
+    bool consistent = partition.part.size() == vertices;
+    for (size_t p = 0; consistent && p < parts; ++p) {
+        for (int k = partition.partStart[p]; k < partition.partStart[p + 1]; ++k) {
+            consistent = consistent && partition.part[k] == static_cast<int>(p);
+        }
+    }
+    check(consistent, what + "part совпадает с partStart");
+
+    vector<pair<int64_t, int>> partOfNode;
+    for (size_t k = 0; k < partition.nodes.size() && k < partition.part.size(); ++k) {
+        partOfNode.push_back({partition.nodes[k], partition.part[k]});
+    }
+    sort(partOfNode.begin(), partOfNode.end());
+    auto partOf = [&](int64_t node) {
+        auto it = lower_bound(partOfNode.begin(), partOfNode.end(), make_pair(node, -1));
+        return it != partOfNode.end() && it->first == node ? it->second : -1;
+    };
+    vector<int> cut;
+    for (const auto& conn : core.getNetwork()) {
+        const Pipe& pipe = *pipeById.find(conn.pipeId);
+        if (partOf(NetworkIslands::nodeIndex(pipe.startId, startIsStation(pipe))) !=
+            partOf(NetworkIslands::nodeIndex(pipe.endId, endIsStation(pipe)))) {
+            cut.push_back(conn.pipeId);
+        }
+    }
+    vector<int> reported = partition.cutPipeIds;
+    sort(cut.begin(), cut.end());
+    sort(reported.begin(), reported.end());
+    check(reported == cut, what + "cutPipeIds - ровно трубы между частями");
+}
+
+// Сетка rows x columns КС, трубы вправо и вниз
+void addGrid(PipelineCore& core, int rows, int columns) {
+    vector<int> ids;
+    for (int i = 0; i < rows * columns; ++i) {
+        ids.push_back(core.addStation("КС " + to_string(i), 2, 1, 1));
+    }
+    for (auto [a, b] : gridEdges(rows, columns)) {
+        core.connectWithNewPipe(ids[a], ids[b], 500, "Участок", 10);
+    }
+}
+
+}
+
+int main() {
+    for (size_t parts : PART_COUNTS) {
+        checkGraph("сетка 40x25", 1000, gridEdges(40, 25), parts);
+    }
+
+    PipelineCore grid;
+    addGrid(grid, 24, 20);
+    for (size_t parts : PART_COUNTS) {
+        checkNetwork("сеть-сетка", grid, parts);
+    }
+
+    // Несвязная сеть: сетка, цепочка, отдельные пары КС и труба-узел
+    PipelineCore scattered;
+    addGrid(scattered, 12, 15);
+    int previous = scattered.addStation("Цепочка", 2, 1, 1);
+    for (int i = 0; i < 120; ++i) {
+        const int next = scattered.addStation("Цепочка", 2, 1, 1);
+        scattered.connectWithNewPipe(previous, next, 700, "Цепочка", 20);
+        previous = next;
+    }
+    for (int i = 0; i < 40; ++i) {
+        const int a = scattered.addStation("Пара", 2, 1, 1);
+        const int b = scattered.addStation("Пара", 2, 1, 1);
+        scattered.connectWithNewPipe(a, b, 1000, "Пара", 5);
+    }
+    const int branch = scattered.addPipe("Отвод", 3, 500);
+    const int tap = scattered.addStation("Отбор", 2, 1, 1);
+    // ID трубы больше ID всех КС, поэтому getObjectInfo находит именно трубу
+    check(scattered.connectWithNewPipe(tap, branch, 500, "К отводу", 2).status == ConnectStatus::Ok &&
+              !scattered.getObjectInfo(branch).first, "труба-узел в сети");
+    for (size_t parts : PART_COUNTS) {
+        checkNetwork("несвязная сеть", scattered, parts);
+    }
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,199 @@
+// Проверка островов и запросов к сети: ID у границ диапазона int (включая
+// INT_MIN) и копии, от которых разделяемый экземпляр DynamicConnectivity
+// ушел вперед.
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+void writeStation(ofstream& out, int id) {
+    out << id << "\nКС\n3\n1\n1\n";
+}
+
+void writePipe(ofstream& out, int id, int startId, int endId) {
+    out << id << "\nТруба\n2\n500\n0\n1\n" << startId << '\n' << endId << "\n0\n0\n";
+}
+
+void writeConnection(ofstream& out, int pipeId, int startId, int endId) {
+    out << pipeId << '\n' << startId << '\n' << endId << "\n0\n0\n";
+}
+
+// Острова по определению: обход соединений рабочих труб без учета направления
+bool reachable(const PipelineCore& core, int fromId, int toId) {
+    vector<int> frontier = {fromId};
+    vector<int> seen = {fromId};
+    while (!frontier.empty()) {
+        int id = frontier.back();
+        frontier.pop_back();
+        if (id == toId) {
+            return true;
+        }
+        for (const auto& conn : core.getNetwork()) {
+            const Pipe& pipe = core.getPipes()[core.findPipeIndexById(conn.pipeId)];
+            if (pipe.underRepair) {
+                continue;
+            }
+            int other = pipe.startId == id ? pipe.endId : pipe.endId == id ? pipe.startId : 0;
+            if (other != 0 && find(seen.begin(), seen.end(), other) == seen.end()) {
+                seen.push_back(other);
+                frontier.push_back(other);
+            }
+        }
+    }
+    return false;
+}
+
+}
+
+int main() {
+    // Прежняя нумерация 2*id переполнялась: КС INT_MAX и КС -1 давали один узел
+    const string file = "islands_test.txt";
+    {
+        ofstream out(file);
+        out << "NEXT_PIPE_ID 4\nNEXT_STATION_ID 3\nPIPES 3\n";
+        writePipe(out, 1, 1, INT_MAX);
+        writePipe(out, 2, 1 << 30, 2);
+        writePipe(out, 3, INT_MIN, 1);
+        out << "STATIONS 6\n";
+        for (int id : {1, 2, INT_MAX, -1, 1 << 30, INT_MIN}) {
+            writeStation(out, id);
+        }
+        out << "NETWORK 3\n";
+        writeConnection(out, 1, 1, INT_MAX);
+        writeConnection(out, 2, 1 << 30, 2);
+        writeConnection(out, 3, INT_MIN, 1);
+    }
+    PipelineCore edges;
+    check(edges.loadFromFile(file) == LoadStatus::Ok, "загрузка сети с крайними ID");
+    remove(file.c_str());
+    check(edges.sameIsland(1, INT_MAX), "КС 1 и INT_MAX соединены");
+    check(!edges.sameIsland(-1, INT_MAX), "КС -1 и INT_MAX не соединены");
+    check(edges.sameIsland(1 << 30, 2), "КС 2^30 и 2 соединены");
+    check(!edges.sameIsland(1 << 30, 1), "КС 2^30 и 1 не соединены");
+    check(edges.getIslands().size() == 2, "два острова");
+
+    // INT_MIN прежде служил признаком пустой ячейки в таблицах ID запросов
+    const PathResult path = edges.findPath(INT_MIN, INT_MAX);
+    check(path.status == PathStatus::Found && path.nodes.size() == 3, "путь из КС INT_MIN");
+    check(path.pipeIds == vector<int>({3, 1}), "путь по трубам 3 и 1");
+    const TopoSortResult order = edges.topologicalSort();
+    check(!order.hasCycle && order.order.size() == 6, "все КС в топологическом порядке");
+    auto position = [&](int id) { return find(order.order.begin(), order.order.end(), id) - order.order.begin(); };
+    check(position(INT_MIN) < position(1) && position(1) < position(INT_MAX), "INT_MIN раньше 1 и INT_MAX");
+
+    // Ошибка в последней секции: загрузка отклоняется, хотя трубы и КС уже
+    // разобраны и построены, и прежние данные не меняются
+    {
+        ofstream out(file);
+        out << "NEXT_PIPE_ID 2\nNEXT_STATION_ID 3\nPIPES 1\n";
+        writePipe(out, 1, 1, 2);
+        out << "STATIONS 2\n";
+        writeStation(out, 1);
+        writeStation(out, 2);
+        out << "NETWORK 1\n1\n1\nдва\n0\n0\n";
+    }
+    check(edges.loadFromFile(file) == LoadStatus::BadFormat, "поврежденная сеть отклонена");
+    remove(file.c_str());
+    check(edges.getStations().size() == 6 && edges.sameIsland(INT_MIN, INT_MAX), "отклоненная загрузка не меняет сеть");
+
+    PipelineCore before = edges;
+    edges.disconnectPipe(1);
+    check(!edges.sameIsland(1, INT_MAX), "после разрыва КС 1 и INT_MAX не соединены");
+    check(before.sameIsland(1, INT_MAX), "копия до разрыва видит соединение");
+    check(!before.sameIsland(-1, INT_MAX), "копия до разрыва: КС -1 отдельно");
+
+    // Случайные изменения; копии всех промежуточных версий опрашиваются после них
+    mt19937 random(7);
+    PipelineCore core;
+    vector<int> stationIds;
+    for (int i = 0; i < 30; ++i) {
+        stationIds.push_back(core.addStation("КС", 3, 1, 1));
+    }
+    vector<PipelineCore> versions;
+    for (int step = 0; step < 120; ++step) {
+        int a = stationIds[random() % stationIds.size()];
+        int b = stationIds[random() % stationIds.size()];
+        switch (random() % 3) {
+            case 0:
+                if (a != b) {
+                    core.connectWithNewPipe(a, b, 500, "Труба", 2);
+                }
+                break;
+            case 1:
+                if (!core.getNetwork().empty()) {
+                    core.disconnectPipe(core.getNetwork()[random() % core.getNetwork().size()].pipeId);
+                }
+                break;
+            default:
+                if (!core.getNetwork().empty()) {
+                    int pipeId = core.getNetwork()[random() % core.getNetwork().size()].pipeId;
+                    const Pipe& pipe = core.getPipes()[core.findPipeIndexById(pipeId)];
+                    core.setPipeRepair(pipeId, !pipe.underRepair);
+                }
+                break;
+        }
+        versions.push_back(core);
+    }
+    for (size_t v = 0; v < versions.size(); v += 7) {
+        const PipelineCore& old = versions[v];
+        for (int query = 0; query < 20; ++query) {
+            int a = stationIds[random() % stationIds.size()];
+            int b = stationIds[random() % stationIds.size()];
+            check(old.sameIsland(a, b) == reachable(old, a, b), "версия " + to_string(v) + ": острова КС");
+        }
+        size_t nodes = 0;
+        for (const IslandSummary& island : old.getIslands()) {
+            nodes += island.stationIds.size() + island.pipeIds.size();
+        }
+        check(nodes <= stationIds.size(), "версия " + to_string(v) + ": узлы островов");
+    }
+
+    // Правки старых версий (как после отмены) забирают общий экземпляр себе,
+    // а правки новой - обратно; острова всех копий остаются верными
+    auto checkIslands = [&](const PipelineCore& copy, const string& what) {
+        for (int query = 0; query < 20; ++query) {
+            int a = stationIds[random() % stationIds.size()];
+            int b = stationIds[random() % stationIds.size()];
+            check(copy.sameIsland(a, b) == reachable(copy, a, b), what);
+        }
+    };
+    for (size_t v = 3; v < versions.size(); v += 17) {
+        PipelineCore undone = versions[v];
+        if (!undone.getNetwork().empty()) {
+            undone.disconnectPipe(undone.getNetwork()[0].pipeId);
+        }
+        undone.connectWithNewPipe(stationIds[v % stationIds.size()], stationIds[(v * 7 + 3) % stationIds.size()],
+                                  500, "Труба", 2);
+        checkIslands(undone, "правка версии " + to_string(v));
+        checkIslands(core, "новая версия после правки версии " + to_string(v));
+        core.connectWithNewPipe(stationIds[v % 5], stationIds[10 + v % 7], 500, "Труба", 2);
+        checkIslands(core, "правка новой версии после версии " + to_string(v));
+        checkIslands(undone, "версия " + to_string(v) + " после правки новой");
+    }
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
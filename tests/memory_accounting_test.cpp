@@ -0,0 +1,97 @@
+// Проверка учета памяти: учитывающий аллокатор возвращает в счетчик все,
+// что взял, пики держатся до сброса, отчет ядра сходится с размером записей
+// и сумма структур равна общему счетчику, а разрушенное ядро память отдает.
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/MemoryAccounting.h"
+#include "pipeline_core/PipelineCore.h"
+#include "pipeline_core/StringPool.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+const MemoryUsage& usageOf(const MemoryReport& report, MemoryCategory category) {
+    return report.entries[static_cast<size_t>(category)];
+}
+
+}
+
+int main() {
+    MemoryTracker& tracker = MemoryTracker::instance();
+
+    // Аллокатор: выделение и освобождение, пик и его сброс
+    const size_t otherBefore = tracker.reserved(MemoryCategory::Other);
+    {
+        vector<int, TrackedAllocator<int, MemoryCategory::Other>> numbers;
+        numbers.reserve(1000);
+        check(tracker.reserved(MemoryCategory::Other) == otherBefore + 1000 * sizeof(int), "выделение учтено");
+    }
+    check(tracker.reserved(MemoryCategory::Other) == otherBefore, "освобождение учтено");
+    check(tracker.peak(MemoryCategory::Other) >= otherBefore + 1000 * sizeof(int), "пик держится после освобождения");
+    tracker.resetPeaks();
+    check(tracker.peak(MemoryCategory::Other) == otherBefore, "сброс опускает пик до текущего");
+    check(tracker.totalPeak() == tracker.totalReserved(), "сброс общего пика");
+
+    const size_t pipesBefore = tracker.reserved(MemoryCategory::Pipes);
+    const size_t stationsBefore = tracker.reserved(MemoryCategory::Stations);
+    {
+        PipelineCore core;
+        vector<int> ids;
+        for (int i = 0; i < 20000; ++i) {
+            core.addPipe("Труба " + to_string(i % 100), 1 + i % 7, 500);
+            if (i % 10 == 0) {
+                ids.push_back(core.addStation("КС", 4, 2, 1));
+            }
+        }
+        for (size_t i = 0; i + 1 < ids.size(); ++i) {
+            core.connectObjects(ids[i], ids[i + 1], 500);
+        }
+
+        MemoryReport report = core.memoryReport();
+        check(report.entries.size() == static_cast<size_t>(MemoryCategory::Count), "по записи на структуру");
+        const MemoryUsage& pipes = usageOf(report, MemoryCategory::Pipes);
+        check(pipes.category == MemoryCategory::Pipes, "порядок структур");
+        check(pipes.used == core.getPipes().size() * sizeof(Pipe), "занято трубами - размер записей");
+        check(pipes.reserved >= pipes.used && pipes.reserved <= pipesBefore + pipes.used * 2, "выделено под трубы");
+        check(pipes.peak >= pipes.reserved, "пик не меньше текущего");
+        check(usageOf(report, MemoryCategory::Network).used == core.getNetwork().size() * sizeof(NetworkConnection),
+              "занято соединениями");
+        check(usageOf(report, MemoryCategory::Names).used == StringPool::bytesUsed(), "занято пулом строк");
+        check(usageOf(report, MemoryCategory::Islands).reserved > 0, "острова учтены");
+        size_t reserved = 0;
+        size_t used = 0;
+        for (const MemoryUsage& usage : report.entries) {
+            reserved += usage.reserved;
+            used += usage.used;
+        }
+        check(reserved == report.totalReserved, "сумма структур равна общему счетчику");
+        check(used == report.totalUsed, "сумма занятого");
+
+        // Копия делит записи: изменение одной трубы добавляет кусок, а не все трубы
+        PipelineCore copy = core;
+        copy.setPipeRepair(copy.getPipes()[7].id, true);
+        const size_t afterEdit = tracker.reserved(MemoryCategory::Pipes);
+        check(afterEdit - pipes.reserved < pipes.used / 10, "копия с правкой не дублирует трубы");
+    }
+    check(tracker.reserved(MemoryCategory::Pipes) == pipesBefore, "трубы освобождены вместе с ядром");
+    check(tracker.reserved(MemoryCategory::Stations) == stationsBefore, "КС освобождены вместе с ядром");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Проверка выгрузки сети: трубы-узлы с ID у границ диапазона int выводятся
+// по одному разу, а отметки узлов не зависят от разброса ID.
+#include <climits>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/NetworkExport.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+size_t countOf(const string& text, const string& part) {
+    size_t count = 0;
+    for (size_t at = text.find(part); at != string::npos; at = text.find(part, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// Подключенная труба id от start к end
+Pipe connectedPipe(int id, int startId, int endId, ConnectionType type) {
+    Pipe pipe{};
+    pipe.id = id;
+    pipe.length = 1;
+    pipe.diameter = 500;
+    pipe.startId = startId;
+    pipe.endId = endId;
+    pipe.inUse = true;
+    pipe.startType = type;
+    pipe.endType = type;
+    return pipe;
+}
+
+// Трубы pipes подключаются в сеть в своем порядке
+string exportDot(const vector<Pipe>& pipes) {
+    vector<NetworkConnection> connections;
+    for (const Pipe& pipe : pipes) {
+        connections.push_back({pipe.id});
+    }
+    ostringstream out;
+    exportNetwork(out, ExportFormat::Dot, PersistentVector<Pipe>(pipes), PersistentVector<CompressorStation>(),
+                  PersistentVector<NetworkConnection>(connections));
+    return out.str();
+}
+
+}
+
+int main() {
+    // Трубы-узлы INT_MIN и INT_MAX: прежде карта на 2^32 бит (512 МБ)
+    vector<Pipe> sparse = {
+        connectedPipe(1, INT_MIN, INT_MAX, PIPE_TO_PIPE),
+        connectedPipe(2, INT_MAX, 5, PIPE_TO_STATION),
+        connectedPipe(3, 7, INT_MIN, STATION_TO_PIPE),
+    };
+    const string edges = exportDot(sparse);
+    check(countOf(edges, "  p-2147483648 [") == 1, "узел трубы INT_MIN один раз");
+    check(countOf(edges, "  p2147483647 [") == 1, "узел трубы INT_MAX один раз");
+    check(countOf(edges, "[shape=ellipse") == 2, "других труб-узлов нет");
+    check(edges.find("p-2147483648 -> p2147483647") != string::npos, "дуга между крайними ID");
+    check(edges.find("p2147483647 -> s5") != string::npos && edges.find("s7 -> p-2147483648") != string::npos,
+          "дуги к КС");
+
+    // Плотные ID: каждая труба-узел один раз, по возрастанию ID
+    vector<Pipe> dense;
+    for (int i = 0; i < 100; ++i) {
+        dense.push_back(connectedPipe(i + 1, 1000 + i, 1000 + (i + 1) % 100, PIPE_TO_PIPE));
+    }
+    const string chain = exportDot(dense);
+    check(countOf(chain, "[shape=ellipse") == 100, "сто труб-узлов");
+    check(chain.find("  p1000 [") < chain.find("  p1099 ["), "узлы по возрастанию ID");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Проверка статистики операций: процентили гистограммы отличаются от точных
+// не больше чем на 3% при разбросе значений в миллионы раз, малые значения
+// хранятся точно, запись из нескольких потоков ничего не теряет, а
+// выключенная статистика операции ядра не считает.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_core/OperationMetrics.h"
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+uint64_t exactPercentile(const vector<uint64_t>& sorted, double quantile) {
+    size_t rank = static_cast<size_t>(quantile * sorted.size() + 0.5);
+    rank = max<size_t>(rank, 1);
+    return sorted[rank - 1];
+}
+
+const OperationStats* statsOf(const vector<OperationStats>& all, Operation operation) {
+    for (const OperationStats& stats : all) {
+        if (stats.operation == operation) {
+            return &stats;
+        }
+    }
+    return nullptr;
+}
+
+}
+
+int main() {
+    // Значения от 1 нс до ~17 мс, равномерно по порядку величины
+    mt19937_64 random(17);
+    LatencyHistogram histogram;
+    vector<uint64_t> values;
+    for (int i = 0; i < 100000; ++i) {
+        const uint64_t value = static_cast<uint64_t>(exp2(uniform_real_distribution<double>(0, 24)(random)));
+        values.push_back(value);
+        histogram.record(value);
+    }
+    sort(values.begin(), values.end());
+    check(histogram.count() == values.size(), "число записей");
+    check(histogram.maxNanoseconds() == values.back(), "максимум точный");
+    for (double quantile : {0.01, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+        const double exact = static_cast<double>(exactPercentile(values, quantile));
+        const double estimate = static_cast<double>(histogram.percentile(quantile));
+        check(fabs(estimate - exact) <= 0.03 * exact, "процентиль " + to_string(quantile));
+    }
+
+    LatencyHistogram small;
+    for (uint64_t value = 0; value < 64; ++value) {
+        small.record(value);
+    }
+    check(small.percentile(0.5) == 31 && small.percentile(1) == 63, "значения до 64 без округления");
+    small.reset();
+    check(small.count() == 0 && small.percentile(0.5) == 0 && small.maxNanoseconds() == 0, "сброс гистограммы");
+
+    // Запись из нескольких потоков без блокировок
+    LatencyHistogram shared;
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared, t] {
+            for (uint64_t i = 0; i < 50000; ++i) {
+                shared.record(100 + t * 1000 + i % 500);
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    check(shared.count() == 200000, "параллельная запись: число записей");
+    check(shared.maxNanoseconds() == 3100 + 499, "параллельная запись: максимум");
+
+    // Операции ядра учитываются только при включенной статистике
+    OperationMetrics& metrics = OperationMetrics::instance();
+    metrics.reset();
+    PipelineCore core;
+    core.addPipe("До включения", 1, 500);
+    check(metrics.collect().empty(), "выключенная статистика ничего не считает");
+    metrics.setEnabled(true);
+    for (int i = 0; i < 10; ++i) {
+        core.addPipe("Труба", 1, 500);
+    }
+    core.findPipesByName("труба");
+    const int from = core.addStation("Начало", 2, 1, 1);
+    const int to = core.addStation("Конец", 2, 1, 1);
+    core.connectObjects(from, to, 500);  // свободной трубой, без add_pipe
+    core.findPath(from, to);
+    core.findAlternativeRoutes(from, to, 3);
+    metrics.setEnabled(false);
+    core.addPipe("После выключения", 1, 500);
+    const vector<OperationStats> all = metrics.collect();
+    const OperationStats* added = statsOf(all, Operation::AddPipe);
+    check(added != nullptr && added->count == 10, "add_pipe: 10 вызовов");
+    check(added != nullptr && added->p50 <= added->p99 && added->p99 <= added->max, "процентили по порядку");
+    check(statsOf(all, Operation::FindPipes) != nullptr, "find_pipes учтен");
+    // Альтернативные маршруты не смешиваются с кратчайшим путем
+    const OperationStats* path = statsOf(all, Operation::FindPath);
+    const OperationStats* routes = statsOf(all, Operation::AltRoutes);
+    check(path != nullptr && path->count == 1, "find_path: 1 вызов");
+    check(routes != nullptr && routes->count == 1, "alt_routes: 1 вызов");
+
+    ostringstream prometheus;
+    metrics.writePrometheus(prometheus);
+    const string text = prometheus.str();
+    check(text.find("pipeline_operation_seconds_count{operation=\"add_pipe\"} 10\n") != string::npos,
+          "Prometheus: число вызовов");
+    check(text.find("pipeline_operation_seconds{operation=\"add_pipe\",quantile=\"0.99\"}") != string::npos,
+          "Prometheus: квантиль");
+    check(text.find("operation=\"load\"") == string::npos, "Prometheus: невызывавшиеся операции пропущены");
+    metrics.reset();
+    check(metrics.collect().empty(), "сброс статистики");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
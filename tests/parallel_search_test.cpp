@@ -0,0 +1,100 @@
+// Проверка параллельных поисков труб и КС: на наборе, который заведомо
+// делится на куски, результаты совпадают с последовательным просмотром
+// (поиск по названию - как toLower + find), в том числе порядок индексов.
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+string lower(string text) {
+    transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+vector<int> scan(size_t count, const function<bool(size_t)>& match) {
+    vector<int> result;
+    for (size_t i = 0; i < count; ++i) {
+        if (match(i)) {
+            result.push_back(static_cast<int>(i));
+        }
+    }
+    return result;
+}
+
+}
+
+int main() {
+    // Латиница в разном регистре и кириллица, которую tolower не меняет
+    const vector<string> words = {"Main", "MAIN line", "main-2", "Магистраль", "магистраль", "Отвод A", "отвод a", "x"};
+    mt19937 random(13);
+    PipelineCore core;
+    const size_t count = 40000;
+    for (size_t i = 0; i < count; ++i) {
+        const string name = words[random() % words.size()] + " " + to_string(random() % 1000);
+        core.addPipe(name, 1 + random() % 50, 500);
+        if (i % 4 == 0) {
+            core.addStation(name, 10, static_cast<int>(random() % 11), 1);
+        }
+    }
+    for (size_t i = 0; i < count; i += 1 + random() % 5) {
+        core.setPipeRepair(core.getPipes()[i].id, true);
+    }
+    const auto& pipes = core.getPipes();
+    const auto& stations = core.getStations();
+
+    for (const string pattern : {"main", "MAIN", "ain-", "Магистраль", "отвод A", "99", "", "нет такого"}) {
+        const string needle = lower(pattern);
+        check(core.findPipesByName(pattern) == scan(pipes.size(), [&](size_t i) {
+                  return lower(pipes[i].name.str()).find(needle) != string::npos;
+              }), "трубы по названию \"" + pattern + "\"");
+        check(core.findStationsByName(pattern) == scan(stations.size(), [&](size_t i) {
+                  return lower(stations[i].name.str()).find(needle) != string::npos;
+              }), "КС по названию \"" + pattern + "\"");
+    }
+    for (bool flag : {false, true}) {
+        check(core.findPipesByRepairStatus(flag) ==
+                  scan(pipes.size(), [&](size_t i) { return pipes[i].underRepair == flag; }),
+              "трубы по ремонту");
+        check(core.findPipesByUseStatus(flag) == scan(pipes.size(), [&](size_t i) { return pipes[i].inUse == flag; }),
+              "трубы по использованию");
+    }
+    for (int comparison : {1, 2, 3}) {
+        check(core.findStationsByInactivePercent(50, comparison) == scan(stations.size(), [&](size_t i) {
+                  const double percent = PipelineCore::calculateInactivePercent(stations[i]);
+                  return comparison == 1 ? percent > 50 : comparison == 2 ? percent < 50 : fabs(percent - 50) < 0.01;
+              }), "КС по проценту простоя, сравнение " + to_string(comparison));
+    }
+
+    // Малый набор просматривается в вызывающем потоке с тем же результатом
+    PipelineCore small;
+    small.addPipe("Main", 1, 500);
+    small.addPipe("другая", 1, 500);
+    small.addPipe("MAINLINE", 1, 500);
+    check(small.findPipesByName("main") == vector<int>({0, 2}), "малый набор");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
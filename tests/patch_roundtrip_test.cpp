@@ -0,0 +1,156 @@
+// Проверка патчей: apply(diff(a, b), a) == b, включая порядок записей.
+// Состояния сравниваются по тексту сохранения, где порядок виден целиком.
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+string savedText(const PipelineCore& core) {
+    ostringstream out;
+    core.saveToStream(out);
+    return out.str();
+}
+
+void checkRoundTrip(const PipelineCore& from, const PipelineCore& to, const string& what) {
+    const string patchFile = "patch_roundtrip_test.patch";
+    DiffSummary summary;
+    check(from.savePatch(to, patchFile, summary), what + ": запись патча");
+    PipelineCore patched = from;
+    check(patched.applyPatch(patchFile) == PatchStatus::Ok, what + ": применение патча");
+    check(savedText(patched) == savedText(to), what + ": состояние после патча");
+    remove(patchFile.c_str());
+}
+
+// Записи секции в файле сохранения занимают фиксированное число строк;
+// перестановка записей дает то же содержимое в другом порядке
+PipelineCore shuffledCopy(const PipelineCore& core, mt19937& random) {
+    istringstream in(savedText(core));
+    vector<string> lines;
+    for (string line; getline(in, line);) {
+        lines.push_back(line);
+    }
+    ostringstream out;
+    size_t i = 0;
+    while (i < lines.size()) {
+        const string& header = lines[i];
+        out << header << '\n';
+        ++i;
+        size_t recordLines = 0;
+        if (header.rfind("PIPES ", 0) == 0) {
+            recordLines = 10;
+        } else if (header.rfind("STATIONS ", 0) == 0) {
+            recordLines = 5;
+        } else if (header.rfind("NETWORK ", 0) == 0) {
+            recordLines = 5;
+        }
+        if (recordLines == 0) {
+            continue;
+        }
+        const size_t count = stoul(header.substr(header.find(' ') + 1));
+        vector<size_t> order(count);
+        for (size_t k = 0; k < count; ++k) {
+            order[k] = k;
+        }
+        shuffle(order.begin(), order.end(), random);
+        for (size_t k : order) {
+            for (size_t line = 0; line < recordLines; ++line) {
+                out << lines[i + k * recordLines + line] << '\n';
+            }
+        }
+        i += count * recordLines;
+    }
+
+    const string file = "patch_roundtrip_test.txt";
+    ofstream(file) << out.str();
+    PipelineCore result;
+    check(result.loadFromFile(file) == LoadStatus::Ok, "загрузка переставленного состояния");
+    remove(file.c_str());
+    return result;
+}
+
+void randomEdits(PipelineCore& core, mt19937& random, int steps) {
+    auto pick = [&random](int limit) { return 1 + static_cast<int>(random() % limit); };
+    for (int step = 0; step < steps; ++step) {
+        const int limit = max(core.getNextPipeId(), core.getNextStationId());
+        switch (random() % 8) {
+            case 0: core.addStation("КС " + to_string(step), 4, 2, 1); break;
+            case 1: core.addPipe("Труба " + to_string(step), 1.25 + step, 500); break;
+            case 2: core.connectObjects(pick(limit), pick(limit), 500); break;
+            case 3: core.connectWithNewPipe(pick(limit), pick(limit), 700, "Новая", 3.5); break;
+            case 4: core.disconnectPipe(pick(limit)); break;
+            case 5: core.setPipeRepair(pick(limit), random() % 2 == 0); break;
+            case 6: core.updateStation(pick(limit), "Изменена", 5, 2); break;
+            default: {
+                // Разрыв и повторное соединение переносят соединение в конец
+                const auto& network = core.getNetwork();
+                if (!network.empty()) {
+                    const Pipe pipe = core.getPipes()[core.findPipeIndexById(network[random() % network.size()].pipeId)];
+                    core.disconnectPipe(pipe.id);
+                    core.connectObjects(pipe.startId, pipe.endId, 500);
+                }
+                break;
+            }
+        }
+    }
+}
+
+}
+
+int main() {
+    // Случай из ревью: соединение разорвано и восстановлено с теми же полями
+    PipelineCore base;
+    for (int i = 0; i < 4; ++i) {
+        base.addStation("КС", 3, 1, 1);
+        base.addPipe("Труба", 2, 500);
+    }
+    base.connectObjects(1, 2, 500);
+    base.connectObjects(2, 3, 500);
+    base.connectObjects(3, 4, 500);
+    PipelineCore moved = base;
+    moved.disconnectPipe(1);
+    moved.connectObjects(1, 2, 500);
+    check(savedText(moved) != savedText(base), "соединение перенесено в конец");
+    checkRoundTrip(moved, base, "возврат соединения на место");
+    checkRoundTrip(base, moved, "перенос соединения в конец");
+
+    mt19937 random(2024);
+    for (int round = 0; round < 200; ++round) {
+        PipelineCore ancestor;
+        randomEdits(ancestor, random, 40);
+        PipelineCore a = ancestor;
+        PipelineCore b = ancestor;
+        randomEdits(a, random, static_cast<int>(random() % 20));
+        randomEdits(b, random, static_cast<int>(random() % 20));
+        if (round % 3 == 0) {
+            b = shuffledCopy(b, random);
+        }
+        const string what = "случайные состояния, раунд " + to_string(round);
+        checkRoundTrip(a, b, what);
+        checkRoundTrip(b, a, what + " (обратно)");
+    }
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
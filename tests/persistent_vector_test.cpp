@@ -0,0 +1,148 @@
+// Проверка PersistentVector на случайных изменениях: каждая сохраненная
+// версия совпадает со своей моделью в std::vector и после изменений копий,
+// удаления из середины не ломают поиск по дереву, запись не копирует блоки,
+// общие с другими версиями, кроме изменяемого.
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PersistentVector.h"
+#include "pipeline_core/PipelineTypes.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+// Небольшие блоки, чтобы дерево было высоким уже на тысячах элементов
+using Vector = PersistentVector<NetworkConnection, 4>;
+
+NetworkConnection connection(int id) {
+    return {id};
+}
+
+bool same(const Vector& vector, const std::vector<int>& model) {
+    if (vector.size() != model.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < model.size(); ++i) {
+        if (vector[i].pipeId != model[i]) {
+            return false;
+        }
+    }
+    size_t i = 0;
+    for (const auto& conn : vector) {
+        if (conn.pipeId != model[i++]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main() {
+    mt19937 random(3);
+    Vector vector;
+    std::vector<int> model;
+    std::vector<Vector> versions;
+    std::vector<std::vector<int>> models;
+    int nextId = 1;
+    for (int step = 0; step < 6000; ++step) {
+        const int operation = random() % 10;
+        if (operation < 5 || model.empty()) {
+            vector.push_back(connection(nextId));
+            model.push_back(nextId++);
+        } else if (operation < 7) {
+            const size_t at = random() % model.size();
+            vector.erase(at);
+            model.erase(model.begin() + at);
+        } else if (operation < 8) {
+            const size_t at = random() % model.size();
+            vector.mutableAt(at) = connection(nextId);
+            model[at] = nextId++;
+        } else if (operation < 9) {
+            const int divisor = 2 + random() % 40;
+            const int rest = random() % divisor;
+            const size_t removed = vector.removeIf([&](const NetworkConnection& conn) {
+                return conn.pipeId % divisor == rest;
+            });
+            const size_t before = model.size();
+            model.erase(remove_if(model.begin(), model.end(), [&](int id) { return id % divisor == rest; }),
+                        model.end());
+            check(removed == before - model.size(), "removeIf возвращает число удаленных");
+        } else {
+            vector.popBack();
+            model.pop_back();
+        }
+        if (step % 97 == 0) {
+            versions.push_back(vector);
+            models.push_back(model);
+        }
+    }
+    check(same(vector, model), "текущая версия");
+    for (size_t v = 0; v < versions.size(); ++v) {
+        check(same(versions[v], models[v]), "сохраненная версия " + to_string(v));
+    }
+
+    // Произвольный доступ итератором
+    const auto begin = vector.begin();
+    for (size_t i = 0; i < model.size(); i += 7) {
+        check(begin[i].pipeId == model[i] && (vector.end() - (model.size() - i))->pipeId == model[i],
+              "итератор + " + to_string(i));
+    }
+    // Алгоритмы разыменовывают копии итератора: блок должен найтись и у копии
+    for (size_t i = 0; i < model.size(); i += 13) {
+        const int id = model[i];
+        auto it = find_if(vector.begin(), vector.end(), [id](const NetworkConnection& conn) {
+            return conn.pipeId == id;
+        });
+        check(it - vector.begin() == static_cast<ptrdiff_t>(i), "find_if " + to_string(id));
+    }
+
+    // Удаление всего из середины и с краев до пустого вектора
+    Vector drained = vector;
+    std::vector<int> drainedModel = model;
+    while (!drainedModel.empty()) {
+        const size_t at = drainedModel.size() / 2;
+        drained.erase(at);
+        drainedModel.erase(drainedModel.begin() + at);
+        if (drainedModel.size() % 50 == 0) {
+            check(same(drained, drainedModel), "удаление до " + to_string(drainedModel.size()));
+        }
+    }
+    check(drained.empty() && same(vector, model), "опустошенная копия не меняет оригинал");
+    drained.push_back(connection(1));
+    check(drained.size() == 1 && drained[0].pipeId == 1, "добавление после опустошения");
+
+    // Запись после снимка выделяет память под путь к блоку, а не под все
+    // блоки: прежде копировался массив из 7813 указателей (125 КБ)
+    PersistentVector<NetworkConnection> large;
+    for (int i = 0; i < 1000000; ++i) {
+        large.push_back(connection(i));
+    }
+    const PersistentVector<NetworkConnection> snapshot = large;
+    MemoryTracker& memory = MemoryTracker::instance();
+    const size_t before = memory.reserved(MemoryCategory::Network);
+    large.mutableAt(500000).pipeId = -1;
+    const size_t added = memory.reserved(MemoryCategory::Network) - before;
+    check(added < 8192, "запись после снимка: " + to_string(added) + " байт");
+    check(snapshot[500000].pipeId == 500000 && large[500000].pipeId == -1, "снимок не видит записи");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Проверка кэша результатов: LruCache вытесняет давние записи и учитывает
+// память, повторный findPath и topologicalSort отвечаются из кэша, а любое
+// изменение (в том числе в разошедшихся копиях ядра) дает свежий ответ.
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/LruCache.h"
+#include "pipeline_core/MemoryAccounting.h"
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+bool samePath(const PathResult& a, const PathResult& b) {
+    return a.status == b.status && a.nodes == b.nodes && a.pipeIds == b.pipeIds && a.totalLength == b.totalLength;
+}
+
+}
+
+int main() {
+    MemoryTracker& tracker = MemoryTracker::instance();
+    const size_t otherBefore = tracker.reserved(MemoryCategory::Other);
+    {
+        LruCache<int, string> cache(100);
+        cache.insert(1, "один", 40);
+        cache.insert(2, "два", 40);
+        check(cache.find(1) != nullptr, "запись найдена");
+        cache.insert(3, "три", 40);  // вытесняется 2 - давняя после обращения к 1
+        check(cache.find(2) == nullptr && cache.find(1) != nullptr && cache.find(3) != nullptr, "вытеснена давняя");
+        check(cache.evictions() == 1 && cache.size() == 2 && cache.bytesUsed() == 80, "счетчики после вытеснения");
+        check(tracker.reserved(MemoryCategory::Other) == otherBefore + 80, "память записей учтена");
+        cache.insert(1, "один снова", 10);
+        check(cache.bytesUsed() == 50 && *cache.find(1) == "один снова", "замена записи с тем же ключом");
+        cache.insert(4, "огромная", 101);
+        check(cache.find(4) == nullptr && cache.size() == 2, "запись дороже кэша не хранится");
+        check(cache.hits() == 4 && cache.misses() == 2, "попадания и промахи");
+    }
+    check(tracker.reserved(MemoryCategory::Other) == otherBefore, "память кэша возвращена");
+
+    // Короткая цепочка А -> Б -> В и длинный обход А -> Г -> В
+    PipelineCore core;
+    const int a = core.addStation("А", 2, 1, 1);
+    const int b = core.addStation("Б", 2, 1, 1);
+    const int c = core.addStation("В", 2, 1, 1);
+    const int d = core.addStation("Г", 2, 1, 1);
+    const int ab = core.connectWithNewPipe(a, b, 500, "АБ", 1).pipeId;
+    core.connectWithNewPipe(b, c, 500, "БВ", 1);
+    core.connectWithNewPipe(a, d, 500, "АГ", 5);
+    core.connectWithNewPipe(d, c, 500, "ГВ", 5);
+    core.clearQueryCache();
+
+    const PathResult first = core.findPath(a, c);
+    const PathResult again = core.findPath(a, c);
+    QueryCacheStats stats = core.getQueryCacheStats();
+    check(samePath(first, again) && first.nodes.size() == 3, "повтор дает тот же путь");
+    check(stats.misses == 1 && stats.hits == 1 && stats.entries == 1 && stats.bytes > 0, "второй запрос из кэша");
+    core.topologicalSort();
+    const TopoSortResult order = core.topologicalSort();
+    stats = core.getQueryCacheStats();
+    check(stats.hits == 2 && stats.entries == 2 && order.order.size() == 4, "сортировка из кэша");
+
+    // Копия делит кэш, пока не изменена; изменения расходятся независимо
+    PipelineCore left = core;
+    PipelineCore right = core;
+    check(samePath(left.findPath(a, c), first) && left.getQueryCacheStats().hits == 3, "копия видит кэш ядра");
+    left.disconnectPipe(ab);
+    right.connectWithNewPipe(a, c, 500, "АВ", 1);
+    const PathResult detour = left.findPath(a, c);
+    const PathResult direct = right.findPath(a, c);
+    check(detour.status == PathStatus::Found && detour.nodes == vector<int>({a, d, c}), "после разрыва - обход");
+    check(direct.status == PathStatus::Found && direct.nodes == vector<int>({a, c}), "другая копия - прямая труба");
+    check(samePath(core.findPath(a, c), first), "исходное ядро отвечает прежним путем");
+    check(left.topologicalSort().order.size() == 4, "сортировка изменившейся копии");
+
+    core.clearQueryCache();
+    stats = core.getQueryCacheStats();
+    check(stats.hits == 0 && stats.misses == 0 && stats.entries == 0 && stats.bytes == 0, "очистка кэша");
+    check(samePath(core.findPath(a, c), first), "после очистки результат тот же");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
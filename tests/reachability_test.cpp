@@ -0,0 +1,129 @@
+// Проверка индекса достижимости: ответы с замыканием и без него (больше
+// MAX_CLOSURE_COMPONENTS компонент) совпадают с обходом сети, а запросы из
+// нескольких потоков получают один общий индекс.
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_core/NetworkIslands.h"
+#include "pipeline_core/PipelineCore.h"
+#include "pipeline_core/ReachabilityIndex.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+// Случайная сеть КС: дуги вперед по номеру и изредка короткие назад - циклы
+// из нескольких соседних КС, так что компонент почти столько же, сколько КС.
+// Дуги - подключенные трубы.
+vector<Pipe> randomNetwork(int stations, int arcs, mt19937& random) {
+    vector<Pipe> network;
+    for (int i = 0; i < arcs; ++i) {
+        int from = 1 + random() % stations;
+        int to = 1 + random() % stations;
+        if (from == to) {
+            continue;
+        }
+        if (from > to && (from - to > 4 || random() % 10 != 0)) {
+            swap(from, to);
+        }
+        Pipe pipe{};
+        pipe.id = i + 1;
+        pipe.startId = from;
+        pipe.endId = to;
+        pipe.inUse = true;
+        pipe.startType = STATION_TO_STATION;
+        pipe.endType = STATION_TO_STATION;
+        network.push_back(pipe);
+    }
+    return network;
+}
+
+bool walk(const vector<vector<int>>& next, int from, int to) {
+    vector<char> seen(next.size(), 0);
+    vector<int> frontier = {from};
+    seen[from] = 1;
+    while (!frontier.empty()) {
+        const int node = frontier.back();
+        frontier.pop_back();
+        if (node == to) {
+            return true;
+        }
+        for (int other : next[node]) {
+            if (!seen[other]) {
+                seen[other] = 1;
+                frontier.push_back(other);
+            }
+        }
+    }
+    return false;
+}
+
+void compareWithWalk(int stations, int arcs, bool expectClosure, mt19937& random) {
+    const vector<Pipe> pipes = randomNetwork(stations, arcs, random);
+    vector<vector<int>> next(stations + 1);
+    vector<NetworkConnection> connections;
+    for (const auto& pipe : pipes) {
+        next[pipe.startId].push_back(pipe.endId);
+        connections.push_back({pipe.id});
+    }
+    const ReachabilityIndex index{PersistentVector<NetworkConnection>(connections), PersistentVector<Pipe>(pipes)};
+    const string size = to_string(stations) + " КС";
+    check(index.hasClosure() == expectClosure, size + ": замыкание только до предела компонент");
+    for (int query = 0; query < 400; ++query) {
+        const int from = 1 + random() % stations;
+        const int to = query % 4 == 0 ? from : 1 + random() % stations;
+        const bool expected = walk(next, from, to);
+        const bool actual = index.canReach(NetworkIslands::nodeIndex(from, true), NetworkIslands::nodeIndex(to, true));
+        check(actual == expected, size + ": " + to_string(from) + " -> " + to_string(to));
+    }
+}
+
+}
+
+int main() {
+    mt19937 random(5);
+    compareWithWalk(300, 500, true, random);
+    compareWithWalk(ReachabilityIndex::MAX_CLOSURE_COMPONENTS + 4000, 30000, false, random);
+
+    // Первые запросы из нескольких потоков к одной версии: индекс строится один раз
+    PipelineCore core;
+    vector<int> ids;
+    for (int i = 0; i < 200; ++i) {
+        ids.push_back(core.addStation("КС", 2, 1, 1));
+    }
+    for (int i = 0; i + 1 < 200; ++i) {
+        core.connectWithNewPipe(ids[i], ids[i + 1], 500, "Труба", 1);
+    }
+    vector<shared_ptr<const ReachabilityIndex>> seen(4);
+    vector<thread> threads;
+    for (size_t t = 0; t < seen.size(); ++t) {
+        threads.emplace_back([&, t] { seen[t] = core.getReachabilityIndex(); });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    for (const auto& index : seen) {
+        check(index == seen[0], "все потоки получили один индекс");
+    }
+    check(core.canReach(ids[0], ids[199]) && !core.canReach(ids[199], ids[0]), "направление соединений");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Проверка поиска обходных маршрутов (Йен с A*): на случайных малых сетях
+// длины найденных маршрутов совпадают с k наименьшими длинами из перебора
+// всех простых путей, трубы в ремонте не используются.
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+struct Arc {
+    int target;
+    int pipeId;
+    double length;
+};
+
+// Длины всех простых путей from -> to по соединениям рабочих труб
+void allPaths(const map<int, vector<Arc>>& next, int node, int to, double length, set<int>& visited,
+              vector<double>& lengths) {
+    if (node == to) {
+        lengths.push_back(length);
+        return;
+    }
+    auto arcs = next.find(node);
+    if (arcs == next.end()) {
+        return;
+    }
+    for (const Arc& arc : arcs->second) {
+        if (visited.insert(arc.target).second) {
+            allPaths(next, arc.target, to, length + arc.length, visited, lengths);
+            visited.erase(arc.target);
+        }
+    }
+}
+
+// Маршрут - простой путь from -> to по рабочим трубам, длина - сумма длин труб
+bool validRoute(const PipelineCore& core, const Route& route, int from, int to) {
+    if (route.nodes.size() != route.pipeIds.size() + 1 || route.nodes.front() != from || route.nodes.back() != to) {
+        return false;
+    }
+    if (set<int>(route.nodes.begin(), route.nodes.end()).size() != route.nodes.size()) {
+        return false;
+    }
+    double length = 0;
+    for (size_t i = 0; i < route.pipeIds.size(); ++i) {
+        const Pipe& pipe = core.getPipes()[core.findPipeIndexById(route.pipeIds[i])];
+        if (pipe.underRepair || pipe.startId != route.nodes[i] || pipe.endId != route.nodes[i + 1]) {
+            return false;
+        }
+        length += pipe.length;
+    }
+    return fabs(length - route.totalLength) < 1e-9;
+}
+
+}
+
+int main() {
+    mt19937 random(3);
+    for (int trial = 0; trial < 60; ++trial) {
+        PipelineCore core;
+        vector<int> ids;
+        for (int i = 0; i < 8; ++i) {
+            ids.push_back(core.addStation("КС " + to_string(i), 3, 1, 1));
+        }
+        for (int arc = 0; arc < 22; ++arc) {
+            const int a = ids[random() % ids.size()];
+            const int b = ids[random() % ids.size()];
+            if (a != b) {
+                core.connectWithNewPipe(a, b, 500, "Труба", 1 + random() % 20 * 0.5);
+            }
+        }
+        for (const auto& conn : core.getNetwork()) {
+            if (random() % 6 == 0) {
+                core.setPipeRepair(conn.pipeId, true);
+            }
+        }
+
+        map<int, vector<Arc>> next;
+        for (const Pipe& pipe : core.getPipes()) {
+            if (pipe.inUse && !pipe.underRepair) {
+                next[pipe.startId].push_back({pipe.endId, pipe.id, pipe.length});
+            }
+        }
+        const int from = ids[0];
+        const int to = ids[1 + trial % 7];
+        vector<double> expected;
+        set<int> visited = {from};
+        allPaths(next, from, to, 0, visited, expected);
+        sort(expected.begin(), expected.end());
+
+        const size_t k = 1 + trial % 6;
+        const RoutesResult result = core.findAlternativeRoutes(from, to, k);
+        const string what = "сеть " + to_string(trial);
+        if (expected.empty()) {
+            check(result.status == PathStatus::NoPath || result.status == PathStatus::NotInNetwork,
+                  what + ": пути нет");
+            continue;
+        }
+        check(result.status == PathStatus::Found, what + ": маршрут найден");
+        check(result.routes.size() == min(k, expected.size()), what + ": число маршрутов");
+        set<vector<int>> distinct;
+        for (size_t i = 0; i < result.routes.size(); ++i) {
+            const Route& route = result.routes[i];
+            check(validRoute(core, route, from, to), what + ": маршрут " + to_string(i) + " корректен");
+            check(fabs(route.totalLength - expected[i]) < 1e-9, what + ": длина маршрута " + to_string(i));
+            distinct.insert(route.pipeIds);
+        }
+        check(distinct.size() == result.routes.size(), what + ": маршруты различны");
+    }
+
+    // Ремонт трубы кратчайшего маршрута: следующий запрос идет в обход
+    PipelineCore core;
+    const int a = core.addStation("А", 2, 1, 1);
+    const int b = core.addStation("Б", 2, 1, 1);
+    const int c = core.addStation("В", 2, 1, 1);
+    const int direct = core.connectWithNewPipe(a, c, 500, "Прямая", 5).pipeId;
+    core.connectWithNewPipe(a, b, 500, "Первая", 4);
+    core.connectWithNewPipe(b, c, 500, "Вторая", 4);
+    RoutesResult routes = core.findAlternativeRoutes(a, c, 3);
+    check(routes.routes.size() == 2 && routes.routes[0].pipeIds == vector<int>({direct}), "прямая короче обхода");
+    core.setPipeRepair(direct, true);
+    routes = core.findAlternativeRoutes(a, c, 3);
+    check(routes.routes.size() == 1 && routes.routes[0].totalLength == 8, "в ремонте - только обход");
+    check(core.findAlternativeRoutes(a, 12345, 3).status == PathStatus::EndNotFound, "нет конечной точки");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Проверка роста пула строк: новые номера и память только для различных
+// строк, повторы (в том числе из разных потоков) пул не увеличивают.
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_core/StringPool.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+}
+
+int main() {
+    check(StringPool::intern("") == 0, "пустая строка - номер 0");
+
+    vector<string> names;
+    size_t textBytes = 0;
+    for (int i = 0; i < 100000; ++i) {
+        names.push_back("Магистраль " + to_string(i));
+        textBytes += names.back().size();
+    }
+
+    const size_t countBefore = StringPool::stringCount();
+    const size_t bytesBefore = StringPool::bytesUsed();
+    vector<uint32_t> handles;
+    for (const string& name : names) {
+        handles.push_back(StringPool::intern(name));
+    }
+    check(StringPool::stringCount() == countBefore + names.size(), "по номеру на каждую новую строку");
+    check(StringPool::bytesUsed() == bytesBefore + textBytes + names.size() * sizeof(uint32_t),
+          "текст и длина каждой новой строки");
+    for (size_t i = 0; i < names.size(); ++i) {
+        check(StringPool::view(handles[i]) == names[i], "строка по номеру " + to_string(i));
+    }
+
+    // Повторы из нескольких потоков получают прежние номера
+    vector<thread> threads;
+    vector<int> mismatches(4, 0);
+    for (size_t t = 0; t < mismatches.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < names.size(); i += 3) {
+                mismatches[t] += StringPool::intern(names[i]) != handles[i];
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+    for (int count : mismatches) {
+        check(count == 0, "повторное интернирование дает тот же номер");
+    }
+    check(StringPool::stringCount() == countBefore + names.size(), "повторы не добавляют строк");
+    check(StringPool::bytesUsed() == bytesBefore + textBytes + names.size() * sizeof(uint32_t),
+          "повторы не добавляют памяти");
+    check(StringPool::stringCount() <= StringPool::MAX_STRINGS, "в пределах MAX_STRINGS");
+
+    // tryIntern выдает те же номера, что intern; неудачное assign не меняет название
+    uint32_t handle = 7;
+    check(StringPool::tryIntern("", handle) && handle == 0, "tryIntern: пустая строка");
+    check(StringPool::tryIntern(names[5], handle) && handle == handles[5], "tryIntern: известная строка");
+    check(StringPool::tryIntern("Отвод 1", handle) && StringPool::view(handle) == "Отвод 1", "tryIntern: новая строка");
+    InternedName name("Магистраль 1");
+    check(name.assign("Отвод 1") && name == InternedName("Отвод 1"), "assign меняет название");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
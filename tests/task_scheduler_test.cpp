@@ -0,0 +1,208 @@
+// Проверка планировщика задач: задачи занятого потока перехватываются
+// другими, TaskGroup::wait дожидается вложенных задач и передает
+// исключение, parallelFor и parallelFilter дают тот же результат, что
+// последовательный просмотр, TaskGraph соблюдает порядок зависимостей.
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_core/TaskScheduler.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+// Ожидание без выполнения чужих задач: работу занятого потока может
+// сделать только другой поток
+void spinUntil(const atomic<int>& value, int expected) {
+    while (value.load() != expected) {
+        this_thread::yield();
+    }
+}
+
+void checkStealing(TaskScheduler& scheduler) {
+    const int children = 64;
+    atomic<int> done{0};
+    atomic<int> stolen{0};
+    atomic<bool> parentFinished{false};
+    scheduler.spawn([&]() {
+        const thread::id parent = this_thread::get_id();
+        // Порожденные задачи попадают в очередь этого потока, а он сам их не берет
+        for (int i = 0; i < children; ++i) {
+            scheduler.spawn([&, parent]() {
+                stolen += this_thread::get_id() != parent;
+                ++done;
+            });
+        }
+        spinUntil(done, children);
+        parentFinished = true;
+    });
+    spinUntil(done, children);
+    while (!parentFinished) {
+        this_thread::yield();
+    }
+    check(stolen == children, "задачи занятого потока выполнены другими потоками");
+}
+
+void checkGroupWait(TaskScheduler& scheduler, const string& name) {
+    atomic<int> count{0};
+    TaskGroup outer(scheduler);
+    for (int i = 0; i < 50; ++i) {
+        outer.run([&]() {
+            // Вложенная группа внутри задачи: ожидающий поток выполняет задачи сам
+            TaskGroup inner(scheduler);
+            for (int j = 0; j < 20; ++j) {
+                inner.run([&]() { ++count; });
+            }
+            inner.wait();
+        });
+    }
+    outer.wait();
+    check(count == 1000, name + ": wait дожидается всех вложенных задач");
+}
+
+void checkException(TaskScheduler& scheduler) {
+    atomic<int> finished{0};
+    TaskGroup group(scheduler);
+    for (int i = 0; i < 100; ++i) {
+        group.run([&, i]() {
+            if (i == 37) {
+                throw runtime_error("задача 37");
+            }
+            ++finished;
+        });
+    }
+    bool caught = false;
+    try {
+        group.wait();
+    } catch (const runtime_error& error) {
+        caught = string(error.what()) == "задача 37";
+    }
+    check(caught, "исключение задачи передается из wait");
+    check(finished == 99, "остальные задачи группы доработали");
+
+    // Группа без wait дожидается задач в деструкторе, исключение не выходит наружу
+    atomic<int> late{0};
+    {
+        TaskGroup abandoned(scheduler);
+        abandoned.run([]() { throw runtime_error("без wait"); });
+        abandoned.run([&]() { ++late; });
+    }
+    check(late == 1, "деструктор группы дожидается задач");
+
+    // После исключения группа снова пригодна
+    group.run([&]() { ++finished; });
+    group.wait();
+    check(finished == 100, "группа после исключения");
+}
+
+void checkParallelFor(TaskScheduler& scheduler) {
+    vector<atomic<int>> visits(100003);
+    parallelFor(0, visits.size(), 100, [&](size_t first, size_t last) {
+        check(last - first <= 100, "кусок не крупнее grain");
+        for (size_t i = first; i < last; ++i) {
+            ++visits[i];
+        }
+    }, scheduler);
+    bool once = true;
+    for (const auto& count : visits) {
+        once = once && count == 1;
+    }
+    check(once, "parallelFor проходит каждый индекс один раз");
+}
+
+void checkParallelFilter(TaskScheduler& scheduler, const string& name) {
+    const size_t count = 300000;
+    auto match = [](size_t i) { return (i * 2654435761u) % 7 == 3; };
+    vector<int> expected;
+    for (size_t i = 0; i < count; ++i) {
+        if (match(i)) {
+            expected.push_back(static_cast<int>(i));
+        }
+    }
+    // Большая оценка стоимости: просмотр заведомо делится на куски
+    check(parallelFilter(count, 1000, match, scheduler) == expected, name + ": порядок как при просмотре подряд");
+    check(parallelFilter(count, 1000, [](size_t) { return true; }, scheduler).size() == count,
+          name + ": все совпадения");
+    check(parallelFilter(100, 1, match, scheduler) ==
+              vector<int>(expected.begin(), lower_bound(expected.begin(), expected.end(), 100)),
+          name + ": малый просмотр");
+}
+
+void checkGraph(TaskScheduler& scheduler) {
+    // Ромб a -> (b, c) -> d и независимая e
+    mutex orderMutex;
+    vector<char> order;
+    auto step = [&](char name) {
+        return [&, name]() {
+            lock_guard<mutex> lock(orderMutex);
+            order.push_back(name);
+        };
+    };
+    TaskGraph graph;
+    const size_t a = graph.add(step('a'));
+    const size_t b = graph.add(step('b'));
+    const size_t c = graph.add(step('c'));
+    const size_t d = graph.add(step('d'));
+    graph.add(step('e'));
+    graph.precede(a, b);
+    graph.precede(a, c);
+    graph.precede(b, d);
+    graph.precede(c, d);
+    check(graph.run(scheduler), "граф без цикла выполнен");
+    auto position = [&](char name) { return find(order.begin(), order.end(), name) - order.begin(); };
+    check(order.size() == 5, "все задачи графа выполнены");
+    check(position('a') < position('b') && position('a') < position('c'), "a раньше b и c");
+    check(position('b') < position('d') && position('c') < position('d'), "d после b и c");
+
+    TaskGraph cyclic;
+    atomic<int> ran{0};
+    const size_t x = cyclic.add([&]() { ++ran; });
+    const size_t y = cyclic.add([&]() { ++ran; });
+    const size_t z = cyclic.add([&]() { ++ran; });
+    cyclic.precede(x, y);
+    cyclic.precede(y, z);
+    cyclic.precede(z, y);
+    check(!cyclic.run(scheduler), "цикл в графе обнаружен");
+    check(ran == 1, "задачи цикла не запускаются");
+}
+
+}
+
+int main() {
+    // Рабочих потоков больше одного и при одном ядре: перехват проверяется всегда
+    TaskScheduler scheduler(3);
+    checkStealing(scheduler);
+    checkGroupWait(scheduler, "три потока");
+    checkException(scheduler);
+    checkParallelFor(scheduler);
+    checkParallelFilter(scheduler, "три потока");
+    checkGraph(scheduler);
+
+    // Без рабочих потоков все задачи выполняет ожидающий поток
+    TaskScheduler single(0);
+    checkGroupWait(single, "без рабочих потоков");
+    checkParallelFilter(single, "без рабочих потоков");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
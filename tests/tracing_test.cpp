@@ -0,0 +1,129 @@
+// Проверка трассы Chrome trace events: выключенная запись ничего не хранит,
+// вложенные отрезки и фазы next() лежат внутри внешнего, события рабочих
+// потоков попадают в трассу со своим tid, start() начинает трассу заново.
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+#include "pipeline_core/Tracing.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+// Событие "X" трассы: время начала и длительность в мкс, поток
+struct TracedSpan {
+    double ts = -1;
+    double dur = -1;
+    int tid = -1;
+};
+
+double numberAfter(const string& line, const string& key) {
+    const size_t at = line.find("\"" + key + "\":");
+    return at == string::npos ? -1 : stod(line.substr(at + key.size() + 3));
+}
+
+// Каждое событие writeChromeTrace пишет отдельной строкой
+vector<TracedSpan> spansNamed(const string& trace, const string& name) {
+    vector<TracedSpan> result;
+    istringstream lines(trace);
+    string line;
+    while (getline(lines, line)) {
+        if (line.find("{\"name\":\"" + name + "\",") == 0 && line.find("\"ph\":\"X\"") != string::npos) {
+            const int tid = static_cast<int>(numberAfter(line, "tid"));
+            result.push_back({numberAfter(line, "ts"), numberAfter(line, "dur"), tid});
+        }
+    }
+    return result;
+}
+
+string traceText() {
+    ostringstream out;
+    TraceRecorder::instance().writeChromeTrace(out);
+    return out.str();
+}
+
+bool inside(const TracedSpan& inner, const TracedSpan& outer) {
+    return inner.ts >= outer.ts && inner.ts + inner.dur <= outer.ts + outer.dur + 0.001;
+}
+
+}
+
+int main() {
+    TraceRecorder& recorder = TraceRecorder::instance();
+    { TraceSpan ignored("до начала"); }
+    check(recorder.eventCount() == 0, "выключенная запись ничего не хранит");
+
+    recorder.start();
+    {
+        TraceSpan outer("внешний");
+        {
+            TraceSpan phase("фаза 1");
+            this_thread::sleep_for(chrono::milliseconds(1));
+            phase.next("фаза 2");
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        vector<thread> workers;
+        for (int t = 0; t < 3; ++t) {
+            workers.emplace_back([] { TraceSpan work("рабочий"); });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        TraceSpan quoted("имя \"в кавычках\"");
+    }
+    PipelineCore core;
+    const int a = core.addStation("А", 2, 1, 1);
+    const int b = core.addStation("Б", 2, 1, 1);
+    core.connectWithNewPipe(a, b, 500, "Труба", 1);
+    core.findAlternativeRoutes(a, b, 2);
+    recorder.stop();
+    { TraceSpan ignored("после остановки"); }
+
+    const string trace = traceText();
+    const vector<TracedSpan> outer = spansNamed(trace, "внешний");
+    const vector<TracedSpan> first = spansNamed(trace, "фаза 1");
+    const vector<TracedSpan> second = spansNamed(trace, "фаза 2");
+    check(outer.size() == 1 && first.size() == 1 && second.size() == 1, "по событию на отрезок и фазу");
+    if (outer.size() == 1 && first.size() == 1 && second.size() == 1) {
+        check(inside(first[0], outer[0]) && inside(second[0], outer[0]), "фазы внутри внешнего отрезка");
+        check(first[0].ts + first[0].dur <= second[0].ts + 0.001, "фаза 2 после фазы 1");
+        check(first[0].dur >= 1000 && second[0].dur >= 1000, "длительность в микросекундах");
+    }
+    const vector<TracedSpan> work = spansNamed(trace, "рабочий");
+    set<int> threads;
+    for (const TracedSpan& span : work) {
+        threads.insert(span.tid);
+    }
+    check(work.size() == 3 && threads.size() == 3, "события рабочих потоков со своими tid");
+    check(outer.size() == 1 && threads.count(outer[0].tid) == 0, "tid рабочих отличны от основного");
+    check(trace.find("\"имя \\\"в кавычках\\\"\"") != string::npos, "кавычки в имени экранируются");
+    check(!spansNamed(trace, "findAlternativeRoutes").empty(), "отрезки операций ядра");
+    check(spansNamed(trace, "после остановки").empty() && spansNamed(trace, "до начала").empty(),
+          "вне записи событий нет");
+    check(trace.find("\"droppedEvents\":0") != string::npos, "потерянных событий нет");
+
+    recorder.start();
+    recorder.stop();
+    check(recorder.eventCount() == 0 && spansNamed(traceText(), "внешний").empty(), "start начинает трассу заново");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}
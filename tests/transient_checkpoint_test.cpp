@@ -0,0 +1,153 @@
+// Проверка контрольных точек переходного режима: восстановление в модель с
+// другим числом потоков (другой нумерацией узлов) продолжает тот же расчет,
+// испорченные файлы и недопустимые настройки отклоняются.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pipeline_core/PipelineCore.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+// Цепочка КС с ответвлениями: длинные трубы и короткие ячейки дают больше
+// 40000 узлов, так что при двух потоках узлы нумеруются по двум частям
+PipelineCore makeNetwork() {
+    PipelineCore core;
+    vector<int> chain;
+    for (int i = 0; i < 6; ++i) {
+        chain.push_back(core.addStation("КС " + to_string(i), 4, 2, 1));
+    }
+    for (size_t i = 0; i + 1 < chain.size(); ++i) {
+        core.connectWithNewPipe(chain[i], chain[i + 1], 1000, "Магистраль", 400);
+    }
+    const int branch = core.addStation("Отвод", 2, 0, 1);
+    core.connectWithNewPipe(chain[2], branch, 700, "Отвод", 100);
+    return core;
+}
+
+TransientSettings settingsFor(size_t threads) {
+    TransientSettings settings;
+    settings.flow.threads = threads;
+    settings.cellLength = 0.04;
+    settings.timeStep = 120;
+    settings.sampleInterval = 300;
+    return settings;
+}
+
+double largestDifference(const vector<double>& a, const vector<double>& b) {
+    double worst = a.size() == b.size() ? 0 : INFINITY;
+    for (size_t i = 0; i < min(a.size(), b.size()); ++i) {
+        worst = max(worst, fabs(a[i] - b[i]));
+    }
+    return worst;
+}
+
+void writeText(const string& file, const string& text) {
+    ofstream out(file);
+    out << text;
+}
+
+}
+
+int main() {
+    const PipelineCore core = makeNetwork();
+    const int watched = core.getStations()[3].id;
+    const int changed = core.getStations()[1].id;
+    const string file = "transient_checkpoint_test.txt";
+
+    // Эталон: весь расчет одним потоком без перерыва
+    TransientSimulator reference = core.createTransientSimulation(settingsFor(1));
+    check(reference.getNodeCount() > 40000, "узлов хватает для разбиения");
+    reference.watchStation(watched);
+    reference.scheduleWorkshops(900, changed, 4);
+    check(reference.run(1800) == TransientStatus::Ok, "эталонный расчет");
+
+    // Первая половина одним потоком, вторая - после восстановления в модель с двумя
+    TransientSimulator first = core.createTransientSimulation(settingsFor(1));
+    first.watchStation(watched);
+    first.scheduleWorkshops(900, changed, 4);
+    check(first.run(600) == TransientStatus::Ok, "расчет до контрольной точки");
+    check(first.saveCheckpoint(file), "запись контрольной точки");
+
+    TransientSimulator second = core.createTransientSimulation(settingsFor(2));
+    check(second.loadCheckpoint(file) == CheckpointStatus::Ok, "восстановление при другом числе потоков");
+    check(second.getTime() == 600, "время восстановлено");
+    check(second.getSampleTimes() == first.getSampleTimes(), "моменты записи восстановлены");
+    check(second.run(1200) == TransientStatus::Ok, "расчет после восстановления");
+    check(second.getSampleTimes() == reference.getSampleTimes(), "моменты записи совпадают с эталоном");
+    check(!second.getSeries().empty() && !reference.getSeries().empty() &&
+              largestDifference(second.getSeries()[0].values, reference.getSeries()[0].values) < 1e-3,
+          "давление после восстановления совпадает с эталоном");
+
+    // Модель другой сети
+    PipelineCore other = makeNetwork();
+    const int extra = other.addStation("Лишняя", 1, 1, 1);
+    other.connectWithNewPipe(other.getStations()[0].id, extra, 500, "Лишняя", 5);
+    TransientSimulator foreign = other.createTransientSimulation(settingsFor(1));
+    check(foreign.loadCheckpoint(file) == CheckpointStatus::Mismatch, "контрольная точка другой сети");
+
+    // Счетчики, которым не хватает файла, отклоняются до выделения памяти
+    string text;
+    {
+        ifstream in(file);
+        text.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    remove(file.c_str());
+    const size_t events = text.find("EVENTS ");
+    check(events != string::npos, "секция событий записана");
+    const string damaged = text.substr(0, events) + "EVENTS 1000000000000000 0 1 1 1\nSAMPLES 0\nSERIES 0\n";
+    writeText(file, damaged);
+    check(second.loadCheckpoint(file) == CheckpointStatus::BadFormat, "огромное число событий");
+    const size_t samples = text.find("SAMPLES ");
+    writeText(file, text.substr(0, samples) + "SAMPLES 1000000000000000 1 2 3\nSERIES 0\n");
+    check(second.loadCheckpoint(file) == CheckpointStatus::BadFormat, "огромное число моментов записи");
+    const size_t seriesStart = text.find("SERIES ");
+    writeText(file, text.substr(0, seriesStart) + "SERIES 1000000000000000\n1 1 3\n");
+    check(second.loadCheckpoint(file) == CheckpointStatus::BadFormat, "огромное число рядов");
+    writeText(file, text.substr(0, text.size() / 2));
+    check(second.loadCheckpoint(file) == CheckpointStatus::BadFormat, "усеченная контрольная точка");
+    check(second.getTime() == 1800, "отклоненная точка не меняет состояние");
+    remove(file.c_str());
+    check(second.loadCheckpoint(file) == CheckpointStatus::FileNotFound, "нет файла");
+
+    // Нулевой период записи или шаг раньше зацикливали run
+    TransientSettings zero = settingsFor(1);
+    zero.sampleInterval = 0;
+    TransientSimulator stuck = makeNetwork().createTransientSimulation(zero);
+    check(stuck.run(600) == TransientStatus::BadSettings, "нулевой период записи");
+    zero = settingsFor(1);
+    zero.timeStep = -1;
+    stuck = makeNetwork().createTransientSimulation(zero);
+    check(stuck.run(600) == TransientStatus::BadSettings, "отрицательный шаг");
+    check(stuck.getTime() == 0 && stuck.getStepCount() == 0, "с недопустимыми настройками расчета нет");
+
+    // Недостижимая точность: шаги наименьшей длины принимаются, но учитываются
+    TransientSettings strict = settingsFor(1);
+    strict.cellLength = 50;
+    strict.flow.tolerance = -1;
+    TransientSimulator rough = makeNetwork().createTransientSimulation(strict);
+    check(rough.run(0.05) == TransientStatus::NotConverged, "несошедшиеся шаги сообщаются");
+    check(rough.getUnconvergedStepCount() > 0, "несошедшиеся шаги подсчитаны");
+
+    if (failures != 0) {
+        cerr << failures << " проверок не прошло" << endl;
+        return 1;
+    }
+    cout << "OK" << endl;
+    return 0;
+}